@@ -0,0 +1 @@
+#include "../../tinycbor/src/cborschema.h"
@@ -117,6 +117,27 @@ typedef enum CborKnownTags {
     CborBase64Tag                  = 34,
     CborRegularExpressionTag       = 35,
     CborMimeMessageTag             = 36,
+    CborTypedArrayUint8Tag         = 64,
+    CborTypedArrayUint16BETag      = 65,
+    CborTypedArrayUint32BETag      = 66,
+    CborTypedArrayUint64BETag      = 67,
+    CborTypedArrayUint8ClampedTag  = 68,
+    CborTypedArrayUint16LETag      = 69,
+    CborTypedArrayUint32LETag      = 70,
+    CborTypedArrayUint64LETag      = 71,
+    CborTypedArraySint8Tag         = 72,
+    CborTypedArraySint16BETag      = 73,
+    CborTypedArraySint32BETag      = 74,
+    CborTypedArraySint64BETag      = 75,
+    CborTypedArraySint16LETag      = 77,
+    CborTypedArraySint32LETag      = 78,
+    CborTypedArraySint64LETag      = 79,
+    CborTypedArrayFloat16BETag     = 80,
+    CborTypedArrayFloat32BETag     = 81,
+    CborTypedArrayFloat64BETag     = 82,
+    CborTypedArrayFloat16LETag     = 84,
+    CborTypedArrayFloat32LETag     = 85,
+    CborTypedArrayFloat64LETag     = 86,
     CborCOSE_EncryptTag            = 96,
     CborCOSE_MacTag                = 97,
     CborCOSE_SignTag               = 98,
@@ -142,11 +163,47 @@ typedef enum CborKnownTags {
 #define CborBase64Tag CborBase64Tag
 #define CborRegularExpressionTag CborRegularExpressionTag
 #define CborMimeMessageTag CborMimeMessageTag
+#define CborTypedArrayUint8Tag CborTypedArrayUint8Tag
+#define CborTypedArrayUint16BETag CborTypedArrayUint16BETag
+#define CborTypedArrayUint32BETag CborTypedArrayUint32BETag
+#define CborTypedArrayUint64BETag CborTypedArrayUint64BETag
+#define CborTypedArrayUint8ClampedTag CborTypedArrayUint8ClampedTag
+#define CborTypedArrayUint16LETag CborTypedArrayUint16LETag
+#define CborTypedArrayUint32LETag CborTypedArrayUint32LETag
+#define CborTypedArrayUint64LETag CborTypedArrayUint64LETag
+#define CborTypedArraySint8Tag CborTypedArraySint8Tag
+#define CborTypedArraySint16BETag CborTypedArraySint16BETag
+#define CborTypedArraySint32BETag CborTypedArraySint32BETag
+#define CborTypedArraySint64BETag CborTypedArraySint64BETag
+#define CborTypedArraySint16LETag CborTypedArraySint16LETag
+#define CborTypedArraySint32LETag CborTypedArraySint32LETag
+#define CborTypedArraySint64LETag CborTypedArraySint64LETag
+#define CborTypedArrayFloat16BETag CborTypedArrayFloat16BETag
+#define CborTypedArrayFloat32BETag CborTypedArrayFloat32BETag
+#define CborTypedArrayFloat64BETag CborTypedArrayFloat64BETag
+#define CborTypedArrayFloat16LETag CborTypedArrayFloat16LETag
+#define CborTypedArrayFloat32LETag CborTypedArrayFloat32LETag
+#define CborTypedArrayFloat64LETag CborTypedArrayFloat64LETag
 #define CborCOSE_EncryptTag CborCOSE_EncryptTag
 #define CborCOSE_MacTag CborCOSE_MacTag
 #define CborCOSE_SignTag CborCOSE_SignTag
 #define CborSignatureTag CborSignatureTag
 
+/* Typed arrays (RFC 8746): the tag number is 64 | type | (little endian ? 4 : 0) */
+typedef enum CborTypedArrayType {
+    CborTypedArrayUint8             = 0x00,
+    CborTypedArrayUint16            = 0x01,
+    CborTypedArrayUint32            = 0x02,
+    CborTypedArrayUint64            = 0x03,
+    CborTypedArraySint8             = 0x08,
+    CborTypedArraySint16            = 0x09,
+    CborTypedArraySint32            = 0x0a,
+    CborTypedArraySint64            = 0x0b,
+    CborTypedArrayFloat16           = 0x10,
+    CborTypedArrayFloat32           = 0x11,
+    CborTypedArrayFloat64           = 0x12
+} CborTypedArrayType;
+
 /* Error API */
 
 typedef enum CborError {
@@ -167,6 +224,7 @@ typedef enum CborError {
     CborErrorIllegalNumber,
     CborErrorIllegalSimpleType,     /* types of value less than 32 encoded in two bytes */
     CborErrorNoMoreStringChunks,
+    CborErrorNeedMoreData,          /* not an error: more data must be appended to the CborStream */
 
     /* parser errors in strict mode parsing only */
     CborErrorUnknownSimpleType = 512,
@@ -197,12 +255,54 @@ typedef enum CborError {
     CborErrorJsonObjectKeyNotString,
     CborErrorJsonNotImplemented,
 
+    /* errors in schema-driven decoding */
+    CborErrorSchemaTypeMismatch = 1536,
+    CborErrorSchemaMissingKey,
+    CborErrorSchemaTooManyItems,
+
     CborErrorOutOfMemory = (int) (~0U / 2 + 1),
     CborErrorInternalError = (int) (~0U / 2)    /* INT_MAX on two's complement machines */
 } CborError;
 
 CBOR_API const char *cbor_error_string(CborError error);
 
+/* Arena */
+struct CborArenaChunk;
+struct CborArena
+{
+    struct CborArenaChunk *first;
+    struct CborArenaChunk *last;
+    size_t chunk_size;
+    size_t size;
+};
+typedef struct CborArena CborArena;
+
+CBOR_API void cbor_arena_init(CborArena *arena, size_t chunk_size);
+CBOR_INLINE_API size_t cbor_arena_get_size(const CborArena *arena)
+{ return arena->size; }
+CBOR_API void *cbor_arena_alloc(CborArena *arena, size_t size);
+CBOR_API size_t cbor_arena_copy(const CborArena *arena, uint8_t *buffer, size_t size);
+CBOR_API void cbor_arena_free(CborArena *arena);
+
+/* Sequences (RFC 8742) */
+struct CborSequence
+{
+    uint8_t *buffer;
+    size_t size;
+    size_t used;
+    size_t pos;
+    size_t count;
+};
+typedef struct CborSequence CborSequence;
+
+CBOR_API CborError cbor_sequence_init(CborSequence *seq, uint8_t *buffer, size_t size, size_t used);
+CBOR_INLINE_API bool cbor_sequence_at_end(const CborSequence *seq)
+{ return seq->pos == seq->used; }
+CBOR_INLINE_API size_t cbor_sequence_get_count(const CborSequence *seq)
+{ return seq->count; }
+CBOR_API CborError cbor_sequence_append(CborSequence *seq, const void *data, size_t len);
+CBOR_API void cbor_sequence_discard_read(CborSequence *seq);
+
 /* Encoder API */
 
 typedef enum CborEncoderAppendType
@@ -216,7 +316,10 @@ typedef CborError (*CborEncoderWriteFunction)(void *, const void *, size_t, Cbor
 enum CborEncoderFlags
 {
     CborIteratorFlag_WriterFunction         = 0x01,
-    CborIteratorFlag_ContainerIsMap_        = 0x20
+    CborIteratorFlag_MeasureOnly            = 0x02,
+    CborIteratorFlag_ContainerIsMap_        = 0x20,
+
+    CborEncoderFlag_Deterministic           = 0x100
 };
 
 struct CborEncoder
@@ -229,6 +332,7 @@ struct CborEncoder
     uint8_t *end;
     size_t remaining;
     int flags;
+    uint8_t *start;
 };
 typedef struct CborEncoder CborEncoder;
 
@@ -237,6 +341,7 @@ static const size_t CborIndefiniteLength = SIZE_MAX;
 #ifndef CBOR_NO_ENCODER_API
 CBOR_API void cbor_encoder_init(CborEncoder *encoder, uint8_t *buffer, size_t size, int flags);
 CBOR_API void cbor_encoder_init_writer(CborEncoder *encoder, CborEncoderWriteFunction writer, void *);
+CBOR_API void cbor_encoder_init_measure(CborEncoder *encoder, size_t *size, int flags);
 CBOR_API CborError cbor_encode_uint(CborEncoder *encoder, uint64_t value);
 CBOR_API CborError cbor_encode_int(CborEncoder *encoder, int64_t value);
 CBOR_API CborError cbor_encode_negative_int(CborEncoder *encoder, uint64_t absolute_value);
@@ -262,6 +367,7 @@ CBOR_INLINE_API CborError cbor_encode_float(CborEncoder *encoder, float value)
 { return cbor_encode_floating_point(encoder, CborFloatType, &value); }
 CBOR_INLINE_API CborError cbor_encode_double(CborEncoder *encoder, double value)
 { return cbor_encode_floating_point(encoder, CborDoubleType, &value); }
+CBOR_API CborError cbor_encode_typed_array(CborEncoder *encoder, CborTypedArrayType type, const void *data, size_t count);
 
 CBOR_API CborError cbor_encoder_create_array(CborEncoder *parentEncoder, CborEncoder *arrayEncoder, size_t length);
 CBOR_API CborError cbor_encoder_create_map(CborEncoder *parentEncoder, CborEncoder *mapEncoder, size_t length);
@@ -282,6 +388,14 @@ CBOR_INLINE_API size_t cbor_encoder_get_extra_bytes_needed(const CborEncoder *en
 {
     return encoder->end ? 0 : (size_t)encoder->data.bytes_needed;
 }
+
+/* Growable output */
+CBOR_API void cbor_encoder_init_arena(CborEncoder *encoder, CborArena *arena);
+
+/* Sequence output */
+CBOR_API void cbor_encoder_init_sequence(CborEncoder *encoder, CborSequence *seq, int flags);
+CBOR_API CborError cbor_sequence_commit(CborSequence *seq, const CborEncoder *encoder);
+CBOR_API CborError cbor_encode_sequence(CborEncoder *encoder, const CborSequence *seq);
 #endif /* CBOR_NO_ENCODER_API */
 
 /* Parser API */
@@ -351,6 +465,29 @@ typedef struct CborValue CborValue;
 CBOR_API CborError cbor_parser_init(const uint8_t *buffer, size_t size, uint32_t flags, CborParser *parser, CborValue *it);
 CBOR_API CborError cbor_parser_init_reader(const struct CborParserOperations *ops, CborParser *parser, CborValue *it, void *token);
 
+struct CborStream
+{
+    uint8_t *buffer;
+    size_t size;
+    size_t used;
+    size_t pos;
+    size_t mark;
+    bool starved;
+    bool finished;
+};
+typedef struct CborStream CborStream;
+
+typedef CborError (*CborStreamStepFunction)(CborValue *it, void *arg);
+
+CBOR_API void cbor_stream_init(CborStream *stream, uint8_t *buffer, size_t size);
+CBOR_API CborError cbor_stream_append(CborStream *stream, const void *data, size_t len);
+CBOR_INLINE_API void cbor_stream_finish(CborStream *stream)
+{ stream->finished = true; }
+CBOR_API CborError cbor_parser_init_stream(CborStream *stream, CborParser *parser, CborValue *it);
+CBOR_API CborError cbor_value_stream_step(CborValue *it, CborStreamStepFunction func, void *arg);
+
+CBOR_API CborError cbor_sequence_next(CborSequence *seq, CborParser *parser, CborValue *it);
+
 CBOR_API CborError cbor_value_validate_basic(const CborValue *it);
 
 CBOR_INLINE_API bool cbor_value_at_end(const CborValue *it)
@@ -499,6 +636,10 @@ CBOR_INLINE_API CborError cbor_value_copy_byte_string(const CborValue *value, ui
     return _cbor_value_copy_string(value, buffer, buflen, next);
 }
 
+CBOR_API CborError cbor_value_get_typed_array_type(const CborValue *value, CborTypedArrayType *type);
+CBOR_API CborError cbor_value_copy_typed_array(const CborValue *value, CborTypedArrayType type, void *buffer,
+                                               size_t *count, CborValue *next);
+
 CBOR_INLINE_API CborError cbor_value_dup_text_string(const CborValue *value, char **buffer,
                                                      size_t *buflen, CborValue *next)
 {
@@ -512,6 +653,36 @@ CBOR_INLINE_API CborError cbor_value_dup_byte_string(const CborValue *value, uin
     return _cbor_value_dup_string(value, (void **)buffer, buflen, next);
 }
 
+CBOR_PRIVATE_API CborError _cbor_value_dup_string_arena(const CborValue *value, CborArena *arena,
+                                                        void **buffer, size_t *buflen, CborValue *next);
+CBOR_INLINE_API CborError cbor_value_dup_text_string_arena(const CborValue *value, CborArena *arena,
+                                                           char **buffer, size_t *buflen, CborValue *next)
+{
+    assert(cbor_value_is_text_string(value));
+    return _cbor_value_dup_string_arena(value, arena, (void **)buffer, buflen, next);
+}
+CBOR_INLINE_API CborError cbor_value_dup_byte_string_arena(const CborValue *value, CborArena *arena,
+                                                           uint8_t **buffer, size_t *buflen, CborValue *next)
+{
+    assert(cbor_value_is_byte_string(value));
+    return _cbor_value_dup_string_arena(value, arena, (void **)buffer, buflen, next);
+}
+
+CBOR_PRIVATE_API CborError _cbor_value_get_string_view(const CborValue *value, const void **bufferptr,
+                                                       size_t *len, CborValue *next);
+CBOR_INLINE_API CborError cbor_value_get_text_string_view(const CborValue *value, const char **bufferptr,
+                                                          size_t *len, CborValue *next)
+{
+    assert(cbor_value_is_text_string(value));
+    return _cbor_value_get_string_view(value, (const void **)bufferptr, len, next);
+}
+CBOR_INLINE_API CborError cbor_value_get_byte_string_view(const CborValue *value, const uint8_t **bufferptr,
+                                                          size_t *len, CborValue *next)
+{
+    assert(cbor_value_is_byte_string(value));
+    return _cbor_value_get_string_view(value, (const void **)bufferptr, len, next);
+}
+
 CBOR_PRIVATE_API CborError _cbor_value_get_string_chunk_size(const CborValue *value, size_t *len);
 CBOR_INLINE_API CborError cbor_value_get_string_chunk_size(const CborValue *value, size_t *len)
 {
@@ -590,6 +761,26 @@ CBOR_INLINE_API CborError cbor_value_get_map_length(const CborValue *value, size
 }
 
 CBOR_API CborError cbor_value_map_find_value(const CborValue *map, const char *string, CborValue *element);
+CBOR_API CborError cbor_value_map_find_values(const CborValue *map, const char *const *strings, size_t count,
+                                              CborValue *elements);
+
+struct CborMapIndexEntry
+{
+    CborValue key;
+    uint32_t hash;
+};
+typedef struct CborMapIndexEntry CborMapIndexEntry;
+
+struct CborMapIndex
+{
+    CborMapIndexEntry *entries;
+    size_t size;
+};
+typedef struct CborMapIndex CborMapIndex;
+
+CBOR_API CborError cbor_value_map_index_init(const CborValue *map, CborMapIndexEntry *entries, size_t size,
+                                             CborMapIndex *index);
+CBOR_API CborError cbor_map_index_find_value(const CborMapIndex *index, const char *string, CborValue *element);
 
 /* Floating point */
 CBOR_INLINE_API bool cbor_value_is_half_float(const CborValue *value)
@@ -674,6 +865,7 @@ enum CborValidationFlags {
 };
 
 CBOR_API CborError cbor_value_validate(const CborValue *it, uint32_t flags);
+CBOR_API CborError cbor_value_validate_deterministic(const CborValue *it);
 #endif /* CBOR_NO_VALIDATION_API */
 
 /* Human-readable (dump) API */
@@ -183,6 +183,41 @@
  *     return NULL;
  *  }
  * \endcode
+ *
+ * Instead of retrying, the exact size can also be computed beforehand by
+ * running the same code with an encoder initialized by
+ * cbor_encoder_init_measure(), or the output can be written to a \ref
+ * CborArena, which grows as needed (see cbor_encoder_init_arena()).
+ *
+ * \section Deterministic encoding
+ *
+ * By default, CborEncoder writes the items in the order and in the form they
+ * are given. When the encoder is initialized with the
+ * CborEncoderFlag_Deterministic flag, it produces the deterministic encoding
+ * described in RFC 8949 section 4.2.1 instead, so that the same data always
+ * results in the same bytes:
+ * \list
+ *   \li integers, lengths and tags use their shortest form (always the case);
+ *   \li floating-point values use the shortest of the half-, single- and
+ *       double-precision forms that represents them exactly, and NaN is
+ *       written as half-precision 0x7e00;
+ *   \li arrays and maps created with \ref CborIndefiniteLength are written
+ *       with a definite length when they are closed;
+ *   \li the pairs of each map are sorted by the bytewise lexicographic order
+ *       of the encoded keys when the map is closed. Duplicate keys are
+ *       reported with \ref CborErrorMapKeysNotUnique.
+ * \endlist
+ *
+ * Sorting and rewriting the length of a container happen in place, in the
+ * output buffer, so the deterministic mode needs no memory besides that
+ * buffer. It is supported by cbor_encoder_init() and
+ * cbor_encoder_init_measure(), which computes the size of the deterministic
+ * encoding. Encoders that write to a function (like the ones from
+ * cbor_encoder_init_writer() and cbor_encoder_init_arena()) cannot go back to
+ * output already written: with them, cbor_encoder_create_map() and creating
+ * an array of indefinite length return \ref CborErrorUnsupportedType.
+ *
+ * The output can be checked with cbor_value_validate_deterministic().
  */
 
 /**
@@ -195,17 +230,28 @@
  * Structure used to encode to CBOR.
  */
 
+/**
+ * \enum CborEncoderFlags
+ * The CborEncoderFlags enum contains flags that control the encoding.
+ *
+ * \value CborEncoderFlag_Deterministic   Produce the deterministic encoding of RFC 8949
+ *                                        section 4.2.1 (see \ref CborEncoding).
+ */
+
 /**
  * Initializes a CborEncoder structure \a encoder by pointing it to buffer \a
- * buffer of size \a size. The \a flags field is currently unused and must be
- * zero.
+ * buffer of size \a size. The \a flags field must be either zero or
+ * CborEncoderFlag_Deterministic.
+ *
+ * \sa CborEncoderFlags
  */
 void cbor_encoder_init(CborEncoder *encoder, uint8_t *buffer, size_t size, int flags)
 {
     encoder->data.ptr = buffer;
     encoder->end = buffer + size;
     encoder->remaining = 2;
-    encoder->flags = flags;
+    encoder->flags = flags & CborEncoderFlag_Deterministic;
+    encoder->start = buffer;
 }
 
 void cbor_encoder_init_writer(CborEncoder *encoder, CborEncoderWriteFunction writer, void *token)
@@ -218,6 +264,38 @@ void cbor_encoder_init_writer(CborEncoder *encoder, CborEncoderWriteFunction wri
     encoder->end = (uint8_t *)token;
     encoder->remaining = 2;
     encoder->flags = CborIteratorFlag_WriterFunction;
+    encoder->start = NULL;
+}
+
+static CborError measure_writer(void *token, const void *data, size_t len, CborEncoderAppendType appendType)
+{
+    (void) data;
+    (void) appendType;
+    *(size_t *)token += len;
+    return CborNoError;
+}
+
+/**
+ * Initializes a CborEncoder structure \a encoder that does not write any
+ * output, but adds the size of everything it would write to \c{*size}. Unlike
+ * encoding into a buffer that is too small, none of the encoding functions
+ * return \ref CborErrorOutOfMemory, so the same code that produces a message
+ * can be run once with this encoder to compute its exact size, and a second
+ * time with a buffer of that size to produce it.
+ *
+ * The value of \c{*size} is not reset by this function. The \a flags are
+ * the same as for cbor_encoder_init(): pass CborEncoderFlag_Deterministic to
+ * measure the deterministic encoding.
+ *
+ * \note This function is not available if the library was built with a
+ * custom CBOR_ENCODER_WRITE_FUNCTION.
+ *
+ * \sa cbor_encoder_init(), cbor_encoder_init_writer(), CborEncoding
+ */
+void cbor_encoder_init_measure(CborEncoder *encoder, size_t *size, int flags)
+{
+    cbor_encoder_init_writer(encoder, measure_writer, size);
+    encoder->flags |= CborIteratorFlag_MeasureOnly | (flags & CborEncoderFlag_Deterministic);
 }
 
 static inline void put16(void *where, uint16_t v)
@@ -269,6 +347,13 @@ static inline void advance_ptr(CborEncoder *encoder, size_t n)
         encoder->data.bytes_needed += n;
 }
 
+static inline bool is_writer_function(const CborEncoder *encoder)
+{
+    if (CBOR_ENCODER_WRITER_CONTROL == 0)
+        return encoder->flags & CborIteratorFlag_WriterFunction;
+    return CBOR_ENCODER_WRITER_CONTROL > 0;
+}
+
 static inline CborError append_to_buffer(CborEncoder *encoder, const void *data, size_t len,
                                          CborEncoderAppendType appendType)
 {
@@ -411,22 +496,36 @@ CborError cbor_encode_simple_value(CborEncoder *encoder, uint8_t value)
  * This function is useful for code that needs to pass through floating point
  * values but does not wish to have the actual floating-point code.
  *
+ * In deterministic mode, the value is written in the shortest form that
+ * represents it exactly, regardless of \a fpType.
+ *
  * \sa cbor_encode_half_float, cbor_encode_float_as_half_float, cbor_encode_float, cbor_encode_double
  */
 CborError cbor_encode_floating_point(CborEncoder *encoder, CborType fpType, const void *value)
 {
     unsigned size;
     uint8_t buf[1 + sizeof(uint64_t)];
+    uint64_t bits;
     cbor_assert(fpType == CborHalfFloatType || fpType == CborFloatType || fpType == CborDoubleType);
-    buf[0] = fpType;
 
     size = 2U << (fpType - CborHalfFloatType);
     if (size == 8)
-        put64(buf + 1, *(const uint64_t*)value);
+        bits = *(const uint64_t*)value;
+    else if (size == 4)
+        bits = *(const uint32_t*)value;
+    else
+        bits = *(const uint16_t*)value;
+    if (encoder->flags & CborEncoderFlag_Deterministic)
+        fpType = shortest_floating_point(fpType, &bits);
+
+    buf[0] = fpType;
+    size = 2U << (fpType - CborHalfFloatType);
+    if (size == 8)
+        put64(buf + 1, bits);
     else if (size == 4)
-        put32(buf + 1, *(const uint32_t*)value);
+        put32(buf + 1, (uint32_t)bits);
     else
-        put16(buf + 1, *(const uint16_t*)value);
+        put16(buf + 1, (uint16_t)bits);
     saturated_decrement(encoder);
     return append_to_buffer(encoder, buf, size + 1, CborEncoderAppendCborData);
 }
@@ -490,6 +589,13 @@ __attribute__((noinline))
 static CborError create_container(CborEncoder *encoder, CborEncoder *container, size_t length, uint8_t shiftedMajorType)
 {
     CborError err;
+    int flags = encoder->flags;
+    if (flags & CborEncoderFlag_Deterministic && is_writer_function(encoder) && !(flags & CborIteratorFlag_MeasureOnly)) {
+        /* can't sort or rewrite the length of what was already written */
+        if (length == CborIndefiniteLength || shiftedMajorType & CborIteratorFlag_ContainerIsMap)
+            return CborErrorUnsupportedType;
+    }
+
     container->data.ptr = encoder->data.ptr;
     container->end = encoder->end;
     saturated_decrement(encoder);
@@ -500,19 +606,48 @@ static CborError create_container(CborEncoder *encoder, CborEncoder *container,
     cbor_static_assert(((ArrayType << MajorTypeShift) & CborIteratorFlag_ContainerIsMap) == 0);
     container->flags = shiftedMajorType & CborIteratorFlag_ContainerIsMap;
     if (CBOR_ENCODER_WRITER_CONTROL == 0)
-        container->flags |= encoder->flags & CborIteratorFlag_WriterFunction;
+        container->flags |= flags & (CborIteratorFlag_WriterFunction | CborIteratorFlag_MeasureOnly);
+    container->flags |= flags & CborEncoderFlag_Deterministic;
 
     if (length == CborIndefiniteLength) {
         container->flags |= CborIteratorFlag_UnknownLength;
-        err = append_byte_to_buffer(container, shiftedMajorType + IndefiniteLength);
+        if (flags & CborEncoderFlag_Deterministic) {
+            /* count the items down from SIZE_MAX and write a one-byte
+             * placeholder, the real length is written on closing */
+            container->remaining = SIZE_MAX;
+            err = append_byte_to_buffer(container, shiftedMajorType);
+        } else {
+            err = append_byte_to_buffer(container, shiftedMajorType + IndefiniteLength);
+        }
     } else {
         if (shiftedMajorType & CborIteratorFlag_ContainerIsMap)
             container->remaining += length;
         err = encode_number_no_update(container, length, shiftedMajorType);
     }
+    container->start = container->data.ptr;
     return err;
 }
 
+/**
+ * Appends the unread items of the sequence \a seq to the CBOR stream provided
+ * by \a encoder, as if each had been encoded with \a encoder: they count as
+ * cbor_sequence_get_count() items towards the length of the container being
+ * encoded. The items are copied as they are, without being decoded.
+ *
+ * This is the way to upload items that were encoded earlier, for example
+ * into an array of indefinite length. With an encoder in deterministic mode,
+ * the items must already be in the deterministic encoding.
+ *
+ * \sa CborSequence
+ */
+CborError cbor_encode_sequence(CborEncoder *encoder, const CborSequence *seq)
+{
+    size_t count = cbor_sequence_get_count(seq);
+    if (encoder->remaining)
+        encoder->remaining = encoder->remaining > count ? encoder->remaining - count : 0;
+    return append_to_buffer(encoder, seq->buffer + seq->pos, seq->used - seq->pos, CborEncoderAppendCborData);
+}
+
 /**
  * Creates a CBOR array in the CBOR stream provided by \a parentEncoder and
  * initializes \a arrayEncoder so that items can be added to the array using
@@ -558,6 +693,163 @@ CborError cbor_encoder_create_map(CborEncoder *parentEncoder, CborEncoder *mapEn
     return create_container(parentEncoder, mapEncoder, length, MapType << MajorTypeShift);
 }
 
+/* Returns the size of the item at ptr, which was written by this encoder in
+ * deterministic mode: all lengths are definite. */
+static size_t encoded_item_size(const uint8_t *ptr)
+{
+    const uint8_t *p = ptr;
+    uint64_t items = 1;
+    while (items--) {
+        uint8_t majorType = *p >> MajorTypeShift;
+        uint8_t info = *p++ & SmallValueMask;
+        uint64_t value = info;
+        if (info >= Value8Bit) {
+            unsigned n = 1U << (info - Value8Bit);
+            for (value = 0; n; --n)
+                value = (value << 8) | *p++;
+        }
+
+        if (majorType == ByteStringType || majorType == TextStringType)
+            p += value;
+        else if (majorType == ArrayType)
+            items += value;
+        else if (majorType == MapType)
+            items += 2 * value;
+        else if (majorType == TagType)
+            ++items;
+    }
+    return (size_t)(p - ptr);
+}
+
+static int compare_keys(const uint8_t *key1, size_t len1, const uint8_t *key2, size_t len2)
+{
+    int r = memcmp(key1, key2, len1 < len2 ? len1 : len2);
+    if (r == 0 && len1 != len2)
+        r = len1 < len2 ? -1 : 1;
+    return r;
+}
+
+static void reverse_bytes(uint8_t *begin, uint8_t *end)
+{
+    while (begin < end--) {
+        uint8_t c = *begin;
+        *begin++ = *end;
+        *end = c;
+    }
+}
+
+/* Sorts the key-value pairs in [begin, end) by their encoded keys. This is an
+ * insertion sort that rotates each pair into place, so it needs no memory and
+ * pairs that are already in order cost a single comparison. */
+static CborError sort_map_pairs(uint8_t *begin, uint8_t *end)
+{
+    uint8_t *lastKey = NULL;
+    size_t lastKeyLen = 0;
+    uint8_t *pair = begin;
+
+    while (pair < end) {
+        size_t keyLen = encoded_item_size(pair);
+        size_t pairLen = keyLen + encoded_item_size(pair + keyLen);
+        int r = lastKey ? compare_keys(lastKey, lastKeyLen, pair, keyLen) : -1;
+        if (r == 0)
+            return CborErrorMapKeysNotUnique;
+        if (r < 0) {
+            lastKey = pair;
+            lastKeyLen = keyLen;
+        } else {
+            /* find the first key that is greater */
+            uint8_t *pos = begin;
+            while (1) {
+                size_t len = encoded_item_size(pos);
+                r = compare_keys(pos, len, pair, keyLen);
+                if (r == 0)
+                    return CborErrorMapKeysNotUnique;
+                if (r > 0)
+                    break;
+                pos += len;
+                pos += encoded_item_size(pos);
+            }
+
+            /* rotate [pos, pair + pairLen) so that this pair moves to pos */
+            reverse_bytes(pos, pair);
+            reverse_bytes(pair, pair + pairLen);
+            reverse_bytes(pos, pair + pairLen);
+            lastKey += pairLen;
+        }
+        pair += pairLen;
+    }
+    return CborNoError;
+}
+
+static CborError close_deterministic_container(CborEncoder *encoder, const CborEncoder *container)
+{
+    CborError err = CborNoError;
+    uint8_t *contents = container->start;
+    bool isMap = container->flags & CborIteratorFlag_ContainerIsMap;
+
+    if (container->flags & CborIteratorFlag_UnknownLength) {
+        /* replace the placeholder with the actual length */
+        uint64_t buf[2];
+        uint8_t *const bufend = (uint8_t *)buf + sizeof(buf);
+        uint8_t *bufstart = bufend - 1;
+        uint8_t shiftedMajorType = isMap ? MapType << MajorTypeShift : ArrayType << MajorTypeShift;
+        size_t count = SIZE_MAX - container->remaining;
+        size_t extra;
+        if (isMap) {
+            if (count & 1)
+                return CborErrorTooFewItems;
+            count /= 2;
+        }
+
+        put64(buf + 1, count);
+        if (count < Value8Bit) {
+            *bufstart += shiftedMajorType;
+        } else {
+            uint8_t more = 0;
+            if (count > 0xffU)
+                ++more;
+            if (count > 0xffffU)
+                ++more;
+            if (count > 0xffffffffU)
+                ++more;
+            bufstart -= (size_t)1 << more;
+            *bufstart = shiftedMajorType + Value8Bit + more;
+        }
+
+        extra = (size_t)(bufend - bufstart) - 1;
+        if (is_writer_function(encoder)) {
+            /* measuring: only the size matters */
+            if (extra)
+                err = append_to_buffer(encoder, bufstart, extra, CborEncoderAppendCborData);
+        } else if (encoder->end && !would_overflow(encoder, extra)) {
+            memmove(contents + extra, contents, (size_t)(encoder->data.ptr - contents));
+            memcpy(contents - 1, bufstart, extra + 1);
+            encoder->data.ptr += extra;
+            contents += extra;
+        } else {
+            if (encoder->end) {
+                encoder->data.bytes_needed = encoder->data.ptr + extra - encoder->end;
+                encoder->end = NULL;
+            } else {
+                encoder->data.bytes_needed += extra;
+            }
+            err = CborErrorOutOfMemory;
+        }
+    } else if (container->remaining != 1) {
+        return container->remaining == 0 ? CborErrorTooManyItems : CborErrorTooFewItems;
+    }
+
+    if (err)
+        return err;
+    if (is_writer_function(encoder))
+        return CborNoError;
+    if (!encoder->end)
+        return CborErrorOutOfMemory;    /* keep the state */
+    if (isMap)
+        return sort_map_pairs(contents, encoder->data.ptr);
+    return CborNoError;
+}
+
 /**
  * Closes the CBOR container (array or map) provided by \a containerEncoder and
  * updates the CBOR stream provided by \a encoder. Both parameters must be the
@@ -576,6 +868,9 @@ CborError cbor_encoder_close_container(CborEncoder *parentEncoder, const CborEnc
     parentEncoder->end = containerEncoder->end;
     parentEncoder->data = containerEncoder->data;
 
+    if (containerEncoder->flags & CborEncoderFlag_Deterministic)
+        return close_deterministic_container(parentEncoder, containerEncoder);
+
     if (containerEncoder->flags & CborIteratorFlag_UnknownLength)
         return append_byte_to_buffer(parentEncoder, BreakByte);
 
@@ -0,0 +1,241 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#ifndef _BSD_SOURCE
+#define _BSD_SOURCE 1
+#endif
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE 1
+#endif
+#ifndef __STDC_LIMIT_MACROS
+#  define __STDC_LIMIT_MACROS 1
+#endif
+
+#include "cbor.h"
+#include "compilersupport_p.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * \addtogroup CborEncoding
+ * @{
+ */
+
+/**
+ * \struct CborArena
+ *
+ * A growable output for the encoder, made of a chain of memory blocks
+ * allocated with \c malloc as the encoded data grows. Each new block is at
+ * least twice as large as the previous one, so encoding N bytes takes
+ * O(log N) allocations and the data is never moved.
+ *
+ * The encoded data can be copied to a contiguous buffer of the exact size
+ * with cbor_arena_copy(), after checking its size with
+ * cbor_arena_get_size():
+ *
+ * \code
+ *      CborArena arena;
+ *      CborEncoder encoder;
+ *      cbor_arena_init(&arena, 256);
+ *      cbor_encoder_init_arena(&encoder, &arena);
+ *      err = encode_message(&encoder);
+ *      if (!err) {
+ *          uint8_t *buf = malloc(cbor_arena_get_size(&arena));
+ *          if (buf)
+ *              send(buf, cbor_arena_copy(&arena, buf, cbor_arena_get_size(&arena)));
+ *          free(buf);
+ *      }
+ *      cbor_arena_free(&arena);
+ * \endcode
+ *
+ * An arena can also serve as a bump allocator for decoded strings, with
+ * cbor_value_dup_text_string_arena() and cbor_value_dup_byte_string_arena():
+ * every string lives until the arena is freed with a single call to
+ * cbor_arena_free(). An arena should be used for either purpose, not both.
+ */
+
+struct CborArenaChunk
+{
+    struct CborArenaChunk *next;
+    size_t size;
+    size_t used;
+    uint8_t data[];
+};
+
+/* Appends an empty block with room for at least \a len bytes */
+static struct CborArenaChunk *arena_grow(CborArena *arena, size_t len)
+{
+    struct CborArenaChunk *chunk = arena->last;
+    size_t size = chunk ? chunk->size * 2 : arena->chunk_size;
+    size_t alloc;
+    if (size < len)
+        size = len;
+    if (add_check_overflow(sizeof(struct CborArenaChunk), size, &alloc))
+        return NULL;
+    struct CborArenaChunk *next = (struct CborArenaChunk *)malloc(alloc);
+    if (!next)
+        return NULL;
+
+    next->next = NULL;
+    next->size = size;
+    next->used = 0;
+    if (chunk)
+        chunk->next = next;
+    else
+        arena->first = next;
+    arena->last = next;
+    return next;
+}
+
+static CborError arena_writer(void *token, const void *data, size_t len, CborEncoderAppendType appendType)
+{
+    CborArena *arena = (CborArena *)token;
+    struct CborArenaChunk *chunk = arena->last;
+    const uint8_t *src = (const uint8_t *)data;
+    size_t avail;
+    (void) appendType;
+
+    avail = chunk ? chunk->size - chunk->used : 0;
+    if (avail >= len) {
+        memcpy(chunk->data + chunk->used, src, len);
+        chunk->used += len;
+        arena->size += len;
+        return CborNoError;
+    }
+
+    /* fill the current block, then put the rest in a new one */
+    if (avail) {
+        memcpy(chunk->data + chunk->used, src, avail);
+        chunk->used += avail;
+        arena->size += avail;
+        src += avail;
+        len -= avail;
+    }
+
+    chunk = arena_grow(arena, len);
+    if (!chunk)
+        return CborErrorOutOfMemory;
+    memcpy(chunk->data, src, len);
+    chunk->used = len;
+    arena->size += len;
+    return CborNoError;
+}
+
+/**
+ * Initializes the empty arena \a arena. The first block, allocated when data
+ * is first written, has \a chunk_size bytes; it should be about the size of a
+ * typical message.
+ *
+ * \sa cbor_encoder_init_arena(), cbor_arena_free()
+ */
+void cbor_arena_init(CborArena *arena, size_t chunk_size)
+{
+    arena->first = NULL;
+    arena->last = NULL;
+    arena->chunk_size = chunk_size ? chunk_size : 1;
+    arena->size = 0;
+}
+
+/**
+ * Initializes a CborEncoder structure \a encoder to append its output to the
+ * arena \a arena. The encoding functions only return \ref CborErrorOutOfMemory
+ * if \c malloc fails.
+ *
+ * \note This function is not available if the library was built with a
+ * custom CBOR_ENCODER_WRITE_FUNCTION.
+ *
+ * \sa cbor_arena_init(), cbor_arena_copy()
+ */
+void cbor_encoder_init_arena(CborEncoder *encoder, CborArena *arena)
+{
+    cbor_encoder_init_writer(encoder, arena_writer, arena);
+}
+
+/**
+ * \fn size_t cbor_arena_get_size(const CborArena *arena)
+ *
+ * Returns the number of bytes written to the arena \a arena.
+ */
+
+/**
+ * Allocates \a size bytes from the arena \a arena and returns a pointer to
+ * them, or NULL if \c malloc fails. The memory is not aligned and must not be
+ * freed on its own: it is released by cbor_arena_free(), together with
+ * everything else in the arena.
+ *
+ * \sa cbor_value_dup_text_string_arena(), cbor_value_dup_byte_string_arena()
+ */
+void *cbor_arena_alloc(CborArena *arena, size_t size)
+{
+    struct CborArenaChunk *chunk = arena->last;
+    if (!chunk || chunk->size - chunk->used < size) {
+        chunk = arena_grow(arena, size);
+        if (!chunk)
+            return NULL;
+    }
+
+    void *ptr = chunk->data + chunk->used;
+    chunk->used += size;
+    arena->size += size;
+    return ptr;
+}
+
+/**
+ * Copies the data written to the arena \a arena to the buffer \a buffer of \a
+ * size bytes, up to the size of the buffer. Returns the number of bytes
+ * copied.
+ *
+ * \sa cbor_arena_get_size()
+ */
+size_t cbor_arena_copy(const CborArena *arena, uint8_t *buffer, size_t size)
+{
+    const struct CborArenaChunk *chunk;
+    size_t copied = 0;
+    for (chunk = arena->first; chunk && copied < size; chunk = chunk->next) {
+        size_t n = chunk->used < size - copied ? chunk->used : size - copied;
+        memcpy(buffer + copied, chunk->data, n);
+        copied += n;
+    }
+    return copied;
+}
+
+/**
+ * Frees the memory used by the arena \a arena and makes it empty again, so it
+ * can be reused.
+ */
+void cbor_arena_free(CborArena *arena)
+{
+    struct CborArenaChunk *chunk = arena->first;
+    while (chunk) {
+        struct CborArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->first = NULL;
+    arena->last = NULL;
+    arena->size = 0;
+}
+
+/** @} */
@@ -56,6 +56,7 @@
  * \value CborErrorIllegalType          An invalid type was found while parsing a chunked CBOR string
  * \value CborErrorIllegalNumber        An illegal initial byte (encoding unspecified additional information) was found
  * \value CborErrorIllegalSimpleType    An illegal encoding of a CBOR Simple Type of value less than 32 was found
+ * \value CborErrorNeedMoreData         More data must be appended to the \ref CborStream before parsing can resume
  * \omitvalue CborErrorUnknownSimpleType
  * \omitvalue CborErrorUnknownTag
  * \omitvalue CborErrorInappropriateTagForType
@@ -68,6 +69,9 @@
  * \omitvalue CborErrorUnsupportedType
  * \value CborErrorJsonObjectKeyIsAggregate Conversion to JSON failed because the key in a map is a CBOR map or array
  * \value CborErrorJsonObjectKeyNotString Conversion to JSON failed because the key in a map is not a text string
+ * \value CborErrorSchemaTypeMismatch   A value does not have the type declared in the schema passed to cbor_schema_decode_advance()
+ * \value CborErrorSchemaMissingKey     A key declared as required in the schema is missing from the map
+ * \value CborErrorSchemaTooManyItems   An array has more elements than the schema allows
  * \value CborErrorOutOfMemory          During CBOR encoding, the buffer provided is insufficient for encoding the data item;
  *                                      in other situations, TinyCBOR failed to allocate memory
  * \value CborErrorInternalError        An internal error occurred in TinyCBOR
@@ -122,6 +126,9 @@ const char *cbor_error_string(CborError error)
     case CborErrorNoMoreStringChunks:
         return _("no more byte or text strings available");
 
+    case CborErrorNeedMoreData:
+        return _("more data needed to continue parsing");
+
     case CborErrorUnknownSimpleType:
         return _("unknown simple type");
 
@@ -181,6 +188,15 @@ const char *cbor_error_string(CborError error)
     case CborErrorJsonNotImplemented:
         return _("conversion to JSON failed: open_memstream unavailable");
 
+    case CborErrorSchemaTypeMismatch:
+        return _("value does not have the type required by the schema");
+
+    case CborErrorSchemaMissingKey:
+        return _("required key missing from map");
+
+    case CborErrorSchemaTooManyItems:
+        return _("array has more items than the schema allows");
+
     case CborErrorInternalError:
         return _("internal error");
     }
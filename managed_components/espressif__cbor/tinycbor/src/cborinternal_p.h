@@ -98,6 +98,80 @@ static inline double decode_half(unsigned short half)
 #  endif
 #endif /* CBOR_NO_HALF_FLOAT_TYPE */
 
+/* Converts the value with the sign, unbiased exponent and significand (with the
+ * leading bit at bit 52) to a format with mantBits of mantissa. Returns false
+ * if that loses precision. */
+static inline bool narrow_floating_point(uint64_t sign, int exp, uint64_t significand, int mantBits, int bias,
+                                         uint64_t *bits)
+{
+    int shift = 52 - mantBits;
+    sign <<= mantBits + (bias == 15 ? 5 : 8);
+    if (exp > bias)
+        return false;
+    if (exp < 1 - bias) {
+        /* subnormal in the smaller format */
+        shift += 1 - bias - exp;
+        if (shift > 52)
+            return false;
+        exp = -bias;
+    }
+    if (significand & ((UINT64_C(1) << shift) - 1))
+        return false;
+    *bits = sign | ((uint64_t)(exp + bias) << mantBits) | ((significand >> shift) & ((UINT64_C(1) << mantBits) - 1));
+    return true;
+}
+
+/* Chooses the shortest of the half-, single- and double-precision forms that
+ * represents the value of type fpType in *bits exactly, and updates *bits.
+ * This works on the bit patterns, so it needs no floating-point support. */
+static inline CborType shortest_floating_point(CborType fpType, uint64_t *bits)
+{
+    uint64_t v = *bits, sign, mant;
+    int exp;
+    if (fpType == CborHalfFloatType) {
+        if ((v & 0x7c00) == 0x7c00 && (v & 0x3ff))
+            *bits = 0x7e00;                 /* NaN */
+        return fpType;
+    }
+
+    if (fpType == CborFloatType) {
+        sign = v >> 31;
+        exp = (v >> 23) & 0xff;
+        mant = v & 0x7fffff;
+        if (exp == 0xff)
+            exp = 0x7ff;
+        else if (exp)
+            exp += 1023 - 127;
+        mant <<= 52 - 23;
+    } else {
+        sign = v >> 63;
+        exp = (v >> 52) & 0x7ff;
+        mant = v & UINT64_C(0xfffffffffffff);
+    }
+
+    if (exp == 0x7ff) {
+        /* infinities and NaN */
+        *bits = mant ? 0x7e00 : (sign << 15) | 0x7c00;
+        return CborHalfFloatType;
+    }
+    if (exp == 0) {
+        if (mant == 0) {
+            *bits = sign << 15;
+            return CborHalfFloatType;
+        }
+        /* subnormals are too small for the smaller formats */
+        return fpType;
+    }
+
+    exp -= 1023;
+    mant |= UINT64_C(1) << 52;
+    if (narrow_floating_point(sign, exp, mant, 10, 15, bits))
+        return CborHalfFloatType;
+    if (fpType == CborDoubleType && narrow_floating_point(sign, exp, mant, 23, 127, bits))
+        return CborFloatType;
+    return fpType;
+}
+
 #ifndef CBOR_INTERNAL_API
 #  define CBOR_INTERNAL_API
 #endif
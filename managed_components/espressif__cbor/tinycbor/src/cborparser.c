@@ -1156,6 +1156,81 @@ CborError _cbor_value_get_string_chunk(const CborValue *value, const void **buff
     return get_string_chunk(next, bufferptr, len);
 }
 
+/**
+ * \fn CborError cbor_value_get_text_string_view(const CborValue *value, const char **bufferptr, size_t *len, CborValue *next)
+ *
+ * Stores in \a bufferptr a pointer to the contents of the definite-length
+ * text string pointed to by \a value and its size in \a len, without copying
+ * it. Neither may be null. For a parser created with cbor_parser_init(), the
+ * pointer points into the input buffer and stays valid as long as that buffer
+ * does; it is not NUL-terminated. For a parser with an external source, the
+ * pointer is the one returned by the reader's \c transfer_string function.
+ *
+ * If the string is chunked (indeterminate length), this function returns
+ * \ref CborErrorUnknownLength without modifying \a bufferptr or \a len; use
+ * cbor_value_get_text_string_chunk() or cbor_value_dup_text_string() for
+ * those.
+ *
+ * If the iterator \a value does not point to a text string, the behaviour is
+ * undefined, so checking with \ref cbor_value_get_type or \ref
+ * cbor_value_is_text_string is recommended.
+ *
+ * The \a next pointer, if not null, will be updated to point to the next item
+ * after this string. If \a value points to the last item, then \a next will be
+ * invalid.
+ *
+ * \note This function does not perform UTF-8 validation on the incoming text
+ * string.
+ *
+ * \sa cbor_value_is_length_known(), cbor_value_get_text_string_chunk(), cbor_value_dup_text_string_arena(), cbor_value_get_byte_string_view()
+ */
+
+/**
+ * \fn CborError cbor_value_get_byte_string_view(const CborValue *value, const uint8_t **bufferptr, size_t *len, CborValue *next)
+ *
+ * Stores in \a bufferptr a pointer to the contents of the definite-length
+ * byte string pointed to by \a value and its size in \a len, without copying
+ * it. Neither may be null. For a parser created with cbor_parser_init(), the
+ * pointer points into the input buffer and stays valid as long as that buffer
+ * does. For a parser with an external source, the pointer is the one returned
+ * by the reader's \c transfer_string function.
+ *
+ * If the string is chunked (indeterminate length), this function returns
+ * \ref CborErrorUnknownLength without modifying \a bufferptr or \a len; use
+ * cbor_value_get_byte_string_chunk() or cbor_value_dup_byte_string() for
+ * those.
+ *
+ * If the iterator \a value does not point to a byte string, the behaviour is
+ * undefined, so checking with \ref cbor_value_get_type or \ref
+ * cbor_value_is_byte_string is recommended.
+ *
+ * The \a next pointer, if not null, will be updated to point to the next item
+ * after this string. If \a value points to the last item, then \a next will be
+ * invalid.
+ *
+ * \sa cbor_value_is_length_known(), cbor_value_get_byte_string_chunk(), cbor_value_dup_byte_string_arena(), cbor_value_get_text_string_view()
+ */
+
+CborError _cbor_value_get_string_view(const CborValue *value, const void **bufferptr,
+                                      size_t *len, CborValue *next)
+{
+    CborValue tmp;
+    CborError err;
+    cbor_assert(cbor_value_is_byte_string(value) || cbor_value_is_text_string(value));
+    if (!cbor_value_is_length_known(value))
+        return CborErrorUnknownLength;
+
+    if (!next)
+        next = &tmp;
+    *next = *value;
+    err = _cbor_value_begin_string_iteration(next);
+    if (!err)
+        err = get_string_chunk(next, bufferptr, len);
+    if (err)
+        return err;
+    return _cbor_value_finish_string_iteration(next);
+}
+
 /* We return uintptr_t so that we can pass memcpy directly as the iteration
  * function. The choice is to optimize for memcpy, which is used in the base
  * parser API (cbor_value_copy_string), while memcmp is used in convenience API
@@ -1459,6 +1534,266 @@ error:
     return err;
 }
 
+/**
+ * Attempts to find the values in map \a map that correspond to each of the
+ * \a count text string entries in \a strings, in a single pass over the map.
+ * If the iterator \a map does not point to a CBOR map, the behaviour is
+ * undefined, so checking with \ref cbor_value_get_type or \ref
+ * cbor_value_is_map is recommended.
+ *
+ * The value found for \c{strings[i]} is stored in \c{elements[i]}, which must
+ * have room for \a count elements. Keys that are not present in the map leave
+ * their element with type \ref CborInvalidType. If the map contains the same
+ * key more than once, the first occurrence is returned, like
+ * cbor_value_map_find_value() does. Matching is performed as in
+ * cbor_value_text_string_equals(), so tagged strings will also match.
+ *
+ * The search stops as soon as all keys have been found. This function has a
+ * time complexity of O(n * k) string comparisons in the worst case, where n
+ * is the number of elements in the map and k the number of keys, but the map
+ * is only decoded once, so it is faster than calling
+ * cbor_value_map_find_value() for each key whenever k > 1.
+ *
+ * \sa cbor_value_map_find_value(), cbor_value_map_index_init()
+ */
+CborError cbor_value_map_find_values(const CborValue *map, const char *const *strings, size_t count,
+                                     CborValue *elements)
+{
+    CborError err;
+    CborValue it;
+    size_t i;
+    size_t missing = count;
+    cbor_assert(cbor_value_is_map(map));
+    for (i = 0; i < count; ++i)
+        elements[i].type = CborInvalidType;
+
+    err = cbor_value_enter_container(map, &it);
+    if (err)
+        goto error;
+
+    while (missing && !cbor_value_at_end(&it)) {
+        /* find the non-tag so we can compare */
+        err = cbor_value_skip_tag(&it);
+        if (err)
+            goto error;
+        if (cbor_value_is_text_string(&it)) {
+            CborValue next;
+            size_t keyLen;
+            bool equals = false;
+
+            /* only strings of the same length need to be compared */
+            if (!cbor_value_is_length_known(&it) || cbor_value_get_string_length(&it, &keyLen) != CborNoError)
+                keyLen = SIZE_MAX;
+
+            for (i = 0; i < count; ++i) {
+                size_t len;
+                if (elements[i].type != CborInvalidType)
+                    continue;
+                len = strlen(strings[i]);
+                if (keyLen != SIZE_MAX && keyLen != len)
+                    continue;
+                err = iterate_string_chunks(&it, CONST_CAST(char *, strings[i]), &len,
+                                            &equals, &next, iterate_memcmp);
+                if (err)
+                    goto error;
+                if (equals)
+                    break;
+            }
+
+            if (equals) {
+                it = next;
+                elements[i] = it;
+                --missing;
+            } else {
+                err = cbor_value_advance(&it);
+                if (err)
+                    goto error;
+            }
+        } else {
+            /* skip this key */
+            err = cbor_value_advance(&it);
+            if (err)
+                goto error;
+        }
+
+        /* skip this value */
+        err = cbor_value_skip_tag(&it);
+        if (err)
+            goto error;
+        err = cbor_value_advance(&it);
+        if (err)
+            goto error;
+    }
+    return CborNoError;
+
+error:
+    for (i = 0; i < count; ++i)
+        elements[i].type = CborInvalidType;
+    return err;
+}
+
+static CborError hash_text_string(const CborValue *value, uint32_t *hash, CborValue *next)
+{
+    CborError err;
+    const void *ptr;
+    size_t chunkLen;
+    uint32_t h = 2166136261U;      /* FNV-1a */
+
+    *next = *value;
+    err = _cbor_value_begin_string_iteration(next);
+    if (err)
+        return err;
+
+    while ((err = get_string_chunk(next, &ptr, &chunkLen)) == CborNoError) {
+        const uint8_t *p = (const uint8_t *)ptr;
+        const uint8_t *end = p + chunkLen;
+        for ( ; p != end; ++p)
+            h = (h ^ *p) * 16777619U;
+    }
+    if (err != CborErrorNoMoreStringChunks)
+        return err;
+
+    *hash = h;
+    return _cbor_value_finish_string_iteration(next);
+}
+
+static uint32_t hash_string(const char *string, size_t *len)
+{
+    const uint8_t *p = (const uint8_t *)string;
+    uint32_t h = 2166136261U;
+    for ( ; *p; ++p)
+        h = (h ^ *p) * 16777619U;
+    *len = (size_t)(p - (const uint8_t *)string);
+    return h;
+}
+
+/**
+ * \struct CborMapIndex
+ *
+ * A hash table over the text string keys of a CBOR map, built by
+ * cbor_value_map_index_init() and queried with cbor_map_index_find_value().
+ * The table does not own any memory: the entries are provided by the caller
+ * and refer to the buffer being parsed, which must remain valid and unchanged
+ * for as long as the index is used.
+ */
+
+/**
+ * Builds in \a index a hash index over the text string keys of the map \a
+ * map, using the \a size entries provided in \a entries. If the iterator \a
+ * map does not point to a CBOR map, the behaviour is undefined, so checking
+ * with \ref cbor_value_get_type or \ref cbor_value_is_map is recommended.
+ *
+ * Building the index decodes the map once. Afterwards, each lookup with
+ * cbor_map_index_find_value() only compares the keys whose hash collides with
+ * the one being searched, so the index pays off for maps that are queried many
+ * times. Keys that are not text strings are not indexed.
+ *
+ * The table uses open addressing, so \a size must be larger than the number of
+ * text string keys in the map, otherwise this function returns \ref
+ * CborErrorOutOfMemory. Keeping it about twice as large as the number of keys
+ * keeps the lookups short.
+ *
+ * \sa cbor_map_index_find_value(), cbor_value_map_find_values()
+ */
+CborError cbor_value_map_index_init(const CborValue *map, CborMapIndexEntry *entries, size_t size,
+                                    CborMapIndex *index)
+{
+    CborError err;
+    CborValue it;
+    size_t i;
+    size_t used = 0;
+    cbor_assert(cbor_value_is_map(map));
+
+    index->entries = entries;
+    index->size = size;
+    for (i = 0; i < size; ++i)
+        entries[i].key.type = CborInvalidType;
+
+    err = cbor_value_enter_container(map, &it);
+    if (err)
+        return err;
+
+    while (!cbor_value_at_end(&it)) {
+        err = cbor_value_skip_tag(&it);
+        if (err)
+            return err;
+        if (cbor_value_is_text_string(&it)) {
+            CborValue next;
+            uint32_t hash;
+            err = hash_text_string(&it, &hash, &next);
+            if (err)
+                return err;
+            if (++used >= size)
+                return CborErrorOutOfMemory;
+
+            /* linear probing keeps duplicates in map order, so the first one wins */
+            for (i = hash % size; entries[i].key.type != CborInvalidType; i = (i + 1) % size)
+                ;
+            entries[i].key = it;
+            entries[i].hash = hash;
+            it = next;
+        } else {
+            /* skip this key */
+            err = cbor_value_advance(&it);
+            if (err)
+                return err;
+        }
+
+        /* skip this value */
+        err = cbor_value_skip_tag(&it);
+        if (err)
+            return err;
+        err = cbor_value_advance(&it);
+        if (err)
+            return err;
+    }
+    return CborNoError;
+}
+
+/**
+ * Looks up in \a index the value that corresponds to the text string entry \a
+ * string, which must have been built by cbor_value_map_index_init(). If the
+ * item is found, it is stored in \a element, otherwise \a element will contain
+ * an element of type \ref CborInvalidType, like cbor_value_map_find_value()
+ * does.
+ *
+ * \sa cbor_value_map_index_init(), cbor_value_map_find_value()
+ */
+CborError cbor_map_index_find_value(const CborMapIndex *index, const char *string, CborValue *element)
+{
+    size_t i, n;
+    size_t len;
+    uint32_t hash = hash_string(string, &len);
+
+    element->type = CborInvalidType;
+    if (!index->size)
+        return CborNoError;
+
+    for (i = hash % index->size, n = 0; n < index->size; i = (i + 1) % index->size, ++n) {
+        const CborMapIndexEntry *entry = &index->entries[i];
+        CborError err;
+        bool equals;
+        size_t dummyLen = len;
+
+        if (entry->key.type == CborInvalidType)
+            break;
+        if (entry->hash != hash)
+            continue;
+
+        err = iterate_string_chunks(&entry->key, CONST_CAST(char *, string), &dummyLen,
+                                    &equals, element, iterate_memcmp);
+        if (err) {
+            element->type = CborInvalidType;
+            return err;
+        }
+        if (equals)
+            return CborNoError;
+    }
+
+    element->type = CborInvalidType;
+    return CborNoError;
+}
+
 /**
  * \fn bool cbor_value_is_float(const CborValue *value)
  *
@@ -117,3 +117,55 @@ CborError _cbor_value_dup_string(const CborValue *value, void **buffer, size_t *
     }
     return CborNoError;
 }
+
+/**
+ * \fn CborError cbor_value_dup_text_string_arena(const CborValue *value, CborArena *arena, char **buffer, size_t *buflen, CborValue *next)
+ *
+ * Like cbor_value_dup_text_string(), but the buffer is allocated from the
+ * arena \a arena instead of with \c malloc. The buffer must not be freed on
+ * its own: all strings duplicated into the arena are released at once by
+ * cbor_arena_free(). Chunked strings are supported too.
+ *
+ * If the arena cannot grow, this function will return error condition \ref
+ * CborErrorOutOfMemory.
+ *
+ * On success, \c{*buffer} points to the NUL-terminated copy of the string and
+ * \c{*buflen} contains its length, not counting the terminator.
+ *
+ * \note This function does not perform UTF-8 validation on the incoming text
+ * string.
+ *
+ * \sa cbor_arena_init(), cbor_value_get_text_string_view(), cbor_value_dup_byte_string_arena()
+ */
+
+/**
+ * \fn CborError cbor_value_dup_byte_string_arena(const CborValue *value, CborArena *arena, uint8_t **buffer, size_t *buflen, CborValue *next)
+ *
+ * Like cbor_value_dup_byte_string(), but the buffer is allocated from the
+ * arena \a arena instead of with \c malloc. The buffer must not be freed on
+ * its own: all strings duplicated into the arena are released at once by
+ * cbor_arena_free(). Chunked strings are supported too.
+ *
+ * If the arena cannot grow, this function will return error condition \ref
+ * CborErrorOutOfMemory.
+ *
+ * \sa cbor_arena_init(), cbor_value_get_byte_string_view(), cbor_value_dup_text_string_arena()
+ */
+CborError _cbor_value_dup_string_arena(const CborValue *value, CborArena *arena, void **buffer,
+                                       size_t *buflen, CborValue *next)
+{
+    CborError err;
+    cbor_assert(arena);
+    cbor_assert(buffer);
+    cbor_assert(buflen);
+    *buflen = SIZE_MAX;
+    err = _cbor_value_copy_string(value, NULL, buflen, NULL);
+    if (err)
+        return err;
+
+    ++*buflen;
+    *buffer = cbor_arena_alloc(arena, *buflen);
+    if (!*buffer)
+        return CborErrorOutOfMemory;
+    return _cbor_value_copy_string(value, *buffer, buflen, next);
+}
@@ -0,0 +1,240 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#ifndef _BSD_SOURCE
+#define _BSD_SOURCE 1
+#endif
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE 1
+#endif
+#ifndef __STDC_LIMIT_MACROS
+#  define __STDC_LIMIT_MACROS 1
+#endif
+
+#include "cbor.h"
+#include "compilersupport_p.h"
+
+#include <string.h>
+
+/**
+ * \addtogroup CborParsing
+ * @{
+ */
+
+/**
+ * \struct CborStream
+ *
+ * A window over CBOR data that arrives in chunks, such as a payload received
+ * in several network packets. The data is appended with cbor_stream_append()
+ * and parsed with a parser initialized by cbor_parser_init_stream().
+ *
+ * Only the bytes that have not been completely parsed yet are kept in the
+ * buffer provided to cbor_stream_init(), so the buffer needs to be as large
+ * as the largest item decoded in one step (see cbor_value_stream_step()) plus
+ * the largest chunk appended, not as large as the whole payload.
+ *
+ * The parsing functions return \ref CborErrorUnexpectedEOF when they run out
+ * of data. cbor_value_stream_step() turns that into the recoverable \ref
+ * CborErrorNeedMoreData, rewinding the iterator and the stream to where the
+ * step began, so that the step can be retried after more data is appended.
+ */
+
+static bool stream_can_read_bytes(void *token, size_t len)
+{
+    CborStream *stream = (CborStream *)token;
+    if (stream->used - stream->pos >= len)
+        return true;
+    stream->starved = true;
+    return false;
+}
+
+static void *stream_read_bytes(void *token, void *dst, size_t offset, size_t len)
+{
+    CborStream *stream = (CborStream *)token;
+    return memcpy(dst, stream->buffer + stream->pos + offset, len);
+}
+
+static void stream_advance_bytes(void *token, size_t len)
+{
+    CborStream *stream = (CborStream *)token;
+    stream->pos += len;
+}
+
+static CborError stream_transfer_string(void *token, const void **userptr, size_t offset, size_t len)
+{
+    CborStream *stream = (CborStream *)token;
+    size_t total;
+    if (add_check_overflow(offset, len, &total) || stream->used - stream->pos < total) {
+        stream->starved = true;
+        return CborErrorUnexpectedEOF;
+    }
+    *userptr = stream->buffer + stream->pos + offset;
+    stream->pos += total;
+    return CborNoError;
+}
+
+static const struct CborParserOperations stream_ops = {
+    stream_can_read_bytes,
+    stream_read_bytes,
+    stream_advance_bytes,
+    stream_transfer_string
+};
+
+/**
+ * Initializes the stream \a stream to hold the data to be parsed in the
+ * buffer \a buffer of \a size bytes. The buffer must remain valid for as long
+ * as the stream is used.
+ *
+ * \sa cbor_stream_append(), cbor_parser_init_stream()
+ */
+void cbor_stream_init(CborStream *stream, uint8_t *buffer, size_t size)
+{
+    memset(stream, 0, sizeof(*stream));
+    stream->buffer = buffer;
+    stream->size = size;
+}
+
+/**
+ * Appends the \a len bytes at \a data to the stream \a stream. Bytes that were
+ * consumed by successful steps are dropped first, if needed to make room.
+ *
+ * Since dropping the consumed bytes moves the remaining ones to the beginning
+ * of the buffer, pointers to string data obtained from the parser (for
+ * example, with cbor_value_get_text_string_chunk()) are invalidated by this
+ * function.
+ *
+ * If there is not enough room for \a data even after dropping the consumed
+ * bytes, this function returns \ref CborErrorOutOfMemory and the stream is not
+ * modified. This happens when the item being parsed is larger than the
+ * buffer, or when appending to a finished stream.
+ *
+ * \sa cbor_stream_finish(), cbor_value_stream_step()
+ */
+CborError cbor_stream_append(CborStream *stream, const void *data, size_t len)
+{
+    if (stream->finished)
+        return CborErrorOutOfMemory;
+    if (stream->size - stream->used < len) {
+        if (stream->size - stream->used + stream->mark < len)
+            return CborErrorOutOfMemory;
+
+        memmove(stream->buffer, stream->buffer + stream->mark, stream->used - stream->mark);
+        stream->used -= stream->mark;
+        stream->pos -= stream->mark;
+        stream->mark = 0;
+    }
+    if (len)
+        memcpy(stream->buffer + stream->used, data, len);
+    stream->used += len;
+    return CborNoError;
+}
+
+/**
+ * \fn void cbor_stream_finish(CborStream *stream)
+ *
+ * Marks the stream \a stream as complete: no more data will be appended, so
+ * running out of data is an error. After this call, cbor_value_stream_step()
+ * and cbor_parser_init_stream() return \ref CborErrorUnexpectedEOF instead of
+ * \ref CborErrorNeedMoreData.
+ */
+
+/**
+ * Initializes the CBOR parser \a parser to parse the data appended to the
+ * stream \a stream. The iterator to the first element is returned in \a it.
+ *
+ * If the stream does not contain enough data to decode the first element's
+ * header yet, this function returns \ref CborErrorNeedMoreData and should be
+ * called again after appending more data.
+ *
+ * Like with cbor_parser_init_reader(), all iterators of this parser share the
+ * stream's read position, so they must be used in the order the data is
+ * found in the stream.
+ *
+ * \sa cbor_value_stream_step()
+ */
+CborError cbor_parser_init_stream(CborStream *stream, CborParser *parser, CborValue *it)
+{
+    CborError err;
+    stream->pos = stream->mark;
+    stream->starved = false;
+    err = cbor_parser_init_reader(&stream_ops, parser, it, stream);
+    if (err == CborErrorUnexpectedEOF && stream->starved && !stream->finished)
+        return CborErrorNeedMoreData;
+    return err;
+}
+
+/**
+ * Runs one resumable parsing step \a func over the iterator \a it of a parser
+ * initialized with cbor_parser_init_stream(), passing \a arg along.
+ *
+ * If \a func runs out of data before the stream is finished, the iterator \a
+ * it and the stream are rewound to where they were before the call and this
+ * function returns \ref CborErrorNeedMoreData: the step should be retried
+ * with the same arguments after appending more data. Once \a func succeeds,
+ * the bytes it consumed are no longer needed and may be dropped by the next
+ * cbor_stream_append().
+ *
+ * Only \c{*it} is saved and restored, so \a func must not modify any other
+ * iterator or state in a way that cannot be repeated, until it is known to
+ * succeed. Typical steps advance over one element of an array, or decode one
+ * key and value of a map.
+ *
+ * \code
+ *   static CborError step(CborValue *it, void *arg)
+ *   {
+ *       // decode one element and advance past it
+ *   }
+ *
+ *   err = cbor_stream_append(&stream, chunk, len);
+ *   while (!err && !cbor_value_at_end(&it))
+ *       err = cbor_value_stream_step(&it, step, NULL);
+ *   if (err == CborErrorNeedMoreData)
+ *       return wait_for_next_chunk();
+ * \endcode
+ *
+ * \sa cbor_stream_append(), cbor_stream_finish()
+ */
+CborError cbor_value_stream_step(CborValue *it, CborStreamStepFunction func, void *arg)
+{
+    CborStream *stream = (CborStream *)it->source.token;
+    CborValue saved = *it;
+    size_t pos = stream->pos;
+    CborError err;
+
+    cbor_assert(it->parser->flags & CborParserFlag_ExternalSource);
+    cbor_assert(it->parser->source.ops == &stream_ops);
+
+    stream->starved = false;
+    err = func(it, arg);
+    if (err == CborErrorUnexpectedEOF && stream->starved && !stream->finished) {
+        *it = saved;
+        stream->pos = pos;
+        return CborErrorNeedMoreData;
+    }
+    if (!err)
+        stream->mark = stream->pos;
+    return err;
+}
+
+/** @} */
@@ -34,6 +34,7 @@
 #include "utf8_p.h"
 
 #include <inttypes.h>
+#include <limits.h>
 #include <string.h>
 
 /**
@@ -201,17 +202,25 @@ static CborError utf8EscapedDump(CborStreamFunction stream, void *out, const voi
     CborError err = CborNoError;
 
     while (buffer < end && !err) {
-        uint32_t uc = get_utf8(&buffer, end);
+        uint32_t uc;
+
+        /* print the characters that need no escaping in one go */
+        size_t plain = _cbor_utf8_json_plain_prefix(buffer, (size_t)(end - buffer));
+        if (plain) {
+            if (plain > INT_MAX)
+                plain = INT_MAX;
+            err = stream(out, "%.*s", (int)plain, (const char *)buffer);
+            buffer += plain;
+            continue;
+        }
+
+        uc = get_utf8(&buffer, end);
         if (uc == ~0U)
             return CborErrorInvalidUtf8TextString;
 
         if (uc < 0x80) {
             /* single-byte UTF-8 */
             unsigned char escaped = (unsigned char)uc;
-            if (uc < 0x7f && uc >= 0x20 && uc != '\\' && uc != '"') {
-                err = stream(out, "%c", (char)uc);
-                continue;
-            }
 
             /* print as an escape sequence */
             switch (uc) {
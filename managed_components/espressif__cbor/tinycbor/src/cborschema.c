@@ -0,0 +1,348 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#ifndef _BSD_SOURCE
+#define _BSD_SOURCE 1
+#endif
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE 1
+#endif
+#ifndef __STDC_LIMIT_MACROS
+#  define __STDC_LIMIT_MACROS 1
+#endif
+
+#include "cborschema.h"
+#include "compilersupport_p.h"
+#include "utf8_p.h"
+
+#include <string.h>
+
+/**
+ * \defgroup CborSchema Schema-driven decoding
+ * \brief Group of functions used to decode CBOR maps into C structures.
+ *
+ * Instead of walking a map with cbor_value_enter_container() and
+ * cbor_value_advance() and comparing each key against the expected ones, the
+ * layout of a message is described once, in a schema file, and the tool
+ * tools/cborschema/cborschema.pl turns the description into a C structure
+ * and the tables that cbor_schema_decode_advance() uses to fill it:
+ *
+ * \code
+ *      # key       type        options
+ *      message command
+ *          n       text[10]                # array of up to 10 strings
+ *          v       any                     # decoded by the caller
+ *          id      uint        required
+ *      end
+ * \endcode
+ *
+ * The supported types are \c bool, \c int (int64_t), \c uint (uint64_t),
+ * \c double, \c text and \c bytes (views into the input buffer, see
+ * CborStringView and CborByteStringView), <tt>text(N)</tt> (copied into a
+ * NUL-terminated char[N]), \c any (the CborValue itself) and the name of a
+ * message defined earlier in the file (a nested map). A type followed by
+ * <tt>[N]</tt> is an array of up to N such elements, with their count in the
+ * \c size_t member named after the field with a \c _count suffix.
+ *
+ * Each map key is looked up with a single hash computation and one final
+ * comparison: the generator picks a hash seed and a table size so that no two
+ * keys of a message share a slot. Keys that are not in the schema, including
+ * non-string keys, are skipped. The first member of each generated structure
+ * is a bitmask of the keys that were found, with one bit per field in the
+ * order of the schema file.
+ *
+ * \sa cbor_value_map_find_values()
+ */
+
+/**
+ * \addtogroup CborSchema
+ * @{
+ */
+
+/**
+ * \struct CborStringView
+ * A text string in the CBOR input, which is not NUL-terminated and is valid as
+ * long as the input buffer is.
+ */
+
+/**
+ * \struct CborByteStringView
+ * A byte string in the CBOR input, valid as long as the input buffer is.
+ */
+
+/* FNV-1a, seeded; cborschema.pl uses the same function to build the tables */
+static uint32_t hash_update(uint32_t h, const uint8_t *ptr, size_t len)
+{
+    while (len--) {
+        h ^= *ptr++;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+static uint8_t hash_slot(const CborSchemaMessage *message, uint32_t h)
+{
+    /* the low bits of FNV only depend on the low bits of the input: fold */
+    return message->hashSlots[(h ^ (h >> 16)) & message->slotMask];
+}
+
+static CborError find_field(CborValue *it, const CborSchemaMessage *message, const CborSchemaField **field)
+{
+    const CborSchemaField *candidate;
+    const char *ptr;
+    size_t len;
+    uint32_t h = 2166136261U ^ message->seed;
+    uint8_t slot;
+    CborError err;
+
+    *field = NULL;
+    if (!cbor_value_is_text_string(it))
+        return cbor_value_advance(it);
+
+    err = cbor_value_get_text_string_view(it, &ptr, &len, it);
+    if (err == CborNoError) {
+        h = hash_update(h, (const uint8_t *)ptr, len);
+        slot = hash_slot(message, h);
+        if (!slot)
+            return CborNoError;
+        candidate = &message->fields[slot - 1];
+        if (candidate->keyLength == len && memcmp(candidate->key, ptr, len) == 0)
+            *field = candidate;
+        return CborNoError;
+    }
+    if (err != CborErrorUnknownLength)
+        return err;
+
+    /* chunked string: hash the chunks, then compare against the one candidate */
+    CborValue next = *it;
+    err = cbor_value_begin_string_iteration(&next);
+    while (!err) {
+        err = cbor_value_get_text_string_chunk(&next, &ptr, &len, &next);
+        if (!err)
+            h = hash_update(h, (const uint8_t *)ptr, len);
+    }
+    if (err != CborErrorNoMoreStringChunks)
+        return err;
+    err = cbor_value_finish_string_iteration(&next);
+    if (err)
+        return err;
+
+    slot = hash_slot(message, h);
+    if (slot) {
+        bool equal;
+        candidate = &message->fields[slot - 1];
+        err = cbor_value_text_string_equals(it, candidate->key, &equal);
+        if (err)
+            return err;
+        if (equal)
+            *field = candidate;
+    }
+    *it = next;
+    return CborNoError;
+}
+
+static CborError decode_double(CborValue *it, double *result)
+{
+    CborError err = CborNoError;
+    if (cbor_value_is_double(it)) {
+        cbor_value_get_double(it, result);
+    } else if (cbor_value_is_float(it)) {
+        float f;
+        cbor_value_get_float(it, &f);
+        *result = f;
+    } else if (cbor_value_is_half_float(it)) {
+        float f;
+        err = cbor_value_get_half_float_as_float(it, &f);
+        *result = f;
+    } else if (cbor_value_is_unsigned_integer(it)) {
+        uint64_t v;
+        cbor_value_get_uint64(it, &v);
+        *result = (double)v;
+    } else if (cbor_value_is_negative_integer(it)) {
+        int64_t v;
+        err = cbor_value_get_int64_checked(it, &v);
+        *result = (double)v;
+    } else {
+        return CborErrorSchemaTypeMismatch;
+    }
+    return err ? err : cbor_value_advance_fixed(it);
+}
+
+static CborError decode_value(CborValue *it, const CborSchemaField *field, void *dst)
+{
+    CborError err;
+    size_t len;
+    switch ((CborSchemaType)field->type) {
+    case CborSchemaBoolean:
+        if (!cbor_value_is_boolean(it))
+            return CborErrorSchemaTypeMismatch;
+        cbor_value_get_boolean(it, (bool *)dst);
+        return cbor_value_advance_fixed(it);
+
+    case CborSchemaInteger:
+        if (!cbor_value_is_integer(it))
+            return CborErrorSchemaTypeMismatch;
+        err = cbor_value_get_int64_checked(it, (int64_t *)dst);
+        return err ? err : cbor_value_advance_fixed(it);
+
+    case CborSchemaUnsigned:
+        if (!cbor_value_is_unsigned_integer(it))
+            return CborErrorSchemaTypeMismatch;
+        cbor_value_get_uint64(it, (uint64_t *)dst);
+        return cbor_value_advance_fixed(it);
+
+    case CborSchemaDouble:
+        return decode_double(it, (double *)dst);
+
+    case CborSchemaText: {
+        CborStringView *view = (CborStringView *)dst;
+        if (!cbor_value_is_text_string(it))
+            return CborErrorSchemaTypeMismatch;
+        err = cbor_value_get_text_string_view(it, &view->ptr, &view->len, it);
+        if (!err && !_cbor_utf8_validate((const uint8_t *)view->ptr, view->len))
+            err = CborErrorInvalidUtf8TextString;
+        return err;
+    }
+
+    case CborSchemaBytes: {
+        CborByteStringView *view = (CborByteStringView *)dst;
+        if (!cbor_value_is_byte_string(it))
+            return CborErrorSchemaTypeMismatch;
+        return cbor_value_get_byte_string_view(it, &view->ptr, &view->len, it);
+    }
+
+    case CborSchemaTextCopy:
+        if (!cbor_value_is_text_string(it))
+            return CborErrorSchemaTypeMismatch;
+        len = field->size;
+        err = cbor_value_copy_text_string(it, (char *)dst, &len, it);
+        if (!err && len == field->size)
+            err = CborErrorOutOfMemory;     /* no room for the NUL */
+        if (!err && !_cbor_utf8_validate((const uint8_t *)dst, len))
+            err = CborErrorInvalidUtf8TextString;
+        return err;
+
+    case CborSchemaAny:
+        *(CborValue *)dst = *it;
+        return cbor_value_advance(it);
+
+    case CborSchemaMap:
+        return cbor_schema_decode_advance(it, field->message, dst);
+    }
+    return CborErrorSchemaTypeMismatch;
+}
+
+static CborError decode_array(CborValue *it, const CborSchemaField *field, uint8_t *dst, size_t *count)
+{
+    CborValue element;
+    CborError err;
+    if (!cbor_value_is_array(it))
+        return CborErrorSchemaTypeMismatch;
+
+    err = cbor_value_enter_container(it, &element);
+    while (!err && !cbor_value_at_end(&element)) {
+        if (*count == field->maxCount)
+            return CborErrorSchemaTooManyItems;
+        err = decode_value(&element, field, dst + *count * field->size);
+        ++*count;
+    }
+    return err ? err : cbor_value_leave_container(it, &element);
+}
+
+/**
+ * Decodes the map pointed to by \a it into the structure \a out, according to
+ * the schema \a message generated by cborschema.pl, and advances \a it to the
+ * next item after the map. The structure is cleared first, so members for
+ * keys that are not in the map are zero.
+ *
+ * The map is validated while it is decoded, in a single pass. This function
+ * returns \ref CborErrorSchemaTypeMismatch if the map or one of its values
+ * does not have the type declared in the schema, \ref
+ * CborErrorDuplicateObjectKeys if a key repeats, \ref CborErrorSchemaMissingKey
+ * if a field marked \c required is absent, \ref CborErrorSchemaTooManyItems if
+ * an array has more elements than the schema allows, \ref CborErrorOutOfMemory
+ * if a copied text string does not fit its buffer with the terminating NUL, and
+ * \ref CborErrorInvalidUtf8TextString if a text string is not valid UTF-8.
+ *
+ * Text and byte string views, as well as values of type \c any, point into
+ * the buffer being parsed. Views require definite-length strings and this
+ * function returns \ref CborErrorUnknownLength for chunked ones; use
+ * <tt>text(N)</tt> if the sender may chunk its strings.
+ *
+ * On error, the contents of \a out and \a it are undefined.
+ *
+ * \sa cbor_schema_decode()
+ */
+CborError cbor_schema_decode_advance(CborValue *it, const CborSchemaMessage *message, void *out)
+{
+    const CborSchemaField *field;
+    CborValue element;
+    CborError err;
+    uint32_t present = 0;
+
+    if (!cbor_value_is_map(it))
+        return CborErrorSchemaTypeMismatch;
+    memset(out, 0, message->size);
+
+    err = cbor_value_enter_container(it, &element);
+    while (!err && !cbor_value_at_end(&element)) {
+        err = find_field(&element, message, &field);
+        if (err)
+            break;
+        if (!field) {
+            /* not in the schema */
+            err = cbor_value_advance(&element);
+            continue;
+        }
+
+        uint32_t bit = 1U << (field - message->fields);
+        if (present & bit)
+            return CborErrorDuplicateObjectKeys;
+        present |= bit;
+
+        uint8_t *dst = (uint8_t *)out + field->offset;
+        if (field->flags & CborSchemaFieldArray)
+            err = decode_array(&element, field, dst, (size_t *)((uint8_t *)out + field->countOffset));
+        else
+            err = decode_value(&element, field, dst);
+    }
+    if (err)
+        return err;
+    if ((present & message->required) != message->required)
+        return CborErrorSchemaMissingKey;
+
+    memcpy(out, &present, sizeof(present));
+    return cbor_value_leave_container(it, &element);
+}
+
+/**
+ * \fn CborError cbor_schema_decode(const CborValue *it, const CborSchemaMessage *message, void *out)
+ *
+ * Decodes the map pointed to by \a it into the structure \a out, like
+ * cbor_schema_decode_advance(), but does not advance \a it.
+ *
+ * \sa cbor_schema_decode_advance()
+ */
+
+/** @} */
@@ -0,0 +1,103 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+
+#ifndef CBORSCHEMA_H
+#define CBORSCHEMA_H
+
+#include "cbor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Schema-driven decoding */
+typedef struct CborStringView
+{
+    const char *ptr;
+    size_t len;
+} CborStringView;
+
+typedef struct CborByteStringView
+{
+    const uint8_t *ptr;
+    size_t len;
+} CborByteStringView;
+
+typedef enum CborSchemaType
+{
+    CborSchemaBoolean,          /* bool */
+    CborSchemaInteger,          /* int64_t */
+    CborSchemaUnsigned,         /* uint64_t */
+    CborSchemaDouble,           /* double */
+    CborSchemaText,             /* CborStringView */
+    CborSchemaBytes,            /* CborByteStringView */
+    CborSchemaTextCopy,         /* char[size] */
+    CborSchemaAny,              /* CborValue */
+    CborSchemaMap               /* nested message */
+} CborSchemaType;
+
+enum CborSchemaFieldFlags
+{
+    CborSchemaFieldRequired = 1,
+    CborSchemaFieldArray = 2
+};
+
+struct CborSchemaMessage;
+typedef struct CborSchemaField
+{
+    const char *key;
+    uint16_t keyLength;
+    uint8_t type;
+    uint8_t flags;
+    uint16_t offset;
+    uint16_t size;
+    uint16_t maxCount;
+    uint16_t countOffset;
+    const struct CborSchemaMessage *message;
+} CborSchemaField;
+
+typedef struct CborSchemaMessage
+{
+    const CborSchemaField *fields;
+    const uint8_t *hashSlots;
+    size_t size;
+    uint32_t seed;
+    uint32_t required;
+    uint16_t fieldCount;
+    uint16_t slotMask;
+} CborSchemaMessage;
+
+CBOR_API CborError cbor_schema_decode_advance(CborValue *it, const CborSchemaMessage *message, void *out);
+CBOR_INLINE_API CborError cbor_schema_decode(const CborValue *it, const CborSchemaMessage *message, void *out)
+{
+    CborValue copy = *it;
+    return cbor_schema_decode_advance(&copy, message, out);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CBORSCHEMA_H */
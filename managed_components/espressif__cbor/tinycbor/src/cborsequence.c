@@ -0,0 +1,269 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+
+#ifndef _BSD_SOURCE
+#define _BSD_SOURCE 1
+#endif
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE 1
+#endif
+#ifndef __STDC_LIMIT_MACROS
+#  define __STDC_LIMIT_MACROS 1
+#endif
+
+#include "cbor.h"
+#include "compilersupport_p.h"
+
+#include <string.h>
+
+/**
+ * \addtogroup CborEncoding
+ * @{
+ */
+
+/**
+ * \struct CborSequence
+ *
+ * An append-only CBOR sequence (RFC 8742): independent top-level items
+ * stored one after the other in a caller-provided buffer, with no array or
+ * map around them. Items are appended by encoding them directly at the end
+ * of the buffer, so appending costs no more than encoding, and they are read
+ * back in order with cbor_sequence_next().
+ *
+ * The sequence only ever contains complete items: an item is added by
+ * cbor_sequence_commit() or cbor_sequence_append() once it is whole, and an
+ * item that did not fit is simply not added. This makes the buffer safe to
+ * keep across resets (for example, in RTC memory): cbor_sequence_init()
+ * drops an item whose writing was interrupted.
+ *
+ * \code
+ *      CborSequence seq;
+ *      CborEncoder encoder;
+ *      cbor_sequence_init(&seq, buffer, sizeof(buffer), 0);
+ *
+ *      // when an event happens
+ *      cbor_encoder_init_sequence(&encoder, &seq, 0);
+ *      encode_event(&encoder, event);
+ *      if (cbor_sequence_commit(&seq, &encoder) == CborErrorOutOfMemory)
+ *          ++dropped_events;
+ *
+ *      // later, all the events go in one array
+ *      cbor_encoder_create_array(&map, &array, CborIndefiniteLength);
+ *      cbor_encode_sequence(&array, &seq);
+ *      cbor_encoder_close_container(&map, &array);
+ * \endcode
+ *
+ * The read position is kept in the sequence too, so reading can stop and
+ * resume at any item boundary, even while more items are appended. The items
+ * already read stay in the buffer until cbor_sequence_discard_read().
+ */
+
+/* Finds the complete items at the beginning of [ptr, ptr + len): returns
+ * their number in *count and their size in *size. */
+static CborError scan_items(const uint8_t *ptr, size_t len, size_t *count, size_t *size)
+{
+    const uint8_t *begin = ptr;
+    const uint8_t *end = ptr + len;
+    CborError err = CborNoError;
+    *count = 0;
+    *size = 0;
+    while (ptr != end) {
+        CborParser parser;
+        CborValue it;
+        err = cbor_parser_init(ptr, (size_t)(end - ptr), 0, &parser, &it);
+        if (!err)
+            err = cbor_value_advance(&it);
+        if (err)
+            break;
+        ptr = cbor_value_get_next_byte(&it);
+        *size = (size_t)(ptr - begin);
+        ++*count;
+    }
+    return err;
+}
+
+/**
+ * Initializes the sequence \a seq to use the buffer \a buffer of \a size
+ * bytes. The first \a used bytes of the buffer are existing items, for
+ * example the contents of a sequence that was being written before a reset;
+ * pass 0 to start empty. The buffer must remain valid for as long as the
+ * sequence is used.
+ *
+ * The existing items are scanned to count them. If the last one is
+ * incomplete, because its writing was interrupted, it is dropped and this
+ * function returns CborNoError. If the data is not well-formed, the sequence
+ * keeps the items before the error and this function returns the error.
+ *
+ * The read position starts at the first item.
+ */
+CborError cbor_sequence_init(CborSequence *seq, uint8_t *buffer, size_t size, size_t used)
+{
+    CborError err;
+    seq->buffer = buffer;
+    seq->size = size;
+    seq->pos = 0;
+    err = scan_items(buffer, used, &seq->count, &seq->used);
+    return err == CborErrorUnexpectedEOF ? CborNoError : err;
+}
+
+/**
+ * \fn bool cbor_sequence_at_end(const CborSequence *seq)
+ *
+ * Returns true if all the items of the sequence \a seq were read.
+ *
+ * \sa cbor_sequence_next()
+ */
+
+/**
+ * \fn size_t cbor_sequence_get_count(const CborSequence *seq)
+ *
+ * Returns the number of items of the sequence \a seq that were not read yet.
+ */
+
+/**
+ * Appends the items encoded in the \a len bytes at \a data to the sequence
+ * \a seq. The data must contain only complete, well-formed items; otherwise
+ * this function returns the error found and the sequence is not modified. If
+ * there is not enough room, it returns CborErrorOutOfMemory and the sequence
+ * is not modified either.
+ *
+ * To append an item that is not encoded yet, encode it in place with an
+ * encoder from cbor_encoder_init_sequence() instead, which saves a copy.
+ */
+CborError cbor_sequence_append(CborSequence *seq, const void *data, size_t len)
+{
+    size_t count, size;
+    CborError err;
+    if (seq->size - seq->used < len)
+        return CborErrorOutOfMemory;
+    err = scan_items((const uint8_t *)data, len, &count, &size);
+    if (err)
+        return err;
+    if (len)
+        memcpy(seq->buffer + seq->used, data, len);
+    seq->used += len;
+    seq->count += count;
+    return CborNoError;
+}
+
+/**
+ * Removes the items of the sequence \a seq that were already read, moving
+ * the remaining ones to the beginning of the buffer to make room for new
+ * items. This invalidates iterators and string pointers obtained from
+ * cbor_sequence_next().
+ */
+void cbor_sequence_discard_read(CborSequence *seq)
+{
+    memmove(seq->buffer, seq->buffer + seq->pos, seq->used - seq->pos);
+    seq->used -= seq->pos;
+    seq->pos = 0;
+}
+
+/**
+ * Initializes the encoder \a encoder to encode one item at the end of the
+ * sequence \a seq. The \a flags are the same as for cbor_encoder_init().
+ * The item is only added to the sequence by cbor_sequence_commit(): until
+ * then, it is invisible to readers and an encoder that is not committed
+ * leaves the sequence unchanged.
+ *
+ * \sa cbor_sequence_commit()
+ */
+void cbor_encoder_init_sequence(CborEncoder *encoder, CborSequence *seq, int flags)
+{
+    cbor_encoder_init(encoder, seq->buffer + seq->used, seq->size - seq->used, flags);
+}
+
+/**
+ * Adds the item encoded by \a encoder, which was initialized with
+ * cbor_encoder_init_sequence() on the same sequence \a seq, to the end of
+ * the sequence. This takes constant time.
+ *
+ * If the item did not fit in the buffer, this function returns
+ * CborErrorOutOfMemory and the sequence is not modified; use
+ * cbor_encoder_get_extra_bytes_needed() to find out how much room was
+ * missing. The encoder must have encoded exactly one top-level item,
+ * otherwise this function returns CborErrorTooFewItems or
+ * CborErrorTooManyItems.
+ */
+CborError cbor_sequence_commit(CborSequence *seq, const CborEncoder *encoder)
+{
+    if (!encoder->end)
+        return CborErrorOutOfMemory;
+    if (encoder->remaining != 1)
+        return encoder->remaining == 0 ? CborErrorTooManyItems : CborErrorTooFewItems;
+
+    seq->used += cbor_encoder_get_buffer_size(encoder, seq->buffer + seq->used);
+    ++seq->count;
+    return CborNoError;
+}
+
+/** @} */
+
+/**
+ * \addtogroup CborParsing
+ * @{
+ */
+
+/**
+ * Initializes the parser \a parser to parse the next unread item of the
+ * sequence \a seq, returning the iterator to it in \a it, and moves the read
+ * position of the sequence past that item. The item is known to be complete
+ * and well-formed. The parser and the iterator remain valid until
+ * cbor_sequence_discard_read() is called.
+ *
+ * If all the items were read, this function returns \ref
+ * CborErrorNeedMoreData: it can be called again after more items are
+ * appended.
+ *
+ * \code
+ *      CborParser parser;
+ *      CborValue it;
+ *      while (cbor_sequence_next(&seq, &parser, &it) == CborNoError)
+ *          decode_event(&it);
+ *      cbor_sequence_discard_read(&seq);
+ * \endcode
+ *
+ * \sa cbor_sequence_at_end()
+ */
+CborError cbor_sequence_next(CborSequence *seq, CborParser *parser, CborValue *it)
+{
+    CborValue next;
+    CborError err;
+    if (cbor_sequence_at_end(seq))
+        return CborErrorNeedMoreData;
+
+    err = cbor_parser_init(seq->buffer + seq->pos, seq->used - seq->pos, 0, parser, it);
+    if (err)
+        return err;
+    next = *it;
+    err = cbor_value_advance(&next);
+    if (err)
+        return err;
+    seq->pos = (size_t)(cbor_value_get_next_byte(&next) - seq->buffer);
+    --seq->count;
+    return CborNoError;
+}
+
+/** @} */
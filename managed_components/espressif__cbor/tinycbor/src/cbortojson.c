@@ -35,6 +35,7 @@
 #include "cborinternal_p.h"
 #include "compilersupport_p.h"
 #include "cborinternal_p.h"
+#include "utf8_p.h"
 
 #include <inttypes.h>
 #include <stdio.h>
@@ -168,6 +169,63 @@ typedef struct ConversionStatus {
 
 static CborError value_to_json(FILE *out, CborValue *it, int flags, CborType type, ConversionStatus *status);
 
+/* Prints the contents of a JSON string. Only quotes, backslashes and control
+ * characters need escaping, so everything else is copied in runs once the
+ * UTF-8 has been validated. */
+static CborError escape_json_string(FILE *out, const char *str, size_t n)
+{
+    const uint8_t *ptr = (const uint8_t *)str;
+    const uint8_t * const end = ptr + n;
+    while (ptr < end) {
+        const uint8_t *run = ptr;
+        uint8_t c;
+        do {
+            ptr += _cbor_utf8_json_plain_prefix(ptr, (size_t)(end - ptr));
+
+            /* the scan also stops at DEL and non-ASCII, which are copied */
+            while (ptr < end && *ptr >= 0x7f) {
+                if (*ptr == 0x7f)
+                    ++ptr;
+                else if (get_utf8(&ptr, end) == ~0U)
+                    return CborErrorInvalidUtf8TextString;
+            }
+        } while (ptr < end && *ptr >= 0x20 && *ptr != '"' && *ptr != '\\');
+        if (ptr != run && fwrite(run, 1, (size_t)(ptr - run), out) != (size_t)(ptr - run))
+            return CborErrorIO;
+        if (ptr == end)
+            break;
+
+        c = *ptr++;
+        switch (c) {
+        case '"':
+        case '\\':
+            break;
+        case '\b':
+            c = 'b';
+            break;
+        case '\f':
+            c = 'f';
+            break;
+        case '\n':
+            c = 'n';
+            break;
+        case '\r':
+            c = 'r';
+            break;
+        case '\t':
+            c = 't';
+            break;
+        default:
+            if (fprintf(out, "\\u%04X", c) < 0)
+                return CborErrorIO;
+            continue;
+        }
+        if (fputc('\\', out) < 0 || fputc(c, out) < 0)
+            return CborErrorIO;
+    }
+    return CborNoError;
+}
+
 static CborError dump_bytestring_base16(char **result, CborValue *it)
 {
     static const char characters[] = "0123456789abcdef";
@@ -449,16 +507,18 @@ static CborError map_to_json(FILE *out, CborValue *it, int flags, ConversionStat
     CborError err;
     while (!cbor_value_at_end(it)) {
         char *key;
+        size_t keyLength = 0;
         if (fprintf(out, "%s", comma) < 0)
             return CborErrorIO;
         comma = ",";
 
         CborType keyType = cbor_value_get_type(it);
         if (likely(keyType == CborTextStringType)) {
-            size_t n = 0;
-            err = cbor_value_dup_text_string(it, &key, &n, it);
+            err = cbor_value_dup_text_string(it, &key, &keyLength, it);
         } else if (flags & CborConvertStringifyMapKeys) {
             err = stringify_map_key(&key, it, flags, keyType);
+            if (!err)
+                keyLength = strlen(key);
         } else {
             return CborErrorJsonObjectKeyNotString;
         }
@@ -466,9 +526,15 @@ static CborError map_to_json(FILE *out, CborValue *it, int flags, ConversionStat
             return err;
 
         /* first, print the key */
-        if (fprintf(out, "\"%s\":", key) < 0) {
+        if (fputc('"', out) < 0)
+            err = CborErrorIO;
+        if (!err)
+            err = escape_json_string(out, key, keyLength);
+        if (!err && fputs("\":", out) < 0)
+            err = CborErrorIO;
+        if (err) {
             free(key);
-            return CborErrorIO;
+            return err;
         }
 
         /* then, print the value */
@@ -478,11 +544,13 @@ static CborError map_to_json(FILE *out, CborValue *it, int flags, ConversionStat
         /* finally, print any metadata we may have */
         if (flags & CborConvertAddMetadata) {
             if (!err && keyType != CborTextStringType) {
-                if (fprintf(out, ",\"%s$keycbordump\":true", key) < 0)
+                if (fputs(",\"", out) < 0 || escape_json_string(out, key, keyLength) != CborNoError ||
+                        fputs("$keycbordump\":true", out) < 0)
                     err = CborErrorIO;
             }
             if (!err && status->flags) {
-                if (fprintf(out, ",\"%s$cbor\":{", key) < 0 ||
+                if (fputs(",\"", out) < 0 || escape_json_string(out, key, keyLength) != CborNoError ||
+                        fputs("$cbor\":{", out) < 0 ||
                         add_value_metadata(out, valueType, status) != CborNoError ||
                         fputc('}', out) < 0)
                     err = CborErrorIO;
@@ -560,14 +628,22 @@ static CborError value_to_json(FILE *out, CborValue *it, int flags, CborType typ
         char *str;
         if (type == CborByteStringType) {
             err = dump_bytestring_base64url(&str, it);
+            if (err)
+                return err;
             status->flags = TypeWasNotNative;
+            err = (fprintf(out, "\"%s\"", str) < 0) ? CborErrorIO : CborNoError;
         } else {
             size_t n = 0;
             err = cbor_value_dup_text_string(it, &str, &n, it);
+            if (err)
+                return err;
+            if (fputc('"', out) < 0)
+                err = CborErrorIO;
+            if (!err)
+                err = escape_json_string(out, str, n);
+            if (!err && fputc('"', out) < 0)
+                err = CborErrorIO;
         }
-        if (err)
-            return err;
-        err = (fprintf(out, "\"%s\"", str) < 0) ? CborErrorIO : CborNoError;
         free(str);
         return err;
     }
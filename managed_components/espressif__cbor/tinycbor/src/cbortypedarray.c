@@ -0,0 +1,248 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+
+#ifndef _BSD_SOURCE
+#define _BSD_SOURCE 1
+#endif
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE 1
+#endif
+#ifndef __STDC_LIMIT_MACROS
+#  define __STDC_LIMIT_MACROS 1
+#endif
+
+#include "cbor.h"
+#include "compilersupport_p.h"
+
+#include <string.h>
+
+/**
+ * \enum CborTypedArrayType
+ * The CborTypedArrayType enum lists the element types of the typed arrays of
+ * RFC 8746 that TinyCBOR supports. A typed array is a tagged byte string
+ * containing the packed elements, so N values take N times the size of the
+ * element plus a few bytes, instead of up to 9 bytes per value in a CBOR
+ * array. The tag number tells the element type and the byte order.
+ *
+ * \value CborTypedArrayUint8       Unsigned 8-bit integers (tag 64)
+ * \value CborTypedArrayUint16      Unsigned 16-bit integers (tags 65 and 69)
+ * \value CborTypedArrayUint32      Unsigned 32-bit integers (tags 66 and 70)
+ * \value CborTypedArrayUint64      Unsigned 64-bit integers (tags 67 and 71)
+ * \value CborTypedArraySint8       Signed 8-bit integers (tag 72)
+ * \value CborTypedArraySint16      Signed 16-bit integers (tags 73 and 77)
+ * \value CborTypedArraySint32      Signed 32-bit integers (tags 74 and 78)
+ * \value CborTypedArraySint64      Signed 64-bit integers (tags 75 and 79)
+ * \value CborTypedArrayFloat16     IEEE 754 half-precision floating point, as uint16_t (tags 80 and 84)
+ * \value CborTypedArrayFloat32     IEEE 754 single-precision floating point (tags 81 and 85)
+ * \value CborTypedArrayFloat64     IEEE 754 double-precision floating point (tags 82 and 86)
+ *
+ * \sa cbor_encode_typed_array(), cbor_value_copy_typed_array()
+ */
+
+#define TypedArrayTagBase       64
+#define TypedArrayLittleEndian  0x04
+
+static inline bool is_little_endian(void)
+{
+    return cbor_htons(1) != 1;
+}
+
+/* returns the element size, or 0 if the type is not supported */
+static size_t element_size(int type)
+{
+    if (type & ~0x1b || type > CborTypedArrayFloat64)
+        return 0;
+    if (type & 0x10)
+        return (size_t)2 << (type & 3);
+    return (size_t)1 << (type & 3);
+}
+
+static CborError type_from_tag(CborTag tag, CborTypedArrayType *type, bool *littleEndian)
+{
+    int bits = (int)(tag - TypedArrayTagBase);
+    if (tag < TypedArrayTagBase || bits > 0x17)
+        return CborErrorIllegalType;
+
+    *littleEndian = bits & TypedArrayLittleEndian;
+    bits &= ~TypedArrayLittleEndian;
+    if (element_size(bits) == 0)
+        return CborErrorUnsupportedType;        /* float128 */
+    if (element_size(bits) == 1) {
+        /* tag 68 is uint8 with clamped arithmetic; tag 76 is reserved */
+        if (*littleEndian && bits == CborTypedArraySint8)
+            return CborErrorUnsupportedType;
+        *littleEndian = is_little_endian();
+    }
+    *type = (CborTypedArrayType)bits;
+    return CborNoError;
+}
+
+static void swap_elements(uint8_t *ptr, size_t count, size_t size)
+{
+    for ( ; count; --count, ptr += size) {
+        uint8_t *begin = ptr, *end = ptr + size;
+        while (begin < --end) {
+            uint8_t c = *begin;
+            *begin++ = *end;
+            *end = c;
+        }
+    }
+}
+
+/**
+ * \addtogroup CborEncoding
+ * @{
+ */
+
+/**
+ * Appends the \a count elements of type \a type at \a data to the CBOR
+ * stream provided by \a encoder as an RFC 8746 typed array: a tag followed by
+ * a byte string with the elements as they are in memory. The data is copied
+ * as is, with no conversion: the tag records the byte order of this machine,
+ * which is allowed by RFC 8746 and read back by cbor_value_copy_typed_array()
+ * on machines of either byte order. Half-precision elements are passed as
+ * their uint16_t representation.
+ *
+ * The array counts as a single item of the container being encoded. If \a
+ * type is not a valid CborTypedArrayType, this function returns
+ * CborErrorUnsupportedType.
+ *
+ * \sa CborTypedArrayType
+ */
+CborError cbor_encode_typed_array(CborEncoder *encoder, CborTypedArrayType type, const void *data, size_t count)
+{
+    size_t size = element_size(type);
+    CborTag tag = TypedArrayTagBase + type;
+    CborError err;
+    if (size == 0)
+        return CborErrorUnsupportedType;
+    if (count > SIZE_MAX / size)
+        return CborErrorDataTooLarge;
+    if (size > 1 && is_little_endian())
+        tag += TypedArrayLittleEndian;
+
+    err = cbor_encode_tag(encoder, tag);
+    if (err && err != CborErrorOutOfMemory)
+        return err;
+    return (CborError)(err | cbor_encode_byte_string(encoder, (const uint8_t *)data, count * size));
+}
+
+/** @} */
+
+/**
+ * \addtogroup CborParsing
+ * @{
+ */
+
+/**
+ * Retrieves the element type of the RFC 8746 typed array that \a value points
+ * to, which must be a tag, and stores it in \a type. If the tag is not a
+ * typed array tag, this function returns CborErrorIllegalType; if it is the
+ * tag of a typed array TinyCBOR does not support (128-bit floating point),
+ * it returns CborErrorUnsupportedType.
+ *
+ * \sa cbor_value_copy_typed_array()
+ */
+CborError cbor_value_get_typed_array_type(const CborValue *value, CborTypedArrayType *type)
+{
+    CborTag tag;
+    bool littleEndian;
+    if (!cbor_value_is_tag(value))
+        return CborErrorIllegalType;
+    cbor_value_get_tag(value, &tag);
+    return type_from_tag(tag, type, &littleEndian);
+}
+
+/**
+ * Copies the elements of the RFC 8746 typed array that \a value points to
+ * into \a buffer, which has room for \a *count elements of type \a type, and
+ * stores the number of elements in \a *count. The elements are converted to
+ * the byte order of this machine. If \a next is not NULL, it is updated to
+ * point to the item after the typed array.
+ *
+ * If \a buffer is NULL, this function only stores the number of elements in
+ * \a *count, so that a large enough buffer can be allocated.
+ *
+ * Possible errors are:
+ * \list
+ *   \li CborErrorIllegalType: \a value is not a typed array of elements of
+ *       type \a type (in either byte order);
+ *   \li CborErrorImproperValue: the byte string length is not a multiple of
+ *       the element size;
+ *   \li CborErrorOutOfMemory: the array has more than \a *count elements.
+ *       Nothing is copied.
+ * \endlist
+ *
+ * \sa cbor_value_get_typed_array_type(), cbor_encode_typed_array()
+ */
+CborError cbor_value_copy_typed_array(const CborValue *value, CborTypedArrayType type, void *buffer,
+                                      size_t *count, CborValue *next)
+{
+    CborTypedArrayType actual;
+    CborValue str;
+    CborTag tag;
+    bool littleEndian;
+    size_t size = element_size(type), len;
+    CborError err;
+
+    if (!cbor_value_is_tag(value))
+        return CborErrorIllegalType;
+    cbor_value_get_tag(value, &tag);
+    err = type_from_tag(tag, &actual, &littleEndian);
+    if (err || actual != type)
+        return CborErrorIllegalType;
+
+    str = *value;
+    err = cbor_value_advance_fixed(&str);
+    if (err)
+        return err;
+    if (!cbor_value_is_byte_string(&str))
+        return CborErrorIllegalType;
+    err = cbor_value_calculate_string_length(&str, &len);
+    if (err)
+        return err;
+    if (len % size)
+        return CborErrorImproperValue;
+
+    if (!buffer) {
+        *count = len / size;
+        if (!next)
+            return CborNoError;
+        *next = str;
+        return cbor_value_advance(next);
+    }
+    if (len / size > *count)
+        return CborErrorOutOfMemory;
+
+    err = cbor_value_copy_byte_string(&str, (uint8_t *)buffer, &len, next);
+    if (err)
+        return err;
+    *count = len / size;
+    if (littleEndian != is_little_endian())
+        swap_elements((uint8_t *)buffer, *count, size);
+    return CborNoError;
+}
+
+/** @} */
@@ -0,0 +1,326 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+
+#define _BSD_SOURCE 1
+#define _DEFAULT_SOURCE 1
+#ifndef __STDC_LIMIT_MACROS
+#  define __STDC_LIMIT_MACROS 1
+#endif
+
+#include "cbor.h"
+#include "cborinternal_p.h"
+#include "compilersupport_p.h"
+#include "utf8_p.h"
+
+#include <string.h>
+
+/*
+ * The scans below look for the first byte that needs more than a copy: a
+ * byte with the high bit set when checking for ASCII, or a byte that a JSON
+ * string can't hold as-is. They process a whole vector at a time and leave
+ * the last partial block, and the block where the search stopped, to the
+ * word-at-a-time code, which also serves targets without a vector unit.
+ *
+ * SSE2 is part of x86-64 and NEON of AArch64, so those are used whenever the
+ * compiler targets them. AVX2 is optional and is selected at run time.
+ */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define CBOR_UTF8_HAVE_SSE2
+#  include <emmintrin.h>
+#  if defined(__AVX2__)
+#    define CBOR_UTF8_HAVE_AVX2
+#    define CBOR_UTF8_AVX2_TARGET
+#    include <immintrin.h>
+#  elif (defined(__x86_64__) || defined(__i386__)) && !defined(__INTEL_COMPILER) && \
+    (defined(__clang__) || (__GNUC__ * 100 + __GNUC_MINOR__ >= 409))
+#    define CBOR_UTF8_HAVE_AVX2
+#    define CBOR_UTF8_AVX2_RUNTIME
+#    define CBOR_UTF8_AVX2_TARGET   __attribute__((target("avx2")))
+#    include <immintrin.h>
+#  endif
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#  define CBOR_UTF8_HAVE_NEON
+#  include <arm_neon.h>
+#endif
+
+typedef size_t (*ScanFunction)(const uint8_t *ptr, size_t n);
+
+typedef struct Utf8Implementation {
+    ScanFunction ascii_prefix;
+    ScanFunction json_plain_prefix;
+} Utf8Implementation;
+
+#define WORD_ONES       ((size_t)-1 / 0xff)         /* 0x0101...01 */
+#define WORD_HIGHS      (WORD_ONES * 0x80)          /* 0x8080...80 */
+
+static inline bool byte_needs_escape(uint8_t c)
+{
+    return c < 0x20 || c >= 0x7f || c == '"' || c == '\\';
+}
+
+/* Returns the high bit of each byte of w that needs escaping. None of the
+ * additions carry from one byte into the next, so the result is exact. */
+static inline size_t word_needs_escape(size_t w)
+{
+    size_t low = w & ~WORD_HIGHS;
+    size_t quote = w ^ (WORD_ONES * '"');
+    size_t backslash = w ^ (WORD_ONES * '\\');
+    size_t r;
+
+    /* 0x7f and up: the high bit is set or adding 1 carries into it */
+    r = w | (low + WORD_ONES);
+    /* below 0x20: the high bit is clear and adding 0x60 doesn't set it */
+    r |= ~(w | (low + WORD_ONES * 0x60));
+    /* zero bytes after XOR with the quote and the backslash */
+    r |= ~(quote | ((quote & ~WORD_HIGHS) + ~WORD_HIGHS));
+    r |= ~(backslash | ((backslash & ~WORD_HIGHS) + ~WORD_HIGHS));
+    return r & WORD_HIGHS;
+}
+
+static size_t ascii_prefix_scalar(const uint8_t *ptr, size_t n)
+{
+    size_t i = 0;
+    for ( ; n - i >= sizeof(size_t); i += sizeof(size_t)) {
+        size_t w;
+        memcpy(&w, ptr + i, sizeof(w));
+        if (w & WORD_HIGHS)
+            break;
+    }
+    while (i < n && ptr[i] < 0x80)
+        ++i;
+    return i;
+}
+
+static size_t json_plain_prefix_scalar(const uint8_t *ptr, size_t n)
+{
+    size_t i = 0;
+    for ( ; n - i >= sizeof(size_t); i += sizeof(size_t)) {
+        size_t w;
+        memcpy(&w, ptr + i, sizeof(w));
+        if (word_needs_escape(w))
+            break;
+    }
+    while (i < n && !byte_needs_escape(ptr[i]))
+        ++i;
+    return i;
+}
+
+#ifdef CBOR_UTF8_HAVE_SSE2
+static size_t ascii_prefix_sse2(const uint8_t *ptr, size_t n)
+{
+    size_t i = 0;
+    for ( ; n - i >= 16; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(ptr + i));
+        if (_mm_movemask_epi8(v))
+            break;
+    }
+    return i + ascii_prefix_scalar(ptr + i, n - i);
+}
+
+static size_t json_plain_prefix_sse2(const uint8_t *ptr, size_t n)
+{
+    const __m128i space = _mm_set1_epi8(0x20);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i del = _mm_set1_epi8(0x7f);
+    size_t i = 0;
+    for ( ; n - i >= 16; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(ptr + i));
+        /* the signed comparison also catches bytes 0x80 and up */
+        __m128i special = _mm_or_si128(_mm_cmplt_epi8(v, space), _mm_cmpeq_epi8(v, del));
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(v, quote));
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(v, backslash));
+        if (_mm_movemask_epi8(special))
+            break;
+    }
+    return i + json_plain_prefix_scalar(ptr + i, n - i);
+}
+#endif
+
+#ifdef CBOR_UTF8_HAVE_AVX2
+CBOR_UTF8_AVX2_TARGET static size_t ascii_prefix_avx2(const uint8_t *ptr, size_t n)
+{
+    size_t i = 0;
+    for ( ; n - i >= 32; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(ptr + i));
+        if (_mm256_movemask_epi8(v))
+            break;
+    }
+    return i + ascii_prefix_scalar(ptr + i, n - i);
+}
+
+CBOR_UTF8_AVX2_TARGET static size_t json_plain_prefix_avx2(const uint8_t *ptr, size_t n)
+{
+    const __m256i space = _mm256_set1_epi8(0x20);
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    size_t i = 0;
+    for ( ; n - i >= 32; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(ptr + i));
+        __m256i special = _mm256_or_si256(_mm256_cmpgt_epi8(space, v), _mm256_cmpeq_epi8(v, del));
+        special = _mm256_or_si256(special, _mm256_cmpeq_epi8(v, quote));
+        special = _mm256_or_si256(special, _mm256_cmpeq_epi8(v, backslash));
+        if (_mm256_movemask_epi8(special))
+            break;
+    }
+    return i + json_plain_prefix_scalar(ptr + i, n - i);
+}
+#endif
+
+#ifdef CBOR_UTF8_HAVE_NEON
+static size_t ascii_prefix_neon(const uint8_t *ptr, size_t n)
+{
+    size_t i = 0;
+    for ( ; n - i >= 16; i += 16) {
+        uint8x16_t v = vld1q_u8(ptr + i);
+        if (vmaxvq_u8(v) >= 0x80)
+            break;
+    }
+    return i + ascii_prefix_scalar(ptr + i, n - i);
+}
+
+static size_t json_plain_prefix_neon(const uint8_t *ptr, size_t n)
+{
+    const uint8x16_t space = vdupq_n_u8(0x20);
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    const uint8x16_t del = vdupq_n_u8(0x7f);
+    size_t i = 0;
+    for ( ; n - i >= 16; i += 16) {
+        uint8x16_t v = vld1q_u8(ptr + i);
+        uint8x16_t special = vorrq_u8(vcltq_u8(v, space), vcgeq_u8(v, del));
+        special = vorrq_u8(special, vceqq_u8(v, quote));
+        special = vorrq_u8(special, vceqq_u8(v, backslash));
+        if (vmaxvq_u8(special))
+            break;
+    }
+    return i + json_plain_prefix_scalar(ptr + i, n - i);
+}
+#endif
+
+static const Utf8Implementation implementations[] = {
+    { ascii_prefix_scalar, json_plain_prefix_scalar },
+#ifdef CBOR_UTF8_HAVE_SSE2
+    { ascii_prefix_sse2, json_plain_prefix_sse2 },
+#else
+    { NULL, NULL },
+#endif
+#ifdef CBOR_UTF8_HAVE_AVX2
+    { ascii_prefix_avx2, json_plain_prefix_avx2 },
+#else
+    { NULL, NULL },
+#endif
+#ifdef CBOR_UTF8_HAVE_NEON
+    { ascii_prefix_neon, json_plain_prefix_neon },
+#else
+    { NULL, NULL },
+#endif
+};
+
+static const Utf8Implementation *current_implementation;
+
+/* The pointer may be set by several threads at once; it only ever points to
+ * the constant table, so relaxed ordering is enough. */
+#if defined(__GNUC__) || defined(__clang__)
+#  define load_implementation()     __atomic_load_n(&current_implementation, __ATOMIC_RELAXED)
+#  define store_implementation(p)   __atomic_store_n(&current_implementation, (p), __ATOMIC_RELAXED)
+#else
+#  define load_implementation()     (current_implementation)
+#  define store_implementation(p)   (void)(current_implementation = (p))
+#endif
+
+static bool implementation_is_available(CborUtf8Implementation impl)
+{
+    if (implementations[impl].ascii_prefix == NULL)
+        return false;
+#ifdef CBOR_UTF8_AVX2_RUNTIME
+    if (impl == CborUtf8Avx2)
+        return __builtin_cpu_supports("avx2");
+#endif
+    return true;
+}
+
+static const Utf8Implementation *select_implementation(void)
+{
+    int impl = sizeof(implementations) / sizeof(implementations[0]);
+    while (--impl > CborUtf8Scalar) {
+        if (implementation_is_available((CborUtf8Implementation)impl))
+            break;
+    }
+    return &implementations[impl];
+}
+
+static inline const Utf8Implementation *implementation(void)
+{
+    /* concurrent first calls all store the same pointer */
+    const Utf8Implementation *impl = load_implementation();
+    if (unlikely(!impl)) {
+        impl = select_implementation();
+        store_implementation(impl);
+    }
+    return impl;
+}
+
+size_t _cbor_utf8_ascii_prefix(const uint8_t *ptr, size_t n)
+{
+    return implementation()->ascii_prefix(ptr, n);
+}
+
+size_t _cbor_utf8_json_plain_prefix(const uint8_t *ptr, size_t n)
+{
+    return implementation()->json_plain_prefix(ptr, n);
+}
+
+bool _cbor_utf8_validate(const uint8_t *ptr, size_t n)
+{
+    const uint8_t * const end = ptr + n;
+    ScanFunction ascii_prefix = implementation()->ascii_prefix;
+    while (ptr < end) {
+        ptr += ascii_prefix(ptr, (size_t)(end - ptr));
+
+        /* decode the multi-byte characters up to the next ASCII one */
+        while (ptr < end && *ptr >= 0x80) {
+            if (get_utf8(&ptr, end) == ~0U)
+                return false;
+        }
+    }
+    return true;
+}
+
+CborUtf8Implementation _cbor_utf8_set_implementation(CborUtf8Implementation impl)
+{
+    const Utf8Implementation *selected;
+    if (impl == CborUtf8Automatic) {
+        selected = select_implementation();
+    } else {
+        if (impl < CborUtf8Scalar || impl > CborUtf8Neon || !implementation_is_available(impl))
+            return CborUtf8Automatic;
+        selected = &implementations[impl];
+    }
+    store_implementation(selected);
+    return (CborUtf8Implementation)(selected - implementations);
+}
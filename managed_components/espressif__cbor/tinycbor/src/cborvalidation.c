@@ -216,6 +216,111 @@
     <td>UTF-8 text string</td>
     <td>MIME message</td>
   </tr>
+  <tr>
+    <td>64</td>
+    <td>byte string</td>
+    <td>uint8 typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>65</td>
+    <td>byte string</td>
+    <td>uint16, big endian, typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>66</td>
+    <td>byte string</td>
+    <td>uint32, big endian, typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>67</td>
+    <td>byte string</td>
+    <td>uint64, big endian, typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>68</td>
+    <td>byte string</td>
+    <td>uint8 typed array, clamped arithmetic (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>69</td>
+    <td>byte string</td>
+    <td>uint16, little endian, typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>70</td>
+    <td>byte string</td>
+    <td>uint32, little endian, typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>71</td>
+    <td>byte string</td>
+    <td>uint64, little endian, typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>72</td>
+    <td>byte string</td>
+    <td>sint8 typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>73</td>
+    <td>byte string</td>
+    <td>sint16, big endian, typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>74</td>
+    <td>byte string</td>
+    <td>sint32, big endian, typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>75</td>
+    <td>byte string</td>
+    <td>sint64, big endian, typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>77</td>
+    <td>byte string</td>
+    <td>sint16, little endian, typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>78</td>
+    <td>byte string</td>
+    <td>sint32, little endian, typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>79</td>
+    <td>byte string</td>
+    <td>sint64, little endian, typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>80</td>
+    <td>byte string</td>
+    <td>IEEE 754 binary16, big endian, typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>81</td>
+    <td>byte string</td>
+    <td>IEEE 754 binary32, big endian, typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>82</td>
+    <td>byte string</td>
+    <td>IEEE 754 binary64, big endian, typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>84</td>
+    <td>byte string</td>
+    <td>IEEE 754 binary16, little endian, typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>85</td>
+    <td>byte string</td>
+    <td>IEEE 754 binary32, little endian, typed array (RFC 8746)</td>
+  </tr>
+  <tr>
+    <td>86</td>
+    <td>byte string</td>
+    <td>IEEE 754 binary64, little endian, typed array (RFC 8746)</td>
+  </tr>
   <tr>
     <td>96</td>
     <td>array</td>
@@ -259,6 +364,27 @@ static const struct KnownTagData knownTagData[] = {
     { 34, (uint32_t)CborTextStringType },
     { 35, (uint32_t)CborTextStringType },
     { 36, (uint32_t)CborTextStringType },
+    { 64, (uint32_t)CborByteStringType },
+    { 65, (uint32_t)CborByteStringType },
+    { 66, (uint32_t)CborByteStringType },
+    { 67, (uint32_t)CborByteStringType },
+    { 68, (uint32_t)CborByteStringType },
+    { 69, (uint32_t)CborByteStringType },
+    { 70, (uint32_t)CborByteStringType },
+    { 71, (uint32_t)CborByteStringType },
+    { 72, (uint32_t)CborByteStringType },
+    { 73, (uint32_t)CborByteStringType },
+    { 74, (uint32_t)CborByteStringType },
+    { 75, (uint32_t)CborByteStringType },
+    { 77, (uint32_t)CborByteStringType },
+    { 78, (uint32_t)CborByteStringType },
+    { 79, (uint32_t)CborByteStringType },
+    { 80, (uint32_t)CborByteStringType },
+    { 81, (uint32_t)CborByteStringType },
+    { 82, (uint32_t)CborByteStringType },
+    { 84, (uint32_t)CborByteStringType },
+    { 85, (uint32_t)CborByteStringType },
+    { 86, (uint32_t)CborByteStringType },
     { 96, (uint32_t)CborArrayType },
     { 97, (uint32_t)CborArrayType },
     { 98, (uint32_t)CborArrayType },
@@ -269,14 +395,7 @@ static CborError validate_value(CborValue *it, uint32_t flags, int recursionLeft
 
 static inline CborError validate_utf8_string(const void *ptr, size_t n)
 {
-    const uint8_t *buffer = (const uint8_t *)ptr;
-    const uint8_t * const end = buffer + n;
-    while (buffer < end) {
-        uint32_t uc = get_utf8(&buffer, end);
-        if (uc == ~0U)
-            return CborErrorInvalidUtf8TextString;
-    }
-    return CborNoError;
+    return _cbor_utf8_validate((const uint8_t *)ptr, n) ? CborNoError : CborErrorInvalidUtf8TextString;
 }
 
 static inline CborError validate_simple_type(uint8_t simple_type, uint32_t flags)
@@ -639,7 +758,7 @@ static CborError validate_value(CborValue *it, uint32_t flags, int recursionLeft
  * This function has the same timing and memory requirements as
  * cbor_value_advance() and cbor_value_validate_basic().
  *
- * \sa CborValidationFlags, cbor_value_validate_basic(), cbor_value_advance()
+ * \sa CborValidationFlags, cbor_value_validate_basic(), cbor_value_validate_deterministic(), cbor_value_advance()
  */
 CborError cbor_value_validate(const CborValue *it, uint32_t flags)
 {
@@ -652,6 +771,147 @@ CborError cbor_value_validate(const CborValue *it, uint32_t flags)
     return CborNoError;
 }
 
+static CborError validate_deterministic(const uint8_t **ptr, const uint8_t *end, int recursionLeft)
+{
+    const uint8_t *p = *ptr;
+    const uint8_t *key = NULL;
+    size_t keyLen = 0;
+    uint64_t value, count;
+    uint8_t majorType, info;
+    CborError err;
+
+    if (p == end)
+        return CborErrorUnexpectedEOF;
+    majorType = *p >> MajorTypeShift;
+    info = *p++ & SmallValueMask;
+    value = info;
+    if (info == IndefiniteLength) {
+        if (majorType == SimpleTypesType)
+            return CborErrorUnexpectedBreak;
+        if (majorType >= ByteStringType && majorType <= MapType)
+            return CborErrorUnknownLength;
+        return CborErrorIllegalNumber;
+    }
+    if (info > Value64Bit)
+        return CborErrorIllegalNumber;
+    if (info >= Value8Bit) {
+        unsigned n = 1U << (info - Value8Bit);
+        if ((size_t)(end - p) < n)
+            return CborErrorUnexpectedEOF;
+        for (value = 0; n; --n)
+            value = (value << 8) | *p++;
+
+        /* each size must hold a value that does not fit the next smaller one */
+        if (majorType != SimpleTypesType &&
+                value <= (info == Value8Bit ? Value8Bit - 1 : (UINT64_C(1) << (4U << (info - Value8Bit))) - 1))
+            return CborErrorOverlongEncoding;
+    }
+
+    switch (majorType) {
+    case UnsignedIntegerType:
+    case NegativeIntegerType:
+        break;
+
+    case ByteStringType:
+    case TextStringType:
+        if (value > (uint64_t)(end - p))
+            return CborErrorUnexpectedEOF;
+        p += value;
+        break;
+
+    case ArrayType:
+    case MapType:
+        if (!recursionLeft)
+            return CborErrorNestingTooDeep;
+        /* no need to check the count: each item takes at least one byte */
+        count = majorType == MapType ? 2 * value : value;
+        if (majorType == MapType && value > UINT64_MAX / 2)
+            return CborErrorDataTooLarge;
+        while (count--) {
+            const uint8_t *item = p;
+            err = validate_deterministic(&p, end, recursionLeft - 1);
+            if (err)
+                return err;
+            if (majorType != MapType || (count & 1) == 0)
+                continue;
+
+            /* that was a key: it must be greater than the previous one */
+            if (key) {
+                size_t len = (size_t)(p - item);
+                int r = memcmp(key, item, keyLen <= len ? keyLen : len);
+                if (r == 0 && keyLen != len)
+                    r = keyLen < len ? -1 : +1;
+                if (r > 0)
+                    return CborErrorMapNotSorted;
+                if (r == 0)
+                    return CborErrorMapKeysNotUnique;
+            }
+            key = item;
+            keyLen = (size_t)(p - item);
+        }
+        break;
+
+    case TagType:
+        if (!recursionLeft)
+            return CborErrorNestingTooDeep;
+        err = validate_deterministic(&p, end, recursionLeft - 1);
+        if (err)
+            return err;
+        break;
+
+    case SimpleTypesType:
+        if (info == Value8Bit) {
+            if (value < 32)
+                return CborErrorIllegalSimpleType;
+        } else if (info > Value8Bit) {
+            uint64_t bits = value;
+            CborType type = (CborType)(SimpleTypesType << MajorTypeShift | info);
+            if (shortest_floating_point(type, &bits) != type)
+                return CborErrorOverlongEncoding;
+            if (bits != value)
+                return CborErrorImproperValue;  /* NaN other than 0x7e00 */
+        }
+        break;
+    }
+
+    *ptr = p;
+    return CborNoError;
+}
+
+/**
+ * Validates that the CBOR item pointed by \a it is in the deterministic
+ * encoding of RFC 8949 section 4.2.1, which is what an encoder in
+ * deterministic mode produces (see \ref CborEncoding):
+ * \list
+ *   \li integers, lengths and tags are in their shortest form;
+ *   \li floating-point values are in their shortest exact form and NaN is
+ *       encoded as half-precision 0x7e00;
+ *   \li no string, array or map has indeterminate length;
+ *   \li map keys are unique and sorted by the bytewise lexicographic order
+ *       of their encodings.
+ * \endlist
+ *
+ * Those are the checks of CborValidateCanonicalFormat plus the uniqueness of
+ * the keys, but this function reads the bytes directly in a single pass
+ * instead of going through the parser, which makes it several times faster
+ * than cbor_value_validate(). It accepts exactly the data that
+ * cbor_value_validate() accepts with CborValidateCanonicalFormat |
+ * CborValidateMapKeysAreUnique, but when the data has several problems, the
+ * two functions may report different ones.
+ *
+ * This function needs the whole item in memory: it returns
+ * CborErrorUnimplementedValidation for parsers with an external source.
+ *
+ * \sa cbor_value_validate(), CborValidationFlags
+ */
+CborError cbor_value_validate_deterministic(const CborValue *it)
+{
+    const uint8_t *ptr = cbor_value_get_next_byte(it);
+    if (it->parser->flags & CborParserFlag_ExternalSource)
+        return CborErrorUnimplementedValidation;
+    return validate_deterministic(&ptr, it->parser->source.end, CBOR_PARSER_MAX_RECURSIONS);
+}
+
 /**
  * @}
  */
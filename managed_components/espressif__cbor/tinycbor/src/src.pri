@@ -1,20 +1,27 @@
 SOURCES += \
     $$PWD/cborencoder.c \
+    $$PWD/cborencoder_arena.c \
     $$PWD/cborencoder_close_container_checked.c \
     $$PWD/cborencoder_float.c \
     $$PWD/cborerrorstrings.c \
     $$PWD/cborparser.c \
     $$PWD/cborparser_dup_string.c \
     $$PWD/cborparser_float.c \
+    $$PWD/cborparser_stream.c \
     $$PWD/cborpretty.c \
     $$PWD/cborpretty_stdio.c \
+    $$PWD/cborschema.c \
+    $$PWD/cborsequence.c \
+    $$PWD/cbortypedarray.c \
     $$PWD/cbortojson.c \
+    $$PWD/cborutf8.c \
     $$PWD/cborvalidation.c \
 
 HEADERS += \
     $$PWD/cbor.h \
     $$PWD/cborinternal_p.h \
     $$PWD/cborjson.h \
+    $$PWD/cborschema.h \
     $$PWD/compilersupport_p.h \
     $$PWD/tinycbor-version.h \
     $$PWD/utf8_p.h \
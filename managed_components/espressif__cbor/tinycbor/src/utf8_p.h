@@ -25,10 +25,38 @@
 #ifndef CBOR_UTF8_H
 #define CBOR_UTF8_H
 
-#include "compilersupport_p.h"
+#include "cborinternal_p.h"
 
 #include <stdint.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bulk scanning of UTF-8 text, in cborutf8.c. The scans use the widest
+ * vector unit the CPU has and fall back to word-at-a-time code elsewhere. */
+typedef enum CborUtf8Implementation {
+    CborUtf8Automatic = -1,
+    CborUtf8Scalar = 0,
+    CborUtf8Sse2,
+    CborUtf8Avx2,
+    CborUtf8Neon
+} CborUtf8Implementation;
+
+/* number of leading bytes below 0x80 */
+CBOR_INTERNAL_API size_t _cbor_utf8_ascii_prefix(const uint8_t *ptr, size_t n);
+/* number of leading bytes that print as themselves in a JSON string
+ * (anything but control characters, '"', '\\', DEL and non-ASCII) */
+CBOR_INTERNAL_API size_t _cbor_utf8_json_plain_prefix(const uint8_t *ptr, size_t n);
+CBOR_INTERNAL_API bool _cbor_utf8_validate(const uint8_t *ptr, size_t n);
+/* returns the implementation in use, or CborUtf8Automatic if the requested
+ * one is not available on this CPU */
+CBOR_INTERNAL_API CborUtf8Implementation _cbor_utf8_set_implementation(CborUtf8Implementation impl);
+
+#ifdef __cplusplus
+}
+#endif
+
 static inline uint32_t get_utf8(const uint8_t **buffer, const uint8_t *end)
 {
     int charsNeeded;
@@ -28,6 +28,10 @@
 #include "../../src/cborparser.c"
 #include "../../src/cborparser_dup_string.c"
 #include "../../src/cborparser_float.c"
+#include "../../src/cborschema.c"
+#include "../../src/cborsequence.c"
+#include "../../src/cbortypedarray.c"
+#include "../../src/cborutf8.c"
 #include "../../src/cborvalidation.c"
 
 #include <QtTest>
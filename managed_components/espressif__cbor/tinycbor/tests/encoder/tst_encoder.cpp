@@ -65,6 +65,12 @@ private slots:
     void writerApi();
     void writerApiFail_data() { tags_data(); }
     void writerApiFail();
+    void measureApi_data() { tags_data(); }
+    void measureApi();
+    void arenaApi_data() { tags_data(); }
+    void arenaApi();
+    void sequenceApi_data() { tags_data(); }
+    void sequenceApi();
     void shortBuffer_data() { tags_data(); }
     void shortBuffer();
     void tooShortArrays_data() { tags_data(); }
@@ -77,6 +83,16 @@ private slots:
     void tooBigMaps();
     void illegalSimpleType_data();
     void illegalSimpleType();
+
+    void deterministicFloat_data();
+    void deterministicFloat();
+    void deterministicContainers();
+    void deterministicShortBuffer();
+    void deterministicErrors();
+
+    void typedArray_data();
+    void typedArray();
+    void typedArrayErrors();
 };
 
 #include "tst_encoder.moc"
@@ -510,6 +526,109 @@ void tst_Encoder::writerApiFail()
     QCOMPARE(callCount, 1);
 }
 
+void tst_Encoder::measureApi()
+{
+    QFETCH(QVariant, input);
+    QFETCH(QByteArray, output);
+
+    size_t size = 0;
+    CborEncoder encoder;
+    cbor_encoder_init_measure(&encoder, &size, 0);
+    QCOMPARE(encodeVariant(&encoder, input), CborNoError);
+    QCOMPARE(encoder.remaining, size_t(1));
+    QCOMPARE(size, size_t(output.length()));
+
+    // the measured size is enough to encode
+    compare(input, output);
+}
+
+void tst_Encoder::arenaApi()
+{
+    QFETCH(QVariant, input);
+    QFETCH(QByteArray, output);
+
+    // small first block, so that most inputs need several
+    CborArena arena;
+    cbor_arena_init(&arena, 2);
+
+    CborEncoder encoder;
+    cbor_encoder_init_arena(&encoder, &arena);
+    QCOMPARE(encodeVariant(&encoder, input), CborNoError);
+    QCOMPARE(cbor_arena_get_size(&arena), size_t(output.length()));
+
+    QByteArray buffer(output.length(), Qt::Uninitialized);
+    QCOMPARE(cbor_arena_copy(&arena, reinterpret_cast<uint8_t *>(buffer.data()), buffer.length()),
+             size_t(output.length()));
+    QCOMPARE(buffer, output);
+
+    // a short buffer receives the beginning
+    buffer.fill('\0');
+    size_t half = size_t(output.length()) / 2;
+    QCOMPARE(cbor_arena_copy(&arena, reinterpret_cast<uint8_t *>(buffer.data()), half), half);
+    QCOMPARE(buffer.left(int(half)), output.left(int(half)));
+
+    cbor_arena_free(&arena);
+    QCOMPARE(cbor_arena_get_size(&arena), size_t(0));
+}
+
+void tst_Encoder::sequenceApi()
+{
+    QFETCH(QVariant, input);
+    QFETCH(QByteArray, output);
+
+    // room for three items, and a bit
+    QByteArray buffer(3 * output.length() + 1, Qt::Uninitialized);
+    CborSequence seq;
+    QCOMPARE(cbor_sequence_init(&seq, reinterpret_cast<quint8 *>(buffer.data()), buffer.length(), 0),
+             CborNoError);
+
+    // one item per commit
+    CborEncoder encoder;
+    cbor_encoder_init_sequence(&encoder, &seq, 0);
+    QCOMPARE(cbor_sequence_commit(&seq, &encoder), CborErrorTooFewItems);
+    cbor_encoder_init_sequence(&encoder, &seq, 0);
+    cbor_encode_null(&encoder);
+    cbor_encode_null(&encoder);
+    QCOMPARE(cbor_sequence_commit(&seq, &encoder), CborErrorTooManyItems);
+    QCOMPARE(cbor_sequence_get_count(&seq), size_t(0));
+
+    for (int i = 0; i < 3; ++i) {
+        cbor_encoder_init_sequence(&encoder, &seq, 0);
+        QCOMPARE(encodeVariant(&encoder, input), CborNoError);
+        QCOMPARE(cbor_sequence_commit(&seq, &encoder), CborNoError);
+    }
+    QCOMPARE(cbor_sequence_get_count(&seq), size_t(3));
+    QCOMPARE(buffer.left(int(seq.used)), output + output + output);
+
+    // an item that doesn't fit is not added
+    cbor_encoder_init_sequence(&encoder, &seq, 0);
+    encodeVariant(&encoder, input);
+    if (output.length() > 1) {
+        QCOMPARE(cbor_sequence_commit(&seq, &encoder), CborErrorOutOfMemory);
+        QCOMPARE(cbor_encoder_get_extra_bytes_needed(&encoder), size_t(output.length() - 1));
+    }
+    QCOMPARE(cbor_sequence_get_count(&seq), size_t(3));
+    QCOMPARE(seq.used, size_t(3 * output.length()));
+
+    // the items are copied as they are into the upload
+    QByteArray upload(3 * output.length() + 2, Qt::Uninitialized);
+    CborEncoder array;
+    cbor_encoder_init(&encoder, reinterpret_cast<quint8 *>(upload.data()), upload.length(), 0);
+    QCOMPARE(cbor_encoder_create_array(&encoder, &array, CborIndefiniteLength), CborNoError);
+    QCOMPARE(cbor_encode_sequence(&array, &seq), CborNoError);
+    QCOMPARE(cbor_encoder_close_container(&encoder, &array), CborNoError);
+    QCOMPARE(upload, "\x9f" + output + output + output + "\xff");
+
+    // and count as the items of a container
+    cbor_encoder_init(&encoder, reinterpret_cast<quint8 *>(upload.data()), upload.length(), 0);
+    QCOMPARE(cbor_encoder_create_array(&encoder, &array, 3), CborNoError);
+    QCOMPARE(cbor_encode_sequence(&array, &seq), CborNoError);
+    QCOMPARE(cbor_encoder_close_container(&encoder, &array), CborNoError);
+    QCOMPARE(cbor_encoder_create_array(&encoder, &array, 2), CborNoError);
+    QCOMPARE(cbor_encode_sequence(&array, &seq), CborErrorOutOfMemory);
+    QCOMPARE(cbor_encoder_close_container(&encoder, &array), CborErrorTooManyItems);
+}
+
 void tst_Encoder::shortBuffer()
 {
     QFETCH(QVariant, input);
@@ -606,4 +725,221 @@ void tst_Encoder::illegalSimpleType()
     QCOMPARE(cbor_encode_simple_value(&encoder, type), CborErrorIllegalSimpleType);
 }
 
+void tst_Encoder::deterministicFloat_data()
+{
+    QTest::addColumn<double>("input");
+    QTest::addColumn<QByteArray>("output");
+
+    QTest::newRow("0") << 0.0 << raw("\xf9\0\0");
+    QTest::newRow("-0") << -0.0 << raw("\xf9\x80\0");
+    QTest::newRow("1.5") << 1.5 << raw("\xf9\x3e\0");
+    QTest::newRow("-4") << -4.0 << raw("\xf9\xc4\0");
+    QTest::newRow("65504") << 65504.0 << raw("\xf9\x7b\xff");
+    QTest::newRow("65536") << 65536.0 << raw("\xfa\x47\x80\0\0");
+    QTest::newRow("100000") << 100000.0 << raw("\xfa\x47\xc3\x50\0");
+    QTest::newRow("0.1") << 0.1 << raw("\xfb\x3f\xb9\x99\x99\x99\x99\x99\x9a");
+    QTest::newRow("1.e300") << 1.e300 << raw("\xfb\x7e\x37\xe4\x3c\x88\0\x75\x9c");
+    QTest::newRow("min.f16") << ldexp(1.0, -14) << raw("\xf9\x04\0");
+    QTest::newRow("min.denorm.f16") << ldexp(1.0, -24) << raw("\xf9\0\1");
+    QTest::newRow("max.f") << double(std::numeric_limits<float>::max()) << raw("\xfa\x7f\x7f\xff\xff");
+    QTest::newRow("min.denorm.f") << ldexp(1.0, -149) << raw("\xfa\0\0\0\1");
+    QTest::newRow("min.denorm") << ldexp(1.0, -1074) << raw("\xfb\0\0\0\0\0\0\0\1");
+    QTest::newRow("inf") << myInf() << raw("\xf9\x7c\0");
+    QTest::newRow("-inf") << -myInf() << raw("\xf9\xfc\0");
+    QTest::newRow("nan") << myNaN() << raw("\xf9\x7e\0");
+    QTest::newRow("-nan") << -myNaN() << raw("\xf9\x7e\0");
+}
+
+void tst_Encoder::deterministicFloat()
+{
+    QFETCH(double, input);
+    QFETCH(QByteArray, output);
+
+    quint8 buf[16];
+    CborEncoder encoder;
+    cbor_encoder_init(&encoder, buf, sizeof(buf), CborEncoderFlag_Deterministic);
+    QCOMPARE(cbor_encode_double(&encoder, input), CborNoError);
+    QByteArray buffer(reinterpret_cast<char *>(buf), int(cbor_encoder_get_buffer_size(&encoder, buf)));
+    QCOMPARE(buffer, output);
+
+    // single precision, if the value fits
+    float f = float(input);
+    if (double(f) == input || qIsNaN(f)) {
+        cbor_encoder_init(&encoder, buf, sizeof(buf), CborEncoderFlag_Deterministic);
+        QCOMPARE(cbor_encode_float(&encoder, f), CborNoError);
+        buffer = QByteArray(reinterpret_cast<char *>(buf), int(cbor_encoder_get_buffer_size(&encoder, buf)));
+        QCOMPARE(buffer, output);
+    }
+}
+
+static CborError encodeUnsortedMap(CborEncoder *encoder)
+{
+    CborEncoder map, array;
+    CborError err = cbor_encoder_create_map(encoder, &map, CborIndefiniteLength);
+    err = CborError(err | cbor_encode_text_stringz(&map, "b"));
+    err = CborError(err | cbor_encoder_create_array(&map, &array, CborIndefiniteLength));
+    for (int i = 0; i < 30; ++i)
+        err = CborError(err | cbor_encode_int(&array, i));
+    err = CborError(err | cbor_encoder_close_container(&map, &array));
+    err = CborError(err | cbor_encode_int(&map, 10));
+    err = CborError(err | cbor_encode_int(&map, 2));
+    err = CborError(err | cbor_encode_text_stringz(&map, "a"));
+    err = CborError(err | cbor_encode_int(&map, 3));
+    err = CborError(err | cbor_encode_int(&map, -1));
+    err = CborError(err | cbor_encode_int(&map, 4));
+    return CborError(err | cbor_encoder_close_container(encoder, &map));
+}
+
+static QByteArray sortedMap()
+{
+    // keys sorted by their encoding: 10, -1, "a", "b"; definite lengths
+    QByteArray output = raw("\xa4\x0a\2\x20\4\x61" "a\3\x61" "b\x98\x1e");
+    for (char i = 0; i < 30; ++i) {
+        if (i >= 24)
+            output += '\x18';
+        output += i;
+    }
+    return output;
+}
+
+void tst_Encoder::deterministicContainers()
+{
+    QByteArray output = sortedMap();
+    quint8 buf[64];
+    CborEncoder encoder;
+    cbor_encoder_init(&encoder, buf, sizeof(buf), CborEncoderFlag_Deterministic);
+    QCOMPARE(encodeUnsortedMap(&encoder), CborNoError);
+    QByteArray buffer(reinterpret_cast<char *>(buf), int(cbor_encoder_get_buffer_size(&encoder, buf)));
+    QCOMPARE(buffer, output);
+
+    // the measured size is the size of the deterministic encoding
+    size_t size = 0;
+    cbor_encoder_init_measure(&encoder, &size, CborEncoderFlag_Deterministic);
+    QCOMPARE(encodeUnsortedMap(&encoder), CborNoError);
+    QCOMPARE(size, size_t(output.length()));
+
+    CborParser parser;
+    CborValue first;
+    QCOMPARE(cbor_parser_init(buf, size, 0, &parser, &first), CborNoError);
+    QCOMPARE(cbor_value_validate_deterministic(&first), CborNoError);
+}
+
+void tst_Encoder::deterministicShortBuffer()
+{
+    QByteArray output = sortedMap();
+    QByteArray buffer(output.length(), Qt::Uninitialized);
+
+    for (int len = 0; len < output.length(); ++len) {
+        CborEncoder encoder;
+        cbor_encoder_init(&encoder, reinterpret_cast<quint8 *>(buffer.data()), len, CborEncoderFlag_Deterministic);
+        QCOMPARE(encodeUnsortedMap(&encoder), CborErrorOutOfMemory);
+        QCOMPARE(len + cbor_encoder_get_extra_bytes_needed(&encoder), size_t(output.length()));
+    }
+}
+
+void tst_Encoder::deterministicErrors()
+{
+    quint8 buf[16];
+    CborEncoder encoder, container;
+
+    cbor_encoder_init(&encoder, buf, sizeof(buf), CborEncoderFlag_Deterministic);
+    QCOMPARE(cbor_encoder_create_map(&encoder, &container, 2), CborNoError);
+    QCOMPARE(cbor_encode_int(&container, 1), CborNoError);
+    QCOMPARE(cbor_encode_int(&container, 1), CborNoError);
+    QCOMPARE(cbor_encode_int(&container, 1), CborNoError);
+    QCOMPARE(cbor_encode_int(&container, 2), CborNoError);
+    QCOMPARE(cbor_encoder_close_container(&encoder, &container), CborErrorMapKeysNotUnique);
+
+    cbor_encoder_init(&encoder, buf, sizeof(buf), CborEncoderFlag_Deterministic);
+    QCOMPARE(cbor_encoder_create_map(&encoder, &container, CborIndefiniteLength), CborNoError);
+    QCOMPARE(cbor_encode_int(&container, 1), CborNoError);
+    QCOMPARE(cbor_encoder_close_container(&encoder, &container), CborErrorTooFewItems);
+
+    // a writer function can't go back to sort or to write the length
+    auto callback = [](void *, const void *, size_t, CborEncoderAppendType) {
+        return CborNoError;
+    };
+    cbor_encoder_init_writer(&encoder, callback, nullptr);
+    encoder.flags |= CborEncoderFlag_Deterministic;
+    QCOMPARE(cbor_encoder_create_map(&encoder, &container, 1), CborErrorUnsupportedType);
+    QCOMPARE(cbor_encoder_create_array(&encoder, &container, CborIndefiniteLength), CborErrorUnsupportedType);
+    QCOMPARE(cbor_encoder_create_array(&encoder, &container, 1), CborNoError);
+}
+
+void tst_Encoder::typedArray_data()
+{
+    QTest::addColumn<int>("type");
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<int>("tag");
+
+    // the byte strings are encoded in the byte order of this machine
+    bool le = QSysInfo::ByteOrder == QSysInfo::LittleEndian;
+    QTest::newRow("empty") << int(CborTypedArrayUint32) << QByteArray() << (le ? 70 : 66);
+    QTest::newRow("uint8") << int(CborTypedArrayUint8) << raw("\x01\x02\xff") << 64;
+    QTest::newRow("sint8") << int(CborTypedArraySint8) << raw("\x01\x80") << 72;
+    QTest::newRow("uint16") << int(CborTypedArrayUint16) << raw("\x01\x02\x03\x04") << (le ? 69 : 65);
+    QTest::newRow("uint32") << int(CborTypedArrayUint32) << raw("\x01\x02\x03\x04") << (le ? 70 : 66);
+    QTest::newRow("uint64") << int(CborTypedArrayUint64) << raw("\1\2\3\4\5\6\7\x08") << (le ? 71 : 67);
+    QTest::newRow("sint16") << int(CborTypedArraySint16) << raw("\x01\x02") << (le ? 77 : 73);
+    QTest::newRow("sint32") << int(CborTypedArraySint32) << raw("\x01\x02\x03\x04") << (le ? 78 : 74);
+    QTest::newRow("sint64") << int(CborTypedArraySint64) << raw("\1\2\3\4\5\6\7\x08") << (le ? 79 : 75);
+    QTest::newRow("float16") << int(CborTypedArrayFloat16) << raw("\x3c\x00\xc0\x00") << (le ? 84 : 80);
+    QTest::newRow("float32") << int(CborTypedArrayFloat32) << raw("\x3f\x80\0\0") << (le ? 85 : 81);
+    QTest::newRow("float64") << int(CborTypedArrayFloat64) << raw("\x3f\xf0\0\0\0\0\0\0") << (le ? 86 : 82);
+}
+
+void tst_Encoder::typedArray()
+{
+    QFETCH(int, type);
+    QFETCH(QByteArray, data);
+    QFETCH(int, tag);
+
+    // element size, from the type
+    int size = type & 0x10 ? 2 << (type & 3) : 1 << (type & 3);
+    QByteArray expected = raw("\xd8") + char(tag);
+    expected += char(0x40 + data.length());
+    expected += data;
+
+    QByteArray buffer(expected.length(), Qt::Uninitialized);
+    CborEncoder encoder;
+    cbor_encoder_init(&encoder, reinterpret_cast<quint8 *>(buffer.data()), buffer.length(), 0);
+    QCOMPARE(cbor_encode_typed_array(&encoder, CborTypedArrayType(type), data.constData(), data.length() / size),
+             CborNoError);
+    QCOMPARE(cbor_encoder_get_buffer_size(&encoder, reinterpret_cast<quint8 *>(buffer.data())),
+             size_t(expected.length()));
+    QCOMPARE(buffer, expected);
+
+    // too short
+    cbor_encoder_init(&encoder, reinterpret_cast<quint8 *>(buffer.data()), buffer.length() - 1, 0);
+    QCOMPARE(cbor_encode_typed_array(&encoder, CborTypedArrayType(type), data.constData(), data.length() / size),
+             CborErrorOutOfMemory);
+    QCOMPARE(cbor_encoder_get_extra_bytes_needed(&encoder), size_t(1));
+
+    // counts as one item
+    CborEncoder container;
+    QByteArray array(expected.length() + 2, Qt::Uninitialized);
+    cbor_encoder_init(&encoder, reinterpret_cast<quint8 *>(array.data()), array.length(), 0);
+    QCOMPARE(cbor_encoder_create_array(&encoder, &container, 2), CborNoError);
+    QCOMPARE(cbor_encode_typed_array(&container, CborTypedArrayType(type), data.constData(), data.length() / size),
+             CborNoError);
+    QCOMPARE(cbor_encode_null(&container), CborNoError);
+    QCOMPARE(cbor_encoder_close_container_checked(&encoder, &container), CborNoError);
+    QCOMPARE(array, "\x82" + expected + "\xf6");
+}
+
+void tst_Encoder::typedArrayErrors()
+{
+    quint8 buffer[16];
+    CborEncoder encoder;
+    cbor_encoder_init(&encoder, buffer, sizeof(buffer), 0);
+
+    // float128, uint8 clamped and the reserved types are not supported
+    QCOMPARE(cbor_encode_typed_array(&encoder, CborTypedArrayType(0x13), buffer, 0), CborErrorUnsupportedType);
+    QCOMPARE(cbor_encode_typed_array(&encoder, CborTypedArrayType(0x04), buffer, 0), CborErrorUnsupportedType);
+    QCOMPARE(cbor_encode_typed_array(&encoder, CborTypedArrayType(0x0c), buffer, 0), CborErrorUnsupportedType);
+    QCOMPARE(cbor_encode_typed_array(&encoder, CborTypedArrayType(0x20), buffer, 0), CborErrorUnsupportedType);
+    QCOMPARE(cbor_encode_typed_array(&encoder, CborTypedArrayUint64, buffer, SIZE_MAX / 4), CborErrorDataTooLarge);
+    QCOMPARE(cbor_encoder_get_buffer_size(&encoder, buffer), size_t(0));
+}
+
 QTEST_MAIN(tst_Encoder)
@@ -0,0 +1,134 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#include <QtTest>
+#include "cbor.h"
+
+#include <stdlib.h>
+
+class tst_EncoderBench : public QObject
+{
+    Q_OBJECT
+private slots:
+    void fixedBuffer_data();
+    void fixedBuffer();
+    void measureThenEncode_data() { fixedBuffer_data(); }
+    void measureThenEncode();
+    void arena_data() { fixedBuffer_data(); }
+    void arena();
+};
+
+// A message shaped like the diagnostics reports: a map holding an array of
+// small records with a timestamp, a key and a value
+static CborError encodeMessage(CborEncoder *encoder, int records)
+{
+    CborEncoder map, array;
+    CborError err = cbor_encoder_create_map(encoder, &map, 1);
+    err = CborError(err | cbor_encode_text_stringz(&map, "diag"));
+    err = CborError(err | cbor_encoder_create_array(&map, &array, CborIndefiniteLength));
+    for (int i = 0; i < records; ++i) {
+        CborEncoder record;
+        err = CborError(err | cbor_encoder_create_map(&array, &record, 3));
+        err = CborError(err | cbor_encode_text_stringz(&record, "ts"));
+        err = CborError(err | cbor_encode_uint(&record, Q_UINT64_C(1700000000000000) + i));
+        err = CborError(err | cbor_encode_text_stringz(&record, "k"));
+        err = CborError(err | cbor_encode_text_stringz(&record, "heap.free"));
+        err = CborError(err | cbor_encode_text_stringz(&record, "v"));
+        err = CborError(err | cbor_encode_int(&record, -i * 1000));
+        err = CborError(err | cbor_encoder_close_container(&array, &record));
+    }
+    err = CborError(err | cbor_encoder_close_container(&map, &array));
+    err = CborError(err | cbor_encoder_close_container(encoder, &map));
+    return err;
+}
+
+void tst_EncoderBench::fixedBuffer_data()
+{
+    QTest::addColumn<int>("records");
+
+    for (int records : { 8, 64, 512 })
+        QTest::newRow(QByteArray("records=" + QByteArray::number(records)).constData()) << records;
+}
+
+void tst_EncoderBench::fixedBuffer()
+{
+    // reference: encode into a buffer that is known to be large enough
+    QFETCH(int, records);
+    QByteArray buffer(64 + records * 64, Qt::Uninitialized);
+    uint8_t *ptr = reinterpret_cast<uint8_t *>(buffer.data());
+
+    size_t size = 0;
+    QBENCHMARK {
+        CborEncoder encoder;
+        cbor_encoder_init(&encoder, ptr, buffer.size(), 0);
+        encodeMessage(&encoder, records);
+        size = cbor_encoder_get_buffer_size(&encoder, ptr);
+    }
+    QVERIFY(size > size_t(records));
+}
+
+void tst_EncoderBench::measureThenEncode()
+{
+    // compute the exact size, allocate it and encode
+    QFETCH(int, records);
+
+    CborError err = CborNoError;
+    QBENCHMARK {
+        size_t size = 0;
+        CborEncoder encoder;
+        cbor_encoder_init_measure(&encoder, &size, 0);
+        encodeMessage(&encoder, records);
+
+        uint8_t *ptr = static_cast<uint8_t *>(malloc(size));
+        cbor_encoder_init(&encoder, ptr, size, 0);
+        err = encodeMessage(&encoder, records);
+        free(ptr);
+    }
+    QCOMPARE(err, CborNoError);
+}
+
+void tst_EncoderBench::arena()
+{
+    // encode into a growable arena and copy the result to an exact-size buffer
+    QFETCH(int, records);
+
+    CborError err = CborNoError;
+    QBENCHMARK {
+        CborArena arena;
+        CborEncoder encoder;
+        cbor_arena_init(&arena, 256);
+        cbor_encoder_init_arena(&encoder, &arena);
+        err = encodeMessage(&encoder, records);
+
+        size_t size = cbor_arena_get_size(&arena);
+        uint8_t *ptr = static_cast<uint8_t *>(malloc(size));
+        cbor_arena_copy(&arena, ptr, size);
+        free(ptr);
+        cbor_arena_free(&arena);
+    }
+    QCOMPARE(err, CborNoError);
+}
+
+QTEST_MAIN(tst_EncoderBench)
+#include "tst_encoderbench.moc"
@@ -214,6 +214,10 @@ void addNonChunkedStringsData()
     QTest::newRow("textstringutf8-2char2") << raw("\x64\xc2\xa0\xc2\xa9") << "\"\\u00A0\\u00A9\"";
     QTest::newRow("textstringutf8-3char") << raw("\x63\xe2\x88\x80") << "\"\\u2200\"";
     QTest::newRow("textstringutf8-4char") << raw("\x64\xf0\x90\x88\x83") << "\"\\uD800\\uDE03\"";
+    QTest::newRow("textstringutf8-after-ascii") << raw("\x78\x22") + QByteArray(32, 'a') + raw("\xc2\xa0")
+                                                << '"' + QString(32, 'a') + "\\u00A0\"";
+    QTest::newRow("textstring-escapes") << raw("\x78\x25") + QByteArray(32, 'a') + raw("\"\\\n\x01\x7f")
+                                        << '"' + QString(32, 'a') + "\\\"\\\\\\n\\u0001\\u007F\"";
 
     // strings with overlong length
     QTest::newRow("emptybytestring*1") << raw("\x58\x00") << "h''_0";
@@ -86,6 +86,10 @@ private slots:
 
     void readerApi_data() { arrays_data(); }
     void readerApi();
+    void streamApi_data() { arrays_data(); }
+    void streamApi();
+    void sequenceApi_data() { arrays_data(); }
+    void sequenceApi();
     void reparse_data();
     void reparse();
 
@@ -98,10 +102,21 @@ private slots:
     // convenience API
     void stringLength_data();
     void stringLength();
+    void stringView_data() { stringLength_data(); }
+    void stringView();
+    void stringDupArena_data() { stringLength_data(); }
+    void stringDupArena();
     void stringCompare_data();
     void stringCompare();
     void mapFind_data();
     void mapFind();
+    void mapFindValues_data() { mapFind_data(); }
+    void mapFindValues();
+    void mapIndexFind_data() { mapFind_data(); }
+    void mapIndexFind();
+    void mapFindValuesMultiple();
+    void typedArray_data();
+    void typedArray();
 
     // validation & errors
     void checkedIntegers_data();
@@ -110,6 +125,8 @@ private slots:
     void validation();
     void strictValidation_data();
     void strictValidation();
+    void deterministicValidation_data();
+    void deterministicValidation();
     void incompleteData_data();
     void incompleteData();
     void endPointer_data();
@@ -808,6 +825,110 @@ void tst_Parser::readerApi()
     QCOMPARE(input.consumed, data.size());
 }
 
+static CborError parseOneStep(CborValue *it, void *arg)
+{
+    // only keep the output of the attempt that succeeds
+    QString parsed;
+    CborError err = parseOne(it, &parsed);
+    if (!err)
+        *static_cast<QString *>(arg) = parsed;
+    return err;
+}
+
+void tst_Parser::streamApi()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(QString, expected);
+
+    // feed one byte at a time, into a buffer only large enough for the data
+    QByteArray buffer(data.size(), Qt::Uninitialized);
+    CborStream stream;
+    cbor_stream_init(&stream, reinterpret_cast<uint8_t *>(buffer.data()), buffer.size());
+
+    CborParser parser;
+    CborValue first;
+    CborError err = cbor_parser_init_stream(&stream, &parser, &first);
+    QCOMPARE(err, CborErrorNeedMoreData);
+
+    QString decoded;
+    bool initialized = false;
+    for (int i = 0; i < data.size(); ++i) {
+        err = cbor_stream_append(&stream, data.constData() + i, 1);
+        QCOMPARE(err, CborNoError);
+        if (i == data.size() - 1)
+            cbor_stream_finish(&stream);
+
+        if (!initialized) {
+            err = cbor_parser_init_stream(&stream, &parser, &first);
+            if (err == CborErrorNeedMoreData)
+                continue;
+            QCOMPARE(err, CborNoError);
+            initialized = true;
+        }
+        err = cbor_value_stream_step(&first, parseOneStep, &decoded);
+        if (err != CborErrorNeedMoreData)
+            break;
+        QVERIFY2(i < data.size() - 1, "Needed more data after the stream was finished");
+    }
+    QCOMPARE(err, CborNoError);
+    QCOMPARE(decoded, expected);
+    QVERIFY(cbor_value_at_end(&first));
+    QCOMPARE(stream.pos, size_t(data.size()));
+
+    // a finished stream reports the real error
+    cbor_stream_init(&stream, reinterpret_cast<uint8_t *>(buffer.data()), buffer.size());
+    err = cbor_stream_append(&stream, data.constData(), data.size() - 1);
+    QCOMPARE(err, CborNoError);
+    cbor_stream_finish(&stream);
+    err = cbor_parser_init_stream(&stream, &parser, &first);
+    if (!err)
+        err = cbor_value_stream_step(&first, parseOneStep, &decoded);
+    QCOMPARE(err, CborErrorUnexpectedEOF);
+}
+
+void tst_Parser::sequenceApi()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(QString, expected);
+
+    // three copies of the item, the last one cut short as if by a reset
+    QByteArray buffer = data + data + data;
+    CborSequence seq;
+    CborError err = cbor_sequence_init(&seq, reinterpret_cast<uint8_t *>(buffer.data()), buffer.size(),
+                                       buffer.size() - 1);
+    QCOMPARE(err, CborNoError);
+    QCOMPARE(cbor_sequence_get_count(&seq), size_t(2));
+    QCOMPARE(seq.used, size_t(2 * data.size()));
+
+    // only complete items can be appended
+    if (data.size() > 1)
+        QCOMPARE(cbor_sequence_append(&seq, data.constData(), data.size() - 1), CborErrorUnexpectedEOF);
+    QCOMPARE(cbor_sequence_append(&seq, data.constData(), data.size()), CborNoError);
+    QCOMPARE(cbor_sequence_get_count(&seq), size_t(3));
+    QCOMPARE(cbor_sequence_append(&seq, data.constData(), data.size()), CborErrorOutOfMemory);
+
+    // read one, make room and append another: reading resumes where it was
+    CborParser parser;
+    CborValue first;
+    for (int i = 0; i < 4; ++i) {
+        QVERIFY(!cbor_sequence_at_end(&seq));
+        QCOMPARE(cbor_sequence_next(&seq, &parser, &first), CborNoError);
+
+        QString decoded;
+        QCOMPARE(parseOne(&first, &decoded), CborNoError);
+        QCOMPARE(decoded, expected);
+        QVERIFY(cbor_value_at_end(&first));
+
+        if (i == 0) {
+            cbor_sequence_discard_read(&seq);
+            QCOMPARE(cbor_sequence_append(&seq, data.constData(), data.size()), CborNoError);
+        }
+    }
+    QVERIFY(cbor_sequence_at_end(&seq));
+    QCOMPARE(cbor_sequence_get_count(&seq), size_t(0));
+    QCOMPARE(cbor_sequence_next(&seq, &parser, &first), CborErrorNeedMoreData);
+}
+
 void tst_Parser::reparse_data()
 {
     // only one-item rows
@@ -1056,6 +1177,76 @@ void tst_Parser::stringLength()
 
 }
 
+void tst_Parser::stringView()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(int, expected);
+
+    ParserWrapper w;
+    CborError err = w.init(data);
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+
+    const uint8_t *ptr = nullptr;
+    size_t len = 0;
+    CborValue next;
+    if (cbor_value_is_text_string(&w.first))
+        err = cbor_value_get_text_string_view(&w.first, reinterpret_cast<const char **>(&ptr), &len, &next);
+    else
+        err = cbor_value_get_byte_string_view(&w.first, &ptr, &len, &next);
+
+    if (!cbor_value_is_length_known(&w.first)) {
+        // chunked strings have no single view
+        QCOMPARE(err, CborErrorUnknownLength);
+        QVERIFY(!ptr);
+        return;
+    }
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+    QCOMPARE(len, size_t(expected));
+
+    // the view points into the input buffer
+    QCOMPARE(ptr, w.end() - expected);
+    QCOMPARE(QByteArray(reinterpret_cast<const char *>(ptr), int(len)), data.right(expected));
+    QVERIFY(cbor_value_at_end(&next));
+}
+
+void tst_Parser::stringDupArena()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(int, expected);
+
+    ParserWrapper w;
+    CborError err = w.init(data);
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+
+    // a tiny first block makes the strings span several blocks
+    CborArena arena;
+    cbor_arena_init(&arena, 2);
+    QByteArray reference;
+    for (int i = 0; i < 3; ++i) {
+        uint8_t *buffer = nullptr;
+        size_t len = 0;
+        CborValue next;
+        if (cbor_value_is_text_string(&w.first))
+            err = cbor_value_dup_text_string_arena(&w.first, &arena, reinterpret_cast<char **>(&buffer), &len, &next);
+        else
+            err = cbor_value_dup_byte_string_arena(&w.first, &arena, &buffer, &len, &next);
+        QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+        QCOMPARE(len, size_t(expected));
+        QCOMPARE(buffer[len], uint8_t(0));
+        QVERIFY(cbor_value_at_end(&next));
+
+        QByteArray copy(reinterpret_cast<const char *>(buffer), int(len));
+        if (i)
+            QCOMPARE(copy, reference);
+        reference = copy;
+    }
+    QCOMPARE(reference.size(), expected);
+    QCOMPARE(cbor_arena_get_size(&arena), size_t(3 * (expected + 1)));
+
+    cbor_arena_free(&arena);
+    QCOMPARE(cbor_arena_get_size(&arena), size_t(0));
+}
+
 void tst_Parser::stringCompare_data()
 {
     QTest::addColumn<QByteArray>("data");
@@ -1265,6 +1456,246 @@ void tst_Parser::mapFind()
     }
 }
 
+static void compareMapFindResult(CborValue *element, bool expected)
+{
+    if (expected) {
+        QCOMPARE(int(element->type), int(CborTagType));
+
+        CborTag tag;
+        CborError err = cbor_value_get_tag(element, &tag);
+        QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+        QCOMPARE(int(tag), 42);
+
+        bool equals;
+        err = cbor_value_text_string_equals(element, "haystack", &equals);
+        QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+        QVERIFY(equals);
+    } else {
+        QCOMPARE(int(element->type), int(CborInvalidType));
+    }
+}
+
+void tst_Parser::mapFindValues()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(bool, expected);
+
+    ParserWrapper w;
+    CborError err = w.init(data);
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+
+    // "needl" and "needles" must not match "needle"
+    static const char *const keys[] = { "needl", "needle", "needles", "haystack!" };
+    CborValue elements[4];
+    err = cbor_value_map_find_values(&w.first, keys, 4, elements);
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+
+    QCOMPARE(int(elements[0].type), int(CborInvalidType));
+    QCOMPARE(int(elements[2].type), int(CborInvalidType));
+    QCOMPARE(int(elements[3].type), int(CborInvalidType));
+    compareMapFindResult(&elements[1], expected);
+}
+
+void tst_Parser::mapIndexFind()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(bool, expected);
+
+    ParserWrapper w;
+    CborError err = w.init(data);
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+
+    CborMapIndexEntry entries[8];
+    CborMapIndex index;
+    err = cbor_value_map_index_init(&w.first, entries, 8, &index);
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+
+    // look it up twice: the index must not be modified by a lookup
+    for (int i = 0; i < 2; ++i) {
+        CborValue element;
+        err = cbor_map_index_find_value(&index, "needle", &element);
+        QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+        compareMapFindResult(&element, expected);
+
+        err = cbor_map_index_find_value(&index, "needles", &element);
+        QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+        QCOMPARE(int(element.type), int(CborInvalidType));
+    }
+}
+
+void tst_Parser::mapFindValuesMultiple()
+{
+    // {"z": 1, "y": 2, "z": 3, "zz": 4, 0: 5}
+    ParserWrapper w;
+    CborError err = w.init(raw("\xa5\x61z\1\x61y\2\x61z\3\x62zz\4\0\5"));
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+
+    // duplicate keys: the first one wins
+    static const char *const keys[] = { "zz", "z", "y" };
+    const int expected[] = { 4, 1, 2 };
+    CborValue elements[3];
+    err = cbor_value_map_find_values(&w.first, keys, 3, elements);
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+    for (int i = 0; i < 3; ++i) {
+        int value;
+        QVERIFY(cbor_value_is_integer(&elements[i]));
+        cbor_value_get_int(&elements[i], &value);
+        QCOMPARE(value, expected[i]);
+    }
+
+    // the table must have more entries than there are text string keys
+    CborMapIndexEntry entries[5];
+    CborMapIndex index;
+    err = cbor_value_map_index_init(&w.first, entries, 4, &index);
+    QCOMPARE(int(err), int(CborErrorOutOfMemory));
+    err = cbor_value_map_index_init(&w.first, entries, 5, &index);
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+    for (int i = 0; i < 3; ++i) {
+        int value;
+        err = cbor_map_index_find_value(&index, keys[i], &elements[i]);
+        QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+        QVERIFY(cbor_value_is_integer(&elements[i]));
+        cbor_value_get_int(&elements[i], &value);
+        QCOMPARE(value, expected[i]);
+    }
+
+    // errors invalidate all the results
+    err = w.init(raw("\xa5\x61z\1\x61y\2\x61z\3\x62zz"));
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+    err = cbor_value_map_find_values(&w.first, keys, 3, elements);
+    QCOMPARE(int(err), int(CborErrorUnexpectedEOF));
+    for (int i = 0; i < 3; ++i)
+        QCOMPARE(int(elements[i].type), int(CborInvalidType));
+}
+
+void tst_Parser::typedArray_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<int>("type");
+    QTest::addColumn<QVariantList>("expected");
+    QTest::addColumn<CborError>("error");
+
+    QVariantList empty;
+    QTest::newRow("empty") << raw("\xd8\x42\x40") << int(CborTypedArrayUint32) << empty << CborNoError;
+    QTest::newRow("uint8") << raw("\xd8\x40\x43\1\2\xff") << int(CborTypedArrayUint8)
+                           << QVariantList{1, 2, 255} << CborNoError;
+    QTest::newRow("uint8-clamped") << raw("\xd8\x44\x42\1\xff") << int(CborTypedArrayUint8)
+                                   << QVariantList{1, 255} << CborNoError;
+    QTest::newRow("sint8") << raw("\xd8\x48\x42\1\xff") << int(CborTypedArraySint8)
+                           << QVariantList{1, -1} << CborNoError;
+    QTest::newRow("uint16be") << raw("\xd8\x41\x44\1\2\3\4") << int(CborTypedArrayUint16)
+                              << QVariantList{0x102, 0x304} << CborNoError;
+    QTest::newRow("uint16le") << raw("\xd8\x45\x44\1\2\3\4") << int(CborTypedArrayUint16)
+                              << QVariantList{0x201, 0x403} << CborNoError;
+    QTest::newRow("uint32be") << raw("\xd8\x42\x44\1\2\3\4") << int(CborTypedArrayUint32)
+                              << QVariantList{0x1020304} << CborNoError;
+    QTest::newRow("uint32le") << raw("\xd8\x46\x44\1\2\3\4") << int(CborTypedArrayUint32)
+                              << QVariantList{0x4030201} << CborNoError;
+    QTest::newRow("uint64be") << raw("\xd8\x43\x48\1\2\3\4\5\6\7\x08") << int(CborTypedArrayUint64)
+                              << QVariantList{Q_UINT64_C(0x0102030405060708)} << CborNoError;
+    QTest::newRow("uint64le") << raw("\xd8\x47\x48\1\2\3\4\5\6\7\x08") << int(CborTypedArrayUint64)
+                              << QVariantList{Q_UINT64_C(0x0807060504030201)} << CborNoError;
+    QTest::newRow("sint16be") << raw("\xd8\x49\x44\xff\xfe\0\1") << int(CborTypedArraySint16)
+                              << QVariantList{-2, 1} << CborNoError;
+    QTest::newRow("sint32le") << raw("\xd8\x4e\x44\xfe\xff\xff\xff") << int(CborTypedArraySint32)
+                              << QVariantList{-2} << CborNoError;
+    QTest::newRow("sint64be") << raw("\xd8\x4b\x48\xff\xff\xff\xff\xff\xff\xff\xfe") << int(CborTypedArraySint64)
+                              << QVariantList{qint64(-2)} << CborNoError;
+    QTest::newRow("float16be") << raw("\xd8\x50\x44\x3c\0\xc0\0") << int(CborTypedArrayFloat16)
+                               << QVariantList{0x3c00, 0xc000} << CborNoError;
+    QTest::newRow("float32le") << raw("\xd8\x55\x44\0\0\x80\x3f") << int(CborTypedArrayFloat32)
+                               << QVariantList{1.0f} << CborNoError;
+    QTest::newRow("float64be") << raw("\xd8\x52\x48\x3f\xf0\0\0\0\0\0\0") << int(CborTypedArrayFloat64)
+                               << QVariantList{1.0} << CborNoError;
+    QTest::newRow("chunked") << raw("\xd8\x41\x5f\x42\1\2\x42\3\4\xff") << int(CborTypedArrayUint16)
+                             << QVariantList{0x102, 0x304} << CborNoError;
+
+    QTest::newRow("not-a-tag") << raw("\x44\1\2\3\4") << int(CborTypedArrayUint32)
+                               << empty << CborErrorIllegalType;
+    QTest::newRow("other-tag") << raw("\xc2\x44\1\2\3\4") << int(CborTypedArrayUint32)
+                               << empty << CborErrorIllegalType;
+    QTest::newRow("wrong-type") << raw("\xd8\x42\x44\1\2\3\4") << int(CborTypedArraySint32)
+                                << empty << CborErrorIllegalType;
+    QTest::newRow("not-bytes") << raw("\xd8\x42\x64\1\2\3\4") << int(CborTypedArrayUint32)
+                               << empty << CborErrorIllegalType;
+    QTest::newRow("float128") << raw("\xd8\x53\x40") << int(CborTypedArrayFloat64)
+                              << empty << CborErrorIllegalType;
+    QTest::newRow("improper-length") << raw("\xd8\x42\x43\1\2\3") << int(CborTypedArrayUint32)
+                                     << empty << CborErrorImproperValue;
+    QTest::newRow("unexpected-eof") << raw("\xd8\x42\x48\1\2\3") << int(CborTypedArrayUint32)
+                                    << empty << CborErrorUnexpectedEOF;
+}
+
+template <typename T, typename W = qint64>
+static QVariantList typedArrayToList(const QByteArray &buffer, size_t count)
+{
+    QVariantList result;
+    const T *ptr = reinterpret_cast<const T *>(buffer.constData());
+    for (size_t i = 0; i < count; ++i)
+        result << QVariant::fromValue(W(ptr[i]));
+    return result;
+}
+
+void tst_Parser::typedArray()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(int, type);
+    QFETCH(QVariantList, expected);
+    QFETCH(CborError, error);
+
+    ParserWrapper w;
+    CborError err = w.init(data);
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+
+    size_t size = type & 0x10 ? 2 << (type & 3) : 1 << (type & 3);
+    CborValue next = w.first;
+    size_t count = 0;
+    err = cbor_value_copy_typed_array(&w.first, CborTypedArrayType(type), nullptr, &count, &next);
+    QCOMPARE(err, error);
+    if (error)
+        return;
+    QCOMPARE(count, size_t(expected.size()));
+    QVERIFY(cbor_value_at_end(&next));
+
+    CborTypedArrayType actualType;
+    QCOMPARE(cbor_value_get_typed_array_type(&w.first, &actualType), CborNoError);
+    QCOMPARE(int(actualType), type);
+
+    // too short
+    QByteArray buffer(int(count * size) + 1, '\xff');
+    if (count) {
+        --count;
+        err = cbor_value_copy_typed_array(&w.first, CborTypedArrayType(type), buffer.data(), &count, nullptr);
+        QCOMPARE(err, CborErrorOutOfMemory);
+        QCOMPARE(buffer, QByteArray(buffer.size(), '\xff'));
+    }
+
+    count = expected.size() + 1;
+    next = w.first;
+    err = cbor_value_copy_typed_array(&w.first, CborTypedArrayType(type), buffer.data(), &count, &next);
+    QCOMPARE(err, CborNoError);
+    QCOMPARE(count, size_t(expected.size()));
+    QVERIFY(cbor_value_at_end(&next));
+
+    QVariantList result;
+    switch (type) {
+    case CborTypedArrayUint8:   result = typedArrayToList<quint8>(buffer, count); break;
+    case CborTypedArraySint8:   result = typedArrayToList<qint8>(buffer, count); break;
+    case CborTypedArrayUint16:
+    case CborTypedArrayFloat16: result = typedArrayToList<quint16>(buffer, count); break;
+    case CborTypedArraySint16:  result = typedArrayToList<qint16>(buffer, count); break;
+    case CborTypedArrayUint32:  result = typedArrayToList<quint32>(buffer, count); break;
+    case CborTypedArraySint32:  result = typedArrayToList<qint32>(buffer, count); break;
+    case CborTypedArrayUint64:  result = typedArrayToList<quint64, quint64>(buffer, count); break;
+    case CborTypedArraySint64:  result = typedArrayToList<qint64>(buffer, count); break;
+    case CborTypedArrayFloat32: result = typedArrayToList<float, double>(buffer, count); break;
+    case CborTypedArrayFloat64: result = typedArrayToList<double, double>(buffer, count); break;
+    }
+    QCOMPARE(result.size(), expected.size());
+    for (int i = 0; i < result.size(); ++i)
+        QCOMPARE(result.at(i).toString(), expected.at(i).toString());
+}
+
 void tst_Parser::checkedIntegers_data()
 {
     QTest::addColumn<QByteArray>("data");
@@ -1586,6 +2017,8 @@ void tst_Parser::strictValidation_data()
     QTest::newRow("invalid-utf8-hi-surrogate") << raw("\x63\xed\xa0\x80") << int(CborValidateStrictMode) << CborErrorInvalidUtf8TextString;
     QTest::newRow("invalid-utf8-lo-surrogate") << raw("\x63\xed\xb0\x80") << int(CborValidateStrictMode) << CborErrorInvalidUtf8TextString;
     QTest::newRow("invalid-utf8-surrogate-pair") << raw("\x66\xed\xa0\x80\xed\xb0\x80") << int(CborValidateStrictMode) << CborErrorInvalidUtf8TextString;
+    QTest::newRow("invalid-utf8-after-ascii") << raw("\x78\x28") + QByteArray(39, 'a') + '\x80' << int(CborValidateStrictMode) << CborErrorInvalidUtf8TextString;
+    QTest::newRow("invalid-utf8-between-ascii") << raw("\x78\x40") + QByteArray(20, 'a') + raw("\xe2\x82") + QByteArray(42, 'a') << int(CborValidateStrictMode) << CborErrorInvalidUtf8TextString;
     // Non-Unicode UTF-8 sequences
     QTest::newRow("invalid-utf8-non-unicode-1") << raw("\x64\xf4\x90\x80\x80") << int(CborValidateStrictMode) << CborErrorInvalidUtf8TextString;
     QTest::newRow("invalid-utf8-non-unicode-2") << raw("\x65\xf8\x88\x80\x80\x80") << int(CborValidateStrictMode) << CborErrorInvalidUtf8TextString;
@@ -1756,6 +2189,66 @@ void tst_Parser::strictValidation()
 
     err = cbor_value_validate(&w.first, flags);
     QCOMPARE(err, expectedError);
+
+    if (flags == CborValidateCanonicalFormat) {
+        // the deterministic check also rejects duplicate keys, which it may find first
+        err = cbor_value_validate_deterministic(&w.first);
+        if (expectedError == CborErrorMapNotSorted && err == CborErrorMapKeysNotUnique)
+            return;
+        QCOMPARE(err, expectedError);
+    }
+}
+
+void tst_Parser::deterministicValidation_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<CborError>("expectedError");
+
+    QTest::newRow("unsigned-24") << raw("\x18\x18") << CborNoError;
+    QTest::newRow("overlong-unsigned-23") << raw("\x18\x17") << CborErrorOverlongEncoding;
+    QTest::newRow("overlong-unsigned-255*2") << raw("\x19\0\xff") << CborErrorOverlongEncoding;
+    QTest::newRow("overlong-tag-1*8") << raw("\xc1\x1b\0\0\0\0\0\0\0\1\0") << CborErrorOverlongEncoding;
+    QTest::newRow("float16-1.5") << raw("\xf9\x3e\0") << CborNoError;
+    QTest::newRow("float16-nan") << raw("\xf9\x7e\0") << CborNoError;
+    QTest::newRow("float16-other-nan") << raw("\xf9\x7e\1") << CborErrorImproperValue;
+    QTest::newRow("float16-inf") << raw("\xf9\x7c\0") << CborNoError;
+    QTest::newRow("float16-denorm") << raw("\xf9\0\1") << CborNoError;
+    QTest::newRow("float-1.5") << raw("\xfa\x3f\xc0\0\0") << CborErrorOverlongEncoding;
+    QTest::newRow("float-nan") << raw("\xfa\x7f\xc0\0\0") << CborErrorOverlongEncoding;
+    QTest::newRow("float-100000") << raw("\xfa\x47\xc3\x50\0") << CborNoError;
+    QTest::newRow("float-denorm") << raw("\xfa\0\0\0\1") << CborNoError;
+    QTest::newRow("double-0") << raw("\xfb\0\0\0\0\0\0\0\0") << CborErrorOverlongEncoding;
+    QTest::newRow("double-100000") << raw("\xfb\x40\xf8\x6a\0\0\0\0\0") << CborErrorOverlongEncoding;
+    QTest::newRow("double-0.1") << raw("\xfb\x3f\xb9\x99\x99\x99\x99\x99\x9a") << CborNoError;
+    QTest::newRow("indeterminate-array") << raw("\x9f\xff") << CborErrorUnknownLength;
+    QTest::newRow("indeterminate-string") << raw("\x7f\xff") << CborErrorUnknownLength;
+    QTest::newRow("sorted-map") << raw("\xa4\x0a\0\x20\0\x61z\0\x62zz\0") << CborNoError;
+    QTest::newRow("unsorted-map") << raw("\xa2\x61z\0\x0a\0") << CborErrorMapNotSorted;
+    QTest::newRow("unsorted-map-length") << raw("\xa2\x62zz\0\x61z\0") << CborErrorMapNotSorted;
+    QTest::newRow("nonunique-map") << raw("\xa2\x61z\0\x61z\1") << CborErrorMapKeysNotUnique;
+    QTest::newRow("nonunique-map-AA") << raw("\xa2\x81\x65Hello\1\x81\x65Hello\2") << CborErrorMapKeysNotUnique;
+    QTest::newRow("nested-nonunique-map") << raw("\x81\xa2\0\0\0\0") << CborErrorMapKeysNotUnique;
+    QTest::newRow("illegal-simple-type") << raw("\xf8\x10") << CborErrorIllegalSimpleType;
+    QTest::newRow("unexpected-break") << raw("\x81\xff") << CborErrorUnexpectedBreak;
+    QTest::newRow("truncated-array") << raw("\x82\0") << CborErrorUnexpectedEOF;
+    QTest::newRow("truncated-string") << raw("\x63xy") << CborErrorUnexpectedEOF;
+    QTest::newRow("truncated-length") << raw("\x19\1") << CborErrorUnexpectedEOF;
+}
+
+void tst_Parser::deterministicValidation()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(CborError, expectedError);
+
+    ParserWrapper w;
+    CborError err = w.init(data);
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+
+    QCOMPARE(cbor_value_validate_deterministic(&w.first), expectedError);
+
+    // same verdict as the parser-based validation
+    err = cbor_value_validate(&w.first, CborValidateCanonicalFormat | CborValidateMapKeysAreUnique);
+    QCOMPARE(err == CborNoError, expectedError == CborNoError);
 }
 
 void tst_Parser::incompleteData_data()
@@ -0,0 +1,227 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#include <QtTest>
+#include "cbor.h"
+
+#include <vector>
+
+class tst_ParserBench : public QObject
+{
+    Q_OBJECT
+private slots:
+    void mapFindValue_data();
+    void mapFindValue();
+    void mapFindValues_data() { mapFindValue_data(); }
+    void mapFindValues();
+    void mapIndex_data() { mapFindValue_data(); }
+    void mapIndex();
+    void mapIndexLookup_data() { mapFindValue_data(); }
+    void mapIndexLookup();
+    void traverse_data();
+    void traverse();
+};
+
+// Builds a map of "key0".."keyN-1", alternating integer, text string and
+// nested array values, like the payloads exchanged with the cloud
+static QByteArray makeMap(int count)
+{
+    QByteArray buffer(64 + count * 64, Qt::Uninitialized);
+    CborEncoder encoder, map;
+    cbor_encoder_init(&encoder, reinterpret_cast<uint8_t *>(buffer.data()), buffer.size(), 0);
+    cbor_encoder_create_map(&encoder, &map, count);
+    for (int i = 0; i < count; ++i) {
+        cbor_encode_text_stringz(&map, QByteArray("key" + QByteArray::number(i)).constData());
+        switch (i % 3) {
+        case 0:
+            cbor_encode_int(&map, i * 1000);
+            break;
+        case 1:
+            cbor_encode_text_stringz(&map, "some value of the entry");
+            break;
+        case 2: {
+            CborEncoder array;
+            cbor_encoder_create_array(&map, &array, 3);
+            cbor_encode_int(&array, i);
+            cbor_encode_boolean(&array, true);
+            cbor_encode_null(&array);
+            cbor_encoder_close_container(&map, &array);
+            break;
+        }
+        }
+    }
+    cbor_encoder_close_container(&encoder, &map);
+    buffer.resize(int(cbor_encoder_get_buffer_size(&encoder, reinterpret_cast<uint8_t *>(buffer.data()))));
+    return buffer;
+}
+
+// the keys to look up are spread over the whole map, the last one is absent
+static std::vector<QByteArray> makeKeys(int count, int lookups)
+{
+    std::vector<QByteArray> keys;
+    for (int i = 0; i < lookups - 1; ++i)
+        keys.push_back("key" + QByteArray::number((count - 1) * i / qMax(1, lookups - 2)));
+    keys.push_back("absent");
+    return keys;
+}
+
+static std::vector<const char *> keyPointers(const std::vector<QByteArray> &keys)
+{
+    std::vector<const char *> ptrs;
+    for (const QByteArray &key : keys)
+        ptrs.push_back(key.constData());
+    return ptrs;
+}
+
+void tst_ParserBench::mapFindValue_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<int>("lookups");
+
+    for (int count : { 8, 32, 128 }) {
+        for (int lookups : { 2, 4, 16 }) {
+            QByteArray name = "keys=" + QByteArray::number(count) + ",lookups=" + QByteArray::number(lookups);
+            QTest::newRow(name.constData()) << count << lookups;
+        }
+    }
+}
+
+void tst_ParserBench::mapFindValue()
+{
+    QFETCH(int, count);
+    QFETCH(int, lookups);
+    QByteArray data = makeMap(count);
+    std::vector<QByteArray> keys = makeKeys(count, lookups);
+    std::vector<CborValue> elements(keys.size());
+
+    CborParser parser;
+    CborValue map;
+    QCOMPARE(cbor_parser_init(reinterpret_cast<const uint8_t *>(data.constData()), data.size(), 0, &parser, &map),
+             CborNoError);
+
+    QBENCHMARK {
+        for (size_t i = 0; i < keys.size(); ++i)
+            cbor_value_map_find_value(&map, keys[i].constData(), &elements[i]);
+    }
+    QVERIFY(cbor_value_is_valid(&elements.front()));
+    QVERIFY(!cbor_value_is_valid(&elements.back()));
+}
+
+void tst_ParserBench::mapFindValues()
+{
+    QFETCH(int, count);
+    QFETCH(int, lookups);
+    QByteArray data = makeMap(count);
+    std::vector<QByteArray> keys = makeKeys(count, lookups);
+    std::vector<const char *> ptrs = keyPointers(keys);
+    std::vector<CborValue> elements(keys.size());
+
+    CborParser parser;
+    CborValue map;
+    QCOMPARE(cbor_parser_init(reinterpret_cast<const uint8_t *>(data.constData()), data.size(), 0, &parser, &map),
+             CborNoError);
+
+    QBENCHMARK {
+        cbor_value_map_find_values(&map, ptrs.data(), ptrs.size(), elements.data());
+    }
+    QVERIFY(cbor_value_is_valid(&elements.front()));
+    QVERIFY(!cbor_value_is_valid(&elements.back()));
+}
+
+void tst_ParserBench::mapIndex()
+{
+    QFETCH(int, count);
+    QFETCH(int, lookups);
+    QByteArray data = makeMap(count);
+    std::vector<QByteArray> keys = makeKeys(count, lookups);
+    std::vector<CborValue> elements(keys.size());
+    std::vector<CborMapIndexEntry> entries(2 * count);
+
+    CborParser parser;
+    CborValue map;
+    QCOMPARE(cbor_parser_init(reinterpret_cast<const uint8_t *>(data.constData()), data.size(), 0, &parser, &map),
+             CborNoError);
+
+    // building the index is included
+    QBENCHMARK {
+        CborMapIndex index;
+        cbor_value_map_index_init(&map, entries.data(), entries.size(), &index);
+        for (size_t i = 0; i < keys.size(); ++i)
+            cbor_map_index_find_value(&index, keys[i].constData(), &elements[i]);
+    }
+    QVERIFY(cbor_value_is_valid(&elements.front()));
+    QVERIFY(!cbor_value_is_valid(&elements.back()));
+}
+
+void tst_ParserBench::mapIndexLookup()
+{
+    QFETCH(int, count);
+    QFETCH(int, lookups);
+    QByteArray data = makeMap(count);
+    std::vector<QByteArray> keys = makeKeys(count, lookups);
+    std::vector<CborValue> elements(keys.size());
+    std::vector<CborMapIndexEntry> entries(2 * count);
+
+    CborParser parser;
+    CborValue map;
+    CborMapIndex index;
+    QCOMPARE(cbor_parser_init(reinterpret_cast<const uint8_t *>(data.constData()), data.size(), 0, &parser, &map),
+             CborNoError);
+    QCOMPARE(cbor_value_map_index_init(&map, entries.data(), entries.size(), &index), CborNoError);
+
+    QBENCHMARK {
+        for (size_t i = 0; i < keys.size(); ++i)
+            cbor_map_index_find_value(&index, keys[i].constData(), &elements[i]);
+    }
+    QVERIFY(cbor_value_is_valid(&elements.front()));
+    QVERIFY(!cbor_value_is_valid(&elements.back()));
+}
+
+void tst_ParserBench::traverse_data()
+{
+    QTest::addColumn<int>("count");
+
+    for (int count : { 8, 32, 128 })
+        QTest::newRow(QByteArray("keys=" + QByteArray::number(count)).constData()) << count;
+}
+
+void tst_ParserBench::traverse()
+{
+    // reference: the time it takes to go over the whole map once
+    QFETCH(int, count);
+    QByteArray data = makeMap(count);
+
+    CborParser parser;
+    CborValue map;
+    QCOMPARE(cbor_parser_init(reinterpret_cast<const uint8_t *>(data.constData()), data.size(), 0, &parser, &map),
+             CborNoError);
+
+    QBENCHMARK {
+        CborValue it = map;
+        cbor_value_advance(&it);
+    }
+}
+
+QTEST_MAIN(tst_ParserBench)
+#include "tst_parserbench.moc"
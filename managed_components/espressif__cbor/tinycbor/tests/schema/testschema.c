@@ -0,0 +1,34 @@
+/* Generated by cborschema.pl from testschema.txt. Do not edit. */
+
+#include "testschema.h"
+
+#include <stddef.h>
+
+static const CborSchemaField point_fields[] = {
+    { "x", 1, CborSchemaInteger, CborSchemaFieldRequired, offsetof(struct point, x), sizeof(((struct point *)0)->x), 0, 0, NULL },
+    { "y", 1, CborSchemaInteger, CborSchemaFieldRequired, offsetof(struct point, y), sizeof(((struct point *)0)->y), 0, 0, NULL },
+};
+static const uint8_t point_slots[] = { 2, 1 };
+
+const CborSchemaMessage point_schema = {
+    point_fields, point_slots, sizeof(struct point), 0U, 0x3U, 2, 1
+};
+
+static const CborSchemaField sample_fields[] = {
+    { "name", 4, CborSchemaText, CborSchemaFieldRequired, offsetof(struct sample, name), sizeof(((struct sample *)0)->name), 0, 0, NULL },
+    { "label", 5, CborSchemaTextCopy, 0, offsetof(struct sample, label), sizeof(((struct sample *)0)->label), 0, 0, NULL },
+    { "id", 2, CborSchemaUnsigned, 0, offsetof(struct sample, id), sizeof(((struct sample *)0)->id), 0, 0, NULL },
+    { "value", 5, CborSchemaDouble, 0, offsetof(struct sample, value), sizeof(((struct sample *)0)->value), 0, 0, NULL },
+    { "enabled", 7, CborSchemaBoolean, 0, offsetof(struct sample, enabled), sizeof(((struct sample *)0)->enabled), 0, 0, NULL },
+    { "blob", 4, CborSchemaBytes, 0, offsetof(struct sample, blob), sizeof(((struct sample *)0)->blob), 0, 0, NULL },
+    { "path", 4, CborSchemaText, CborSchemaFieldArray, offsetof(struct sample, path), sizeof(((struct sample *)0)->path[0]), 4, offsetof(struct sample, path_count), NULL },
+    { "origin", 6, CborSchemaMap, 0, offsetof(struct sample, origin), sizeof(((struct sample *)0)->origin), 0, 0, &point_schema },
+    { "points", 6, CborSchemaMap, CborSchemaFieldArray, offsetof(struct sample, points), sizeof(((struct sample *)0)->points[0]), 3, offsetof(struct sample, points_count), &point_schema },
+    { "extra", 5, CborSchemaAny, 0, offsetof(struct sample, extra), sizeof(((struct sample *)0)->extra), 0, 0, NULL },
+    { "two words", 9, CborSchemaBoolean, 0, offsetof(struct sample, two_words), sizeof(((struct sample *)0)->two_words), 0, 0, NULL },
+};
+static const uint8_t sample_slots[] = { 8, 7, 0, 9, 4, 11, 6, 0, 3, 10, 2, 0, 0, 5, 0, 1 };
+
+const CborSchemaMessage sample_schema = {
+    sample_fields, sample_slots, sizeof(struct sample), 0U, 0x1U, 11, 15
+};
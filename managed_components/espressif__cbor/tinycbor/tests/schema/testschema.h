@@ -0,0 +1,68 @@
+/* Generated by cborschema.pl from testschema.txt. Do not edit. */
+
+#ifndef TESTSCHEMA_H
+#define TESTSCHEMA_H
+
+#include <cborschema.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define POINT_X_PRESENT 0x1U
+#define POINT_Y_PRESENT 0x2U
+typedef struct point
+{
+    uint32_t present;
+    int64_t x;
+    int64_t y;
+} point_t;
+
+extern const CborSchemaMessage point_schema;
+
+static inline CborError point_decode(CborValue *it, point_t *out)
+{
+    return cbor_schema_decode_advance(it, &point_schema, out);
+}
+
+#define SAMPLE_NAME_PRESENT 0x1U
+#define SAMPLE_LABEL_PRESENT 0x2U
+#define SAMPLE_ID_PRESENT 0x4U
+#define SAMPLE_VALUE_PRESENT 0x8U
+#define SAMPLE_ENABLED_PRESENT 0x10U
+#define SAMPLE_BLOB_PRESENT 0x20U
+#define SAMPLE_PATH_PRESENT 0x40U
+#define SAMPLE_ORIGIN_PRESENT 0x80U
+#define SAMPLE_POINTS_PRESENT 0x100U
+#define SAMPLE_EXTRA_PRESENT 0x200U
+#define SAMPLE_TWO_WORDS_PRESENT 0x400U
+typedef struct sample
+{
+    uint32_t present;
+    CborStringView name;
+    char label[8];
+    uint64_t id;
+    double value;
+    bool enabled;
+    CborByteStringView blob;
+    CborStringView path[4];
+    size_t path_count;
+    struct point origin;
+    struct point points[3];
+    size_t points_count;
+    CborValue extra;
+    bool two_words;
+} sample_t;
+
+extern const CborSchemaMessage sample_schema;
+
+static inline CborError sample_decode(CborValue *it, sample_t *out)
+{
+    return cbor_schema_decode_advance(it, &sample_schema, out);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TESTSCHEMA_H */
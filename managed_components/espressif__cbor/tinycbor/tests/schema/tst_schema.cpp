@@ -0,0 +1,229 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+
+#include <QtTest>
+#include "cbor.h"
+#include "testschema.h"
+
+Q_DECLARE_METATYPE(CborError)
+namespace QTest {
+template<> char *toString<CborError>(const CborError &err)
+{
+    return qstrdup(cbor_error_string(err));
+}
+}
+
+class tst_Schema : public QObject
+{
+    Q_OBJECT
+private slots:
+    void fullMessage();
+    void advance();
+    void validation_data();
+    void validation();
+};
+
+template <size_t N> QByteArray raw(const char (&data)[N])
+{
+    return QByteArray::fromRawData(data, N - 1);
+}
+
+static QByteArray encodeFullMessage()
+{
+    uint8_t buffer[256];
+    CborEncoder encoder, map, array, point;
+    cbor_encoder_init(&encoder, buffer, sizeof(buffer), 0);
+    cbor_encoder_create_map(&encoder, &map, CborIndefiniteLength);
+    cbor_encode_text_stringz(&map, "points");
+    cbor_encoder_create_array(&map, &array, 2);
+    for (int i = 0; i < 2; ++i) {
+        cbor_encoder_create_map(&array, &point, 2);
+        cbor_encode_text_stringz(&point, "y");
+        cbor_encode_int(&point, 10 * i + 1);
+        cbor_encode_text_stringz(&point, "x");
+        cbor_encode_int(&point, 10 * i);
+        cbor_encoder_close_container(&array, &point);
+    }
+    cbor_encoder_close_container(&map, &array);
+    cbor_encode_text_stringz(&map, "name");
+    cbor_encode_text_stringz(&map, "sensor");
+    cbor_encode_text_stringz(&map, "label");
+    cbor_encode_text_stringz(&map, "abc");
+    cbor_encode_text_stringz(&map, "id");
+    cbor_encode_uint(&map, 42);
+    cbor_encode_text_stringz(&map, "value");
+    cbor_encode_double(&map, 1.5);
+    cbor_encode_text_stringz(&map, "enabled");
+    cbor_encode_boolean(&map, true);
+    cbor_encode_text_stringz(&map, "blob");
+    cbor_encode_byte_string(&map, reinterpret_cast<const uint8_t *>("\1\2"), 2);
+    cbor_encode_text_stringz(&map, "path");
+    cbor_encoder_create_array(&map, &array, CborIndefiniteLength);
+    cbor_encode_text_stringz(&array, "a");
+    cbor_encode_text_stringz(&array, "bc");
+    cbor_encoder_close_container(&map, &array);
+    cbor_encode_text_stringz(&map, "origin");
+    cbor_encoder_create_map(&map, &point, 2);
+    cbor_encode_text_stringz(&point, "x");
+    cbor_encode_int(&point, -1);
+    cbor_encode_text_stringz(&point, "y");
+    cbor_encode_int(&point, -2);
+    cbor_encoder_close_container(&map, &point);
+    cbor_encode_int(&map, 7);                       // not in the schema
+    cbor_encode_text_stringz(&map, "ignored");
+    cbor_encode_text_stringz(&map, "extra");
+    cbor_encoder_create_array(&map, &array, 1);
+    cbor_encode_null(&array);
+    cbor_encoder_close_container(&map, &array);
+    cbor_encode_text_stringz(&map, "two words");
+    cbor_encode_boolean(&map, false);
+    cbor_encoder_close_container(&encoder, &map);
+    return QByteArray(reinterpret_cast<const char *>(buffer),
+                      int(cbor_encoder_get_buffer_size(&encoder, buffer)));
+}
+
+void tst_Schema::fullMessage()
+{
+    QByteArray data = encodeFullMessage();
+    CborParser parser;
+    CborValue first;
+    CborError err = cbor_parser_init(reinterpret_cast<const quint8 *>(data.constData()), data.size(), 0,
+                                     &parser, &first);
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+
+    sample_t s;
+    memset(&s, 0xff, sizeof(s));
+    err = sample_decode(&first, &s);
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+    QVERIFY(cbor_value_at_end(&first));
+
+    QCOMPARE(s.present, uint32_t(SAMPLE_NAME_PRESENT | SAMPLE_LABEL_PRESENT | SAMPLE_ID_PRESENT |
+                                 SAMPLE_VALUE_PRESENT | SAMPLE_ENABLED_PRESENT | SAMPLE_BLOB_PRESENT |
+                                 SAMPLE_PATH_PRESENT | SAMPLE_ORIGIN_PRESENT | SAMPLE_POINTS_PRESENT |
+                                 SAMPLE_EXTRA_PRESENT | SAMPLE_TWO_WORDS_PRESENT));
+    QCOMPARE(QByteArray(s.name.ptr, int(s.name.len)), QByteArray("sensor"));
+    QVERIFY(s.name.ptr > data.constData() && s.name.ptr < data.constData() + data.size());
+    QCOMPARE(QByteArray(s.label), QByteArray("abc"));
+    QCOMPARE(s.id, uint64_t(42));
+    QCOMPARE(s.value, 1.5);
+    QCOMPARE(s.enabled, true);
+    QCOMPARE(QByteArray(reinterpret_cast<const char *>(s.blob.ptr), int(s.blob.len)), raw("\1\2"));
+    QCOMPARE(s.path_count, size_t(2));
+    QCOMPARE(QByteArray(s.path[0].ptr, int(s.path[0].len)), QByteArray("a"));
+    QCOMPARE(QByteArray(s.path[1].ptr, int(s.path[1].len)), QByteArray("bc"));
+    QCOMPARE(s.origin.present, uint32_t(POINT_X_PRESENT | POINT_Y_PRESENT));
+    QCOMPARE(s.origin.x, int64_t(-1));
+    QCOMPARE(s.origin.y, int64_t(-2));
+    QCOMPARE(s.points_count, size_t(2));
+    for (int i = 0; i < 2; ++i) {
+        QCOMPARE(s.points[i].x, int64_t(10 * i));
+        QCOMPARE(s.points[i].y, int64_t(10 * i + 1));
+    }
+    QCOMPARE(s.points[2].present, uint32_t(0));
+    QVERIFY(cbor_value_is_array(&s.extra));
+    QCOMPARE(s.two_words, false);
+}
+
+void tst_Schema::advance()
+{
+    // two messages in a row, then a scalar
+    QByteArray data = raw("\x83" "\xa1\x64name\x61""a" "\xa1\x64name\x61""b" "\x01");
+    CborParser parser;
+    CborValue array, it;
+    QCOMPARE(cbor_parser_init(reinterpret_cast<const quint8 *>(data.constData()), data.size(), 0, &parser, &array),
+             CborNoError);
+    QCOMPARE(cbor_value_enter_container(&array, &it), CborNoError);
+
+    sample_t s;
+    QCOMPARE(cbor_schema_decode(&it, &sample_schema, &s), CborNoError);
+    QCOMPARE(QByteArray(s.name.ptr, int(s.name.len)), QByteArray("a"));
+    QCOMPARE(sample_decode(&it, &s), CborNoError);
+    QCOMPARE(QByteArray(s.name.ptr, int(s.name.len)), QByteArray("a"));
+    QCOMPARE(sample_decode(&it, &s), CborNoError);
+    QCOMPARE(QByteArray(s.name.ptr, int(s.name.len)), QByteArray("b"));
+    QVERIFY(cbor_value_is_unsigned_integer(&it));
+    QCOMPARE(sample_decode(&it, &s), CborErrorSchemaTypeMismatch);
+    QCOMPARE(cbor_value_advance_fixed(&it), CborNoError);
+    QVERIFY(cbor_value_at_end(&it));
+    QCOMPARE(cbor_value_leave_container(&array, &it), CborNoError);
+}
+
+void tst_Schema::validation_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<CborError>("expected");
+
+    QTest::newRow("not-map") << raw("\x80") << CborErrorSchemaTypeMismatch;
+    QTest::newRow("empty-map") << raw("\xa0") << CborErrorSchemaMissingKey;
+    QTest::newRow("name-not-text") << raw("\xa1""dname\x01") << CborErrorSchemaTypeMismatch;
+    QTest::newRow("name-bytes") << raw("\xa1""dnameAa") << CborErrorSchemaTypeMismatch;
+    QTest::newRow("name-chunked") << raw("\xa1""dname\x7f""aa\xff") << CborErrorUnknownLength;
+    QTest::newRow("name-invalid-utf8") << raw("\xa1""dnamea\xff") << CborErrorInvalidUtf8TextString;
+    QTest::newRow("duplicate-key") << raw("\xa2""dnameaadnameab") << CborErrorDuplicateObjectKeys;
+    QTest::newRow("id-negative") << raw("\xa2""dnameaabid ") << CborErrorSchemaTypeMismatch;
+    QTest::newRow("value-text") << raw("\xa2""dnameaaevalueax") << CborErrorSchemaTypeMismatch;
+    QTest::newRow("enabled-null") << raw("\xa2""dnameaagenabled\xf6") << CborErrorSchemaTypeMismatch;
+    QTest::newRow("blob-text") << raw("\xa2""dnameaadblobax") << CborErrorSchemaTypeMismatch;
+    QTest::newRow("label-too-long") << raw("\xa2""dnameaaelabelhabcdefgh") << CborErrorOutOfMemory;
+    QTest::newRow("path-not-array") << raw("\xa2""dnameaadpathax") << CborErrorSchemaTypeMismatch;
+    QTest::newRow("path-too-long") << raw("\xa2""dnameaadpath\x85""aaabacadae") << CborErrorSchemaTooManyItems;
+    QTest::newRow("path-item-type") << raw("\xa2""dnameaadpath\x81\x01") << CborErrorSchemaTypeMismatch;
+    QTest::newRow("origin-missing-y") << raw("\xa2""dnameaaforigin\xa1""ax\x01") << CborErrorSchemaMissingKey;
+    QTest::newRow("origin-array") << raw("\xa2""dnameaaforigin\x80") << CborErrorSchemaTypeMismatch;
+    QTest::newRow("points-too-many") << raw("\xa2""dnameaafpoints\x84\xa2""ax\x01""ay\x02\xa2""ax\x01""ay\x02\xa2""ax\x01""ay\x02\xa2""ax\x01""ay\x02") << CborErrorSchemaTooManyItems;
+    QTest::newRow("truncated") << raw("\xa2""dnameaa") << CborErrorUnexpectedEOF;
+    QTest::newRow("name-only") << raw("\xa1""dnameaa") << CborNoError;
+    QTest::newRow("label-fits") << raw("\xa2""dnameaaelabelgabcdefg") << CborNoError;
+    QTest::newRow("label-chunked") << raw("\xa2""dnameaaelabel\x7f""babac\xff") << CborNoError;
+    QTest::newRow("key-chunked") << raw("\xa1\x7f""bnabme\xff""aa") << CborNoError;
+    QTest::newRow("key-chunked-unknown") << raw("\xa2""dnameaa\x7f""bnabmf\xff""aa") << CborNoError;
+    QTest::newRow("unknown-keys") << raw("\xa4""dnameaa\x07""axczzz\xa1""aa\x01@\x01") << CborNoError;
+    QTest::newRow("indefinite-map") << raw("\xbf""dnameaadpath\x9f""aa\xff\xff") << CborNoError;
+    QTest::newRow("value-half") << raw("\xa2""dnameaaevalue\xf9>\x00") << CborNoError;
+    QTest::newRow("value-integer") << raw("\xa2""dnameaaevalue8c") << CborNoError;
+    QTest::newRow("path-empty") << raw("\xa2""dnameaadpath\x80") << CborNoError;
+    QTest::newRow("points-full") << raw("\xa2""dnameaafpoints\x83\xa2""ax\x01""ay\x02\xa2""ax\x01""ay\x02\xa2""ax\x01""ay\x02") << CborNoError;
+}
+
+void tst_Schema::validation()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(CborError, expected);
+
+    CborParser parser;
+    CborValue first;
+    CborError err = cbor_parser_init(reinterpret_cast<const quint8 *>(data.constData()), data.size(), 0,
+                                     &parser, &first);
+    QVERIFY2(!err, QByteArray("Got error \"") + cbor_error_string(err) + "\"");
+
+    sample_t s;
+    QCOMPARE(sample_decode(&first, &s), expected);
+    if (!expected) {
+        QVERIFY(s.present & SAMPLE_NAME_PRESENT);
+        QVERIFY(cbor_value_at_end(&first));
+    }
+}
+
+QTEST_MAIN(tst_Schema)
+#include "tst_schema.moc"
@@ -0,0 +1,9 @@
+SOURCES += tst_stringbench.cpp
+
+CONFIG += testcase c++11
+QT = core testlib
+
+INCLUDEPATH += ../../src
+msvc: POST_TARGETDEPS = ../../lib/tinycbor.lib
+else: POST_TARGETDEPS += ../../lib/libtinycbor.a
+LIBS += $$POST_TARGETDEPS
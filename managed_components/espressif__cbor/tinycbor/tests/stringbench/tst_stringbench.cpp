@@ -0,0 +1,263 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Intel Corporation
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+** THE SOFTWARE.
+**
+****************************************************************************/
+#include <QtTest>
+#include "cbor.h"
+#include "cborjson.h"
+#include "utf8_p.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+// Set TINYCBOR_BENCH_CORPUS to a directory of .cbor files (for example,
+// captured diagnostics reports) to add them to the generated payloads.
+class tst_StringBench : public QObject
+{
+    Q_OBJECT
+private slots:
+    void cleanup();
+
+    void asciiCheck_data();
+    void asciiCheck();
+    void validate_data() { asciiCheck_data(); }
+    void validate();
+    void prettyDump_data() { asciiCheck_data(); }
+    void prettyDump();
+    void toJson_data() { asciiCheck_data(); }
+    void toJson();
+};
+
+static const char *const implementationNames[] = { "scalar", "sse2", "avx2", "neon" };
+
+// Reports like the diagnostics ones: an array of records with a timestamp,
+// a tag and a message. The messages are ASCII in the "logs" payload, with a
+// few characters that need escaping, and mostly non-ASCII in the "utf8" one.
+static QByteArray encodeLogs(const char *const *messages, int count)
+{
+    QByteArray buffer(count * 256, Qt::Uninitialized);
+    CborEncoder encoder, array;
+    cbor_encoder_init(&encoder, reinterpret_cast<uint8_t *>(buffer.data()), buffer.size(), 0);
+    CborError err = cbor_encoder_create_array(&encoder, &array, count);
+    for (int i = 0; i < count; ++i) {
+        CborEncoder record;
+        err = CborError(err | cbor_encoder_create_map(&array, &record, 3));
+        err = CborError(err | cbor_encode_text_stringz(&record, "ts"));
+        err = CborError(err | cbor_encode_uint(&record, Q_UINT64_C(1700000000000000) + i));
+        err = CborError(err | cbor_encode_text_stringz(&record, "tag"));
+        err = CborError(err | cbor_encode_text_stringz(&record, i % 2 ? "wifi" : "esp_insights"));
+        err = CborError(err | cbor_encode_text_stringz(&record, "msg"));
+        err = CborError(err | cbor_encode_text_stringz(&record, messages[i % 4]));
+        err = CborError(err | cbor_encoder_close_container(&array, &record));
+    }
+    err = CborError(err | cbor_encoder_close_container(&encoder, &array));
+    Q_ASSERT(!err);
+    buffer.resize(int(cbor_encoder_get_buffer_size(&encoder, reinterpret_cast<uint8_t *>(buffer.data()))));
+    return buffer;
+}
+
+static QList<QPair<QByteArray, QByteArray>> payloads()
+{
+    static const char *const logs[] = {
+        "sta connected to ap \"office-2g\", channel 6, rssi -54 dBm, phy 11bgn",
+        "heap_caps_malloc failed: requested 4096 bytes from MALLOC_CAP_DMA, largest free block 3072",
+        "task_wdt: task watchdog got triggered. The following tasks did not reset the watchdog in time:\n - IDLE (CPU 0)",
+        "mqtt_client: [MQTT_EVENT_PUBLISHED] msg_id=4312 topic=node/7c9ebd3a/diag/metrics qos=1 retain=0",
+    };
+    static const char *const utf8[] = {
+        "Température du capteur élevée : 45 °C, ventilateur activé à 80 %",
+        "Соединение с точкой доступа потеряно, повторная попытка через 5 с",
+        "デバイスの空きヒープが少なくなっています：残り 12 KB",
+        "Überlauf im Empfangspuffer – 3 Pakete verworfen, Größe 1460 Bytes",
+    };
+
+    QList<QPair<QByteArray, QByteArray>> result;
+    result.append({ "logs", encodeLogs(logs, 256) });
+    result.append({ "utf8", encodeLogs(utf8, 256) });
+
+    QByteArray corpusPath = qgetenv("TINYCBOR_BENCH_CORPUS");
+    if (!corpusPath.isEmpty()) {
+        QDir corpus(QFile::decodeName(corpusPath));
+        for (const QFileInfo &info : corpus.entryInfoList({ "*.cbor" }, QDir::Files, QDir::Name)) {
+            QFile f(info.filePath());
+            if (f.open(QIODevice::ReadOnly))
+                result.append({ info.fileName().toUtf8(), f.readAll() });
+        }
+    }
+    return result;
+}
+
+// Runs f repeatedly for at least 100 ms and reports the bytes processed per
+// second, as QBENCHMARK can only report the time per iteration.
+template <typename F> static void measureThroughput(qint64 bytes, F f)
+{
+    QElapsedTimer timer;
+    qint64 iterations = 0;
+    timer.start();
+    do {
+        f();
+        ++iterations;
+    } while (timer.nsecsElapsed() < 100 * 1000 * 1000);
+    QTest::setBenchmarkResult(double(bytes) * iterations * 1e9 / timer.nsecsElapsed(), QTest::BytesPerSecond);
+}
+
+static void collectText(CborValue *it, QByteArray &text)
+{
+    while (!cbor_value_at_end(it)) {
+        if (cbor_value_is_container(it)) {
+            CborValue child;
+            cbor_value_enter_container(it, &child);
+            collectText(&child, text);
+            cbor_value_leave_container(it, &child);
+        } else if (cbor_value_is_text_string(it)) {
+            const char *ptr;
+            size_t len;
+            cbor_value_begin_string_iteration(it);
+            while (cbor_value_get_text_string_chunk(it, &ptr, &len, it) == CborNoError)
+                text.append(ptr, int(len));
+            cbor_value_finish_string_iteration(it);
+        } else {
+            cbor_value_advance(it);
+        }
+    }
+}
+
+static CborError discardStream(void *token, const char *fmt, ...)
+{
+    char buffer[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buffer, sizeof(buffer), fmt, ap);
+    va_end(ap);
+    *static_cast<qint64 *>(token) += n;
+    return n < 0 ? CborErrorIO : CborNoError;
+}
+
+void tst_StringBench::cleanup()
+{
+    _cbor_utf8_set_implementation(CborUtf8Automatic);
+}
+
+void tst_StringBench::asciiCheck_data()
+{
+    QTest::addColumn<QByteArray>("payload");
+    QTest::addColumn<int>("implementation");
+
+    const auto list = payloads();
+    for (const auto &payload : list) {
+        for (int impl = CborUtf8Scalar; impl <= CborUtf8Neon; ++impl) {
+            if (_cbor_utf8_set_implementation(CborUtf8Implementation(impl)) != impl)
+                continue;
+            QTest::newRow((payload.first + '/' + implementationNames[impl]).constData())
+                    << payload.second << impl;
+        }
+    }
+    _cbor_utf8_set_implementation(CborUtf8Automatic);
+}
+
+void tst_StringBench::asciiCheck()
+{
+    // the text of all strings, as the pure-ASCII check only looks at those
+    QFETCH(QByteArray, payload);
+    QFETCH(int, implementation);
+    QCOMPARE(int(_cbor_utf8_set_implementation(CborUtf8Implementation(implementation))), implementation);
+
+    CborParser parser;
+    CborValue first;
+    QByteArray text;
+    QCOMPARE(cbor_parser_init(reinterpret_cast<const quint8 *>(payload.constData()), payload.size(), 0, &parser, &first), CborNoError);
+    collectText(&first, text);
+
+    const uint8_t *ptr = reinterpret_cast<const uint8_t *>(text.constData());
+    size_t ascii = 0;
+    measureThroughput(text.size(), [&] {
+        // skip over the non-ASCII bytes one at a time
+        ascii = 0;
+        for (size_t i = 0; i < size_t(text.size()); ++i) {
+            size_t n = _cbor_utf8_ascii_prefix(ptr + i, text.size() - i);
+            ascii += n;
+            i += n;
+        }
+    });
+    QVERIFY(ascii > 0);
+}
+
+void tst_StringBench::validate()
+{
+    QFETCH(QByteArray, payload);
+    QFETCH(int, implementation);
+    QCOMPARE(int(_cbor_utf8_set_implementation(CborUtf8Implementation(implementation))), implementation);
+
+    CborParser parser;
+    CborValue first;
+    QCOMPARE(cbor_parser_init(reinterpret_cast<const quint8 *>(payload.constData()), payload.size(), 0, &parser, &first), CborNoError);
+
+    CborError err = CborNoError;
+    measureThroughput(payload.size(), [&] {
+        err = cbor_value_validate(&first, CborValidateUtf8);
+    });
+    QCOMPARE(err, CborNoError);
+}
+
+void tst_StringBench::prettyDump()
+{
+    QFETCH(QByteArray, payload);
+    QFETCH(int, implementation);
+    QCOMPARE(int(_cbor_utf8_set_implementation(CborUtf8Implementation(implementation))), implementation);
+
+    CborParser parser;
+    CborValue first;
+    QCOMPARE(cbor_parser_init(reinterpret_cast<const quint8 *>(payload.constData()), payload.size(), 0, &parser, &first), CborNoError);
+
+    CborError err = CborNoError;
+    qint64 written = 0;
+    measureThroughput(payload.size(), [&] {
+        CborValue it = first;
+        err = cbor_value_to_pretty_stream(discardStream, &written, &it, CborPrettyDefaultFlags);
+    });
+    QCOMPARE(err, CborNoError);
+    QVERIFY(written > payload.size());
+}
+
+void tst_StringBench::toJson()
+{
+    QFETCH(QByteArray, payload);
+    QFETCH(int, implementation);
+    QCOMPARE(int(_cbor_utf8_set_implementation(CborUtf8Implementation(implementation))), implementation);
+
+    CborParser parser;
+    CborValue first;
+    QCOMPARE(cbor_parser_init(reinterpret_cast<const quint8 *>(payload.constData()), payload.size(), 0, &parser, &first), CborNoError);
+
+    FILE *out = tmpfile();
+    QVERIFY(out);
+    CborError err = CborNoError;
+    measureThroughput(payload.size(), [&] {
+        rewind(out);
+        err = cbor_value_to_json(out, &first, 0);
+    });
+    fclose(out);
+    QCOMPARE(err, CborNoError);
+}
+
+QTEST_MAIN(tst_StringBench)
+#include "tst_stringbench.moc"
@@ -1,3 +1,3 @@
 TEMPLATE = subdirs
-SUBDIRS = parser encoder c90 cpp tojson
-msvc: SUBDIRS -= tojson
+SUBDIRS = parser parserbench encoder encoderbench schema stringbench c90 cpp tojson
+msvc: SUBDIRS -= stringbench tojson
@@ -147,6 +147,9 @@ void addTextStringsData()
                                   << "\"123456789012345678901234\"";
     QTest::newRow("textstring256") << raw("\x79\1\0") + QByteArray(256, '3')
                                    << '"' + QString(256, '3') + '"';
+    QTest::newRow("textstring-escapes") << raw("\x78\x27") + QByteArray(32, 'a') + raw("\"\\\b\n\x01\x1f\t")
+                                        << '"' + QString(32, 'a') + "\\\"\\\\\\b\\n\\u0001\\u001F\\t\"";
+    QTest::newRow("textstringutf8") << raw("\x65\xc3\xa9t\xc3\xa9") << QString::fromUtf8("\"\xc3\xa9t\xc3\xa9\"");
 
     // strings with undefined length
     QTest::newRow("_emptytextstring") << raw("\x7f\xff") << "\"\"";
@@ -26,9 +26,13 @@
 #include "cbor.h"
 #include "cborjson.h"
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 void *xrealloc(void *old, size_t size, const char *fname)
@@ -47,11 +51,11 @@ void printerror(CborError err, const char *fname)
     exit(EXIT_FAILURE);
 }
 
-void dumpFile(FILE *in, const char *fname, bool printJosn, int flags)
+uint8_t *readFile(FILE *in, const char *fname, size_t *len)
 {
     static const size_t chunklen = 16 * 1024;
-    static size_t bufsize = 0;
-    static uint8_t *buffer = NULL;
+    size_t bufsize = 0;
+    uint8_t *buffer = NULL;
 
     size_t buflen = 0;
     do {
@@ -68,6 +72,15 @@ void dumpFile(FILE *in, const char *fname, bool printJosn, int flags)
         }
     } while (!feof(in));
 
+    *len = buflen;
+    return buffer;
+}
+
+void dumpFile(FILE *in, const char *fname, bool printJosn, int flags)
+{
+    size_t buflen;
+    uint8_t *buffer = readFile(in, fname, &buflen);
+
     CborParser parser;
     CborValue value;
     CborError err = cbor_parser_init(buffer, buflen, 0, &parser, &value);
@@ -83,15 +96,406 @@ void dumpFile(FILE *in, const char *fname, bool printJosn, int flags)
         err = CborErrorGarbageAtEnd;
     if (err)
         printerror(err, fname);
+    free(buffer);
+}
+
+/*
+ * Batch mode: each input is a CBOR sequence (one or more concatenated items)
+ * and every item is printed on a line of its own. The inputs are cut into
+ * jobs, which a pool of worker threads converts into buffers of their own.
+ * The main thread queues the jobs and writes the buffers out in input order,
+ * so at most a window of jobs is held in memory at any time.
+ *
+ * Small files are grouped into a job and read by the worker. Large files are
+ * memory-mapped and split at item boundaries.
+ */
+enum {
+    BatchJobSize = 64 * 1024,       /* input bytes per job */
+    BatchPiecesPerJob = 64,
+    BatchJobsPerThread = 4
+};
+
+struct Mapping {
+    uint8_t *data;
+    size_t size;
+    bool mapped;
+    size_t refs;                    /* queued pieces, plus one while it's being split */
+};
+
+struct Piece {
+    const char *fname;
+    struct Mapping *mapping;        /* NULL if the worker reads the whole file */
+    const uint8_t *begin;
+    const uint8_t *end;
+};
+
+struct Job {
+    struct Piece pieces[BatchPiecesPerJob];
+    int count;
+    size_t size;
+    char *out;
+    size_t outlen;
+    int failed;                     /* index of the piece that failed, or -1 */
+    int errnum;
+    CborError err;
+    size_t errpos;
+    bool done;
+};
+
+struct Batch {
+    pthread_mutex_t mutex;
+    pthread_cond_t jobQueued;
+    pthread_cond_t jobDone;
+    struct Job *jobs;               /* ring of window entries */
+    struct Job *filling;            /* the next job, not yet queued */
+    size_t window;
+    size_t queued;
+    size_t taken;
+    size_t written;
+    bool finished;
+    bool printJson;
+    int flags;
+};
+
+struct Mapping *mapFile(const char *fname)
+{
+    struct Mapping *m = xrealloc(NULL, sizeof(*m), fname);
+    struct stat st;
+    int fd = strcmp(fname, "-") == 0 ? STDIN_FILENO : open(fname, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        fprintf(stderr, "%s: %s\n", fname, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    m->refs = 1;
+    m->mapped = false;
+    m->data = NULL;
+    m->size = 0;
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr != MAP_FAILED) {
+            m->data = ptr;
+            m->size = st.st_size;
+            m->mapped = true;
+        }
+    }
+    if (!m->mapped && (!S_ISREG(st.st_mode) || st.st_size > 0)) {
+        /* pipes and such */
+        FILE *in = fd == STDIN_FILENO ? stdin : fdopen(fd, "rb");
+        if (!in) {
+            fprintf(stderr, "%s: %s\n", fname, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        m->data = readFile(in, fname, &m->size);
+        if (in != stdin)
+            fclose(in);
+        return m;
+    }
+    if (fd != STDIN_FILENO)
+        close(fd);
+    return m;
+}
+
+void releaseMapping(struct Mapping *m)
+{
+    if (--m->refs)
+        return;
+    if (m->mapped)
+        munmap(m->data, m->size);
+    else
+        free(m->data);
+    free(m);
+}
+
+/* Reads a whole file into the worker's buffer. Returns an errno value. */
+int loadFile(const char *fname, uint8_t **buffer, size_t *bufsize, size_t *len)
+{
+    int fd = open(fname, O_RDONLY);
+    if (fd < 0)
+        return errno;
+
+    *len = 0;
+    for (;;) {
+        if (*len == *bufsize) {
+            uint8_t *ptr = realloc(*buffer, *bufsize + BatchJobSize);
+            if (!ptr) {
+                close(fd);
+                return ENOMEM;
+            }
+            *buffer = ptr;
+            *bufsize += BatchJobSize;
+        }
+
+        ssize_t n = read(fd, *buffer + *len, *bufsize - *len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0) {
+            int errnum = errno;
+            close(fd);
+            return errnum;
+        }
+        if (n == 0)
+            break;
+        *len += n;
+    }
+    close(fd);
+    return 0;
+}
+
+/* Prints the items in [*ptr, end), one per line. *complete is the length of the output up to the
+ * last complete line, as seen in outlen, the size variable of the memstream out. */
+CborError convertItems(FILE *out, const uint8_t **ptr, const uint8_t *end, bool printJson, int flags,
+                       const size_t *outlen, size_t *complete)
+{
+    while (*ptr < end) {
+        CborParser parser;
+        CborValue value;
+        CborError err = cbor_parser_init(*ptr, end - *ptr, 0, &parser, &value);
+        if (!err) {
+            if (printJson)
+                err = cbor_value_to_json_advance(out, &value, flags);
+            else
+                err = cbor_value_to_pretty_advance_flags(out, &value, flags);
+        }
+        if (err)
+            return err;
+
+        fputc('\n', out);
+        if (fflush(out) != 0)
+            return CborErrorIO;
+        *ptr = cbor_value_get_next_byte(&value);
+        *complete = *outlen;
+    }
+    return CborNoError;
+}
+
+void convertJob(struct Job *job, bool printJson, int flags, uint8_t **buffer, size_t *bufsize)
+{
+    size_t complete = 0;
+    int i;
+    FILE *out = open_memstream(&job->out, &job->outlen);
+    if (!out) {
+        fprintf(stderr, "%s: %s\n", job->pieces[0].fname, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    job->failed = -1;
+    for (i = 0; i < job->count; ++i) {
+        const struct Piece *piece = &job->pieces[i];
+        const uint8_t *base = *buffer;
+        const uint8_t *ptr = *buffer;
+        const uint8_t *end;
+        if (piece->mapping) {
+            base = piece->mapping->data;
+            ptr = piece->begin;
+            end = piece->end;
+        } else {
+            size_t len = 0;
+            job->errnum = loadFile(piece->fname, buffer, bufsize, &len);
+            if (job->errnum) {
+                job->failed = i;
+                break;
+            }
+            base = ptr = *buffer;
+            end = ptr + len;
+        }
+
+        job->err = convertItems(out, &ptr, end, printJson, flags, &job->outlen, &complete);
+        if (job->err) {
+            job->failed = i;
+            job->errpos = ptr - base;
+            break;
+        }
+    }
+    if (fclose(out) != 0 && job->failed < 0) {
+        job->failed = 0;
+        job->errnum = errno;
+    }
+    if (job->failed >= 0)
+        job->outlen = complete;     /* drop the partial line */
+}
+
+void *batchWorker(void *arg)
+{
+    struct Batch *b = arg;
+    uint8_t *buffer = NULL;
+    size_t bufsize = 0;
+
+    pthread_mutex_lock(&b->mutex);
+    for (;;) {
+        while (b->taken == b->queued && !b->finished)
+            pthread_cond_wait(&b->jobQueued, &b->mutex);
+        if (b->taken == b->queued)
+            break;
+
+        struct Job *job = &b->jobs[b->taken++ % b->window];
+        pthread_mutex_unlock(&b->mutex);
+        convertJob(job, b->printJson, b->flags, &buffer, &bufsize);
+        pthread_mutex_lock(&b->mutex);
+        job->done = true;
+        pthread_cond_signal(&b->jobDone);
+    }
+    pthread_mutex_unlock(&b->mutex);
+    free(buffer);
+    return NULL;
+}
+
+/* Called with the mutex held. Waits for the oldest job and prints it. */
+void writeOldestJob(struct Batch *b)
+{
+    struct Job *job = &b->jobs[b->written % b->window];
+    int i;
+    while (!job->done)
+        pthread_cond_wait(&b->jobDone, &b->mutex);
+    pthread_mutex_unlock(&b->mutex);
+
+    fwrite(job->out, 1, job->outlen, stdout);
+    free(job->out);
+    if (job->failed >= 0) {
+        const char *fname = job->pieces[job->failed].fname;
+        fflush(stdout);
+        if (job->errnum)
+            fprintf(stderr, "%s: %s\n", fname, strerror(job->errnum));
+        else
+            fprintf(stderr, "%s: offset %zu: %s\n", fname, job->errpos, cbor_error_string(job->err));
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < job->count; ++i) {
+        if (job->pieces[i].mapping)
+            releaseMapping(job->pieces[i].mapping);
+    }
+
+    pthread_mutex_lock(&b->mutex);
+    ++b->written;
+}
+
+void queueJob(struct Batch *b)
+{
+    if (!b->filling)
+        return;
+    pthread_mutex_lock(&b->mutex);
+    ++b->queued;
+    pthread_cond_signal(&b->jobQueued);
+    pthread_mutex_unlock(&b->mutex);
+    b->filling = NULL;
+}
+
+void addPiece(struct Batch *b, const char *fname, struct Mapping *m, const uint8_t *begin,
+              const uint8_t *end, size_t size)
+{
+    if (!b->filling) {
+        /* wait for a free entry in the ring */
+        pthread_mutex_lock(&b->mutex);
+        while (b->queued - b->written == b->window)
+            writeOldestJob(b);
+        pthread_mutex_unlock(&b->mutex);
+
+        b->filling = &b->jobs[b->queued % b->window];
+        b->filling->count = 0;
+        b->filling->size = 0;
+        b->filling->errnum = 0;
+        b->filling->err = CborNoError;
+        b->filling->done = false;
+    }
+
+    struct Piece *piece = &b->filling->pieces[b->filling->count++];
+    piece->fname = fname;
+    piece->mapping = m;
+    piece->begin = begin;
+    piece->end = end;
+    if (m)
+        ++m->refs;
+    b->filling->size += size;
+    if (b->filling->count == BatchPiecesPerJob || b->filling->size >= BatchJobSize)
+        queueJob(b);
+}
+
+void queueFile(struct Batch *b, const char *fname)
+{
+    struct stat st;
+    if (strcmp(fname, "-") != 0 && stat(fname, &st) == 0 && S_ISREG(st.st_mode) &&
+            st.st_size < BatchJobSize) {
+        addPiece(b, fname, NULL, NULL, NULL, st.st_size);
+        return;
+    }
+
+    struct Mapping *m = mapFile(fname);
+    const uint8_t *ptr = m->data;
+    const uint8_t *end = ptr + m->size;
+    while (ptr < end) {
+        const uint8_t *begin = ptr;
+        while (ptr < end && (size_t)(ptr - begin) < BatchJobSize) {
+            /* skip over one item; if it's invalid, let the worker report it */
+            CborParser parser;
+            CborValue value;
+            if (cbor_parser_init(ptr, end - ptr, 0, &parser, &value) != CborNoError ||
+                    cbor_value_advance(&value) != CborNoError) {
+                ptr = end;
+                break;
+            }
+            ptr = cbor_value_get_next_byte(&value);
+        }
+        addPiece(b, fname, m, begin, ptr, ptr - begin);
+    }
+    releaseMapping(m);
+}
+
+void dumpBatch(char **fname, int threads, bool printJson, int flags)
+{
+    static char *const readStdin[] = { "-", NULL };
+    struct Batch b;
+    pthread_t *workers = xrealloc(NULL, threads * sizeof(pthread_t), "batch");
+    int i;
+
+    pthread_mutex_init(&b.mutex, NULL);
+    pthread_cond_init(&b.jobQueued, NULL);
+    pthread_cond_init(&b.jobDone, NULL);
+    b.window = threads * BatchJobsPerThread;
+    b.jobs = xrealloc(NULL, b.window * sizeof(struct Job), "batch");
+    b.filling = NULL;
+    b.queued = b.taken = b.written = 0;
+    b.finished = false;
+    b.printJson = printJson;
+    b.flags = flags;
+
+    for (i = 0; i < threads; ++i) {
+        if (pthread_create(&workers[i], NULL, batchWorker, &b) != 0) {
+            fprintf(stderr, "batch: %s\n", strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (!*fname)
+        fname = (char **)readStdin;
+    for ( ; *fname; ++fname)
+        queueFile(&b, *fname);
+    queueJob(&b);
+
+    pthread_mutex_lock(&b.mutex);
+    b.finished = true;
+    pthread_cond_broadcast(&b.jobQueued);
+    while (b.written != b.queued)
+        writeOldestJob(&b);
+    pthread_mutex_unlock(&b.mutex);
+
+    for (i = 0; i < threads; ++i)
+        pthread_join(workers[i], NULL);
+    free(workers);
+    free(b.jobs);
+    pthread_cond_destroy(&b.jobDone);
+    pthread_cond_destroy(&b.jobQueued);
+    pthread_mutex_destroy(&b.mutex);
 }
 
 int main(int argc, char **argv)
 {
     bool printJson = false;
+    bool batch = false;
+    int threads = 0;
     int json_flags = CborConvertDefaultFlags;
     int cbor_flags = CborPrettyDefaultFlags;
     int c;
-    while ((c = getopt(argc, argv, "MOSUcjhfn")) != -1) {
+    while ((c = getopt(argc, argv, "MOSUbcjhfnt:")) != -1) {
         switch (c) {
         case 'c':
             printJson = false;
@@ -100,6 +504,17 @@ int main(int argc, char **argv)
             printJson = true;
             break;
 
+        case 'b':
+            batch = true;
+            break;
+        case 't':
+            threads = atoi(optarg);
+            if (threads <= 0) {
+                fprintf(stderr, "Invalid thread count '%s'.\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+
         case 'f':
             cbor_flags |= CborPrettyShowStringFragments;
             break;
@@ -131,6 +546,8 @@ int main(int argc, char **argv)
                  " -c       Print a CBOR dump (see RFC 7049) (default)\n"
                  " -j       Print a JSON equivalent version\n"
                  " -h       Print this help output and exit\n"
+                 " -b       Batch mode: FILEs are CBOR sequences, print one line per item\n"
+                 " -t N     Use N threads in batch mode (default: one per CPU)\n"
                  "When JSON output is active, the following options are recognized:\n"
                  " -M       Add metadata so converting back to CBOR is possible\n"
                  " -O       Convert CBOR tags to JSON objects\n"
@@ -145,7 +562,13 @@ int main(int argc, char **argv)
     }
 
     char **fname = argv + optind;
-    if (!*fname) {
+    if (batch) {
+        if (!threads) {
+            long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            threads = cpus > 0 ? (int)cpus : 1;
+        }
+        dumpBatch(fname, threads, printJson, printJson ? json_flags : cbor_flags);
+    } else if (!*fname) {
         dumpFile(stdin, "-", printJson, printJson ? json_flags : cbor_flags);
     } else {
         for ( ; *fname; ++fname) {
@@ -8,3 +8,4 @@ CBORDIR = $$PWD/../../src
 INCLUDEPATH += $$CBORDIR
 SOURCES += cbordump.c
 LIBS += ../../lib/libtinycbor.a
+unix: LIBS += -lpthread
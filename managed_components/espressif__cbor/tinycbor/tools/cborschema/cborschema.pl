@@ -0,0 +1,255 @@
+#!/usr/bin/perl -l
+## Copyright (C) 2021 Intel Corporation
+##
+## Permission is hereby granted, free of charge, to any person obtaining a copy
+## of this software and associated documentation files (the "Software"), to deal
+## in the Software without restriction, including without limitation the rights
+## to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+## copies of the Software, and to permit persons to whom the Software is
+## furnished to do so, subject to the following conditions:
+##
+## The above copyright notice and this permission notice shall be included in
+## all copies or substantial portions of the Software.
+##
+## THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+## IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+## FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+## AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+## LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+## OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+## THE SOFTWARE.
+##
+##
+## Generates the structures and tables used by cbor_schema_decode_advance()
+## from a description of the messages:
+##
+##   # comment
+##   message name
+##       key     type[N]     required as=member
+##   end
+##
+## where type is bool, int, uint, double, text, bytes, text(N), any or the
+## name of a message defined earlier, [N] makes it an array of up to N
+## elements, and the options are optional. The output is written to
+## <basename>.h and <basename>.c.
+##
+use strict;
+my ($fname, $basename) = @ARGV;
+die("Usage: cborschema.pl schema.txt basename\n")
+    unless defined $basename;
+open SCHEMA, "<", $fname
+    or die("Cannot open $fname: $!\n");
+
+my %types = (
+    "bool" => [ "CborSchemaBoolean", "bool" ],
+    "int" => [ "CborSchemaInteger", "int64_t" ],
+    "uint" => [ "CborSchemaUnsigned", "uint64_t" ],
+    "double" => [ "CborSchemaDouble", "double" ],
+    "text" => [ "CborSchemaText", "CborStringView" ],
+    "bytes" => [ "CborSchemaBytes", "CborByteStringView" ],
+    "any" => [ "CborSchemaAny", "CborValue" ]
+);
+
+my @messages;
+my %messages;
+my $current;
+while (<SCHEMA>) {
+    s/\s*#.*$//;
+    next if /^\s*$/;
+    chomp;
+
+    if (/^message\s+([A-Za-z_]\w*)$/) {
+        die("$fname:$.: message $1 inside message $current->{name}\n") if $current;
+        die("$fname:$.: message $1 defined twice\n") if $messages{$1};
+        $current = { name => $1, fields => [] };
+        next;
+    }
+    if (/^end$/) {
+        die("$fname:$.: end outside a message\n") unless $current;
+        die("$fname:$.: message $current->{name} has no fields\n")
+            unless scalar @{$current->{fields}};
+        push @messages, $current;
+        $messages{$current->{name}} = $current;
+        undef $current;
+        next;
+    }
+    die("$fname:$.: field outside a message\n") unless $current;
+    die("$fname:$.: could not parse line \"$_\"\n")
+        unless /^\s+("[^"]*"|\S+)\s+(\w+)(?:\((\d+)\))?(?:\[(\d+)\])?((?:\s+\S+)*)$/;
+
+    my %field = (key => $1, type => $2, copysize => $3, count => $4);
+    $field{key} =~ s/^"(.*)"$/$1/;
+    ($field{member} = $field{key}) =~ s/\W/_/g;
+    $field{member} = "_$field{member}" if $field{member} =~ /^\d/;
+    for my $option (split(' ', $5)) {
+        if ($option eq "required") {
+            $field{required} = 1;
+        } elsif ($option =~ /^as=([A-Za-z_]\w*)$/) {
+            $field{member} = $1;
+        } else {
+            die("$fname:$.: unknown option \"$option\"\n");
+        }
+    }
+
+    die("$fname:$.: key \"$field{key}\" is empty or contains a NUL\n")
+        if $field{key} eq "" or $field{key} =~ /\0/;
+    die("$fname:$.: count must not be zero\n")
+        if defined $field{count} and $field{count} == 0;
+    if (defined $field{copysize}) {
+        die("$fname:$.: only text takes a buffer size\n") unless $field{type} eq "text";
+        die("$fname:$.: buffer size must be between 1 and 65535\n")
+            if $field{copysize} == 0 or $field{copysize} > 65535;
+        $field{kind} = "CborSchemaTextCopy";
+        $field{ctype} = "char";
+    } elsif ($types{$field{type}}) {
+        ($field{kind}, $field{ctype}) = @{$types{$field{type}}};
+    } elsif ($messages{$field{type}}) {
+        $field{kind} = "CborSchemaMap";
+        $field{ctype} = "struct $field{type}";
+    } else {
+        die("$fname:$.: unknown type $field{type}\n");
+    }
+    for my $other (@{$current->{fields}}) {
+        die("$fname:$.: key \"$field{key}\" repeated\n") if $other->{key} eq $field{key};
+        die("$fname:$.: member $field{member} repeated, use as=\n")
+            if $other->{member} eq $field{member} or "$other->{member}_count" eq $field{member}
+                or (defined $other->{count} and $field{member} eq "$other->{member}_count")
+                or (defined $field{count} and $other->{member} eq "$field{member}_count");
+    }
+    push @{$current->{fields}}, \%field;
+    die("$fname:$.: message $current->{name} has more than 32 fields\n")
+        if scalar @{$current->{fields}} > 32;
+}
+die("$fname: message $current->{name} not terminated\n") if $current;
+close SCHEMA or die;
+
+# Same function as hash_update() in cborschema.c
+sub hash {
+    my ($seed, $key) = @_;
+    my $h = 2166136261 ^ $seed;
+    for my $byte (unpack("C*", $key)) {
+        $h = (($h ^ $byte) * 16777619) & 0xffffffff;
+    }
+    return $h ^ ($h >> 16);
+}
+
+# Find a seed and a table size giving each key a slot of its own
+sub perfect_hash {
+    my ($message) = @_;
+    my @keys = map { $_->{key} } @{$message->{fields}};
+    my $size = 1;
+    $size *= 2 while $size < scalar @keys;
+    for (my $tries = 0; $tries < 4; ++$tries, $size *= 2) {
+        SEED: for my $seed (0 .. 65535) {
+            my @slots = (0) x $size;
+            for my $i (0 .. $#keys) {
+                my $slot = hash($seed, $keys[$i]) & ($size - 1);
+                next SEED if $slots[$slot];
+                $slots[$slot] = $i + 1;
+            }
+            return ($seed, \@slots);
+        }
+    }
+    die("Could not find a perfect hash for message $message->{name}\n");
+}
+
+sub c_string {
+    my ($s) = @_;
+    $s =~ s/([\\"])/\\$1/g;
+    $s =~ s/([^\x20-\x7e])/sprintf("\\%03o", ord($1))/ge;
+    return "\"$s\"";
+}
+
+(my $shortname = $basename) =~ s,.*/,,;
+(my $guard = uc($shortname) . "_H") =~ s/\W/_/g;
+(my $schemaname = $fname) =~ s,.*/,,;
+
+open HEADER, ">", "$basename.h"
+    or die("Cannot create $basename.h: $!\n");
+select HEADER;
+print "/* Generated by cborschema.pl from $schemaname. Do not edit. */";
+print "";
+print "#ifndef $guard";
+print "#define $guard";
+print "";
+print "#include <cborschema.h>";
+print "";
+print "#ifdef __cplusplus";
+print "extern \"C\" {";
+print "#endif";
+for my $message (@messages) {
+    my $name = $message->{name};
+    print "";
+    my $bit = 0;
+    for my $field (@{$message->{fields}}) {
+        printf "#define %s_%s_PRESENT 0x%xU\n", uc($name), uc($field->{member}), 1 << $bit++;
+    }
+    print "typedef struct $name";
+    print "{";
+    print "    uint32_t present;";
+    for my $field (@{$message->{fields}}) {
+        my $decl = "$field->{ctype} $field->{member}";
+        $decl .= "[$field->{count}]" if defined $field->{count};
+        $decl .= "[$field->{copysize}]" if defined $field->{copysize};
+        print "    $decl;";
+        print "    size_t $field->{member}_count;" if defined $field->{count};
+    }
+    print "} ${name}_t;";
+    print "";
+    print "extern const CborSchemaMessage ${name}_schema;";
+    print "";
+    print "static inline CborError ${name}_decode(CborValue *it, ${name}_t *out)";
+    print "{";
+    print "    return cbor_schema_decode_advance(it, &${name}_schema, out);";
+    print "}";
+}
+print "";
+print "#ifdef __cplusplus";
+print "}";
+print "#endif";
+print "";
+print "#endif /* $guard */";
+close HEADER or die;
+
+open SOURCE, ">", "$basename.c"
+    or die("Cannot create $basename.c: $!\n");
+select SOURCE;
+print "/* Generated by cborschema.pl from $schemaname. Do not edit. */";
+print "";
+print "#include \"$shortname.h\"";
+print "";
+print "#include <stddef.h>";
+for my $message (@messages) {
+    my $name = $message->{name};
+    my ($seed, $slots) = perfect_hash($message);
+    my $required = 0;
+    my $bit = 0;
+
+    print "";
+    print "static const CborSchemaField ${name}_fields[] = {";
+    for my $field (@{$message->{fields}}) {
+        my $member = "((struct $name *)0)->$field->{member}";
+        my @flags;
+        push @flags, "CborSchemaFieldRequired" if $field->{required};
+        push @flags, "CborSchemaFieldArray" if defined $field->{count};
+        $required |= 1 << $bit if $field->{required};
+        ++$bit;
+
+        printf "    { %s, %d, %s, %s, offsetof(struct %s, %s), sizeof(%s), %d, %s, %s },\n",
+            c_string($field->{key}), length($field->{key}), $field->{kind},
+            scalar @flags ? join(" | ", @flags) : "0",
+            $name, $field->{member},
+            defined $field->{count} ? "${member}[0]" : $member,
+            $field->{count} // 0,
+            defined $field->{count} ? "offsetof(struct $name, $field->{member}_count)" : "0",
+            $field->{kind} eq "CborSchemaMap" ? "&$field->{type}_schema" : "NULL";
+    }
+    print "};";
+    printf "static const uint8_t %s_slots[] = { %s };\n", $name, join(", ", @$slots);
+    print "";
+    print "const CborSchemaMessage ${name}_schema = {";
+    printf "    %s_fields, %s_slots, sizeof(struct %s), %dU, 0x%xU, %d, %d\n",
+        $name, $name, $name, $seed, $required, scalar @{$message->{fields}}, scalar @$slots - 1;
+    print "};";
+}
+close SOURCE or die;
@@ -32,6 +32,29 @@ typedef enum {
     ESP_DIAG_DATA_STORE_EVENT_NON_CRITICAL_DATA_LOW_MEM,
 } esp_diag_data_store_events_t;
 
+/**
+ * @brief Drop counters of the staging rings
+ *
+ * With CONFIG_DIAG_DATA_STORE_STAGING, writes go through lock-free staging rings
+ * and these counters account for the records that never reached the data store.
+ */
+typedef struct {
+    uint32_t ring_full;     /*!< Records dropped because the staging ring had no room */
+    uint32_t ring_busy;     /*!< Records dropped because every staging ring was in use */
+    uint32_t store_fail;    /*!< Staged records the data store did not accept (e.g. it was full) */
+} esp_diag_data_store_drop_stats_t;
+
+/** Maximum number of segments of a gather write */
+#define ESP_DIAG_DATA_STORE_IOV_MAX     8
+
+/**
+ * @brief Segment of a gather write
+ */
+typedef struct {
+    const void *base;       /*!< Start of the segment */
+    size_t len;             /*!< Length of the segment */
+} esp_diag_data_store_iov_t;
+
 /**
  * @brief Write critical data to the diagnostics data store
  *
@@ -39,6 +62,9 @@ typedef enum {
  * @param[in] len length of the data to be written
  *
  * @return ESP_OK on success, appropriate error code otherwise.
+ *
+ * @note With CONFIG_DIAG_DATA_STORE_STAGING, ESP_OK means the data was staged; it is
+ *       committed to the store later and failures are counted in \ref esp_diag_data_store_drop_stats_t
  */
 esp_err_t esp_diag_data_store_critical_write(void *data, size_t len);
 
@@ -50,9 +76,36 @@ esp_err_t esp_diag_data_store_critical_write(void *data, size_t len);
  * @param[in] len length of the data to be written
  *
  * @return ESP_OK on success, appropriate error code otherwise.
+ *
+ * @note With CONFIG_DIAG_DATA_STORE_STAGING, ESP_OK means the data was staged, as for
+ *       \ref esp_diag_data_store_critical_write
  */
 esp_err_t esp_diag_data_store_non_critical_write(const char *dg, void *data, size_t len);
 
+/**
+ * @brief Write critical data gathered from several segments to the diagnostics data store
+ *
+ * The segments are stored back to back as one record, as if they had been copied into a single
+ * buffer and written with \ref esp_diag_data_store_critical_write.
+ *
+ * @param[in] iov Segments of the record
+ * @param[in] iovcnt Number of segments, at most ESP_DIAG_DATA_STORE_IOV_MAX
+ *
+ * @return ESP_OK on success, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_data_store_critical_writev(const esp_diag_data_store_iov_t *iov, int iovcnt);
+
+/**
+ * @brief Write non_critical data gathered from several segments to the diagnostics data store
+ *
+ * @param[in] dg Data group of the data
+ * @param[in] iov Segments of the record
+ * @param[in] iovcnt Number of segments, at most ESP_DIAG_DATA_STORE_IOV_MAX
+ *
+ * @return ESP_OK on success, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_data_store_non_critical_writev(const char *dg, const esp_diag_data_store_iov_t *iov, int iovcnt);
+
 /**
  * @brief Read critical data from the diagnostics data store
  *
@@ -120,6 +173,37 @@ uint32_t esp_diag_data_store_get_crc(void);
  * @return ESP_OK on success, appropriate error on failure.
  */
 esp_err_t esp_diag_data_discard_data(void);
+
+/**
+ * @brief Get the drop counters of the staging rings
+ *
+ * @param[out] stats Drop counters since the data store was initialized
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if CONFIG_DIAG_DATA_STORE_STAGING is disabled.
+ */
+esp_err_t esp_diag_data_store_get_drop_stats(esp_diag_data_store_drop_stats_t *stats);
+
+/**
+ * @brief Get the number of records waiting in the flash overflow tier
+ *
+ * With CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW, data that does not fit in the RTC store above its
+ * reporting watermark is kept in a flash partition, and read back once the RTC store is empty.
+ *
+ * @return Number of records in the flash overflow tier, 0 if it is disabled
+ */
+size_t esp_diag_data_store_get_overflow_pending(void);
+
+/**
+ * @brief Get the time base of the current boot, setting it to ts if not set yet
+ *
+ * The time base is kept with the boot information of the stored records, so that timestamps
+ * stored relative to it can be restored when the records are read, also after a reboot.
+ *
+ * @param[in] ts Wall clock timestamp in microseconds to use if the time base is not set yet
+ *
+ * @return Time base of the current boot, 0 if the data store is not initialized
+ */
+uint64_t esp_diag_data_store_get_time_base(uint64_t ts);
 #ifdef __cplusplus
 }
 #endif
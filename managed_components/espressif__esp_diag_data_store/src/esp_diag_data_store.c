@@ -4,11 +4,25 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
 #include <esp_err.h>
 #include <esp_diag_data_store.h>
 #include <rtc_store.h>
+#if CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW
+#include <esp_crc.h>
+#include "flash_store.h"
+#endif
+#if CONFIG_DIAG_DATA_STORE_STAGING
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "staging.h"
+
+#define STAGING_TASK_NAME           "diag_staging"
+/* A busy store is retried after this delay */
+#define STAGING_RETRY_TICKS         pdMS_TO_TICKS(10)
+#endif
 
 ESP_EVENT_DEFINE_BASE(ESP_DIAG_DATA_STORE_EVENT);
 
@@ -20,6 +34,10 @@ typedef void (*deinit_cb_t) (void);
 typedef esp_err_t (*write_cb_t) (void *data, size_t len);
 /* Callback type to write non_critical data */
 typedef esp_err_t (*nc_write_cb_t) (const char *dg, void *data, size_t len);
+/* Callback type to write data gathered from segments */
+typedef esp_err_t (*writev_cb_t) (const esp_diag_data_store_iov_t *iov, int iovcnt);
+/* Callback type to write non_critical data gathered from segments */
+typedef esp_err_t (*nc_writev_cb_t) (const char *dg, const esp_diag_data_store_iov_t *iov, int iovcnt);
 /* Callback type to read data */
 typedef int (*read_cb_t) (uint8_t *buf, size_t size);
 /* Callback type to release the data */
@@ -29,23 +47,44 @@ This crc will be used to discard data from data store if its value is changed */
 typedef uint32_t (*crc_cb_t) ();
 /* Callback type to discard data from data store. */
 typedef esp_err_t (*discard_data_cb_t) ();
+/* Callback type to get the space left before the reporting watermark */
+typedef size_t (*headroom_cb_t) (void);
+/* Callback type to get the number of records waiting to be read */
+typedef size_t (*pending_cb_t) (void);
 
 typedef struct {
     init_cb_t init;
     deinit_cb_t deinit;
     write_cb_t critical_write;
     nc_write_cb_t non_critical_write;
+    writev_cb_t critical_writev;
+    nc_writev_cb_t non_critical_writev;
     read_cb_t critical_read;
     read_cb_t non_critical_read;
     release_cb_t critical_release;
     release_cb_t non_critical_release;
     crc_cb_t data_store_crc;
     discard_data_cb_t discard_data;
+    headroom_cb_t critical_headroom;
+    headroom_cb_t non_critical_headroom;
+    pending_cb_t critical_pending;
+    pending_cb_t non_critical_pending;
 } data_store_cbs_t;
 
 typedef struct {
     bool init;
     data_store_cbs_t cbs;
+#if CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW
+    bool overflow_init;
+    data_store_cbs_t overflow;          // tier the store spills into past its reporting watermark
+    bool critical_read_overflow;        // last critical read was served by the overflow tier
+    bool non_critical_read_overflow;    // last non critical read was served by the overflow tier
+#endif
+#if CONFIG_DIAG_DATA_STORE_STAGING
+    TaskHandle_t staging_task;          // drains the staging rings into the store
+    TaskHandle_t staging_waiter;        // deinit waiting for the staging task to exit
+    volatile bool staging_stop;
+#endif
 } priv_data_t;
 
 static priv_data_t s_priv_data;
@@ -63,12 +102,32 @@ static void set_diag_store_cbs(void)
     s_priv_data.cbs.deinit = rtc_store_deinit;
     s_priv_data.cbs.critical_write = rtc_store_critical_data_write;
     s_priv_data.cbs.non_critical_write = rtc_store_non_critical_data_write;
+    s_priv_data.cbs.critical_writev = rtc_store_critical_data_writev;
+    s_priv_data.cbs.non_critical_writev = rtc_store_non_critical_data_writev;
     s_priv_data.cbs.critical_read = rtc_store_critical_data_read;
     s_priv_data.cbs.non_critical_read = rtc_store_non_critical_data_read;
     s_priv_data.cbs.critical_release = rtc_store_critical_data_release;
     s_priv_data.cbs.non_critical_release = rtc_store_non_critical_data_release;
     s_priv_data.cbs.data_store_crc = rtc_store_get_crc;
     s_priv_data.cbs.discard_data = rtc_store_discard_data;
+    s_priv_data.cbs.critical_headroom = rtc_store_critical_data_headroom;
+    s_priv_data.cbs.non_critical_headroom = rtc_store_non_critical_data_headroom;
+#if CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW
+    s_priv_data.overflow.init = flash_store_init;
+    s_priv_data.overflow.deinit = flash_store_deinit;
+    s_priv_data.overflow.critical_write = flash_store_critical_data_write;
+    s_priv_data.overflow.non_critical_write = flash_store_non_critical_data_write;
+    s_priv_data.overflow.critical_writev = flash_store_critical_data_writev;
+    s_priv_data.overflow.non_critical_writev = flash_store_non_critical_data_writev;
+    s_priv_data.overflow.critical_read = flash_store_critical_data_read;
+    s_priv_data.overflow.non_critical_read = flash_store_non_critical_data_read;
+    s_priv_data.overflow.critical_release = flash_store_critical_data_release;
+    s_priv_data.overflow.non_critical_release = flash_store_non_critical_data_release;
+    s_priv_data.overflow.data_store_crc = flash_store_get_crc;
+    s_priv_data.overflow.discard_data = flash_store_discard_data;
+    s_priv_data.overflow.critical_pending = flash_store_critical_data_pending;
+    s_priv_data.overflow.non_critical_pending = flash_store_non_critical_data_pending;
+#endif
 }
 
 static void unset_diag_store_cbs(void)
@@ -77,47 +136,263 @@ static void unset_diag_store_cbs(void)
     s_priv_data.cbs.deinit = NULL;
     s_priv_data.cbs.critical_write = NULL;
     s_priv_data.cbs.non_critical_write = NULL;
+    s_priv_data.cbs.critical_writev = NULL;
+    s_priv_data.cbs.non_critical_writev = NULL;
     s_priv_data.cbs.critical_read = NULL;
     s_priv_data.cbs.non_critical_read = NULL;
     s_priv_data.cbs.critical_release = NULL;
     s_priv_data.cbs.non_critical_release = NULL;
     s_priv_data.cbs.data_store_crc = NULL;
     s_priv_data.cbs.discard_data = NULL;
+    s_priv_data.cbs.critical_headroom = NULL;
+    s_priv_data.cbs.non_critical_headroom = NULL;
+#if CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW
+    memset(&s_priv_data.overflow, 0, sizeof(s_priv_data.overflow));
+#endif
+}
+
+#if CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW
+/* Spill once the store reaches its reporting watermark, and keep spilling while the
+ * overflow tier holds data of the same kind, so that data is read back in order */
+static bool spill_to_overflow(headroom_cb_t headroom, pending_cb_t pending, size_t len)
+{
+    return s_priv_data.overflow_init && (pending() || headroom() < len);
+}
+#endif
+
+static esp_err_t store_critical_write(void *data, size_t len)
+{
+#if CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW
+    if (spill_to_overflow(s_priv_data.cbs.critical_headroom, s_priv_data.overflow.critical_pending, len)) {
+        return s_priv_data.overflow.critical_write(data, len);
+    }
+#endif
+    return s_priv_data.cbs.critical_write(data, len);
+}
+
+static esp_err_t store_non_critical_write(const char *dg, void *data, size_t len)
+{
+#if CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW
+    if (spill_to_overflow(s_priv_data.cbs.non_critical_headroom, s_priv_data.overflow.non_critical_pending, len)) {
+        return s_priv_data.overflow.non_critical_write(dg, data, len);
+    }
+#endif
+    return s_priv_data.cbs.non_critical_write(dg, data, len);
+}
+
+static size_t iov_len(const esp_diag_data_store_iov_t *iov, int iovcnt)
+{
+    size_t len = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        len += iov[i].len;
+    }
+    return len;
+}
+
+static esp_err_t store_critical_writev(const esp_diag_data_store_iov_t *iov, int iovcnt)
+{
+#if CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW
+    if (spill_to_overflow(s_priv_data.cbs.critical_headroom, s_priv_data.overflow.critical_pending,
+                          iov_len(iov, iovcnt))) {
+        return s_priv_data.overflow.critical_writev(iov, iovcnt);
+    }
+#endif
+    return s_priv_data.cbs.critical_writev(iov, iovcnt);
+}
+
+static esp_err_t store_non_critical_writev(const char *dg, const esp_diag_data_store_iov_t *iov, int iovcnt)
+{
+#if CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW
+    if (spill_to_overflow(s_priv_data.cbs.non_critical_headroom, s_priv_data.overflow.non_critical_pending,
+                          iov_len(iov, iovcnt))) {
+        return s_priv_data.overflow.non_critical_writev(dg, iov, iovcnt);
+    }
+#endif
+    return s_priv_data.cbs.non_critical_writev(dg, iov, iovcnt);
+}
+
+#if CONFIG_DIAG_DATA_STORE_STAGING
+/* Called by the drainer, dg is NULL for critical data */
+static esp_err_t staging_commit(const char *dg, void *data, size_t len)
+{
+    if (dg) {
+        return store_non_critical_write(dg, data, len);
+    }
+    return store_critical_write(data, len);
+}
+
+static void staging_notify(void)
+{
+    xTaskNotifyGive(s_priv_data.staging_task);
+}
+
+/* Writers never touch the store locks, this task commits what they staged */
+static void staging_task(void *arg)
+{
+    bool pending = false;
+
+    while (!s_priv_data.staging_stop) {
+        ulTaskNotifyTake(pdTRUE, pending ? STAGING_RETRY_TICKS : portMAX_DELAY);
+        pending = staging_drain();
+    }
+    xTaskNotifyGive(s_priv_data.staging_waiter);
+    vTaskDelete(NULL);
+}
+
+static esp_err_t staging_task_start(void)
+{
+    s_priv_data.staging_stop = false;
+    if (xTaskCreate(staging_task, STAGING_TASK_NAME, CONFIG_DIAG_DATA_STORE_STAGING_TASK_STACK_SIZE, NULL,
+                    CONFIG_DIAG_DATA_STORE_STAGING_TASK_PRIORITY, &s_priv_data.staging_task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return staging_init(staging_commit, staging_notify);
+}
+
+static void staging_task_stop(void)
+{
+    TaskHandle_t task = s_priv_data.staging_task;
+
+    // no writer can notify the task anymore once it is gone
+    staging_stop();
+    while (staging_writing()) {
+        vTaskDelay(1);
+    }
+    s_priv_data.staging_task = NULL;
+    s_priv_data.staging_waiter = xTaskGetCurrentTaskHandle();
+    s_priv_data.staging_stop = true;
+    xTaskNotifyGive(task);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 }
 
+static esp_err_t staged_write(const char *dg, void *data, size_t len)
+{
+    esp_err_t err = staging_write(xPortGetCoreID(), dg, data, len);
+    if (err == ESP_ERR_INVALID_SIZE) {
+        // larger than a staging ring, write it directly: the store only try-locks non critical data
+        return staging_commit(dg, data, len);
+    }
+    return err;
+}
+
+static esp_err_t staged_writev(const char *dg, const esp_diag_data_store_iov_t *iov, int iovcnt)
+{
+    esp_err_t err = staging_writev(xPortGetCoreID(), dg, iov, iovcnt);
+    if (err == ESP_ERR_INVALID_SIZE) {
+        if (dg) {
+            return store_non_critical_writev(dg, iov, iovcnt);
+        }
+        return store_critical_writev(iov, iovcnt);
+    }
+    return err;
+}
+#endif /* CONFIG_DIAG_DATA_STORE_STAGING */
+
 esp_err_t esp_diag_data_store_critical_write(void *data, size_t len)
 {
     CHECK_STORE_INIT(ESP_ERR_INVALID_STATE);
-    return s_priv_data.cbs.critical_write(data, len);
+#if CONFIG_DIAG_DATA_STORE_STAGING
+    if (!data || !len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return staged_write(NULL, data, len);
+#else
+    return store_critical_write(data, len);
+#endif
 }
 
 esp_err_t esp_diag_data_store_non_critical_write(const char *dg, void *data, size_t len)
 {
     CHECK_STORE_INIT(ESP_ERR_INVALID_STATE);
-    return s_priv_data.cbs.non_critical_write(dg, data, len);
+#if CONFIG_DIAG_DATA_STORE_STAGING
+    if (!dg || !data || !len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return staged_write(dg, data, len);
+#else
+    return store_non_critical_write(dg, data, len);
+#endif
+}
+
+esp_err_t esp_diag_data_store_critical_writev(const esp_diag_data_store_iov_t *iov, int iovcnt)
+{
+    CHECK_STORE_INIT(ESP_ERR_INVALID_STATE);
+    if (!iov || iovcnt <= 0 || iovcnt > ESP_DIAG_DATA_STORE_IOV_MAX || !iov_len(iov, iovcnt)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+#if CONFIG_DIAG_DATA_STORE_STAGING
+    return staged_writev(NULL, iov, iovcnt);
+#else
+    return store_critical_writev(iov, iovcnt);
+#endif
+}
+
+esp_err_t esp_diag_data_store_non_critical_writev(const char *dg, const esp_diag_data_store_iov_t *iov, int iovcnt)
+{
+    CHECK_STORE_INIT(ESP_ERR_INVALID_STATE);
+    if (!dg || !iov || iovcnt <= 0 || iovcnt > ESP_DIAG_DATA_STORE_IOV_MAX || !iov_len(iov, iovcnt)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+#if CONFIG_DIAG_DATA_STORE_STAGING
+    return staged_writev(dg, iov, iovcnt);
+#else
+    return store_non_critical_writev(dg, iov, iovcnt);
+#endif
 }
 
 int esp_diag_data_store_critical_read(uint8_t *buf, size_t size)
 {
     CHECK_STORE_INIT(-1);
-    return s_priv_data.cbs.critical_read(buf, size);
+#if CONFIG_DIAG_DATA_STORE_STAGING
+    staging_drain();
+#endif
+    int ret = s_priv_data.cbs.critical_read(buf, size);
+#if CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW
+    /* The store holds the oldest data, the overflow tier is read once it is empty */
+    s_priv_data.critical_read_overflow = ret == 0 && s_priv_data.overflow_init;
+    if (s_priv_data.critical_read_overflow) {
+        ret = s_priv_data.overflow.critical_read(buf, size);
+    }
+#endif
+    return ret;
 }
 
 int esp_diag_data_store_non_critical_read(uint8_t *buf, size_t size)
 {
     CHECK_STORE_INIT(-1);
-    return s_priv_data.cbs.non_critical_read(buf, size);
+#if CONFIG_DIAG_DATA_STORE_STAGING
+    staging_drain();
+#endif
+    int ret = s_priv_data.cbs.non_critical_read(buf, size);
+#if CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW
+    /* The store holds the oldest data, the overflow tier is read once it is empty */
+    s_priv_data.non_critical_read_overflow = ret == 0 && s_priv_data.overflow_init;
+    if (s_priv_data.non_critical_read_overflow) {
+        ret = s_priv_data.overflow.non_critical_read(buf, size);
+    }
+#endif
+    return ret;
 }
 
 esp_err_t esp_diag_data_store_critical_release(size_t size)
 {
     CHECK_STORE_INIT(ESP_ERR_INVALID_STATE);
+#if CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW
+    if (s_priv_data.critical_read_overflow) {
+        return s_priv_data.overflow.critical_release(size);
+    }
+#endif
     return s_priv_data.cbs.critical_release(size);
 }
 
 esp_err_t esp_diag_data_store_non_critical_release(size_t size)
 {
     CHECK_STORE_INIT(ESP_ERR_INVALID_STATE);
+#if CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW
+    if (s_priv_data.non_critical_read_overflow) {
+        return s_priv_data.overflow.non_critical_release(size);
+    }
+#endif
     return s_priv_data.cbs.non_critical_release(size);
 }
 
@@ -128,6 +403,29 @@ esp_err_t esp_diag_data_store_init(void)
     if (err != ESP_OK) {
         return err;
     }
+#if CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW
+    /* Without its partition the store works as before */
+    err = s_priv_data.overflow.init();
+    s_priv_data.overflow_init = err == ESP_OK;
+    if (err != ESP_OK) {
+        printf("Flash overflow tier disabled, err 0x%x\n", err);
+    }
+#endif
+#if CONFIG_DIAG_DATA_STORE_STAGING
+    err = staging_task_start();
+    if (err != ESP_OK) {
+        printf("Failed to start the staging task, err 0x%x\n", err);
+#if CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW
+        if (s_priv_data.overflow_init) {
+            s_priv_data.overflow.deinit();
+            s_priv_data.overflow_init = false;
+        }
+#endif
+        s_priv_data.cbs.deinit();
+        unset_diag_store_cbs();
+        return err;
+    }
+#endif
     s_priv_data.init = true;
     return ESP_OK;
 }
@@ -135,6 +433,17 @@ esp_err_t esp_diag_data_store_init(void)
 void esp_diag_data_store_deinit(void)
 {
     CHECK_STORE_INIT();
+#if CONFIG_DIAG_DATA_STORE_STAGING
+    staging_task_stop();
+    staging_drain();
+    staging_deinit();
+#endif
+#if CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW
+    if (s_priv_data.overflow_init) {
+        s_priv_data.overflow.deinit();
+        s_priv_data.overflow_init = false;
+    }
+#endif
     s_priv_data.cbs.deinit();
     unset_diag_store_cbs();
     s_priv_data.init = false;
@@ -143,11 +452,60 @@ void esp_diag_data_store_deinit(void)
 uint32_t esp_diag_data_store_get_crc(void)
 {
     CHECK_STORE_INIT(ESP_ERR_INVALID_STATE);
-    return s_priv_data.cbs.data_store_crc();
+    uint32_t crc = s_priv_data.cbs.data_store_crc();
+#if CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW
+    if (s_priv_data.overflow_init) {
+        uint32_t overflow_crc = s_priv_data.overflow.data_store_crc();
+        crc = esp_crc32_le(crc, (const unsigned char *) &overflow_crc, sizeof(overflow_crc));
+    }
+#endif
+    return crc;
 }
 
 esp_err_t esp_diag_data_discard_data(void)
 {
     CHECK_STORE_INIT(ESP_ERR_INVALID_STATE);
+#if CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW
+    if (s_priv_data.overflow_init) {
+        esp_err_t err = s_priv_data.overflow.discard_data();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+#endif
     return s_priv_data.cbs.discard_data();
-}
\ No newline at end of file
+}
+
+esp_err_t esp_diag_data_store_get_drop_stats(esp_diag_data_store_drop_stats_t *stats)
+{
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+#if CONFIG_DIAG_DATA_STORE_STAGING
+    staging_stats_t staging_stats;
+    staging_get_stats(&staging_stats);
+    stats->ring_full = staging_stats.ring_full;
+    stats->ring_busy = staging_stats.ring_busy;
+    stats->store_fail = staging_stats.store_fail;
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+size_t esp_diag_data_store_get_overflow_pending(void)
+{
+    CHECK_STORE_INIT(0);
+#if CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW
+    if (s_priv_data.overflow_init) {
+        return s_priv_data.overflow.critical_pending() + s_priv_data.overflow.non_critical_pending();
+    }
+#endif
+    return 0;
+}
+
+uint64_t esp_diag_data_store_get_time_base(uint64_t ts)
+{
+    CHECK_STORE_INIT(0);
+    return rtc_store_get_meta_time_base(ts);
+}
@@ -0,0 +1,461 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include "flash_log.h"
+
+/**
+ * @brief Layout of the log
+ *
+ * Every sector starts with a flash_log_sector_t header. Sequence numbers increase by one each time
+ * a sector is opened, so the valid sectors with consecutive numbers ending at the highest one form
+ * the log, oldest first.
+ *
+ * Records follow as [flash_log_rec_t][payload], 4-byte aligned. The header is programmed before the
+ * payload, so a record torn by a power loss has a bad CRC; mount marks it released and seals its
+ * sector. The tag of a record is not part of its payload, the owner of the log checks it on read. A record is unread while its state word is still erased: releasing clears it in place.
+ * Every unread record in the log is valid and counted in flash_log_t.unread.
+ */
+
+#define FLASH_LOG_MAGIC         0x324c4744  /* "DGL2", records have a tag and a CRC-32 */
+#define FLASH_LOG_ERASED_LEN    UINT16_MAX
+#define FLASH_LOG_UNREAD        UINT32_MAX
+#define FLASH_LOG_RELEASED      0
+
+#define ALIGN4(x)               (((x) + 3) & ~(size_t) 3)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+} flash_log_sector_t;
+
+typedef struct {
+    uint16_t len;       // length of the payload, FLASH_LOG_ERASED_LEN past the last record
+    uint16_t type;
+    uint32_t crc;       // CRC-32 of len, type, tag and payload
+    uint32_t tag;
+    uint32_t state;     // FLASH_LOG_UNREAD or FLASH_LOG_RELEASED
+} flash_log_rec_t;
+
+#define SECTOR_HDR_SIZE         sizeof(flash_log_sector_t)
+#define REC_SIZE(len)           (sizeof(flash_log_rec_t) + ALIGN4(len))
+
+/* Bitwise CRC-32 (reflected 0x04c11db7), records are small and written rarely */
+static uint32_t crc32(uint32_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    while (len--) {
+        crc ^= *p++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+        }
+    }
+    return crc;
+}
+
+static uint32_t rec_crc_start(const flash_log_rec_t *rec)
+{
+    uint32_t crc = crc32(UINT32_MAX, &rec->len, sizeof(rec->len));
+    crc = crc32(crc, &rec->type, sizeof(rec->type));
+    return crc32(crc, &rec->tag, sizeof(rec->tag));
+}
+
+static inline size_t sector_addr(const flash_log_t *log, uint32_t sector)
+{
+    return (size_t) sector * log->part.sector_size;
+}
+
+static inline uint32_t next_sector(const flash_log_t *log, uint32_t sector)
+{
+    return (sector + 1) % log->sectors;
+}
+
+static inline uint32_t prev_sector(const flash_log_t *log, uint32_t sector)
+{
+    return (sector + log->sectors - 1) % log->sectors;
+}
+
+static esp_err_t read_sector_hdr(flash_log_t *log, uint32_t sector, flash_log_sector_t *hdr)
+{
+    return log->part.read(log->part.ctx, sector_addr(log, sector), hdr, sizeof(*hdr));
+}
+
+static esp_err_t set_state(flash_log_t *log, const flash_log_pos_t *pos, uint32_t state)
+{
+    return log->part.write(log->part.ctx, sector_addr(log, pos->sector) + pos->offset +
+                           offsetof(flash_log_rec_t, state), &state, sizeof(state));
+}
+
+/* Check the CRC of the record at pos, reading its payload in chunks */
+static esp_err_t rec_valid(flash_log_t *log, const flash_log_pos_t *pos, const flash_log_rec_t *rec, bool *valid)
+{
+    uint8_t chunk[32];
+    uint32_t crc = rec_crc_start(rec);
+    size_t addr = sector_addr(log, pos->sector) + pos->offset + sizeof(*rec);
+    for (size_t done = 0; done < rec->len; ) {
+        size_t n = rec->len - done < sizeof(chunk) ? rec->len - done : sizeof(chunk);
+        esp_err_t err = log->part.read(log->part.ctx, addr + done, chunk, n);
+        if (err != ESP_OK) {
+            return err;
+        }
+        crc = crc32(crc, chunk, n);
+        done += n;
+    }
+    *valid = crc == rec->crc;
+    return ESP_OK;
+}
+
+/* Read the header of the record at or after pos, moving to the next sector past the last record
+ * of one. Returns ESP_ERR_NOT_FOUND at the head of the log. */
+static esp_err_t rec_at(flash_log_t *log, flash_log_pos_t *pos, flash_log_rec_t *rec)
+{
+    const size_t sector_size = log->part.sector_size;
+    while (1) {
+        if (pos->sector == log->head.sector && pos->offset >= log->head.offset) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        if (pos->offset + sizeof(*rec) <= sector_size) {
+            esp_err_t err = log->part.read(log->part.ctx, sector_addr(log, pos->sector) + pos->offset,
+                                           rec, sizeof(*rec));
+            if (err != ESP_OK) {
+                return err;
+            }
+            if (rec->len != FLASH_LOG_ERASED_LEN && REC_SIZE(rec->len) <= sector_size - pos->offset) {
+                return ESP_OK;
+            }
+        }
+        if (pos->sector == log->head.sector) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        pos->sector = next_sector(log, pos->sector);
+        pos->offset = SECTOR_HDR_SIZE;
+    }
+}
+
+static esp_err_t open_sector(flash_log_t *log, uint32_t sector, uint32_t seq)
+{
+    flash_log_sector_t hdr = { .magic = FLASH_LOG_MAGIC, .seq = seq };
+    esp_err_t err = log->part.erase(log->part.ctx, sector_addr(log, sector), log->part.sector_size);
+    if (err == ESP_OK) {
+        err = log->part.write(log->part.ctx, sector_addr(log, sector), &hdr, sizeof(hdr));
+    }
+    if (err == ESP_OK) {
+        log->seq = seq;
+        log->head.sector = sector;
+        log->head.offset = SECTOR_HDR_SIZE;
+    }
+    return err;
+}
+
+static void reset_cursors(flash_log_t *log)
+{
+    for (int i = 0; i < FLASH_LOG_TYPES; i++) {
+        log->read[i].sector = log->oldest;
+        log->read[i].offset = SECTOR_HDR_SIZE;
+    }
+}
+
+static esp_err_t evict_oldest(flash_log_t *log)
+{
+    flash_log_pos_t pos = { .sector = log->oldest, .offset = SECTOR_HDR_SIZE };
+    flash_log_rec_t rec;
+    esp_err_t err;
+    while ((err = rec_at(log, &pos, &rec)) == ESP_OK && pos.sector == log->oldest) {
+        if (rec.state == FLASH_LOG_UNREAD && rec.type < FLASH_LOG_TYPES) {
+            log->unread[rec.type]--;
+            log->dropped[rec.type]++;
+        }
+        pos.offset += REC_SIZE(rec.len);
+    }
+    if (err != ESP_OK && err != ESP_ERR_NOT_FOUND) {
+        return err;
+    }
+    uint32_t evicted = log->oldest;
+    log->oldest = next_sector(log, evicted);
+    for (int i = 0; i < FLASH_LOG_TYPES; i++) {
+        if (log->read[i].sector == evicted) {
+            log->read[i].sector = log->oldest;
+            log->read[i].offset = SECTOR_HDR_SIZE;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t flash_log_format(flash_log_t *log)
+{
+    flash_log_sector_t hdr;
+    for (uint32_t i = 0; i < log->sectors; i++) {
+        esp_err_t err = read_sector_hdr(log, i, &hdr);
+        if (err == ESP_OK && hdr.magic != UINT32_MAX) {
+            err = log->part.erase(log->part.ctx, sector_addr(log, i), log->part.sector_size);
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    /* Carry on from the sector after the old head, so that formatting does not wear sector 0 */
+    uint32_t sector = log->seq ? next_sector(log, log->head.sector) : 0;
+    esp_err_t err = open_sector(log, sector, log->seq + 1);
+    if (err != ESP_OK) {
+        return err;
+    }
+    log->oldest = sector;
+    memset(log->unread, 0, sizeof(log->unread));
+    reset_cursors(log);
+    return ESP_OK;
+}
+
+/* Find the write position in the newest sector, sealing it after a torn record */
+static esp_err_t find_head(flash_log_t *log)
+{
+    const size_t sector_size = log->part.sector_size;
+    flash_log_pos_t pos = { .sector = log->head.sector, .offset = SECTOR_HDR_SIZE };
+    flash_log_rec_t rec;
+    while (pos.offset + sizeof(rec) <= sector_size) {
+        esp_err_t err = log->part.read(log->part.ctx, sector_addr(log, pos.sector) + pos.offset, &rec, sizeof(rec));
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (rec.len == FLASH_LOG_ERASED_LEN && rec.type == UINT16_MAX && rec.crc == UINT32_MAX &&
+            rec.tag == UINT32_MAX && rec.state == FLASH_LOG_UNREAD) {
+            break;
+        }
+        bool valid = false;
+        if (rec.len != FLASH_LOG_ERASED_LEN && REC_SIZE(rec.len) <= sector_size - pos.offset) {
+            err = rec_valid(log, &pos, &rec, &valid);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        if (!valid) {
+            /* Torn record: release it if it can be walked over, and write no more to this sector */
+            if (rec.len != FLASH_LOG_ERASED_LEN && REC_SIZE(rec.len) <= sector_size - pos.offset &&
+                rec.state != FLASH_LOG_RELEASED) {
+                set_state(log, &pos, FLASH_LOG_RELEASED);
+            }
+            pos.offset = sector_size;
+            break;
+        }
+        pos.offset += REC_SIZE(rec.len);
+    }
+    log->head.offset = pos.offset;
+    return ESP_OK;
+}
+
+/* Count the unread records and point the read cursors at the oldest ones */
+static esp_err_t scan_unread(flash_log_t *log)
+{
+    bool found[FLASH_LOG_TYPES] = { false };
+    flash_log_pos_t pos = { .sector = log->oldest, .offset = SECTOR_HDR_SIZE };
+    flash_log_rec_t rec;
+    esp_err_t err;
+
+    reset_cursors(log);
+    while ((err = rec_at(log, &pos, &rec)) == ESP_OK) {
+        if (rec.state == FLASH_LOG_UNREAD) {
+            bool valid = false;
+            if (rec.type < FLASH_LOG_TYPES) {
+                err = rec_valid(log, &pos, &rec, &valid);
+                if (err != ESP_OK) {
+                    return err;
+                }
+            }
+            if (valid) {
+                if (!found[rec.type]) {
+                    found[rec.type] = true;
+                    log->read[rec.type] = pos;
+                }
+                log->unread[rec.type]++;
+            } else {
+                set_state(log, &pos, FLASH_LOG_RELEASED);
+            }
+        }
+        pos.offset += REC_SIZE(rec.len);
+    }
+    return err == ESP_ERR_NOT_FOUND ? ESP_OK : err;
+}
+
+esp_err_t flash_log_mount(flash_log_t *log, const flash_log_part_t *part)
+{
+    if (!log || !part || !part->read || !part->write || !part->erase ||
+        part->sector_size < SECTOR_HDR_SIZE + REC_SIZE(1) || part->sector_size % 4 ||
+        part->size % part->sector_size || part->size / part->sector_size < 2) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(log, 0, sizeof(*log));
+    log->part = *part;
+    log->sectors = part->size / part->sector_size;
+
+    /* The newest sector has the highest sequence number */
+    flash_log_sector_t hdr;
+    bool found = false;
+    for (uint32_t i = 0; i < log->sectors; i++) {
+        esp_err_t err = read_sector_hdr(log, i, &hdr);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (hdr.magic == FLASH_LOG_MAGIC && (!found || hdr.seq > log->seq)) {
+            found = true;
+            log->seq = hdr.seq;
+            log->head.sector = i;
+        }
+    }
+    if (!found) {
+        return flash_log_format(log);
+    }
+
+    /* Walk back over the sectors with consecutive sequence numbers to the oldest one */
+    log->oldest = log->head.sector;
+    for (uint32_t n = 1; n < log->sectors; n++) {
+        uint32_t prev = prev_sector(log, log->oldest);
+        esp_err_t err = read_sector_hdr(log, prev, &hdr);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (hdr.magic != FLASH_LOG_MAGIC || hdr.seq != log->seq - n) {
+            break;
+        }
+        log->oldest = prev;
+    }
+
+    esp_err_t err = find_head(log);
+    if (err == ESP_OK) {
+        err = scan_unread(log);
+    }
+    return err;
+}
+
+esp_err_t flash_log_append(flash_log_t *log, uint8_t type, uint32_t tag,
+                           const esp_diag_data_store_iov_t *iov, int iovcnt)
+{
+    size_t payload_len = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        payload_len += iov[i].len;
+    }
+    if (type >= FLASH_LOG_TYPES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (payload_len >= FLASH_LOG_ERASED_LEN ||
+        REC_SIZE(payload_len) > log->part.sector_size - SECTOR_HDR_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    esp_err_t err;
+    if (REC_SIZE(payload_len) > log->part.sector_size - log->head.offset) {
+        uint32_t next = next_sector(log, log->head.sector);
+        if (next == log->oldest) {
+            err = evict_oldest(log);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        err = open_sector(log, next, log->seq + 1);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    flash_log_rec_t rec = {
+        .len = (uint16_t) payload_len,
+        .type = type,
+        .tag = tag,
+        .state = FLASH_LOG_UNREAD,
+    };
+    rec.crc = rec_crc_start(&rec);
+    for (int i = 0; i < iovcnt; i++) {
+        rec.crc = crc32(rec.crc, iov[i].base, iov[i].len);
+    }
+
+    size_t addr = sector_addr(log, log->head.sector) + log->head.offset;
+    err = log->part.write(log->part.ctx, addr, &rec, sizeof(rec));
+    addr += sizeof(rec);
+    for (int i = 0; i < iovcnt && err == ESP_OK; i++) {
+        if (iov[i].len) {
+            err = log->part.write(log->part.ctx, addr, iov[i].base, iov[i].len);
+            addr += iov[i].len;
+        }
+    }
+    /* Even a failed record takes its space: the next one must not be programmed over it */
+    log->head.offset += REC_SIZE(payload_len);
+    if (err == ESP_OK) {
+        log->unread[type]++;
+    }
+    return err;
+}
+
+int flash_log_read(flash_log_t *log, uint8_t type, flash_log_tag_cb_t keep, void *ctx, uint8_t *buf, size_t size)
+{
+    if (type >= FLASH_LOG_TYPES || !buf) {
+        return -1;
+    }
+    flash_log_pos_t pos = log->read[type];
+    flash_log_rec_t rec;
+    bool first = true;
+    size_t filled = 0;
+    esp_err_t err = ESP_OK;
+
+    while (log->unread[type] && (err = rec_at(log, &pos, &rec)) == ESP_OK) {
+        if (rec.type == type && rec.state == FLASH_LOG_UNREAD && keep && !keep(ctx, rec.tag)) {
+            /* Stale for the owner of the log: drop it like a bad record */
+            if (set_state(log, &pos, FLASH_LOG_RELEASED) == ESP_OK) {
+                log->unread[type]--;
+                log->dropped[type]++;
+            }
+        } else if (rec.type == type && rec.state == FLASH_LOG_UNREAD) {
+            if (first) {
+                /* Skip the released records next time */
+                log->read[type] = pos;
+                first = false;
+            }
+            if (rec.len > size - filled) {
+                break;
+            }
+            err = log->part.read(log->part.ctx, sector_addr(log, pos.sector) + pos.offset + sizeof(rec),
+                                 buf + filled, rec.len);
+            if (err != ESP_OK) {
+                return -1;
+            }
+            if (crc32(rec_crc_start(&rec), buf + filled, rec.len) == rec.crc) {
+                filled += rec.len;
+            } else if (set_state(log, &pos, FLASH_LOG_RELEASED) == ESP_OK) {
+                /* Went bad since it was written: drop it, as it could not be released otherwise */
+                log->unread[type]--;
+                log->dropped[type]++;
+            }
+        }
+        pos.offset += REC_SIZE(rec.len);
+    }
+    if (err != ESP_OK && err != ESP_ERR_NOT_FOUND) {
+        return -1;
+    }
+    return (int) filled;
+}
+
+esp_err_t flash_log_release(flash_log_t *log, uint8_t type, size_t size)
+{
+    if (type >= FLASH_LOG_TYPES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    flash_log_pos_t pos = log->read[type];
+    flash_log_rec_t rec;
+    esp_err_t err = ESP_OK;
+
+    while (log->unread[type] && (err = rec_at(log, &pos, &rec)) == ESP_OK) {
+        if (rec.type == type && rec.state == FLASH_LOG_UNREAD) {
+            if (rec.len > size) {
+                break;
+            }
+            err = set_state(log, &pos, FLASH_LOG_RELEASED);
+            if (err != ESP_OK) {
+                return err;
+            }
+            size -= rec.len;
+            log->unread[type]--;
+        }
+        pos.offset += REC_SIZE(rec.len);
+        log->read[type] = pos;
+    }
+    return err == ESP_ERR_NOT_FOUND ? ESP_OK : err;
+}
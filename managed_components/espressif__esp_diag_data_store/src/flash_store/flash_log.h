@@ -0,0 +1,148 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include <esp_diag_data_store.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLASH_LOG_TYPES     2   /* Number of record types, e.g. critical and non critical data */
+
+/**
+ * @brief Flash partition operations used by the log
+ *
+ * Writes follow NOR flash semantics: they can only clear bits of erased (0xff) bytes.
+ */
+typedef struct {
+    esp_err_t (*read)(void *ctx, size_t offset, void *buf, size_t len);         /*!< Read from the partition */
+    esp_err_t (*write)(void *ctx, size_t offset, const void *buf, size_t len);  /*!< Program the partition */
+    esp_err_t (*erase)(void *ctx, size_t offset, size_t len);                   /*!< Erase whole sectors */
+    void *ctx;              /*!< Passed to the operations */
+    size_t size;            /*!< Size of the partition, a multiple of sector_size */
+    size_t sector_size;     /*!< Erase unit */
+} flash_log_part_t;
+
+/**
+ * @brief Callback to check the tag of a record on read
+ *
+ * @param[in] ctx Context given to \ref flash_log_read
+ * @param[in] tag Tag the record was appended with
+ *
+ * @return true to read the record, false to drop it
+ */
+typedef bool (*flash_log_tag_cb_t)(void *ctx, uint32_t tag);
+
+/**
+ * @brief Position of a record in the log
+ */
+typedef struct {
+    uint32_t sector;
+    uint32_t offset;
+} flash_log_pos_t;
+
+/**
+ * @brief Append-only log of records in a flash partition
+ *
+ * The sectors are used as a ring: records are appended to the newest sector and, when it is full,
+ * the next sector is erased and opened, evicting the oldest records if the ring is full. So every
+ * sector is erased once per turn of the ring. Records are marked as released by clearing their
+ * state word in place, so no sector is rewritten to consume data and the log survives reboots.
+ */
+typedef struct {
+    flash_log_part_t part;
+    uint32_t sectors;                           /*!< Number of sectors */
+    uint32_t seq;                               /*!< Sequence number of the newest sector */
+    uint32_t oldest;                            /*!< Oldest sector */
+    flash_log_pos_t head;                       /*!< Where the next record is written */
+    flash_log_pos_t read[FLASH_LOG_TYPES];      /*!< Where to look for the oldest unread record of a type */
+    uint32_t unread[FLASH_LOG_TYPES];           /*!< Unread records of a type */
+    uint32_t dropped[FLASH_LOG_TYPES];          /*!< Unread records evicted to make room, or dropped on read */
+} flash_log_t;
+
+/**
+ * @brief Mount the log, formatting the partition if it holds no log
+ *
+ * A record that was being written when power was lost is skipped.
+ *
+ * @param[out] log Log to mount
+ * @param[in] part Partition holding the log, at least two sectors
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for an unsuitable partition, or a partition error
+ */
+esp_err_t flash_log_mount(flash_log_t *log, const flash_log_part_t *part);
+
+/**
+ * @brief Erase all the records
+ *
+ * @param[in] log Mounted log
+ *
+ * @return ESP_OK on success, or a partition error
+ */
+esp_err_t flash_log_format(flash_log_t *log);
+
+/**
+ * @brief Append a record gathered from several segments
+ *
+ * @param[in] log Mounted log
+ * @param[in] type Record type, less than FLASH_LOG_TYPES
+ * @param[in] tag Stored with the record, but not part of the data read back
+ * @param[in] iov Segments of the record, stored back to back
+ * @param[in] iovcnt Number of segments
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_SIZE if the record does not fit in a sector,
+ *         or a partition error
+ */
+esp_err_t flash_log_append(flash_log_t *log, uint8_t type, uint32_t tag,
+                           const esp_diag_data_store_iov_t *iov, int iovcnt);
+
+/**
+ * @brief Read the oldest unread records of a type
+ *
+ * Copies as many whole records as fit in buf, back to back. The records stay unread until released.
+ * Records whose tag is rejected by \a keep are released instead, and counted as dropped.
+ *
+ * @param[in] log Mounted log
+ * @param[in] type Record type
+ * @param[in] keep Callback to check the tags, NULL to read every record
+ * @param[in] ctx Passed to keep
+ * @param[out] buf Buffer to read the records in
+ * @param[in] size Size of buf
+ *
+ * @return Number of bytes read, or -1 on error
+ */
+int flash_log_read(flash_log_t *log, uint8_t type, flash_log_tag_cb_t keep, void *ctx, uint8_t *buf, size_t size);
+
+/**
+ * @brief Release the oldest unread records of a type
+ *
+ * Releases the records read by \ref flash_log_read that fit entirely in size bytes.
+ *
+ * @param[in] log Mounted log
+ * @param[in] type Record type
+ * @param[in] size Number of bytes to release
+ *
+ * @return ESP_OK on success, or a partition error
+ */
+esp_err_t flash_log_release(flash_log_t *log, uint8_t type, size_t size);
+
+/**
+ * @brief Number of unread records of a type
+ */
+static inline uint32_t flash_log_unread(const flash_log_t *log, uint8_t type)
+{
+    return log->unread[type];
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,338 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <esp_system.h>
+#include <esp_partition.h>
+#include <esp_crc.h>
+
+#include <esp_diag_data_store.h>
+#include <rtc_store.h>
+#include "flash_log.h"
+#include "flash_store.h"
+
+/**
+ * @brief Flash overflow tier of the RTC store
+ *
+ * Keeps the data the RTC store has no room for in a flash log (see flash_log.h), framed the same
+ * way as in the RTC store: [meta index][data] for critical data and
+ * [meta index][rtc_store_non_critical_data_hdr_t][data] for non critical data.
+ *
+ * The meta records live in RTC memory, so the data is discarded on the resets that lose it,
+ * like the RTC store data. The meta records are a ring reused every few boots, while the log is
+ * kept across soft resets: each record is tagged with the boot that wrote it (see flash_store_tag())
+ * and dropped on read once its meta record belongs to another boot.
+ *
+ * @attention Like the RTC store, this uses prints rather than logs, as it is written to from the
+ *    log hooks of diagnostics.
+ */
+
+#if CONFIG_DIAG_DATA_STORE_DBG_PRINTS
+#define FLASH_STORE_DBG_PRINTS 1
+#endif
+
+#define FLASH_STORE_SECTOR_SIZE     4096    /* SPI flash erase unit */
+
+#define CRITICAL        0
+#define NON_CRITICAL    1
+
+typedef struct {
+    bool init;
+    SemaphoreHandle_t lock;     // the log is shared by critical and non critical data
+    const esp_partition_t *part;
+    flash_log_t log;
+} flash_store_priv_data_t;
+
+static flash_store_priv_data_t s_priv_data;
+
+static esp_err_t part_read(void *ctx, size_t offset, void *buf, size_t len)
+{
+    return esp_partition_read((const esp_partition_t *) ctx, offset, buf, len);
+}
+
+static esp_err_t part_write(void *ctx, size_t offset, const void *buf, size_t len)
+{
+    return esp_partition_write((const esp_partition_t *) ctx, offset, buf, len);
+}
+
+static esp_err_t part_erase(void *ctx, size_t offset, size_t len)
+{
+    return esp_partition_erase_range((const esp_partition_t *) ctx, offset, len);
+}
+
+/* Tag of the records written in this boot: [meta index][gen_id][boot_cnt] */
+static uint32_t flash_store_tag(void)
+{
+    uint8_t meta_idx = rtc_store_get_meta_record_current_index();
+    rtc_store_meta_header_t *meta = rtc_store_get_meta_record_current();
+    return meta_idx | ((uint32_t) meta->gen_id << 8) | ((uint32_t) meta->boot_cnt << 16);
+}
+
+/* Keep a record only while its meta record still describes the boot that wrote it */
+static bool flash_store_tag_valid(void *ctx, uint32_t tag)
+{
+    rtc_store_meta_header_t *meta = rtc_store_get_meta_record_by_index(tag & 0xff);
+    return meta && meta->gen_id == ((tag >> 8) & 0xff) && meta->boot_cnt == ((tag >> 16) & 0xff);
+}
+
+static size_t iov_len(const esp_diag_data_store_iov_t *iov, int iovcnt)
+{
+    size_t len = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        len += iov[i].len;
+    }
+    return len;
+}
+
+/* Append a record made of the RTC store framing followed by the segments.
+ * first is set when the log held no unread record of this type before. */
+static esp_err_t flash_store_append(uint8_t type, const void *prefix, size_t prefix_len,
+                                    const esp_diag_data_store_iov_t *iov, int iovcnt, bool *first)
+{
+    esp_diag_data_store_iov_t segs[1 + ESP_DIAG_DATA_STORE_IOV_MAX];
+
+    segs[0].base = prefix;
+    segs[0].len = prefix_len;
+    memcpy(&segs[1], iov, iovcnt * sizeof(*iov));
+    xSemaphoreTake(s_priv_data.lock, portMAX_DELAY);
+    *first = flash_log_unread(&s_priv_data.log, type) == 0;
+    esp_err_t err = flash_log_append(&s_priv_data.log, type, flash_store_tag(), segs, 1 + iovcnt);
+    xSemaphoreGive(s_priv_data.lock);
+#if FLASH_STORE_DBG_PRINTS
+    if (err != ESP_OK) {
+        printf("flash_store: append failed, err 0x%x\n", err);
+    }
+#endif
+    return err;
+}
+
+esp_err_t flash_store_critical_data_writev(const esp_diag_data_store_iov_t *iov, int iovcnt)
+{
+    if (!iov || iovcnt <= 0 || iovcnt > ESP_DIAG_DATA_STORE_IOV_MAX || !iov_len(iov, iovcnt)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_priv_data.init) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint8_t meta_idx = rtc_store_get_meta_record_current_index();
+    bool first;
+    esp_err_t err = flash_store_append(CRITICAL, &meta_idx, sizeof(meta_idx), iov, iovcnt, &first);
+    if (err != ESP_OK) {
+        esp_event_post(ESP_DIAG_DATA_STORE_EVENT, ESP_DIAG_DATA_STORE_EVENT_CRITICAL_DATA_WRITE_FAIL,
+                       iov[0].base, iov[0].len, 0);
+        return err;
+    }
+    /* Data only spills here past the reporting watermark of the RTC store, report it once */
+    if (first) {
+        esp_event_post(ESP_DIAG_DATA_STORE_EVENT, ESP_DIAG_DATA_STORE_EVENT_CRITICAL_DATA_LOW_MEM, NULL, 0, 0);
+    }
+    return ESP_OK;
+}
+
+esp_err_t flash_store_critical_data_write(void *data, size_t len)
+{
+    esp_diag_data_store_iov_t iov = {
+        .base = data,
+        .len = len,
+    };
+    if (!data) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return flash_store_critical_data_writev(&iov, 1);
+}
+
+esp_err_t flash_store_non_critical_data_writev(const char *dg, const esp_diag_data_store_iov_t *iov, int iovcnt)
+{
+    if (!dg || !iov || iovcnt <= 0 || iovcnt > ESP_DIAG_DATA_STORE_IOV_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t len = iov_len(iov, iovcnt);
+    if (!len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_priv_data.init) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint8_t prefix[1 + sizeof(rtc_store_non_critical_data_hdr_t)];
+    rtc_store_non_critical_data_hdr_t header = {
+        .len = len,
+    };
+    prefix[0] = rtc_store_get_meta_record_current_index();
+    memcpy(prefix + 1, &header, sizeof(header));
+    bool first;
+    esp_err_t err = flash_store_append(NON_CRITICAL, prefix, sizeof(prefix), iov, iovcnt, &first);
+    if (err != ESP_OK) {
+        esp_event_post(ESP_DIAG_DATA_STORE_EVENT, ESP_DIAG_DATA_STORE_EVENT_NON_CRITICAL_DATA_WRITE_FAIL, NULL, 0, 0);
+        return err;
+    }
+    if (first) {
+        esp_event_post(ESP_DIAG_DATA_STORE_EVENT, ESP_DIAG_DATA_STORE_EVENT_NON_CRITICAL_DATA_LOW_MEM, NULL, 0, 0);
+    }
+    return ESP_OK;
+}
+
+esp_err_t flash_store_non_critical_data_write(const char *dg, void *data, size_t len)
+{
+    esp_diag_data_store_iov_t iov = {
+        .base = data,
+        .len = len,
+    };
+    if (!data) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return flash_store_non_critical_data_writev(dg, &iov, 1);
+}
+
+static int flash_store_read(uint8_t type, uint8_t *buf, size_t size)
+{
+    if (!buf || !size) {
+        return -1;
+    }
+    if (!s_priv_data.init) {
+        return -1;
+    }
+    xSemaphoreTake(s_priv_data.lock, portMAX_DELAY);
+    int ret = flash_log_read(&s_priv_data.log, type, flash_store_tag_valid, NULL, buf, size);
+    xSemaphoreGive(s_priv_data.lock);
+    return ret;
+}
+
+static esp_err_t flash_store_release(uint8_t type, size_t size)
+{
+    if (!s_priv_data.init) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_priv_data.lock, portMAX_DELAY);
+    esp_err_t err = flash_log_release(&s_priv_data.log, type, size);
+    xSemaphoreGive(s_priv_data.lock);
+    return err;
+}
+
+int flash_store_critical_data_read(uint8_t *buf, size_t size)
+{
+    return flash_store_read(CRITICAL, buf, size);
+}
+
+int flash_store_non_critical_data_read(uint8_t *buf, size_t size)
+{
+    return flash_store_read(NON_CRITICAL, buf, size);
+}
+
+esp_err_t flash_store_critical_data_release(size_t size)
+{
+    return flash_store_release(CRITICAL, size);
+}
+
+esp_err_t flash_store_non_critical_data_release(size_t size)
+{
+    return flash_store_release(NON_CRITICAL, size);
+}
+
+size_t flash_store_critical_data_pending(void)
+{
+    return s_priv_data.init ? flash_log_unread(&s_priv_data.log, CRITICAL) : 0;
+}
+
+size_t flash_store_non_critical_data_pending(void)
+{
+    return s_priv_data.init ? flash_log_unread(&s_priv_data.log, NON_CRITICAL) : 0;
+}
+
+esp_err_t flash_store_discard_data(void)
+{
+    if (!s_priv_data.init) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_priv_data.lock, portMAX_DELAY);
+    esp_err_t err = flash_log_format(&s_priv_data.log);
+    xSemaphoreGive(s_priv_data.lock);
+    return err;
+}
+
+uint32_t flash_store_get_crc(void)
+{
+    struct {
+        uint32_t address;
+        uint32_t size;
+    } flash_meta_info = {
+        .address = s_priv_data.part ? s_priv_data.part->address : 0,
+        .size = s_priv_data.part ? s_priv_data.part->size : 0,
+    };
+    return esp_crc32_le(0, (const unsigned char *) &flash_meta_info, sizeof(flash_meta_info));
+}
+
+esp_err_t flash_store_init(void)
+{
+    if (s_priv_data.init) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_priv_data.part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW_PARTITION_LABEL);
+    if (!s_priv_data.part) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (s_priv_data.part->encrypted) {
+        /* Records are released by clearing bits in place, which encryption does not allow */
+        printf("flash_store: partition %s must not be encrypted\n", s_priv_data.part->label);
+        s_priv_data.part = NULL;
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    s_priv_data.lock = xSemaphoreCreateMutex();
+    if (!s_priv_data.lock) {
+        s_priv_data.part = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    flash_log_part_t part = {
+        .read = part_read,
+        .write = part_write,
+        .erase = part_erase,
+        .ctx = (void *) s_priv_data.part,
+        .size = s_priv_data.part->size - s_priv_data.part->size % FLASH_STORE_SECTOR_SIZE,
+        .sector_size = FLASH_STORE_SECTOR_SIZE,
+    };
+    esp_err_t err = flash_log_mount(&s_priv_data.log, &part);
+    if (err == ESP_OK) {
+        esp_reset_reason_t reset_reason = esp_reset_reason();
+        if (reset_reason == ESP_RST_UNKNOWN ||
+                reset_reason == ESP_RST_POWERON ||
+                reset_reason == ESP_RST_BROWNOUT) {
+            // meta records of the data are lost with RTC memory
+            err = flash_log_format(&s_priv_data.log);
+        }
+    }
+    if (err != ESP_OK) {
+        printf("flash_store: failed to mount partition %s, err 0x%x\n", s_priv_data.part->label, err);
+        vSemaphoreDelete(s_priv_data.lock);
+        s_priv_data.lock = NULL;
+        s_priv_data.part = NULL;
+        return err;
+    }
+#if FLASH_STORE_DBG_PRINTS
+    printf("flash_store: %" PRIu32 " critical, %" PRIu32 " non critical records pending\n",
+           flash_log_unread(&s_priv_data.log, CRITICAL), flash_log_unread(&s_priv_data.log, NON_CRITICAL));
+#endif
+    s_priv_data.init = true;
+    return ESP_OK;
+}
+
+void flash_store_deinit(void)
+{
+    if (!s_priv_data.init) {
+        return;
+    }
+    xSemaphoreTake(s_priv_data.lock, portMAX_DELAY);
+    s_priv_data.init = false;
+    xSemaphoreGive(s_priv_data.lock);
+    vSemaphoreDelete(s_priv_data.lock);
+    s_priv_data.lock = NULL;
+    s_priv_data.part = NULL;
+}
@@ -0,0 +1,138 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+#include <esp_diag_data_store.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Write critical data to the flash store
+ *
+ * Data is framed as in the RTC store, so it reads back the same.
+ *
+ * @param[in] data Data to be written
+ * @param[in] len Length of data
+ *
+ * @return ESP_OK on success, appropriate error code otherwise.
+ */
+esp_err_t flash_store_critical_data_write(void *data, size_t len);
+
+/**
+ * @brief Write critical data gathered from several segments to the flash store
+ *
+ * @param[in] iov Segments of the record
+ * @param[in] iovcnt Number of segments, at most ESP_DIAG_DATA_STORE_IOV_MAX
+ *
+ * @return ESP_OK on success, appropriate error code otherwise.
+ */
+esp_err_t flash_store_critical_data_writev(const esp_diag_data_store_iov_t *iov, int iovcnt);
+
+/**
+ * @brief Read the oldest critical data from the flash store
+ *
+ * @param[in] buf Buffer to read data in
+ * @param[in] size Size of buf
+ *
+ * @return Number of bytes read or -1 on error
+ */
+int flash_store_critical_data_read(uint8_t *buf, size_t size);
+
+/**
+ * @brief Release size bytes of critical data from the flash store
+ *
+ * @param[in] size Number of bytes to free.
+ *
+ * @return ESP_OK on success, appropriate error code otherwise.
+ */
+esp_err_t flash_store_critical_data_release(size_t size);
+
+/**
+ * @brief Number of critical data records in the flash store
+ */
+size_t flash_store_critical_data_pending(void);
+
+/**
+ * @brief Write non critical data to the flash store
+ *
+ * @param[in] dg Data group of the data
+ * @param[in] data Data to be written
+ * @param[in] len Length of data
+ *
+ * @return ESP_OK on success, appropriate error code otherwise.
+ */
+esp_err_t flash_store_non_critical_data_write(const char *dg, void *data, size_t len);
+
+/**
+ * @brief Write non critical data gathered from several segments to the flash store
+ *
+ * @param[in] dg Data group of the data
+ * @param[in] iov Segments of the record
+ * @param[in] iovcnt Number of segments, at most ESP_DIAG_DATA_STORE_IOV_MAX
+ *
+ * @return ESP_OK on success, appropriate error code otherwise.
+ */
+esp_err_t flash_store_non_critical_data_writev(const char *dg, const esp_diag_data_store_iov_t *iov, int iovcnt);
+
+/**
+ * @brief Read the oldest non critical data from the flash store
+ *
+ * @param[in] buf Buffer to read data in
+ * @param[in] size Size of buf
+ *
+ * @return Number of bytes read or -1 on error
+ */
+int flash_store_non_critical_data_read(uint8_t *buf, size_t size);
+
+/**
+ * @brief Release size bytes of non critical data from the flash store
+ *
+ * @param[in] size Number of bytes to free.
+ *
+ * @return ESP_OK on success, appropriate error code otherwise.
+ */
+esp_err_t flash_store_non_critical_data_release(size_t size);
+
+/**
+ * @brief Number of non critical data records in the flash store
+ */
+size_t flash_store_non_critical_data_pending(void);
+
+/**
+ * @brief Initializes the flash store in the CONFIG_DIAG_DATA_STORE_FLASH_OVERFLOW_PARTITION_LABEL partition
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if there is no such partition, appropriate error code otherwise
+ */
+esp_err_t flash_store_init(void);
+
+/**
+ * @brief Deinitializes the flash store
+ */
+void flash_store_deinit(void);
+
+/**
+ * @brief Get CRC of flash store configuration
+ *
+ * @return crc
+ */
+uint32_t flash_store_get_crc(void);
+
+/**
+ * @brief Discard all the data in the flash store
+ *
+ * @return ESP_OK on success, appropriate error code otherwise.
+ */
+esp_err_t flash_store_discard_data(void);
+
+#ifdef __cplusplus
+}
+#endif
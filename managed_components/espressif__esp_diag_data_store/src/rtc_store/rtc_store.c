@@ -18,6 +18,7 @@
 #include "rtc_store.h"
 #include <esp_crc.h>
 #include <inttypes.h>
+#include <stdatomic.h>
 
 #if __has_include("esp_idf_version.h")
 #include "esp_idf_version.h"
@@ -94,6 +95,7 @@ typedef struct {
     rbuf_data_t critical;
     rbuf_data_t non_critical;
     rtc_store_meta_header_t *meta_hdr;
+    atomic_bool time_base_set;  // meta_hdr->time_base is final for this boot
     char sha_sum[RTC_STORE_HEX_SHA_SIZE + 1];
 } rtc_store_priv_data_t;
 
@@ -122,6 +124,7 @@ typedef struct {
     rtc_store_t *rtc_store;
     size_t critical_buf_size;
     size_t non_critical_buf_size;
+    size_t meta_hdr_size;
 } rtc_store_meta_info_t;
 
 static rtc_store_priv_data_t s_priv_data;
@@ -132,16 +135,6 @@ static inline size_t data_store_get_size(data_store_t *store)
     return store->size;
 }
 
-static inline size_t data_store_get_free_at_end(data_store_t *store)
-{
-    data_store_info_t *info = (data_store_info_t *) &store->info;
-    size_t free_at_end = 0;
-    if (info->read_offset + info->filled < store->size) {
-        free_at_end = store->size - (info->filled + info->read_offset);
-    }
-    return free_at_end;
-}
-
 static inline size_t data_store_get_free(data_store_t *store)
 {
     data_store_info_t *info = (data_store_info_t *) &store->info;
@@ -175,63 +168,68 @@ static void rtc_store_read_complete(rbuf_data_t *rbuf_data, size_t len)
     rbuf_data->store->info.value = info.value;
 }
 
-static void rtc_store_write_complete(rbuf_data_t *rbuf_data, size_t len)
+/* Copy data at pos of the buffer, wrapping around its end. Returns the position after the data */
+static size_t rtc_store_copy_at(data_store_t *store, size_t pos, const void *data, size_t len)
 {
-    data_store_info_t *info = (data_store_info_t *) &rbuf_data->store->info;
-#if RTC_STORE_DBG_PRINTS
-    ESP_LOGI(TAG, "before write_complete, filled %" PRIu16 ", size %u, read_offset %" PRIu16 ", len %u",
-             info->filled, rbuf_data->store->size, info->read_offset, len);
-#endif
-
-    info->filled += len;
-
-#if RTC_STORE_DBG_PRINTS
-    ESP_LOGI(TAG, "after write_complete, filled %" PRIu16 ", size %u, read_offset %" PRIu16 ", len %u",
-             info->filled, rbuf_data->store->size, info->read_offset, len);
-#endif
+    size_t to_end = store->size - pos;
+    if (len < to_end) {
+        memcpy(store->buf + pos, data, len);
+        return pos + len;
+    }
+    memcpy(store->buf + pos, data, to_end);
+    memcpy(store->buf, (const uint8_t *) data + to_end, len - to_end);
+    return len - to_end;
 }
 
-// Caller has made sure that enough memory is free...
-static size_t rtc_store_write_at_offset(rbuf_data_t *rbuf_data, void *data, size_t len, size_t offset)
+/* Caller holds the lock and has made sure that len bytes are free.
+ * Copies prefix and the segments back to back from the write offset, then publishes the record
+ * with a single update of the store info. */
+static void rtc_store_writev_unsafe(rbuf_data_t *rbuf_data, const void *prefix, size_t prefix_len,
+                                    const esp_diag_data_store_iov_t *iov, int iovcnt, size_t len)
 {
-    data_store_info_t *info = (data_store_info_t *) &rbuf_data->store->info;
+    data_store_t *store = rbuf_data->store;
+    data_store_info_t info = {
+        .value = store->info.value,
+    };
 #if RTC_STORE_DBG_PRINTS
-    ESP_LOGI(TAG, "(write_at_offset): size %u, available: %u, filled %u, read_ptr %" PRIu16 ", to_write %u",
-             rbuf_data->store->size, data_store_get_free(rbuf_data->store),
-             data_store_get_filled(rbuf_data->store), info->read_offset, len);
+    ESP_LOGI(TAG, "(writev): size %u, available: %u, filled %" PRIu16 ", read_ptr %" PRIu16 ", to_write %u",
+             store->size, data_store_get_free(store), info.filled, info.read_offset, len);
 #endif
-
-    uint16_t write_offset = info->filled + info->read_offset;
-    if (write_offset >= rbuf_data->store->size) { // wrap around
-        write_offset -= rbuf_data->store->size;
+    size_t pos = info.read_offset + info.filled;
+    if (pos >= store->size) { // wrap around
+        pos -= store->size;
     }
-
-    size_t free_at_end = data_store_get_free_at_end(rbuf_data->store);
-    if (free_at_end && (free_at_end < offset)) {
-        offset -= free_at_end;
-        memcpy(rbuf_data->store->buf + offset, data, len);
-    } else if (free_at_end && (free_at_end < offset + len)) {
-        free_at_end -= offset;
-        uint8_t *write_ptr = (uint8_t *) (rbuf_data->store->buf + write_offset + offset);
-        memcpy(write_ptr, data, free_at_end);
-        memcpy(rbuf_data->store->buf, data + free_at_end, len - free_at_end);
-    } else {
-        uint8_t *write_ptr = (uint8_t *) (rbuf_data->store->buf + write_offset + offset);
-        memcpy(write_ptr, data, len);
+    pos = rtc_store_copy_at(store, pos, prefix, prefix_len);
+    for (int i = 0; i < iovcnt; i++) {
+        pos = rtc_store_copy_at(store, pos, iov[i].base, iov[i].len);
     }
-    return len;
+
+    // commit
+    info.filled += len;
+    store->info.value = info.value;
 }
 
-static size_t rtc_store_write(rbuf_data_t *rbuf_data, void *data, size_t len)
+static esp_err_t rtc_store_iov_len(const esp_diag_data_store_iov_t *iov, int iovcnt, size_t *len)
 {
-    return rtc_store_write_at_offset(rbuf_data, data, len, 0);
+    if (!iov || iovcnt <= 0 || iovcnt > ESP_DIAG_DATA_STORE_IOV_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *len = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        if (!iov[i].base && iov[i].len) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        *len += iov[i].len;
+    }
+    return *len ? ESP_OK : ESP_ERR_INVALID_ARG;
 }
 
-esp_err_t rtc_store_critical_data_write(void *data, size_t len)
+esp_err_t rtc_store_critical_data_writev(const esp_diag_data_store_iov_t *iov, int iovcnt)
 {
     esp_err_t ret = ESP_OK;
+    size_t len;
 
-    if (!data || !len) {
+    if (rtc_store_iov_len(iov, iovcnt, &len) != ESP_OK) {
         return ESP_ERR_INVALID_ARG;
     }
     if (!s_priv_data.init) {
@@ -248,18 +246,16 @@ esp_err_t rtc_store_critical_data_write(void *data, size_t len)
     xSemaphoreTake(s_priv_data.critical.lock, portMAX_DELAY);
 
     size_t curr_free = data_store_get_free(s_priv_data.critical.store);
-    // size_t free_at_end = data_store_get_free_at_end(s_priv_data.critical.store);
     // If no space available... Raise write fail event
     if (curr_free < len_real) {
-        esp_event_post(ESP_DIAG_DATA_STORE_EVENT, ESP_DIAG_DATA_STORE_EVENT_CRITICAL_DATA_WRITE_FAIL, data, len_real, 0);
+        esp_event_post(ESP_DIAG_DATA_STORE_EVENT, ESP_DIAG_DATA_STORE_EVENT_CRITICAL_DATA_WRITE_FAIL,
+                       iov[0].base, iov[0].len, 0);
 #if RTC_STORE_DBG_PRINTS
         printf("%s, curr_free %d, req_free %d\n", TAG, curr_free, len_real);
 #endif
         ret = ESP_ERR_NO_MEM;
     } else { // we have enough space of (len + 1)
-        rtc_store_write(&s_priv_data.critical, &s_rtc_store.meta_hdr_idx, 1);
-        rtc_store_write_at_offset(&s_priv_data.critical, data, len, 1);
-        rtc_store_write_complete(&s_priv_data.critical, len + 1);
+        rtc_store_writev_unsafe(&s_priv_data.critical, &s_rtc_store.meta_hdr_idx, 1, iov, iovcnt, len_real);
         curr_free = data_store_get_free(s_priv_data.critical.store);
     }
     xSemaphoreGive(s_priv_data.critical.lock);
@@ -270,11 +266,25 @@ esp_err_t rtc_store_critical_data_write(void *data, size_t len)
     return ret;
 }
 
+esp_err_t rtc_store_critical_data_write(void *data, size_t len)
+{
+    if (!data || !len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_diag_data_store_iov_t iov = {
+        .base = data,
+        .len = len,
+    };
+    return rtc_store_critical_data_writev(&iov, 1);
+}
+
 static int rtc_store_data_read_unsafe(rbuf_data_t *rbuf_data, uint8_t *buf, size_t size);
 
-esp_err_t rtc_store_non_critical_data_write(const char *dg, void *data, size_t len)
+esp_err_t rtc_store_non_critical_data_writev(const char *dg, const esp_diag_data_store_iov_t *iov, int iovcnt)
 {
-    if (!dg || !len || !data) {
+    size_t len;
+
+    if (!dg || rtc_store_iov_len(iov, iovcnt, &len) != ESP_OK) {
         return ESP_ERR_INVALID_ARG;
     }
     if (!esp_ptr_in_drom(dg)) {
@@ -295,7 +305,7 @@ esp_err_t rtc_store_non_critical_data_write(const char *dg, void *data, size_t l
     }
 
     if (xSemaphoreTake(s_priv_data.non_critical.lock, 0) == pdFALSE) {
-        return ESP_FAIL;
+        return ESP_ERR_TIMEOUT;
     }
 
 #if CONFIG_RTC_STORE_OVERWRITE_NON_CRITICAL_DATA
@@ -319,10 +329,10 @@ esp_err_t rtc_store_non_critical_data_write(const char *dg, void *data, size_t l
     header.len = len;
 
     // we have made sure of free size at this point, write index byte, data header and then actual data
-    rtc_store_write(&s_priv_data.non_critical, &s_rtc_store.meta_hdr_idx, 1);
-    rtc_store_write_at_offset(&s_priv_data.non_critical, &header, sizeof(header), 1);
-    rtc_store_write_at_offset(&s_priv_data.non_critical, data, len, 1 + sizeof(header));
-    rtc_store_write_complete(&s_priv_data.non_critical, req_free);
+    uint8_t prefix[1 + sizeof(header)];
+    prefix[0] = s_rtc_store.meta_hdr_idx;
+    memcpy(prefix + 1, &header, sizeof(header));
+    rtc_store_writev_unsafe(&s_priv_data.non_critical, prefix, sizeof(prefix), iov, iovcnt, req_free);
 
     curr_free = data_store_get_free(s_priv_data.non_critical.store);
     xSemaphoreGive(s_priv_data.non_critical.lock);
@@ -334,6 +344,18 @@ esp_err_t rtc_store_non_critical_data_write(const char *dg, void *data, size_t l
     return ESP_OK;
 }
 
+esp_err_t rtc_store_non_critical_data_write(const char *dg, void *data, size_t len)
+{
+    if (!data || !len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_diag_data_store_iov_t iov = {
+        .base = data,
+        .len = len,
+    };
+    return rtc_store_non_critical_data_writev(dg, &iov, 1);
+}
+
 static int rtc_store_data_read_unsafe(rbuf_data_t *rbuf_data, uint8_t *buf, size_t size)
 {
     data_store_info_t *info = (data_store_info_t *) &rbuf_data->store->info;
@@ -499,6 +521,53 @@ rtc_store_meta_header_t *rtc_store_get_meta_record_current()
     return &s_rtc_store.meta[s_rtc_store.meta_hdr_idx];
 }
 
+uint8_t rtc_store_get_meta_record_current_index(void)
+{
+    return s_rtc_store.meta_hdr_idx;
+}
+
+uint64_t rtc_store_get_meta_time_base(uint64_t ts)
+{
+    if (!s_priv_data.init) {
+        return 0;
+    }
+    if (atomic_load_explicit(&s_priv_data.time_base_set, memory_order_acquire)) {
+        return s_priv_data.meta_hdr->time_base;
+    }
+    /* 64 bit stores are not atomic, first caller sets the base under the lock */
+    xSemaphoreTake(s_priv_data.non_critical.lock, portMAX_DELAY);
+    if (!atomic_load_explicit(&s_priv_data.time_base_set, memory_order_relaxed)) {
+        s_priv_data.meta_hdr->time_base = ts;
+        atomic_store_explicit(&s_priv_data.time_base_set, true, memory_order_release);
+    }
+    xSemaphoreGive(s_priv_data.non_critical.lock);
+    return s_priv_data.meta_hdr->time_base;
+}
+
+/* overhead is the framing added to each record: meta index, and header for non critical data */
+static size_t rtc_store_data_headroom(rbuf_data_t *rbuf_data, size_t watermark, size_t overhead)
+{
+    size_t curr_free = data_store_get_free(rbuf_data->store);
+    return curr_free > watermark + overhead ? curr_free - watermark - overhead : 0;
+}
+
+size_t rtc_store_critical_data_headroom(void)
+{
+    if (!s_priv_data.init) {
+        return 0;
+    }
+    return rtc_store_data_headroom(&s_priv_data.critical, DIAG_CRITICAL_DATA_REPORTING_WATERMARK, 1);
+}
+
+size_t rtc_store_non_critical_data_headroom(void)
+{
+    if (!s_priv_data.init) {
+        return 0;
+    }
+    return rtc_store_data_headroom(&s_priv_data.non_critical, DIAG_NON_CRITICAL_DATA_REPORTING_WATERMARK,
+                                   1 + sizeof(rtc_store_non_critical_data_hdr_t));
+}
+
 static inline uint8_t to_int_digit(unsigned val)
 {
     return (val <= '9') ? (val - '0') : (val - 'a' + 10);
@@ -567,6 +636,8 @@ skip_nvs_read_write:
 
     s_priv_data.meta_hdr->gen_id = gen_id;
     s_priv_data.meta_hdr->boot_cnt = boot_cnt;
+    s_priv_data.meta_hdr->time_base = 0;
+    atomic_store(&s_priv_data.time_base_set, false);
 
     return ESP_OK;
 }
@@ -593,7 +664,8 @@ uint32_t rtc_store_get_crc()
         .non_critical_buf = s_rtc_store.non_critical.buf,
         .rtc_store = &s_rtc_store,
         .critical_buf_size = DIAG_CRITICAL_BUF_SIZE,
-        .non_critical_buf_size = DIAG_NON_CRITICAL_BUF_SIZE
+        .non_critical_buf_size = DIAG_NON_CRITICAL_BUF_SIZE,
+        .meta_hdr_size = sizeof(rtc_store_meta_header_t)
     };
     uint32_t crc = 0;
     crc = esp_crc32_le(crc, (const unsigned char *)&rtc_meta_info, sizeof(rtc_meta_info));
@@ -8,6 +8,7 @@
 
 #include <esp_err.h>
 #include <esp_event.h>
+#include <esp_diag_data_store.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -24,6 +25,7 @@ typedef struct {
     uint8_t boot_cnt;           // updated on each soft reboot
     char sha_sum[RTC_STORE_SHA_SIZE];     // elf shasum
     bool valid;                 //
+    uint64_t time_base;         // first wall clock timestamp of this boot, 0 until one is seen
 } rtc_store_meta_header_t;
 
 /**
@@ -41,6 +43,24 @@ rtc_store_meta_header_t *rtc_store_get_meta_record_by_index(uint8_t idx);
  */
 rtc_store_meta_header_t *rtc_store_get_meta_record_current();
 
+/**
+ * @brief   get index of the current meta header, as stored in front of each data record
+ *
+ * @return index of the current meta header
+ */
+uint8_t rtc_store_get_meta_record_current_index(void);
+
+/**
+ * @brief   get time base of the current boot, setting it to ts if not set yet
+ *
+ * Compact data records store wall clock timestamps relative to this base. The base is
+ * kept in the meta header of the boot so that records of previous boots can still be restored.
+ *
+ * @param ts    wall clock timestamp in microseconds to use if base is not set yet
+ * @return time base of the current boot
+ */
+uint64_t rtc_store_get_meta_time_base(uint64_t ts);
+
 /**
  * @brief Non critical data header
  */
@@ -58,6 +78,18 @@ typedef struct {
  */
 esp_err_t rtc_store_critical_data_write(void *data, size_t len);
 
+/**
+ * @brief Write critical data gathered from several segments to the RTC storage
+ *
+ * Space is reserved once for the whole record and the record becomes visible to readers at once.
+ *
+ * @param[in] iov Segments of the record
+ * @param[in] iovcnt Number of segments, at most ESP_DIAG_DATA_STORE_IOV_MAX
+ *
+ * @return ESP_OK on success, appropriate error code otherwise.
+ */
+esp_err_t rtc_store_critical_data_writev(const esp_diag_data_store_iov_t *iov, int iovcnt);
+
 /**
  * @brief Read critical data from the RTC storage
  *
@@ -98,7 +130,7 @@ int rtc_store_critical_data_read_and_release(uint8_t *buf, size_t size);
  * @param[in] data Pointer to non critical data
  * @param[in] len Length of non critical data
  *
- * @return ESP_OK on success, appropriate error code otherwise.
+ * @return ESP_OK on success, ESP_ERR_TIMEOUT if the store is in use, appropriate error code otherwise.
  *
  * @note Data is stored in Type-Length-Value format
  *       Type(Data group)  - 4 byte      - Pointer to the string in rodata
@@ -107,6 +139,17 @@ int rtc_store_critical_data_read_and_release(uint8_t *buf, size_t size);
  */
 esp_err_t rtc_store_non_critical_data_write(const char *dg, void *data, size_t len);
 
+/**
+ * @brief Write non critical data gathered from several segments to the RTC storage
+ *
+ * @param[in] dg Data group of the data
+ * @param[in] iov Segments of the record
+ * @param[in] iovcnt Number of segments, at most ESP_DIAG_DATA_STORE_IOV_MAX
+ *
+ * @return ESP_OK on success, ESP_ERR_TIMEOUT if the store is in use, appropriate error code otherwise.
+ */
+esp_err_t rtc_store_non_critical_data_writev(const char *dg, const esp_diag_data_store_iov_t *iov, int iovcnt);
+
 /**
  * @brief Read non critical data from the RTC storage
  *
@@ -136,6 +179,22 @@ esp_err_t rtc_store_non_critical_data_release(size_t size);
  */
 int rtc_store_non_critical_data_read_and_release(uint8_t *buf, size_t size);
 
+/**
+ * @brief Free space of critical data store above the reporting watermark
+ *
+ * @return length of the largest record that can be written before the free space drops below the
+ *         reporting watermark, the framing the store adds to each record taken into account
+ */
+size_t rtc_store_critical_data_headroom(void);
+
+/**
+ * @brief Free space of non critical data store above the reporting watermark
+ *
+ * @return length of the largest record that can be written before the free space drops below the
+ *         reporting watermark, the framing the store adds to each record taken into account
+ */
+size_t rtc_store_non_critical_data_headroom(void);
+
 /**
  * @brief Initializes the RTC storage
  *
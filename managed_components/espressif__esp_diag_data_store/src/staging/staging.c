@@ -0,0 +1,286 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "staging.h"
+
+/**
+ * @brief Lock-free staging rings in front of the data store
+ *
+ * Each ring has a single producer at a time: a producer claims a free ring with an atomic
+ * test-and-set, copies its record, releases the ring and notifies the drainer, so writers never
+ * wait for each other or for the store. A single drainer (the drain task, or a reader, whichever
+ * wins the drain flag) commits the records into the store in order, ring by ring. A record the
+ * store is too busy to take stays staged until the next drain.
+ *
+ * Records are stored contiguously as [staging_hdr_t][data], so they can be committed in place.
+ * A record that does not fit at the end of the buffer starts again at offset 0, after a padding
+ * header (or less than a header of unused space).
+ */
+
+#ifdef CONFIG_DIAG_DATA_STORE_STAGING_RINGS
+#define STAGING_RINGS       CONFIG_DIAG_DATA_STORE_STAGING_RINGS
+#else
+#define STAGING_RINGS       4
+#endif
+
+#ifdef CONFIG_DIAG_DATA_STORE_STAGING_RING_SIZE
+#define STAGING_RING_SIZE   CONFIG_DIAG_DATA_STORE_STAGING_RING_SIZE
+#else
+#define STAGING_RING_SIZE   1024
+#endif
+
+#define STAGING_PAD_LEN     UINT16_MAX
+
+typedef struct {
+    uint16_t len;           // length of data, STAGING_PAD_LEN for padding
+    const char *dg;         // data group, NULL for critical data
+} staging_hdr_t;
+
+typedef struct {
+    atomic_flag owner;      // held by the producer writing into the ring
+    atomic_uint head;       // next write offset, written by the producer
+    atomic_uint tail;       // next read offset, written by the drainer
+    uint8_t buf[STAGING_RING_SIZE];
+} staging_ring_t;
+
+typedef struct {
+    bool init;
+    atomic_bool open;       // accepting records, cleared by staging_stop()
+    atomic_uint writers;    // producers between their check of open and their notify
+    staging_commit_cb_t commit;
+    staging_notify_cb_t notify;
+    atomic_flag draining;
+    atomic_uint ring_full;
+    atomic_uint ring_busy;
+    atomic_uint store_fail;
+    staging_ring_t rings[STAGING_RINGS];
+} staging_priv_data_t;
+
+static staging_priv_data_t s_priv_data = {
+    .draining = ATOMIC_FLAG_INIT,
+};
+
+/* Returns the offset to write a record of `need` bytes at, or -1 if the ring is full */
+static int staging_reserve(staging_ring_t *ring, uint32_t head, size_t need)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    staging_hdr_t pad = {
+        .len = STAGING_PAD_LEN,
+    };
+
+    // one byte stays unused so that head == tail means empty
+    if (head < tail) {
+        return (tail - head - 1 >= need) ? (int) head : -1;
+    }
+    if (STAGING_RING_SIZE - head - (tail == 0) >= need) {
+        return head;
+    }
+    if (tail <= need) {
+        return -1;
+    }
+    // wrap around, the drainer skips a padding header or less than a header at the end
+    if (STAGING_RING_SIZE - head >= sizeof(pad)) {
+        memcpy(ring->buf + head, &pad, sizeof(pad));
+    }
+    return 0;
+}
+
+esp_err_t staging_write(unsigned hint, const char *dg, const void *data, size_t len)
+{
+    esp_diag_data_store_iov_t iov = {
+        .base = data,
+        .len = len,
+    };
+    return staging_writev(hint, dg, &iov, 1);
+}
+
+esp_err_t staging_writev(unsigned hint, const char *dg, const esp_diag_data_store_iov_t *iov, int iovcnt)
+{
+    bool full = false;
+    int pos = -1;
+    size_t len = 0;
+
+    for (int i = 0; i < iovcnt; i++) {
+        len += iov[i].len;
+    }
+    size_t need = sizeof(staging_hdr_t) + len;
+    if (len >= STAGING_PAD_LEN || need >= STAGING_RING_SIZE) {
+        return atomic_load(&s_priv_data.open) ? ESP_ERR_INVALID_SIZE : ESP_ERR_INVALID_STATE;
+    }
+    // pairs with staging_stop(): either we see it, or it waits for our notify
+    atomic_fetch_add(&s_priv_data.writers, 1);
+    if (!atomic_load(&s_priv_data.open)) {
+        atomic_fetch_sub(&s_priv_data.writers, 1);
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (unsigned i = 0; i < STAGING_RINGS && pos < 0; i++) {
+        staging_ring_t *ring = &s_priv_data.rings[(hint + i) % STAGING_RINGS];
+        if (atomic_flag_test_and_set_explicit(&ring->owner, memory_order_acquire)) {
+            continue;
+        }
+        uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        pos = staging_reserve(ring, head, need);
+        if (pos >= 0) {
+            staging_hdr_t hdr = {
+                .len = len,
+                .dg = dg,
+            };
+            uint8_t *dst = ring->buf + pos;
+            memcpy(dst, &hdr, sizeof(hdr));
+            dst += sizeof(hdr);
+            // records never wrap inside the ring, so the segments are copied one after the other
+            for (int j = 0; j < iovcnt; j++) {
+                memcpy(dst, iov[j].base, iov[j].len);
+                dst += iov[j].len;
+            }
+            head = pos + need;
+            if (head == STAGING_RING_SIZE) {
+                head = 0;
+            }
+            atomic_store_explicit(&ring->head, head, memory_order_release);
+        } else {
+            // only the drainer makes room, try the next ring
+            full = true;
+        }
+        atomic_flag_clear_explicit(&ring->owner, memory_order_release);
+    }
+    s_priv_data.notify();
+    atomic_fetch_sub_explicit(&s_priv_data.writers, 1, memory_order_release);
+
+    if (pos < 0) {
+        atomic_fetch_add_explicit(full ? &s_priv_data.ring_full : &s_priv_data.ring_busy, 1, memory_order_relaxed);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/* Returns false if the store was busy and the ring still holds records */
+static bool staging_drain_ring(staging_ring_t *ring)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    staging_hdr_t hdr;
+
+    while (tail != head) {
+        if (STAGING_RING_SIZE - tail < sizeof(hdr)) {
+            tail = 0;
+            continue;
+        }
+        memcpy(&hdr, ring->buf + tail, sizeof(hdr));
+        if (hdr.len == STAGING_PAD_LEN) {
+            tail = 0;
+            continue;
+        }
+        esp_err_t err = s_priv_data.commit(hdr.dg, ring->buf + tail + sizeof(hdr), hdr.len);
+        if (err == ESP_ERR_TIMEOUT) {
+            // keep the record and the order of the ring, retry on the next drain
+            break;
+        }
+        if (err != ESP_OK) {
+            atomic_fetch_add_explicit(&s_priv_data.store_fail, 1, memory_order_relaxed);
+        }
+        tail += sizeof(hdr) + hdr.len;
+        if (tail == STAGING_RING_SIZE) {
+            tail = 0;
+        }
+        // hand the space back to the producers record by record
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    return tail == head;
+}
+
+static bool staging_pending(void)
+{
+    for (int i = 0; i < STAGING_RINGS; i++) {
+        staging_ring_t *ring = &s_priv_data.rings[i];
+        if (atomic_load_explicit(&ring->head, memory_order_relaxed) !=
+                atomic_load_explicit(&ring->tail, memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool staging_drain(void)
+{
+    if (!s_priv_data.init) {
+        return false;
+    }
+    do {
+        bool busy = false;
+        // pairs with the fence below: either we get the flag, or the drainer sees our record
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_flag_test_and_set_explicit(&s_priv_data.draining, memory_order_acquire)) {
+            return staging_pending();
+        }
+        for (int i = 0; i < STAGING_RINGS; i++) {
+            busy |= !staging_drain_ring(&s_priv_data.rings[i]);
+        }
+        atomic_flag_clear_explicit(&s_priv_data.draining, memory_order_release);
+        if (busy) {
+            // do not spin on a busy store
+            return true;
+        }
+        // pick up a record staged after its ring was drained, but before the flag was cleared
+        atomic_thread_fence(memory_order_seq_cst);
+    } while (staging_pending());
+    return false;
+}
+
+void staging_get_stats(staging_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    stats->ring_full = atomic_load_explicit(&s_priv_data.ring_full, memory_order_relaxed);
+    stats->ring_busy = atomic_load_explicit(&s_priv_data.ring_busy, memory_order_relaxed);
+    stats->store_fail = atomic_load_explicit(&s_priv_data.store_fail, memory_order_relaxed);
+}
+
+esp_err_t staging_init(staging_commit_cb_t commit, staging_notify_cb_t notify)
+{
+    if (!commit || !notify) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < STAGING_RINGS; i++) {
+        staging_ring_t *ring = &s_priv_data.rings[i];
+        atomic_flag_clear(&ring->owner);
+        atomic_init(&ring->head, 0);
+        atomic_init(&ring->tail, 0);
+    }
+    atomic_flag_clear(&s_priv_data.draining);
+    atomic_init(&s_priv_data.ring_full, 0);
+    atomic_init(&s_priv_data.ring_busy, 0);
+    atomic_init(&s_priv_data.store_fail, 0);
+    s_priv_data.commit = commit;
+    s_priv_data.notify = notify;
+    atomic_init(&s_priv_data.writers, 0);
+    s_priv_data.init = true;
+    atomic_store(&s_priv_data.open, true);
+    return ESP_OK;
+}
+
+void staging_stop(void)
+{
+    atomic_store(&s_priv_data.open, false);
+}
+
+bool staging_writing(void)
+{
+    return atomic_load(&s_priv_data.writers) != 0;
+}
+
+void staging_deinit(void)
+{
+    atomic_store(&s_priv_data.open, false);
+    s_priv_data.init = false;
+    s_priv_data.commit = NULL;
+    s_priv_data.notify = NULL;
+}
@@ -0,0 +1,131 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <esp_err.h>
+#include <esp_diag_data_store.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Callback to commit a staged record into the data store
+ *
+ * @param[in] dg Data group for non critical data, NULL for critical data
+ * @param[in] data Record data
+ * @param[in] len Length of the record data
+ *
+ * @return ESP_OK if the record was stored,
+ *         ESP_ERR_TIMEOUT if the store is busy: the record stays staged for the next drain.
+ *         Any other error drops the record.
+ */
+typedef esp_err_t (*staging_commit_cb_t)(const char *dg, void *data, size_t len);
+
+/**
+ * @brief Callback to wake up the drainer after a record was staged
+ *
+ * Called by the producers, it must not block.
+ */
+typedef void (*staging_notify_cb_t)(void);
+
+/**
+ * @brief Drop counters of the staging rings
+ */
+typedef struct {
+    uint32_t ring_full;     /*!< Records dropped because the staging ring had no room */
+    uint32_t ring_busy;     /*!< Records dropped because every staging ring was in use */
+    uint32_t store_fail;    /*!< Staged records the data store did not accept */
+} staging_stats_t;
+
+/**
+ * @brief Initialize the staging rings
+ *
+ * @param[in] commit Callback used by the drainer to store the records
+ * @param[in] notify Callback used by the producers to wake up the drainer
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if a callback is NULL
+ */
+esp_err_t staging_init(staging_commit_cb_t commit, staging_notify_cb_t notify);
+
+/**
+ * @brief Stop accepting records
+ *
+ * Writers get ESP_ERR_INVALID_STATE from now on, the staged records can still be drained.
+ * Writers that started before may still be staging, see \ref staging_writing.
+ */
+void staging_stop(void);
+
+/**
+ * @brief Check for writers still staging a record
+ *
+ * @return true while a writer that started before \ref staging_stop may still call the notify callback
+ */
+bool staging_writing(void);
+
+/**
+ * @brief Discard the staged records and stop staging
+ */
+void staging_deinit(void);
+
+/**
+ * @brief Stage a record
+ *
+ * Never blocks: the producer claims a free ring with room for the record, starting with the
+ * ring at \a hint (e.g. the current core), copies the record, releases the ring and notifies
+ * the drainer. It never commits records itself.
+ *
+ * @param[in] hint Preferred ring
+ * @param[in] dg Data group for non critical data, NULL for critical data
+ * @param[in] data Record data
+ * @param[in] len Length of the record data
+ *
+ * @return ESP_OK if the record was staged,
+ *         ESP_ERR_INVALID_SIZE if it can never fit in a ring (caller may store it directly),
+ *         ESP_ERR_NO_MEM if it was dropped (counted in \ref staging_stats_t),
+ *         ESP_ERR_INVALID_STATE if staging is not initialized or stopped
+ */
+esp_err_t staging_write(unsigned hint, const char *dg, const void *data, size_t len);
+
+/**
+ * @brief Stage a record gathered from several segments
+ *
+ * Same as \ref staging_write, the segments are copied back to back into the ring.
+ *
+ * @param[in] hint Preferred ring
+ * @param[in] dg Data group for non critical data, NULL for critical data
+ * @param[in] iov Segments of the record
+ * @param[in] iovcnt Number of segments
+ *
+ * @return Same as \ref staging_write
+ */
+esp_err_t staging_writev(unsigned hint, const char *dg, const esp_diag_data_store_iov_t *iov, int iovcnt);
+
+/**
+ * @brief Commit the staged records into the data store
+ *
+ * Only one drainer runs at a time: if another task is draining, this returns immediately
+ * and that task picks up the new records.
+ *
+ * @return true if records are still staged, because the store was busy or another task is
+ *         draining: call again later. false if the rings are empty.
+ */
+bool staging_drain(void);
+
+/**
+ * @brief Get the drop counters
+ *
+ * @param[out] stats Drop counters since init
+ */
+void staging_get_stats(staging_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,15 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Minimal esp_event.h to include esp_diag_data_store.h on the host */
+#pragma once
+
+#include <stddef.h>
+#include "esp_err.h"
+
+typedef const char *esp_event_base_t;
+
+#define ESP_EVENT_DECLARE_BASE(id) extern esp_event_base_t const id
@@ -0,0 +1,359 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Host test of the flash log against a file-backed stand-in for the partition */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "flash_log.h"
+
+#define SECTOR_SIZE     512
+#define SECTORS         4
+#define CRITICAL        0
+#define NON_CRITICAL    1
+
+#define TEST_ASSERT(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d: assertion failed: %s\n", __FILE__, __LINE__, #cond); \
+        exit(1); \
+    } \
+} while (0)
+
+/* Partition in a temporary file, with NOR flash semantics and simulated power loss */
+typedef struct {
+    FILE *file;
+    unsigned erase_count[SECTORS];
+    long write_budget;          // bytes that can be programmed before "power loss", -1 for no limit
+} part_file_t;
+
+static esp_err_t part_read(void *ctx, size_t offset, void *buf, size_t len)
+{
+    part_file_t *p = ctx;
+    TEST_ASSERT(offset + len <= SECTOR_SIZE * SECTORS);
+    TEST_ASSERT(pread(fileno(p->file), buf, len, offset) == (ssize_t) len);
+    return ESP_OK;
+}
+
+static esp_err_t part_write(void *ctx, size_t offset, const void *buf, size_t len)
+{
+    part_file_t *p = ctx;
+    uint8_t old[SECTOR_SIZE];
+    const uint8_t *data = buf;
+    esp_err_t err = ESP_OK;
+
+    TEST_ASSERT(offset + len <= SECTOR_SIZE * SECTORS && len <= SECTOR_SIZE);
+    if (p->write_budget >= 0 && (long) len > p->write_budget) {
+        len = p->write_budget;
+        err = ESP_FAIL;
+    }
+    if (p->write_budget >= 0) {
+        p->write_budget -= len;
+    }
+    part_read(ctx, offset, old, len);
+    for (size_t i = 0; i < len; i++) {
+        // programming can only clear bits
+        TEST_ASSERT((old[i] & data[i]) == data[i]);
+        old[i] &= data[i];
+    }
+    TEST_ASSERT(pwrite(fileno(p->file), old, len, offset) == (ssize_t) len);
+    return err;
+}
+
+static esp_err_t part_erase(void *ctx, size_t offset, size_t len)
+{
+    part_file_t *p = ctx;
+    uint8_t erased[SECTOR_SIZE];
+
+    TEST_ASSERT(offset % SECTOR_SIZE == 0 && len % SECTOR_SIZE == 0);
+    memset(erased, 0xff, sizeof(erased));
+    for (size_t s = offset; s < offset + len; s += SECTOR_SIZE) {
+        TEST_ASSERT(pwrite(fileno(p->file), erased, SECTOR_SIZE, s) == SECTOR_SIZE);
+        p->erase_count[s / SECTOR_SIZE]++;
+    }
+    return ESP_OK;
+}
+
+static part_file_t s_file;
+
+static flash_log_part_t part_open(void)
+{
+    memset(&s_file, 0, sizeof(s_file));
+    s_file.file = tmpfile();
+    s_file.write_budget = -1;
+    TEST_ASSERT(s_file.file);
+    // a new chip holds random data, not an erased log
+    uint8_t junk[SECTOR_SIZE * SECTORS];
+    for (size_t i = 0; i < sizeof(junk); i++) {
+        junk[i] = (uint8_t) rand();
+    }
+    TEST_ASSERT(fwrite(junk, 1, sizeof(junk), s_file.file) == sizeof(junk));
+    fflush(s_file.file);
+
+    flash_log_part_t part = {
+        .read = part_read,
+        .write = part_write,
+        .erase = part_erase,
+        .ctx = &s_file,
+        .size = SECTOR_SIZE * SECTORS,
+        .sector_size = SECTOR_SIZE,
+    };
+    return part;
+}
+
+static void part_close(void)
+{
+    fclose(s_file.file);
+}
+
+/* Records are a 1 byte prefix followed by a sequence number and a fill of varying length */
+static esp_err_t append(flash_log_t *log, uint8_t type, uint32_t seq)
+{
+    uint8_t prefix = type;
+    uint8_t data[4 + 40];
+    size_t len = 4 + seq % 40;
+    memcpy(data, &seq, 4);
+    for (size_t i = 4; i < len; i++) {
+        data[i] = (uint8_t) (seq + i);
+    }
+    esp_diag_data_store_iov_t iov[] = {
+        { .base = &prefix, .len = 1 },
+        { .base = data, .len = len },
+    };
+    return flash_log_append(log, type, seq, iov, 2);
+}
+
+/* Check the records in buf, returning their count and the sequence number of the first one */
+static int check_records(const uint8_t *buf, int len, uint8_t type, uint32_t *first, uint32_t *last)
+{
+    int count = 0;
+    for (int off = 0; off < len; count++) {
+        uint32_t seq;
+        TEST_ASSERT(buf[off] == type);
+        memcpy(&seq, buf + off + 1, 4);
+        size_t rec_len = 1 + 4 + seq % 40;
+        TEST_ASSERT(off + (int) rec_len <= len);
+        for (size_t i = 5; i < rec_len; i++) {
+            TEST_ASSERT(buf[off + i] == (uint8_t) (seq + i - 1));
+        }
+        if (count == 0) {
+            *first = seq;
+        } else {
+            TEST_ASSERT(seq > *last);
+        }
+        *last = seq;
+        off += rec_len;
+    }
+    return count;
+}
+
+static void test_read_release(void)
+{
+    flash_log_t log;
+    flash_log_part_t part = part_open();
+    uint8_t buf[256];
+    uint32_t first, last;
+
+    TEST_ASSERT(flash_log_mount(&log, &part) == ESP_OK);
+    TEST_ASSERT(flash_log_unread(&log, CRITICAL) == 0);
+    TEST_ASSERT(flash_log_read(&log, CRITICAL, NULL, NULL, buf, sizeof(buf)) == 0);
+
+    // interleaved types, odd sequence numbers are critical
+    for (uint32_t seq = 0; seq < 20; seq++) {
+        TEST_ASSERT(append(&log, seq & 1 ? CRITICAL : NON_CRITICAL, seq) == ESP_OK);
+    }
+    TEST_ASSERT(flash_log_unread(&log, CRITICAL) == 10);
+    TEST_ASSERT(flash_log_unread(&log, NON_CRITICAL) == 10);
+
+    // reads return whole records of the type, oldest first, and do not consume them
+    int len = flash_log_read(&log, CRITICAL, NULL, NULL, buf, 100);
+    TEST_ASSERT(len > 0 && len <= 100);
+    int count = check_records(buf, len, CRITICAL, &first, &last);
+    TEST_ASSERT(first == 1 && count >= 2);
+    TEST_ASSERT(flash_log_read(&log, CRITICAL, NULL, NULL, buf, 100) == len);
+
+    // release all but the last record read, and part of it
+    uint32_t seq_last = last;
+    TEST_ASSERT(flash_log_release(&log, CRITICAL, len - 1) == ESP_OK);
+    TEST_ASSERT(flash_log_unread(&log, CRITICAL) == (uint32_t) (10 - (count - 1)));
+    len = flash_log_read(&log, CRITICAL, NULL, NULL, buf, sizeof(buf));
+    check_records(buf, len, CRITICAL, &first, &last);
+    TEST_ASSERT(first == seq_last);
+
+    // a remount finds the same unread records and appends after them
+    TEST_ASSERT(flash_log_mount(&log, &part) == ESP_OK);
+    TEST_ASSERT(flash_log_unread(&log, CRITICAL) == (uint32_t) (10 - (count - 1)));
+    TEST_ASSERT(flash_log_unread(&log, NON_CRITICAL) == 10);
+    len = flash_log_read(&log, CRITICAL, NULL, NULL, buf, sizeof(buf));
+    check_records(buf, len, CRITICAL, &first, &last);
+    TEST_ASSERT(first == seq_last);
+    TEST_ASSERT(append(&log, CRITICAL, 21) == ESP_OK);
+
+    // drain everything
+    uint32_t next[2] = { 1, 0 };
+    for (uint8_t type = 0; type < 2; type++) {
+        while ((len = flash_log_read(&log, type, NULL, NULL, buf, sizeof(buf))) > 0) {
+            check_records(buf, len, type, &first, &last);
+            TEST_ASSERT(first >= next[type]);
+            next[type] = last + 1;
+            TEST_ASSERT(flash_log_release(&log, type, len) == ESP_OK);
+        }
+        TEST_ASSERT(flash_log_unread(&log, type) == 0);
+    }
+    TEST_ASSERT(next[CRITICAL] == 22 && next[NON_CRITICAL] == 19);
+
+    // oversized records are rejected
+    uint8_t big[SECTOR_SIZE] = { 0 };
+    esp_diag_data_store_iov_t iov = { .base = big, .len = sizeof(big) };
+    TEST_ASSERT(flash_log_append(&log, CRITICAL, 0, &iov, 1) == ESP_ERR_INVALID_SIZE);
+    iov.len = 1;
+    TEST_ASSERT(flash_log_append(&log, 2, 0, &iov, 1) == ESP_ERR_INVALID_ARG);
+
+    // format drops everything, also across a remount
+    TEST_ASSERT(append(&log, NON_CRITICAL, 30) == ESP_OK);
+    TEST_ASSERT(flash_log_format(&log) == ESP_OK);
+    TEST_ASSERT(flash_log_unread(&log, NON_CRITICAL) == 0);
+    TEST_ASSERT(flash_log_mount(&log, &part) == ESP_OK);
+    TEST_ASSERT(flash_log_unread(&log, NON_CRITICAL) == 0);
+    part_close();
+}
+
+static void test_overwrite_and_wear(void)
+{
+    flash_log_t log;
+    flash_log_part_t part = part_open();
+    uint8_t buf[SECTOR_SIZE * SECTORS];
+    uint32_t first, last, seq;
+
+    // without readers, the oldest records are evicted
+    TEST_ASSERT(flash_log_mount(&log, &part) == ESP_OK);
+    for (seq = 0; seq < 1000; seq++) {
+        TEST_ASSERT(append(&log, CRITICAL, seq) == ESP_OK);
+    }
+    TEST_ASSERT(log.dropped[CRITICAL] > 0);
+    TEST_ASSERT(flash_log_unread(&log, CRITICAL) + log.dropped[CRITICAL] == 1000);
+
+    // what is left is the newest records, in order, without gaps
+    int len = flash_log_read(&log, CRITICAL, NULL, NULL, buf, sizeof(buf));
+    int count = check_records(buf, len, CRITICAL, &first, &last);
+    TEST_ASSERT((uint32_t) count == flash_log_unread(&log, CRITICAL));
+    TEST_ASSERT(last == 999 && last - first + 1 == (uint32_t) count);
+
+    // and it survives a remount
+    TEST_ASSERT(flash_log_mount(&log, &part) == ESP_OK);
+    TEST_ASSERT(flash_log_unread(&log, CRITICAL) == (uint32_t) count);
+
+    // a producer and a consumer that keeps up: nothing is dropped, sectors wear evenly
+    TEST_ASSERT(flash_log_release(&log, CRITICAL, len) == ESP_OK);
+    memset(s_file.erase_count, 0, sizeof(s_file.erase_count));
+    uint32_t expected = seq;
+    for (int round = 0; round < 500; round++) {
+        for (int i = 0; i < 5; i++, seq++) {
+            TEST_ASSERT(append(&log, round & 1 ? CRITICAL : NON_CRITICAL, seq) == ESP_OK);
+        }
+        uint8_t type = round & 1 ? CRITICAL : NON_CRITICAL;
+        len = flash_log_read(&log, type, NULL, NULL, buf, sizeof(buf));
+        TEST_ASSERT(check_records(buf, len, type, &first, &last) == 5);
+        TEST_ASSERT(first == expected && last == expected + 4);
+        expected += 5;
+        TEST_ASSERT(flash_log_release(&log, type, len) == ESP_OK);
+    }
+    TEST_ASSERT(log.dropped[NON_CRITICAL] == 0);
+    unsigned min = UINT32_MAX, max = 0;
+    for (int i = 0; i < SECTORS; i++) {
+        min = s_file.erase_count[i] < min ? s_file.erase_count[i] : min;
+        max = s_file.erase_count[i] > max ? s_file.erase_count[i] : max;
+    }
+    TEST_ASSERT(min > 10 && max - min <= 1);
+    part_close();
+}
+
+/* Records of an odd sequence number are stale, like those of a boot whose meta record was reused */
+static bool keep_even(void *ctx, uint32_t tag)
+{
+    (*(int *) ctx)++;
+    return !(tag & 1);
+}
+
+static void test_tag(void)
+{
+    flash_log_t log;
+    flash_log_part_t part = part_open();
+    uint8_t buf[SECTOR_SIZE];
+    uint32_t first, last;
+    int checked = 0;
+
+    TEST_ASSERT(flash_log_mount(&log, &part) == ESP_OK);
+    for (uint32_t seq = 0; seq < 20; seq++) {
+        TEST_ASSERT(append(&log, CRITICAL, seq) == ESP_OK);
+    }
+    // the tag survives a remount, stale records are dropped on read and never released by the reader
+    TEST_ASSERT(flash_log_mount(&log, &part) == ESP_OK);
+    int len = flash_log_read(&log, CRITICAL, keep_even, &checked, buf, sizeof(buf));
+    TEST_ASSERT(check_records(buf, len, CRITICAL, &first, &last) == 10);
+    TEST_ASSERT(first == 0 && last == 18 && checked == 20);
+    TEST_ASSERT(flash_log_unread(&log, CRITICAL) == 10 && log.dropped[CRITICAL] == 10);
+    TEST_ASSERT(flash_log_release(&log, CRITICAL, len) == ESP_OK);
+    TEST_ASSERT(flash_log_unread(&log, CRITICAL) == 0);
+    TEST_ASSERT(flash_log_mount(&log, &part) == ESP_OK);
+    TEST_ASSERT(flash_log_unread(&log, CRITICAL) == 0);
+    part_close();
+}
+
+static void test_power_loss(void)
+{
+    flash_log_t log;
+    flash_log_part_t part = part_open();
+    uint8_t buf[SECTOR_SIZE];
+    uint32_t first, last;
+
+    // cut the power at every byte of a record's write
+    for (long budget = 0; budget < 16 + 1 + 4 + 5; budget++) {
+        TEST_ASSERT(flash_log_mount(&log, &part) == ESP_OK);
+        TEST_ASSERT(flash_log_format(&log) == ESP_OK);
+        TEST_ASSERT(append(&log, CRITICAL, 0) == ESP_OK);
+        s_file.write_budget = budget;
+        TEST_ASSERT(append(&log, CRITICAL, 5) == ESP_FAIL);
+        s_file.write_budget = -1;
+
+        // the torn record is never read back, the log keeps working
+        TEST_ASSERT(flash_log_mount(&log, &part) == ESP_OK);
+        TEST_ASSERT(flash_log_unread(&log, CRITICAL) == 1);
+        TEST_ASSERT(append(&log, CRITICAL, 6) == ESP_OK);
+        TEST_ASSERT(flash_log_mount(&log, &part) == ESP_OK);
+        int len = flash_log_read(&log, CRITICAL, NULL, NULL, buf, sizeof(buf));
+        TEST_ASSERT(check_records(buf, len, CRITICAL, &first, &last) == 2);
+        TEST_ASSERT(first == 0 && last == 6);
+    }
+
+    // losing power while releasing leaves the record either read or unread
+    for (long budget = 0; budget < 4; budget++) {
+        TEST_ASSERT(flash_log_format(&log) == ESP_OK);
+        TEST_ASSERT(append(&log, NON_CRITICAL, 1) == ESP_OK);
+        TEST_ASSERT(append(&log, NON_CRITICAL, 2) == ESP_OK);
+        int len = flash_log_read(&log, NON_CRITICAL, NULL, NULL, buf, 1 + 4 + 1);
+        s_file.write_budget = budget;
+        TEST_ASSERT(flash_log_release(&log, NON_CRITICAL, len) == ESP_FAIL);
+        s_file.write_budget = -1;
+        TEST_ASSERT(flash_log_mount(&log, &part) == ESP_OK);
+        len = flash_log_read(&log, NON_CRITICAL, NULL, NULL, buf, sizeof(buf));
+        int count = check_records(buf, len, NON_CRITICAL, &first, &last);
+        TEST_ASSERT(last == 2 && (budget == 0 ? count == 2 : count == 1));
+    }
+    part_close();
+}
+
+int main(void)
+{
+    test_read_release();
+    test_overwrite_and_wear();
+    test_tag();
+    test_power_loss();
+    printf("test_flash_log: OK\n");
+    return 0;
+}
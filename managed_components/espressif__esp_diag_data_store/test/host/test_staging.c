@@ -0,0 +1,214 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Host stress test of the staging rings: many producer threads, a reader draining concurrently */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include "staging.h"
+
+#define PRODUCERS           16
+#define RECORDS             20000
+#define STORE_FAIL_EVERY    97      // the store rejects some records, like a full RTC buffer
+#define STORE_BUSY_EVERY    13      // the store is busy on some commits, like a reader holding its lock
+#define MAX_PAYLOAD         120
+
+#define TEST_ASSERT(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d: assertion failed: %s\n", __FILE__, __LINE__, #cond); \
+        exit(1); \
+    } \
+} while (0)
+
+typedef struct {
+    uint16_t producer;
+    uint16_t len;       // length of fill
+    uint32_t seq;
+    uint8_t fill[MAX_PAYLOAD];
+} record_t;
+
+static const char *s_dg = "test";
+static uint8_t s_seen[PRODUCERS][RECORDS];
+static atomic_uint s_committed, s_rejected, s_staged, s_dropped, s_busy, s_notified;
+static atomic_bool s_done;
+static atomic_int s_in_commit;
+
+static uint8_t fill_byte(const record_t *rec, int i)
+{
+    return (uint8_t) (rec->producer * 31 + rec->seq * 7 + i);
+}
+
+static esp_err_t commit(const char *dg, void *data, size_t len)
+{
+    record_t rec;
+
+    // a single drainer at a time
+    TEST_ASSERT(atomic_fetch_add(&s_in_commit, 1) == 0);
+    TEST_ASSERT(len >= offsetof(record_t, fill) && len <= sizeof(rec));
+    memcpy(&rec, data, len);
+    TEST_ASSERT(rec.producer < PRODUCERS && rec.seq < RECORDS);
+    TEST_ASSERT(len == offsetof(record_t, fill) + rec.len);
+    // producers with odd ids write critical data
+    TEST_ASSERT((rec.producer & 1) ? dg == NULL : dg == s_dg);
+    for (int i = 0; i < rec.len; i++) {
+        TEST_ASSERT(rec.fill[i] == fill_byte(&rec, i));
+    }
+    TEST_ASSERT(s_seen[rec.producer][rec.seq] == 1);   // staged once, committed once
+    atomic_fetch_sub(&s_in_commit, 1);
+
+    // a busy store keeps the record staged, it is committed again later
+    if (atomic_fetch_add(&s_busy, 1) % STORE_BUSY_EVERY == 0) {
+        return ESP_ERR_TIMEOUT;
+    }
+    s_seen[rec.producer][rec.seq] = 2;
+
+    if (rec.seq % STORE_FAIL_EVERY == 0) {
+        atomic_fetch_add(&s_rejected, 1);
+        return ESP_ERR_NO_MEM;
+    }
+    atomic_fetch_add(&s_committed, 1);
+    return ESP_OK;
+}
+
+static void notify(void)
+{
+    atomic_fetch_add(&s_notified, 1);
+}
+
+static void *producer(void *arg)
+{
+    unsigned id = (uintptr_t) arg;
+    record_t rec = {
+        .producer = id,
+    };
+
+    for (uint32_t seq = 0; seq < RECORDS; seq++) {
+        rec.seq = seq;
+        rec.len = (id + seq) % MAX_PAYLOAD;
+        for (int i = 0; i < rec.len; i++) {
+            rec.fill[i] = fill_byte(&rec, i);
+        }
+        // the record can only be seen by the drainer once staged, mark it first
+        s_seen[id][seq] = 1;
+        esp_err_t err = staging_write(id, (id & 1) ? NULL : s_dg, &rec, offsetof(record_t, fill) + rec.len);
+        if (err == ESP_OK) {
+            atomic_fetch_add(&s_staged, 1);
+        } else {
+            TEST_ASSERT(err == ESP_ERR_NO_MEM);
+            s_seen[id][seq] = 0;
+            atomic_fetch_add(&s_dropped, 1);
+        }
+        // like the notified drain task getting scheduled
+        sched_yield();
+    }
+    return NULL;
+}
+
+static void *reader(void *arg)
+{
+    (void) arg;
+    while (!atomic_load(&s_done)) {
+        staging_drain();
+    }
+    return NULL;
+}
+
+static void test_api(void)
+{
+    uint8_t big[8192] = { 0 };
+    staging_stats_t stats;
+
+    TEST_ASSERT(staging_write(0, NULL, big, 10) == ESP_ERR_INVALID_STATE);
+    TEST_ASSERT(staging_init(NULL, notify) == ESP_ERR_INVALID_ARG);
+    TEST_ASSERT(staging_init(commit, NULL) == ESP_ERR_INVALID_ARG);
+    TEST_ASSERT(staging_init(commit, notify) == ESP_OK);
+    // does not fit in a ring, the caller writes it directly
+    TEST_ASSERT(staging_write(0, NULL, big, sizeof(big)) == ESP_ERR_INVALID_SIZE);
+    staging_get_stats(&stats);
+    TEST_ASSERT(stats.ring_full == 0 && stats.ring_busy == 0 && stats.store_fail == 0);
+    staging_deinit();
+
+    // once stopped, nothing is staged or notified, but what was staged can still be drained
+    record_t rec = {
+        .producer = 0,
+        .seq = 0,
+    };
+    memset(s_seen, 0, sizeof(s_seen));
+    TEST_ASSERT(staging_init(commit, notify) == ESP_OK);
+    s_seen[0][0] = 1;
+    TEST_ASSERT(staging_write(0, s_dg, &rec, offsetof(record_t, fill)) == ESP_OK);
+    staging_stop();
+    TEST_ASSERT(!staging_writing());
+    unsigned notified = atomic_load(&s_notified);
+    TEST_ASSERT(staging_write(0, s_dg, &rec, offsetof(record_t, fill)) == ESP_ERR_INVALID_STATE);
+    TEST_ASSERT(staging_write(0, NULL, big, sizeof(big)) == ESP_ERR_INVALID_STATE);
+    TEST_ASSERT(atomic_load(&s_notified) == notified);
+    while (staging_drain()) {
+    }
+    TEST_ASSERT(s_seen[0][0] == 2);
+    staging_deinit();
+    atomic_store(&s_committed, 0);
+    atomic_store(&s_busy, 0);
+    atomic_store(&s_rejected, 0);
+    atomic_store(&s_notified, 0);
+}
+
+static void test_stress(void)
+{
+    pthread_t threads[PRODUCERS], drain_thread;
+    staging_stats_t stats;
+
+    memset(s_seen, 0, sizeof(s_seen));
+    TEST_ASSERT(staging_init(commit, notify) == ESP_OK);
+    pthread_create(&drain_thread, NULL, reader, NULL);
+    for (uintptr_t i = 0; i < PRODUCERS; i++) {
+        pthread_create(&threads[i], NULL, producer, (void *) i);
+    }
+    for (int i = 0; i < PRODUCERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    atomic_store(&s_done, true);
+    pthread_join(drain_thread, NULL);
+    while (staging_drain()) {
+    }
+    // producers never drain, every write wakes up the drainer
+    TEST_ASSERT(atomic_load(&s_notified) == PRODUCERS * RECORDS);
+
+    // every staged record was committed exactly once, intact
+    unsigned staged = 0;
+    for (int p = 0; p < PRODUCERS; p++) {
+        for (int s = 0; s < RECORDS; s++) {
+            TEST_ASSERT(s_seen[p][s] != 1);
+            staged += s_seen[p][s] == 2;
+        }
+    }
+    TEST_ASSERT(staged == atomic_load(&s_staged));
+    TEST_ASSERT(atomic_load(&s_committed) + atomic_load(&s_rejected) == staged);
+    TEST_ASSERT(staged + atomic_load(&s_dropped) == PRODUCERS * RECORDS);
+
+    // every drop is accounted for
+    staging_get_stats(&stats);
+    TEST_ASSERT(stats.ring_full + stats.ring_busy == atomic_load(&s_dropped));
+    TEST_ASSERT(stats.store_fail == atomic_load(&s_rejected));
+    printf("%d producers, %d records: %u committed, %u rejected by the store, "
+           "%u dropped (ring full %u, all rings busy %u)\n",
+           PRODUCERS, PRODUCERS * RECORDS, atomic_load(&s_committed), stats.store_fail,
+           atomic_load(&s_dropped), stats.ring_full, stats.ring_busy);
+    staging_deinit();
+}
+
+int main(void)
+{
+    test_api();
+    test_stress();
+    printf("test_staging: OK\n");
+    return 0;
+}
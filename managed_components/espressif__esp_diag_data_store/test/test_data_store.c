@@ -13,6 +13,8 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <esp_random.h>
+#include <esp_timer.h>
+#include <inttypes.h>
 
 #define TAG              "diag_data_store_UT"
 #define NVS_KEY_B1_CHARS "b1_chars"
@@ -213,6 +215,120 @@ TEST_CASE("data store write read release_zero read release_zero release_all", "[
     nvs_flash_deinit();
 }
 
+TEST_CASE("data store writev wrapped", "[data-store]")
+{
+    size_t len = 0;
+    uint8_t seg[3][20];
+    esp_diag_data_store_iov_t iov[3];
+
+    /* diag data store init */
+    init_nvs_flash();
+    assert(rtc_store_init() == ESP_OK);
+
+    ESP_LOGI(TAG, "Writev invalid arguments");
+    TEST_ASSERT(rtc_store_critical_data_writev(NULL, 1) == ESP_ERR_INVALID_ARG);
+    TEST_ASSERT(rtc_store_critical_data_writev(iov, 0) == ESP_ERR_INVALID_ARG);
+    TEST_ASSERT(rtc_store_critical_data_writev(iov, ESP_DIAG_DATA_STORE_IOV_MAX + 1) == ESP_ERR_INVALID_ARG);
+
+    /* Move the write offset close to the end so that the record wraps inside the segments */
+    memset(data, 0, CONFIG_RTC_STORE_CRITICAL_DATA_SIZE);
+    TEST_ASSERT(rtc_store_critical_data_write(data, CONFIG_RTC_STORE_CRITICAL_DATA_SIZE - 30) == ESP_OK);
+    TEST_ASSERT(rtc_store_critical_data_release(CONFIG_RTC_STORE_CRITICAL_DATA_SIZE - 29) == ESP_OK);
+
+    for (int i = 0; i < 3; i++) {
+        memset(seg[i], 'a' + i, sizeof(seg[i]));
+        iov[i].base = seg[i];
+        iov[i].len = sizeof(seg[i]);
+    }
+    TEST_ASSERT(rtc_store_critical_data_writev(iov, 3) == ESP_OK);
+
+    /* Read back as a single record, meta index byte followed by the segments */
+    len = rtc_store_critical_data_read(data, READ_DATA_SIZE);
+    TEST_ASSERT(len == 1 + sizeof(seg) + s_sha_off);
+    TEST_ASSERT(memcmp(data + s_sha_off + 1, seg, sizeof(seg)) == 0);
+    TEST_ASSERT(rtc_store_critical_data_release(len) == ESP_OK);
+
+    /* data store deinit */
+    rtc_store_deinit();
+    nvs_flash_deinit();
+}
+
+TEST_CASE("data store time base", "[data-store]")
+{
+    const uint64_t base = 1700000000000000ULL;
+    uint8_t prev_idx;
+
+    /* diag data store init */
+    init_nvs_flash();
+    assert(rtc_store_init() == ESP_OK);
+
+    ESP_LOGI(TAG, "First timestamp of the boot becomes the time base");
+    TEST_ASSERT(rtc_store_get_meta_time_base(base) == base);
+    TEST_ASSERT(rtc_store_get_meta_time_base(base + 1000) == base);
+    TEST_ASSERT(rtc_store_get_meta_record_current()->time_base == base);
+    prev_idx = rtc_store_get_meta_record_current_index();
+    rtc_store_deinit();
+
+    ESP_LOGI(TAG, "Next boot gets its own time base, previous one is kept");
+    assert(rtc_store_init() == ESP_OK);
+    TEST_ASSERT(rtc_store_get_meta_record_current_index() != prev_idx);
+    TEST_ASSERT(rtc_store_get_meta_time_base(base + 2000) == base + 2000);
+    TEST_ASSERT(rtc_store_get_meta_record_by_index(prev_idx)->time_base == base);
+
+    /* data store deinit */
+    rtc_store_deinit();
+    nvs_flash_deinit();
+}
+
+TEST_CASE("data store write writev throughput", "[data-store-perf]")
+{
+    const size_t sizes[] = {16, 32, 64, 128, 256};
+    const int count = 1000;
+    uint8_t hdr[8], body[256], staged[272];
+    uint64_t ts = 0;
+
+    /* diag data store init */
+    init_nvs_flash();
+    assert(rtc_store_init() == ESP_OK);
+
+    memset(hdr, 'h', sizeof(hdr));
+    memset(body, 'b', sizeof(body));
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t body_len = sizes[s] - sizeof(hdr) - sizeof(ts);
+
+        /* Record staged in a contiguous buffer first, as the write callbacks do */
+        int64_t start = esp_timer_get_time();
+        for (int i = 0; i < count; i++) {
+            memcpy(staged, hdr, sizeof(hdr));
+            memcpy(staged + sizeof(hdr), &ts, sizeof(ts));
+            memcpy(staged + sizeof(hdr) + sizeof(ts), body, body_len);
+            TEST_ASSERT(rtc_store_critical_data_write(staged, sizes[s]) == ESP_OK);
+            TEST_ASSERT(rtc_store_critical_data_release(sizes[s] + 1) == ESP_OK);
+        }
+        int64_t write_us = esp_timer_get_time() - start;
+
+        /* Same record gathered from its segments */
+        start = esp_timer_get_time();
+        for (int i = 0; i < count; i++) {
+            esp_diag_data_store_iov_t iov[3] = {
+                { .base = hdr, .len = sizeof(hdr) },
+                { .base = &ts, .len = sizeof(ts) },
+                { .base = body, .len = body_len },
+            };
+            TEST_ASSERT(rtc_store_critical_data_writev(iov, 3) == ESP_OK);
+            TEST_ASSERT(rtc_store_critical_data_release(sizes[s] + 1) == ESP_OK);
+        }
+        int64_t writev_us = esp_timer_get_time() - start;
+
+        ESP_LOGI(TAG, "record %3u bytes: write %" PRId64 " writes/s, writev %" PRId64 " writes/s", (unsigned) sizes[s],
+                 (int64_t) count * 1000000 / write_us, (int64_t) count * 1000000 / writev_us);
+    }
+
+    /* data store deinit */
+    rtc_store_deinit();
+    nvs_flash_deinit();
+}
+
 static char *nvs_read_chars(size_t *len, uint32_t bank)
 {
     nvs_handle_t handle;
@@ -195,6 +195,94 @@ typedef struct {
     } value;
 } esp_diag_str_data_pt_t;
 
+/**
+ * @brief Flag set in the first byte of a compact data point
+ *
+ * The first byte of \ref esp_diag_data_pt_t and \ref esp_diag_str_data_pt_t is the low byte of the point type,
+ * which never has this bit set.
+ */
+#define ESP_DIAG_COMPACT_PT_FLAG        0x80
+
+/**
+ * @brief Maximum length of an encoded compact data point
+ */
+#define ESP_DIAG_COMPACT_PT_MAX_SZ      (3 + 10 + sizeof(((esp_diag_str_data_pt_t *)0)->value.str))
+
+/**
+ * @brief Timestamps from this value on are wall clock time, smaller ones are time since bootup
+ */
+#define ESP_DIAG_COMPACT_PT_WALL_CLOCK  (1ULL << 40)
+
+/**
+ * @brief Compact data point
+ *
+ * Variable length form of \ref esp_diag_data_pt_t and \ref esp_diag_str_data_pt_t that refers to the metric or
+ * variable by its position in the registry instead of its tag and key. It is encoded as
+ *   Header  - 1 byte      - ESP_DIAG_COMPACT_PT_FLAG, variable (bit 6), relative timestamp (bit 5), data type
+ *   Index   - 1 byte      - Position of the metric or variable in the registry
+ *   Check   - 1 byte      - \ref esp_diag_compact_pt_check of the tag and key, points with a stale index are dropped
+ *   ts      - 1-10 bytes  - Timestamp, or the zigzag encoded difference to the time base, as a varint
+ *   Value   - 1-32 bytes  - Sized by the data type, strings are prefixed by their length
+ */
+typedef struct {
+    uint16_t type;          /*!< Metrics or Variable */
+    uint16_t data_type;     /*!< Data type */
+    uint8_t index;          /*!< Position of the metric or variable in the registry */
+    uint8_t check;          /*!< Check of the tag and key */
+    bool ts_relative;       /*!< ts is relative to the time base of the boot the point was recorded in */
+    int64_t ts;             /*!< Timestamp, or difference to the time base */
+    union {
+        bool b;             /*!< Value for boolean data type */
+        int32_t i;          /*!< Value for integer data type */
+        uint32_t u;         /*!< Value for unsigned integer data type */
+        float f;            /*!< Value for float data type */
+        uint32_t ipv4;      /*!< Value for the IPv4 address */
+        uint8_t mac[6];     /*!< Value for the MAC address */
+        char str[32];       /*!< Value for string data type, NULL terminated */
+    } value;
+} esp_diag_compact_pt_t;
+
+/**
+ * @brief Callback to get the time base for compact data points
+ *
+ * @param[in] ts     Timestamp of the data point, used as the time base if none is set for the current boot
+ * @param[in] cb_arg User data to pass in callback function
+ *
+ * @return Time base of the current boot, 0 if there is none
+ */
+typedef uint64_t (*esp_diag_time_base_cb_t)(uint64_t ts, void *cb_arg);
+
+/**
+ * @brief Encode a compact data point
+ *
+ * @param[in]  pt   Data point
+ * @param[out] buf  Buffer of at least ESP_DIAG_COMPACT_PT_MAX_SZ bytes
+ *
+ * @return Length of the encoded data point, 0 if the data type is not supported
+ */
+size_t esp_diag_compact_pt_encode(const esp_diag_compact_pt_t *pt, uint8_t *buf);
+
+/**
+ * @brief Decode a compact data point
+ *
+ * @param[in]  buf  Encoded data point
+ * @param[in]  len  Length of the encoded data point
+ * @param[out] pt   Decoded data point
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if buf does not hold a valid compact data point.
+ */
+esp_err_t esp_diag_compact_pt_decode(const uint8_t *buf, size_t len, esp_diag_compact_pt_t *pt);
+
+/**
+ * @brief Check value of a tag and key pair, stored in compact data points
+ *
+ * @param[in] tag Tag of the metric or variable
+ * @param[in] key Key of the metric or variable
+ *
+ * @return check value
+ */
+uint8_t esp_diag_compact_pt_check(const char *tag, const char *key);
+
 /**
  * @brief Initialize diagnostics log hook
  *
@@ -25,12 +25,36 @@ extern "C"
  */
 typedef esp_err_t (*esp_diag_metrics_write_cb_t)(const char *tag, void *data, size_t len, void *cb_arg);
 
+/**
+ * @brief Segment of a metrics record
+ */
+typedef struct {
+    const void *base;   /*!< Start of the segment */
+    size_t len;         /*!< Length of the segment */
+} esp_diag_metrics_iov_t;
+
+/**
+ * @brief Callback to write metrics data gathered from several segments
+ *
+ * The concatenation of the segments is laid out exactly as the record passed to \ref esp_diag_metrics_write_cb_t.
+ *
+ * @param[in] tag   Tag for metrics
+ * @param[in] iov   Segments of metrics data
+ * @param[in] iovcnt Number of segments
+ * @param[in] cb_arg User data to pass in write callback
+ */
+typedef esp_err_t (*esp_diag_metrics_writev_cb_t)(const char *tag, const esp_diag_metrics_iov_t *iov, int iovcnt,
+                                                  void *cb_arg);
+
 /**
  * @brief Diagnostics metrics config structure
  */
 typedef struct {
     esp_diag_metrics_write_cb_t write_cb; /*!< Callback function to write diagnostics data */
     void *cb_arg;                         /*!< User data to pass in callback function */
+    esp_diag_metrics_writev_cb_t writev_cb; /*!< Optional, used instead of write_cb if set */
+    bool compact;                         /*!< Write \ref esp_diag_compact_pt_t records through write_cb */
+    esp_diag_time_base_cb_t time_base_cb; /*!< Optional, time base for the timestamps of compact records */
 } esp_diag_metrics_config_t;
 
 /**
@@ -46,6 +70,14 @@ typedef struct {
     esp_diag_data_type_t type; /*!< Data type of metrics */
 } esp_diag_metrics_meta_t;
 
+/**
+ * @brief Handle of a registered metrics, see \ref esp_diag_metrics_register_h
+ *
+ * A handle stays valid until its metrics is unregistered, other metrics may be registered and unregistered
+ * meanwhile. 0 is never a valid handle.
+ */
+typedef uint32_t esp_diag_metrics_handle_t;
+
 /**
  * @brief Initialize the diagnostics metrics
  *
@@ -79,6 +111,111 @@ esp_err_t esp_diag_metrics_register(const char *tag,
                                     const char *path,
                                     esp_diag_data_type_t type);
 
+/**
+ * @brief Register a metrics and get a handle to report it with
+ *
+ * Reporting through the handle, with the esp_diag_metrics_report_*_h APIs, skips the lookup of tag and key.
+ *
+ * @param[in]  tag    Tag of metrics
+ * @param[in]  key    Unique key for the metrics
+ * @param[in]  label  Label for the metrics
+ * @param[in]  path   Hierarchical path for key, must be separated by '.' for more than one level
+ * @param[in]  type   Data type of metrics
+ * @param[out] handle Handle of the metrics, can be NULL
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_metrics_register_h(const char *tag,
+                                      const char *key,
+                                      const char *label,
+                                      const char *path,
+                                      esp_diag_data_type_t type,
+                                      esp_diag_metrics_handle_t *handle);
+
+/**
+ * @brief Add metrics to storage by handle
+ *
+ * @param[in] handle    Handle of the metrics, from \ref esp_diag_metrics_register_h
+ * @param[in] data_type Data type of metrics \ref esp_diag_data_type_t
+ * @param[in] val       Value of metrics
+ * @param[in] val_sz    Size of val
+ * @param[in] ts        Timestamp in microseconds, this should be the value at the time of data gathering
+ *
+ * @return ESP_OK if successful, ESP_ERR_NOT_FOUND if the handle is stale, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_metrics_report_h(esp_diag_metrics_handle_t handle, esp_diag_data_type_t data_type,
+                                    const void *val, size_t val_sz, uint64_t ts);
+
+/**
+ * @brief Add the metrics of data type boolean by handle
+ *
+ * @param[in] handle Handle of the metrics
+ * @param[in] b      Value of the metrics
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_metrics_report_bool_h(esp_diag_metrics_handle_t handle, bool b);
+
+/**
+ * @brief Add the metrics of data type integer by handle
+ *
+ * @param[in] handle Handle of the metrics
+ * @param[in] i      Value of the metrics
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_metrics_report_int_h(esp_diag_metrics_handle_t handle, int32_t i);
+
+/**
+ * @brief Add the metrics of data type unsigned integer by handle
+ *
+ * @param[in] handle Handle of the metrics
+ * @param[in] u      Value of the metrics
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_metrics_report_uint_h(esp_diag_metrics_handle_t handle, uint32_t u);
+
+/**
+ * @brief Add the metrics of data type float by handle
+ *
+ * @param[in] handle Handle of the metrics
+ * @param[in] f      Value of the metrics
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_metrics_report_float_h(esp_diag_metrics_handle_t handle, float f);
+
+/**
+ * @brief Add the IPv4 address metrics by handle
+ *
+ * @param[in] handle Handle of the metrics
+ * @param[in] ip     IPv4 address
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_metrics_report_ipv4_h(esp_diag_metrics_handle_t handle, uint32_t ip);
+
+/**
+ * @brief Add the MAC address metrics by handle
+ *
+ * @param[in] handle Handle of the metrics
+ * @param[in] mac    Array of length 6 i.e 6 octets of mac address
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_metrics_report_mac_h(esp_diag_metrics_handle_t handle, uint8_t *mac);
+
+/**
+ * @brief Add the metrics of data type string by handle
+ *
+ * @param[in] handle Handle of the metrics
+ * @param[in] str    Value of the metrics
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_metrics_report_str_h(esp_diag_metrics_handle_t handle, const char *str);
+
 /**
  * @brief Unregister all previously registered metrics
  *
@@ -33,6 +33,8 @@ typedef esp_err_t (*esp_diag_variable_write_cb_t)(const char *tag, void *data, s
 typedef struct {
     esp_diag_variable_write_cb_t write_cb; /*!< Callback function to write diagnostics data */
     void *cb_arg;                          /*!< User data to pass in callback function */
+    bool compact;                          /*!< Write \ref esp_diag_compact_pt_t records */
+    esp_diag_time_base_cb_t time_base_cb;  /*!< Optional, time base for the timestamps of compact records */
 } esp_diag_variable_config_t;
 
 /**
@@ -48,6 +50,14 @@ typedef struct {
     esp_diag_data_type_t type; /*!< Data type of variables */
 } esp_diag_variable_meta_t;
 
+/**
+ * @brief Handle of a registered variable, see \ref esp_diag_variable_register_h
+ *
+ * A handle stays valid until its variable is unregistered, other variables may be registered and unregistered
+ * meanwhile. 0 is never a valid handle.
+ */
+typedef uint32_t esp_diag_variable_handle_t;
+
 /**
  * @brief Initialize the diagnostics variable
  *
@@ -81,6 +91,111 @@ esp_err_t esp_diag_variable_register(const char *tag,
                                      const char *path,
                                      esp_diag_data_type_t type);
 
+/**
+ * @brief Register a variable and get a handle to report it with
+ *
+ * Reporting through the handle, with the esp_diag_variable_report_*_h APIs, skips the lookup of tag and key.
+ *
+ * @param[in]  tag    Tag of variable
+ * @param[in]  key    Unique key for the variable
+ * @param[in]  label  Label for the variable
+ * @param[in]  path   Hierarchical path for key, must be separated by '.' for more than one level
+ * @param[in]  type   Data type of variable
+ * @param[out] handle Handle of the variable, can be NULL
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_variable_register_h(const char *tag,
+                                       const char *key,
+                                       const char *label,
+                                       const char *path,
+                                       esp_diag_data_type_t type,
+                                       esp_diag_variable_handle_t *handle);
+
+/**
+ * @brief Add variable to storage by handle
+ *
+ * @param[in] handle    Handle of the variable, from \ref esp_diag_variable_register_h
+ * @param[in] data_type Data type of variable \ref esp_diag_data_type_t
+ * @param[in] val       Value of variable
+ * @param[in] val_sz    Size of val
+ * @param[in] ts        Timestamp in microseconds, this should be the value at the time of data gathering
+ *
+ * @return ESP_OK if successful, ESP_ERR_NOT_FOUND if the handle is stale, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_variable_report_h(esp_diag_variable_handle_t handle, esp_diag_data_type_t data_type,
+                                     const void *val, size_t val_sz, uint64_t ts);
+
+/**
+ * @brief Add the variable of data type boolean by handle
+ *
+ * @param[in] handle Handle of the variable
+ * @param[in] b      Value of the variable
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_variable_report_bool_h(esp_diag_variable_handle_t handle, bool b);
+
+/**
+ * @brief Add the variable of data type integer by handle
+ *
+ * @param[in] handle Handle of the variable
+ * @param[in] i      Value of the variable
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_variable_report_int_h(esp_diag_variable_handle_t handle, int32_t i);
+
+/**
+ * @brief Add the variable of data type unsigned integer by handle
+ *
+ * @param[in] handle Handle of the variable
+ * @param[in] u      Value of the variable
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_variable_report_uint_h(esp_diag_variable_handle_t handle, uint32_t u);
+
+/**
+ * @brief Add the variable of data type float by handle
+ *
+ * @param[in] handle Handle of the variable
+ * @param[in] f      Value of the variable
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_variable_report_float_h(esp_diag_variable_handle_t handle, float f);
+
+/**
+ * @brief Add the IPv4 address variable by handle
+ *
+ * @param[in] handle Handle of the variable
+ * @param[in] ip     IPv4 address
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_variable_report_ipv4_h(esp_diag_variable_handle_t handle, uint32_t ip);
+
+/**
+ * @brief Add the MAC address variable by handle
+ *
+ * @param[in] handle Handle of the variable
+ * @param[in] mac    Array of length 6 i.e 6 octets of mac address
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_variable_report_mac_h(esp_diag_variable_handle_t handle, uint8_t *mac);
+
+/**
+ * @brief Add the variable of data type string by handle
+ *
+ * @param[in] handle Handle of the variable
+ * @param[in] str    Value of the variable
+ *
+ * @return ESP_OK if successful, appropriate error code otherwise.
+ */
+esp_err_t esp_diag_variable_report_str_h(esp_diag_variable_handle_t handle, const char *str);
+
 /**
  * @brief Unregister all previously registered variables
  *
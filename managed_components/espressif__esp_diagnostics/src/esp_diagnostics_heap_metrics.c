@@ -37,6 +37,15 @@
 typedef struct {
     bool init;
     TimerHandle_t handle;
+    esp_diag_metrics_handle_t alloc_fail;
+    esp_diag_metrics_handle_t free;
+    esp_diag_metrics_handle_t lfb;
+    esp_diag_metrics_handle_t min_free;
+#ifdef CONFIG_ESP32_SPIRAM_SUPPORT
+    esp_diag_metrics_handle_t ext_free;
+    esp_diag_metrics_handle_t ext_lfb;
+    esp_diag_metrics_handle_t ext_min_free;
+#endif /* CONFIG_ESP32_SPIRAM_SUPPORT */
 } heap_diag_priv_data_t;
 
 static heap_diag_priv_data_t s_priv_data;
@@ -50,12 +59,11 @@ esp_err_t esp_diag_heap_metrics_dump(void)
     uint32_t free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
     uint32_t lfb = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
     uint32_t min_free_ever = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
-#ifndef CONFIG_ESP_INSIGHTS_META_VERSION_10
-    RET_ON_ERR_WITH_LOG(esp_diag_metrics_report_uint(METRICS_TAG, KEY_FREE, free), ESP_LOG_WARN, LOG_TAG,
+    RET_ON_ERR_WITH_LOG(esp_diag_metrics_report_uint_h(s_priv_data.free, free), ESP_LOG_WARN, LOG_TAG,
                         "Failed to add heap metric key:" KEY_FREE);
-    RET_ON_ERR_WITH_LOG(esp_diag_metrics_report_uint(METRICS_TAG, KEY_LFB, lfb), ESP_LOG_WARN, LOG_TAG,
+    RET_ON_ERR_WITH_LOG(esp_diag_metrics_report_uint_h(s_priv_data.lfb, lfb), ESP_LOG_WARN, LOG_TAG,
                         "Failed to add heap metric key:" KEY_LFB);
-    RET_ON_ERR_WITH_LOG(esp_diag_metrics_report_uint(METRICS_TAG, KEY_MIN_FREE, min_free_ever), ESP_LOG_WARN, LOG_TAG,
+    RET_ON_ERR_WITH_LOG(esp_diag_metrics_report_uint_h(s_priv_data.min_free, min_free_ever), ESP_LOG_WARN, LOG_TAG,
                         "Failed to add heap metric key:" KEY_MIN_FREE);
 
     ESP_LOGI(LOG_TAG, KEY_FREE ":0x%" PRIx32 " " KEY_LFB ":0x%" PRIx32 " " KEY_MIN_FREE ":0x%" PRIx32, free, lfb, min_free_ever);
@@ -64,39 +72,15 @@ esp_err_t esp_diag_heap_metrics_dump(void)
     lfb = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
     min_free_ever = heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM);
 
-    RET_ON_ERR_WITH_LOG(esp_diag_metrics_report_uint(METRICS_TAG, KEY_EXT_FREE, free), ESP_LOG_WARN, LOG_TAG,
+    RET_ON_ERR_WITH_LOG(esp_diag_metrics_report_uint_h(s_priv_data.ext_free, free), ESP_LOG_WARN, LOG_TAG,
                         "Failed to add heap metric key:" KEY_EXT_FREE);
-    RET_ON_ERR_WITH_LOG(esp_diag_metrics_report_uint(METRICS_TAG, KEY_EXT_LFB, lfb), ESP_LOG_WARN, LOG_TAG,
+    RET_ON_ERR_WITH_LOG(esp_diag_metrics_report_uint_h(s_priv_data.ext_lfb, lfb), ESP_LOG_WARN, LOG_TAG,
                         "Failed to add heap metric key:" KEY_EXT_LFB);
-    RET_ON_ERR_WITH_LOG(esp_diag_metrics_report_uint(METRICS_TAG, KEY_EXT_MIN_FREE, min_free_ever), ESP_LOG_WARN, LOG_TAG,
+    RET_ON_ERR_WITH_LOG(esp_diag_metrics_report_uint_h(s_priv_data.ext_min_free, min_free_ever), ESP_LOG_WARN, LOG_TAG,
                         "Failed to add heap metric key:" KEY_EXT_MIN_FREE);
 
     ESP_LOGI(LOG_TAG, KEY_EXT_FREE ":0x%" PRIx32 " " KEY_EXT_LFB ":0x%" PRIx32 " " KEY_EXT_MIN_FREE ":0x%" PRIx32, free, lfb, min_free_ever);
 #endif /* CONFIG_ESP32_SPIRAM_SUPPORT */
-#else
-    RET_ON_ERR_WITH_LOG(esp_diag_metrics_add_uint(KEY_FREE, free), ESP_LOG_WARN, LOG_TAG,
-                        "Failed to add heap metric key:" KEY_FREE);
-    RET_ON_ERR_WITH_LOG(esp_diag_metrics_add_uint(KEY_LFB, lfb), ESP_LOG_WARN, LOG_TAG,
-                        "Failed to add heap metric key:" KEY_LFB);
-    RET_ON_ERR_WITH_LOG(esp_diag_metrics_add_uint(KEY_MIN_FREE, min_free_ever), ESP_LOG_WARN, LOG_TAG,
-                        "Failed to add heap metric key:" KEY_MIN_FREE);
-
-    ESP_LOGI(LOG_TAG, KEY_FREE ":0x%"PRIx32" " KEY_LFB ":0x%"PRIx32" " KEY_MIN_FREE ":0x%"PRIx32, free, lfb, min_free_ever);
-#ifdef CONFIG_ESP32_SPIRAM_SUPPORT
-    free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
-    lfb = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
-    min_free_ever = heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM);
-
-    RET_ON_ERR_WITH_LOG(esp_diag_metrics_add_uint(KEY_EXT_FREE, free), ESP_LOG_WARN, LOG_TAG,
-                        "Failed to add heap metric key:" KEY_EXT_FREE);
-    RET_ON_ERR_WITH_LOG(esp_diag_metrics_add_uint(KEY_EXT_LFB, lfb), ESP_LOG_WARN, LOG_TAG,
-                        "Failed to add heap metric key:" KEY_EXT_LFB);
-    RET_ON_ERR_WITH_LOG(esp_diag_metrics_add_uint(KEY_EXT_MIN_FREE, min_free_ever), ESP_LOG_WARN, LOG_TAG,
-                        "Failed to add heap metric key:" KEY_EXT_MIN_FREE);
-
-    ESP_LOGI(LOG_TAG, KEY_EXT_FREE ":0x%"PRIx32" " KEY_EXT_LFB ":0x%"PRIx32" " KEY_EXT_MIN_FREE ":0x%"PRIx32, free, lfb, min_free_ever);
-#endif /* CONFIG_ESP32_SPIRAM_SUPPORT */
-#endif
     return ESP_OK;
 }
 
@@ -114,11 +98,7 @@ static void heap_timer_cb(TimerHandle_t handle)
 static void alloc_failed_hook(size_t size, uint32_t caps, const char *func)
 {
     esp_diag_heap_metrics_dump();
-#ifndef CONFIG_ESP_INSIGHTS_META_VERSION_10
-    esp_diag_metrics_report_uint(METRICS_TAG, KEY_ALLOC_FAIL, size);
-#else
-    esp_diag_metrics_add_uint(KEY_ALLOC_FAIL, size);
-#endif
+    esp_diag_metrics_report_uint_h(s_priv_data.alloc_fail, size);
 
     ESP_DIAG_EVENT(METRICS_TAG, KEY_ALLOC_FAIL " size:0x%x func:%s", size, func);
 }
@@ -134,7 +114,8 @@ esp_err_t esp_diag_heap_metrics_init(void)
     if (err != ESP_OK) {
         return err;
     }
-    esp_diag_metrics_register(METRICS_TAG, KEY_ALLOC_FAIL, "Malloc fail", METRICS_TAG, ESP_DIAG_DATA_TYPE_UINT);
+    esp_diag_metrics_register_h(METRICS_TAG, KEY_ALLOC_FAIL, "Malloc fail", METRICS_TAG, ESP_DIAG_DATA_TYPE_UINT,
+                                &s_priv_data.alloc_fail);
 #ifndef CONFIG_ESP_INSIGHTS_META_VERSION_10
     esp_diag_metrics_add_unit(METRICS_TAG, KEY_ALLOC_FAIL, METRICS_UNIT);
 #else
@@ -143,9 +124,12 @@ esp_err_t esp_diag_heap_metrics_init(void)
 #endif
 
 #ifdef CONFIG_ESP32_SPIRAM_SUPPORT
-    esp_diag_metrics_register(METRICS_TAG, KEY_EXT_FREE, "External free heap", PATH_HEAP_EXTERNAL, ESP_DIAG_DATA_TYPE_UINT);
-    esp_diag_metrics_register(METRICS_TAG, KEY_EXT_LFB, "External largest free block", PATH_HEAP_EXTERNAL, ESP_DIAG_DATA_TYPE_UINT);
-    esp_diag_metrics_register(METRICS_TAG, KEY_EXT_MIN_FREE, "External minimum free size", PATH_HEAP_EXTERNAL, ESP_DIAG_DATA_TYPE_UINT);
+    esp_diag_metrics_register_h(METRICS_TAG, KEY_EXT_FREE, "External free heap", PATH_HEAP_EXTERNAL, ESP_DIAG_DATA_TYPE_UINT,
+                                &s_priv_data.ext_free);
+    esp_diag_metrics_register_h(METRICS_TAG, KEY_EXT_LFB, "External largest free block", PATH_HEAP_EXTERNAL, ESP_DIAG_DATA_TYPE_UINT,
+                                &s_priv_data.ext_lfb);
+    esp_diag_metrics_register_h(METRICS_TAG, KEY_EXT_MIN_FREE, "External minimum free size", PATH_HEAP_EXTERNAL, ESP_DIAG_DATA_TYPE_UINT,
+                                &s_priv_data.ext_min_free);
 #ifndef CONFIG_ESP_INSIGHTS_META_VERSION_10
     esp_diag_metrics_add_unit(METRICS_TAG, KEY_EXT_FREE, METRICS_UNIT);
     esp_diag_metrics_add_unit(METRICS_TAG, KEY_EXT_LFB, METRICS_UNIT);
@@ -157,9 +141,12 @@ esp_err_t esp_diag_heap_metrics_init(void)
 #endif
 #endif /* CONFIG_ESP32_SPIRAM_SUPPORT */
 
-    esp_diag_metrics_register(METRICS_TAG, KEY_FREE, "Free heap", PATH_HEAP_INTERNAL, ESP_DIAG_DATA_TYPE_UINT);
-    esp_diag_metrics_register(METRICS_TAG, KEY_LFB, "Largest free block", PATH_HEAP_INTERNAL, ESP_DIAG_DATA_TYPE_UINT);
-    esp_diag_metrics_register(METRICS_TAG, KEY_MIN_FREE, "Minimum free size", PATH_HEAP_INTERNAL, ESP_DIAG_DATA_TYPE_UINT);
+    esp_diag_metrics_register_h(METRICS_TAG, KEY_FREE, "Free heap", PATH_HEAP_INTERNAL, ESP_DIAG_DATA_TYPE_UINT,
+                                &s_priv_data.free);
+    esp_diag_metrics_register_h(METRICS_TAG, KEY_LFB, "Largest free block", PATH_HEAP_INTERNAL, ESP_DIAG_DATA_TYPE_UINT,
+                                &s_priv_data.lfb);
+    esp_diag_metrics_register_h(METRICS_TAG, KEY_MIN_FREE, "Minimum free size", PATH_HEAP_INTERNAL, ESP_DIAG_DATA_TYPE_UINT,
+                                &s_priv_data.min_free);
 #ifndef CONFIG_ESP_INSIGHTS_META_VERSION_10
     esp_diag_metrics_add_unit(METRICS_TAG, KEY_FREE, METRICS_UNIT);
     esp_diag_metrics_add_unit(METRICS_TAG, KEY_LFB, METRICS_UNIT);
@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include <esp_diagnostics.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -20,6 +22,24 @@ extern "C" {
 
 #define SEC2TICKS(s) ((s * 1000) / portTICK_PERIOD_MS)
 
+#define ESP_DIAG_STR_HASH_INIT  2166136261u
+
+/* FNV-1a of str including its terminator, continuing from hash. NULL hashes as "". */
+static inline uint32_t esp_diag_str_hash(uint32_t hash, const char *str)
+{
+    const char *c = str ? str : "";
+    do {
+        hash = (hash ^ (uint8_t) *c) * 16777619u;
+    } while (*c++);
+    return hash;
+}
+
+/* Encodes the compact data point of a metric or variable report into buf, which holds at least
+ * ESP_DIAG_COMPACT_PT_MAX_SZ bytes. Returns the length of the data point. */
+size_t esp_diag_compact_pt_report(uint8_t *buf, uint16_t type, uint16_t data_type, uint8_t index, uint8_t check,
+                                  const void *val, size_t val_sz, uint64_t ts,
+                                  esp_diag_time_base_cb_t time_base_cb, void *cb_arg);
+
 #ifdef __cplusplus
 }
 #endif
@@ -19,6 +19,7 @@
 #include "esp_debug_helpers.h"
 #include "esp_diagnostics_metrics.h"
 #include "esp_diagnostics_variables.h"
+#include "esp_diagnostics_internal.h"
 
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
 #include "esp_chip_info.h"
@@ -307,6 +308,147 @@ void esp_diag_task_snapshot_dump(void)
     free(tasks);
 }
 
+/* Bits of the first byte of a compact data point, besides ESP_DIAG_COMPACT_PT_FLAG */
+#define COMPACT_PT_VARIABLE         0x40
+#define COMPACT_PT_TS_RELATIVE      0x20
+#define COMPACT_PT_DATA_TYPE_MASK   0x0f
+#define COMPACT_PT_HDR_SZ           3
+#define VARINT_MAX_SZ               10
+
+static size_t compact_pt_value_len(uint16_t data_type)
+{
+    switch (data_type) {
+        case ESP_DIAG_DATA_TYPE_BOOL:
+            return 1;
+        case ESP_DIAG_DATA_TYPE_INT:
+        case ESP_DIAG_DATA_TYPE_UINT:
+        case ESP_DIAG_DATA_TYPE_FLOAT:
+        case ESP_DIAG_DATA_TYPE_IPv4:
+            return 4;
+        case ESP_DIAG_DATA_TYPE_MAC:
+            return 6;
+        default:
+            return 0;
+    }
+}
+
+size_t esp_diag_compact_pt_encode(const esp_diag_compact_pt_t *pt, uint8_t *buf)
+{
+    size_t i = 0;
+    size_t len;
+    uint64_t ts;
+
+    if (!pt || !buf || pt->type > ESP_DIAG_DATA_PT_VARIABLE || pt->data_type >= ESP_DIAG_DATA_TYPE_NULL) {
+        return 0;
+    }
+    buf[i++] = ESP_DIAG_COMPACT_PT_FLAG | (pt->type == ESP_DIAG_DATA_PT_VARIABLE ? COMPACT_PT_VARIABLE : 0) |
+               (pt->ts_relative ? COMPACT_PT_TS_RELATIVE : 0) | pt->data_type;
+    buf[i++] = pt->index;
+    buf[i++] = pt->check;
+
+    // zigzag encoding keeps small negative differences short
+    if (pt->ts_relative) {
+        ts = ((uint64_t) pt->ts << 1) ^ (uint64_t) (pt->ts >> 63);
+    } else {
+        ts = (uint64_t) pt->ts;
+    }
+    do {
+        buf[i] = ts & 0x7f;
+        ts >>= 7;
+        buf[i++] |= ts ? 0x80 : 0;
+    } while (ts);
+
+    if (pt->data_type == ESP_DIAG_DATA_TYPE_STR) {
+        len = strnlen(pt->value.str, sizeof(pt->value.str) - 1);
+        buf[i++] = len;
+    } else {
+        len = compact_pt_value_len(pt->data_type);
+    }
+    memcpy(buf + i, &pt->value, len);
+    return i + len;
+}
+
+esp_err_t esp_diag_compact_pt_decode(const uint8_t *buf, size_t len, esp_diag_compact_pt_t *pt)
+{
+    size_t i = COMPACT_PT_HDR_SZ;
+    size_t value_len;
+    uint64_t ts = 0;
+    int shift = 0;
+
+    if (!buf || !pt || len <= COMPACT_PT_HDR_SZ || !(buf[0] & ESP_DIAG_COMPACT_PT_FLAG)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(pt, 0, sizeof(*pt));
+    pt->type = (buf[0] & COMPACT_PT_VARIABLE) ? ESP_DIAG_DATA_PT_VARIABLE : ESP_DIAG_DATA_PT_METRICS;
+    pt->data_type = buf[0] & COMPACT_PT_DATA_TYPE_MASK;
+    pt->ts_relative = (buf[0] & COMPACT_PT_TS_RELATIVE) != 0;
+    pt->index = buf[1];
+    pt->check = buf[2];
+    if (pt->data_type >= ESP_DIAG_DATA_TYPE_NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    do {
+        if (i == len || i - COMPACT_PT_HDR_SZ == VARINT_MAX_SZ) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        ts |= (uint64_t) (buf[i] & 0x7f) << shift;
+        shift += 7;
+    } while (buf[i++] & 0x80);
+    if (pt->ts_relative) {
+        pt->ts = (int64_t) (ts >> 1) ^ -(int64_t) (ts & 1);
+    } else {
+        pt->ts = (int64_t) ts;
+    }
+
+    if (pt->data_type == ESP_DIAG_DATA_TYPE_STR) {
+        if (i == len || buf[i] >= sizeof(pt->value.str)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        value_len = buf[i++];
+    } else {
+        value_len = compact_pt_value_len(pt->data_type);
+    }
+    if (len - i != value_len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(&pt->value, buf + i, value_len);
+    return ESP_OK;
+}
+
+uint8_t esp_diag_compact_pt_check(const char *tag, const char *key)
+{
+    // hash of tag and key folded to a byte
+    uint32_t hash = esp_diag_str_hash(esp_diag_str_hash(ESP_DIAG_STR_HASH_INIT, tag), key);
+    return (hash ^ (hash >> 8) ^ (hash >> 16) ^ (hash >> 24)) & 0xff;
+}
+
+size_t esp_diag_compact_pt_report(uint8_t *buf, uint16_t type, uint16_t data_type, uint8_t index, uint8_t check,
+                                  const void *val, size_t val_sz, uint64_t ts,
+                                  esp_diag_time_base_cb_t time_base_cb, void *cb_arg)
+{
+    esp_diag_compact_pt_t pt = {
+        .type = type,
+        .data_type = data_type,
+        .index = index,
+        .check = check,
+        .ts = ts,
+    };
+    // wall clock timestamps are long varints, store them relative to the time base of the boot
+    if (ts >= ESP_DIAG_COMPACT_PT_WALL_CLOCK && time_base_cb) {
+        uint64_t base = time_base_cb(ts, cb_arg);
+        if (base) {
+            pt.ts = (int64_t) (ts - base);
+            pt.ts_relative = true;
+        }
+    }
+    if (val_sz > sizeof(pt.value) - 1) {
+        val_sz = sizeof(pt.value) - 1;
+    }
+    memcpy(&pt.value, val, val_sz);
+    return esp_diag_compact_pt_encode(&pt, buf);
+}
+
 uint32_t esp_diag_data_size_get_crc(void)
 {
     size_t diag_data_size = sizeof(esp_diag_data_pt_t) + sizeof(esp_diag_str_data_pt_t) + sizeof(esp_diag_log_data_t);
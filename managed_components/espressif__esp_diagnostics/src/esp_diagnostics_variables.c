@@ -10,6 +10,7 @@
 #include <esp_log.h>
 #include <esp_diagnostics.h>
 #include <esp_diagnostics_variables.h>
+#include "esp_diagnostics_internal.h"
 
 #define TAG "DIAG_VARIABLES"
 #define DIAG_VARIABLES_MAX_COUNT   CONFIG_DIAG_VARIABLES_MAX_COUNT
@@ -19,49 +20,97 @@
 #define MAX_VARIABLES_WRITE_SZ     sizeof(esp_diag_data_pt_t)
 #define MAX_STR_VARIABLES_WRITE_SZ sizeof(esp_diag_str_data_pt_t)
 
+/* Key hash index with linear probing, kept at most half full */
+#define VARIABLES_HASH_SZ   (2 * DIAG_VARIABLES_MAX_COUNT)
+
+/* Handles are the slot number plus one and the generation of the slot when the handle was given out */
+#define VARIABLE_HANDLE(slot, gen)  (((uint32_t) (gen) << 16) | ((slot) + 1))
+
+typedef struct {
+    uint16_t pos;       /* 1 + position in variables[], 0 if the slot is free */
+    uint16_t gen;       /* bumped when the slot is freed, so that stale handles are rejected */
+} variable_slot_t;
+
 typedef struct {
     size_t variables_count;
     esp_diag_variable_meta_t variables[DIAG_VARIABLES_MAX_COUNT];
+    uint8_t check[DIAG_VARIABLES_MAX_COUNT];    /* compact record check of variables[i] */
+    uint16_t slot_of[DIAG_VARIABLES_MAX_COUNT]; /* handle slot of variables[i] */
+    variable_slot_t slots[DIAG_VARIABLES_MAX_COUNT];
+    uint16_t hash_index[VARIABLES_HASH_SZ];     /* 1 + position in variables[], 0 if empty */
     esp_diag_variable_config_t config;
     bool init;
 } variables_priv_data_t;
 
 static variables_priv_data_t s_priv_data;
 
-static esp_diag_variable_meta_t *esp_diag_variable_meta_get(const char *tag, const char *key)
+static inline bool str_equal(const char *a, const char *b)
 {
-    uint32_t i;
-    if (!tag || !key) {
-        return NULL;
+    /* tags and keys are mostly string literals, so the same pointer is passed on every report */
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+static void variables_hash_add(size_t i)
+{
+    uint32_t h = esp_diag_str_hash(ESP_DIAG_STR_HASH_INIT, s_priv_data.variables[i].key) % VARIABLES_HASH_SZ;
+    while (s_priv_data.hash_index[h]) {
+        h = (h + 1) % VARIABLES_HASH_SZ;
+    }
+    s_priv_data.hash_index[h] = i + 1;
+}
+
+static void variables_hash_rebuild(void)
+{
+    memset(&s_priv_data.hash_index, 0, sizeof(s_priv_data.hash_index));
+    for (size_t i = 0; i < s_priv_data.variables_count; i++) {
+        variables_hash_add(i);
     }
-    for (i = 0; i < s_priv_data.variables_count; i++) {
-        if (s_priv_data.variables[i].key &&
-                (strcmp(s_priv_data.variables[i].tag, tag) == 0) &&
-                (strcmp(s_priv_data.variables[i].key, key) == 0)) {
-            return &s_priv_data.variables[i];
+}
+
+/* Finds the variable by key, and by tag if it is not NULL */
+static esp_diag_variable_meta_t *variables_hash_find(const char *tag, const char *key)
+{
+    uint32_t h = esp_diag_str_hash(ESP_DIAG_STR_HASH_INIT, key) % VARIABLES_HASH_SZ;
+    uint16_t pos;
+    while ((pos = s_priv_data.hash_index[h]) != 0) {
+        esp_diag_variable_meta_t *variable = &s_priv_data.variables[pos - 1];
+        if (str_equal(variable->key, key) && (!tag || str_equal(variable->tag, tag))) {
+            return variable;
         }
+        h = (h + 1) % VARIABLES_HASH_SZ;
     }
     return NULL;
 }
 
+static esp_diag_variable_meta_t *esp_diag_variable_meta_get(const char *tag, const char *key)
+{
+    if (!tag || !key) {
+        return NULL;
+    }
+    return variables_hash_find(tag, key);
+}
+
 #ifdef CONFIG_ESP_INSIGHTS_META_VERSION_10
 /* Checks only by key for registered variable. Use this for meta version < 1.1 */
 static esp_diag_variable_meta_t *esp_diag_variable_meta_get_by_key(const char *key)
 {
-    uint32_t i;
     if (!key) {
         return NULL;
     }
-    for (i = 0; i < s_priv_data.variables_count; i++) {
-        if (s_priv_data.variables[i].key &&
-                (strcmp(s_priv_data.variables[i].key, key) == 0)) {
-            return &s_priv_data.variables[i];
-        }
-    }
-    return NULL;
+    return variables_hash_find(NULL, key);
 }
 #endif
 
+static esp_diag_variable_meta_t *esp_diag_variable_meta_get_by_handle(esp_diag_variable_handle_t handle)
+{
+    uint32_t slot = (handle & 0xffff) - 1;
+    if (slot >= DIAG_VARIABLES_MAX_COUNT || !s_priv_data.slots[slot].pos ||
+            s_priv_data.slots[slot].gen != (handle >> 16)) {
+        return NULL;
+    }
+    return &s_priv_data.variables[s_priv_data.slots[slot].pos - 1];
+}
+
 static bool tag_key_present(const char *tag, const char *key)
 {
     return (esp_diag_variable_meta_get(tag, key) != NULL);
@@ -70,6 +119,13 @@ static bool tag_key_present(const char *tag, const char *key)
 esp_err_t esp_diag_variable_register(const char *tag, const char *key,
                                      const char *label, const char *path,
                                      esp_diag_data_type_t type)
+{
+    return esp_diag_variable_register_h(tag, key, label, path, type, NULL);
+}
+
+esp_err_t esp_diag_variable_register_h(const char *tag, const char *key,
+                                       const char *label, const char *path,
+                                       esp_diag_data_type_t type, esp_diag_variable_handle_t *handle)
 {
     if (!tag || !key || !label || !path) {
         ESP_LOGE(TAG, "Failed to register variable, tag, key, lable, or path is NULL");
@@ -92,7 +148,20 @@ esp_err_t esp_diag_variable_register(const char *tag, const char *key,
     s_priv_data.variables[s_priv_data.variables_count].unit = NULL;
     s_priv_data.variables[s_priv_data.variables_count].path = path;
     s_priv_data.variables[s_priv_data.variables_count].type = type;
+    s_priv_data.check[s_priv_data.variables_count] = esp_diag_compact_pt_check(tag, key);
+
+    /* there is a free slot as long as there is a free entry */
+    uint16_t slot = 0;
+    while (s_priv_data.slots[slot].pos) {
+        slot++;
+    }
+    s_priv_data.slots[slot].pos = s_priv_data.variables_count + 1;
+    s_priv_data.slot_of[s_priv_data.variables_count] = slot;
+    variables_hash_add(s_priv_data.variables_count);
     s_priv_data.variables_count++;
+    if (handle) {
+        *handle = VARIABLE_HANDLE(slot, s_priv_data.slots[slot].gen);
+    }
     return ESP_OK;
 }
 
@@ -131,7 +200,6 @@ esp_err_t esp_diag_variable_unregister(const char *key)
 esp_err_t esp_diag_variable_unregister(const char *tag, const char *key)
 #endif
 {
-    int i;
 #ifndef CONFIG_ESP_INSIGHTS_META_VERSION_10
     if (!tag) {
         return ESP_ERR_INVALID_ARG;
@@ -140,22 +208,30 @@ esp_err_t esp_diag_variable_unregister(const char *tag, const char *key)
     if (!key) {
         return ESP_ERR_INVALID_ARG;
     }
-    for (i = 0; i < s_priv_data.variables_count; i++) {
-        if (s_priv_data.variables[i].key &&
-#ifndef CONFIG_ESP_INSIGHTS_META_VERSION_10
-                (strcmp(s_priv_data.variables[i].tag, tag) == 0) &&
+#ifdef CONFIG_ESP_INSIGHTS_META_VERSION_10
+    esp_diag_variable_meta_t *variable = esp_diag_variable_meta_get_by_key(key);
+#else
+    esp_diag_variable_meta_t *variable = esp_diag_variable_meta_get(tag, key);
 #endif
-                (strcmp(s_priv_data.variables[i].key, key) == 0)) {
-            break;
-        }
+    if (!variable) {
+        return ESP_ERR_NOT_FOUND;
     }
-    if (i < s_priv_data.variables_count) {
-        s_priv_data.variables[i] = s_priv_data.variables[s_priv_data.variables_count - 1];
-        memset(&s_priv_data.variables[s_priv_data.variables_count - 1], 0, sizeof(esp_diag_variable_meta_t));
-        s_priv_data.variables_count--;
-        return ESP_OK;
+    size_t i = variable - s_priv_data.variables;
+    size_t last = s_priv_data.variables_count - 1;
+
+    variable_slot_t *slot = &s_priv_data.slots[s_priv_data.slot_of[i]];
+    slot->pos = 0;
+    slot->gen++;
+    if (i != last) {
+        s_priv_data.variables[i] = s_priv_data.variables[last];
+        s_priv_data.check[i] = s_priv_data.check[last];
+        s_priv_data.slot_of[i] = s_priv_data.slot_of[last];
+        s_priv_data.slots[s_priv_data.slot_of[i]].pos = i + 1;
     }
-    return ESP_ERR_NOT_FOUND;
+    memset(&s_priv_data.variables[last], 0, sizeof(esp_diag_variable_meta_t));
+    s_priv_data.variables_count--;
+    variables_hash_rebuild();
+    return ESP_OK;
 }
 
 esp_err_t esp_diag_variable_unregister_all(void)
@@ -164,6 +240,15 @@ esp_err_t esp_diag_variable_unregister_all(void)
         return ESP_ERR_INVALID_STATE;
     }
     memset(&s_priv_data.variables, 0, sizeof(s_priv_data.variables));
+    memset(&s_priv_data.check, 0, sizeof(s_priv_data.check));
+    memset(&s_priv_data.slot_of, 0, sizeof(s_priv_data.slot_of));
+    memset(&s_priv_data.hash_index, 0, sizeof(s_priv_data.hash_index));
+    for (size_t slot = 0; slot < DIAG_VARIABLES_MAX_COUNT; slot++) {
+        if (s_priv_data.slots[slot].pos) {
+            s_priv_data.slots[slot].pos = 0;
+            s_priv_data.slots[slot].gen++;
+        }
+    }
     s_priv_data.variables_count = 0;
     return ESP_OK;
 }
@@ -213,6 +298,49 @@ esp_err_t esp_diag_variables_deinit(void)
     return ESP_OK;
 }
 
+/* Writes the record of a registered variable */
+static esp_err_t variable_write(const esp_diag_variable_meta_t *variable, esp_diag_data_type_t data_type,
+                                const void *val, size_t val_sz, uint64_t ts)
+{
+    if (variable->type != data_type) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t write_sz = MAX_VARIABLES_WRITE_SZ;
+    if (variable->type == ESP_DIAG_DATA_TYPE_STR) {
+        write_sz = MAX_STR_VARIABLES_WRITE_SZ;
+        if (val_sz > MAX_STR_LEN) {
+            val_sz = MAX_STR_LEN;
+        }
+    } else if (val_sz > sizeof(((esp_diag_data_pt_t *)0)->value)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t index = variable - s_priv_data.variables;
+    if (s_priv_data.config.compact && index <= UINT8_MAX) {
+        uint8_t buf[ESP_DIAG_COMPACT_PT_MAX_SZ];
+        size_t len = esp_diag_compact_pt_report(buf, ESP_DIAG_DATA_PT_VARIABLE, data_type, index,
+                                                s_priv_data.check[index], val, val_sz, ts,
+                                                s_priv_data.config.time_base_cb, s_priv_data.config.cb_arg);
+        return s_priv_data.config.write_cb(variable->tag, buf, len, s_priv_data.config.cb_arg);
+    }
+
+    esp_diag_str_data_pt_t data;
+    memset(&data, 0, sizeof(data));
+    data.type = ESP_DIAG_DATA_PT_VARIABLE;
+    data.data_type = data_type;
+#ifndef CONFIG_ESP_INSIGHTS_META_VERSION_10
+    strlcpy(data.tag, variable->tag, sizeof(data.tag));
+#endif
+    strlcpy(data.key, variable->key, sizeof(data.key));
+    data.ts = ts;
+    memcpy(&data.value, val, val_sz);
+
+    if (s_priv_data.config.write_cb) {
+        return s_priv_data.config.write_cb(variable->tag, &data, write_sz, s_priv_data.config.cb_arg);
+    }
+    return ESP_OK;
+}
+
 #ifdef CONFIG_ESP_INSIGHTS_META_VERSION_10
 esp_err_t esp_diag_variable_add(esp_diag_data_type_t data_type,
 #else
@@ -246,29 +374,61 @@ esp_err_t esp_diag_variable_report(esp_diag_data_type_t data_type, const char *t
         return ESP_ERR_NOT_FOUND;
     }
 #endif
-    if (variable->type != data_type) {
+    return variable_write(variable, data_type, val, val_sz, ts);
+}
+
+esp_err_t esp_diag_variable_report_h(esp_diag_variable_handle_t handle, esp_diag_data_type_t data_type,
+                                     const void *val, size_t val_sz, uint64_t ts)
+{
+    if (!val) {
         return ESP_ERR_INVALID_ARG;
     }
-    size_t write_sz = MAX_VARIABLES_WRITE_SZ;
-    if (variable->type == ESP_DIAG_DATA_TYPE_STR) {
-        write_sz = MAX_STR_VARIABLES_WRITE_SZ;
+    if (!s_priv_data.init) {
+        return ESP_ERR_INVALID_STATE;
     }
+    const esp_diag_variable_meta_t *variable = esp_diag_variable_meta_get_by_handle(handle);
+    if (!variable) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return variable_write(variable, data_type, val, val_sz, ts);
+}
 
-    esp_diag_str_data_pt_t data;
-    memset(&data, 0, sizeof(data));
-    data.type = ESP_DIAG_DATA_PT_VARIABLE;
-    data.data_type = data_type;
-#ifndef CONFIG_ESP_INSIGHTS_META_VERSION_10
-    strlcpy(data.tag, tag, sizeof(data.tag));
-#endif
-    strlcpy(data.key, key, sizeof(data.key));
-    data.ts = ts;
-    memcpy(&data.value, val, val_sz);
+esp_err_t esp_diag_variable_report_bool_h(esp_diag_variable_handle_t handle, bool b)
+{
+    return esp_diag_variable_report_h(handle, ESP_DIAG_DATA_TYPE_BOOL, &b, sizeof(b), esp_diag_timestamp_get());
+}
 
-    if (s_priv_data.config.write_cb) {
-        return s_priv_data.config.write_cb(variable->tag, &data, write_sz, s_priv_data.config.cb_arg);
+esp_err_t esp_diag_variable_report_int_h(esp_diag_variable_handle_t handle, int32_t i)
+{
+    return esp_diag_variable_report_h(handle, ESP_DIAG_DATA_TYPE_INT, &i, sizeof(i), esp_diag_timestamp_get());
+}
+
+esp_err_t esp_diag_variable_report_uint_h(esp_diag_variable_handle_t handle, uint32_t u)
+{
+    return esp_diag_variable_report_h(handle, ESP_DIAG_DATA_TYPE_UINT, &u, sizeof(u), esp_diag_timestamp_get());
+}
+
+esp_err_t esp_diag_variable_report_float_h(esp_diag_variable_handle_t handle, float f)
+{
+    return esp_diag_variable_report_h(handle, ESP_DIAG_DATA_TYPE_FLOAT, &f, sizeof(f), esp_diag_timestamp_get());
+}
+
+esp_err_t esp_diag_variable_report_ipv4_h(esp_diag_variable_handle_t handle, uint32_t ip)
+{
+    return esp_diag_variable_report_h(handle, ESP_DIAG_DATA_TYPE_IPv4, &ip, sizeof(ip), esp_diag_timestamp_get());
+}
+
+esp_err_t esp_diag_variable_report_mac_h(esp_diag_variable_handle_t handle, uint8_t *mac)
+{
+    return esp_diag_variable_report_h(handle, ESP_DIAG_DATA_TYPE_MAC, mac, 6, esp_diag_timestamp_get());
+}
+
+esp_err_t esp_diag_variable_report_str_h(esp_diag_variable_handle_t handle, const char *str)
+{
+    if (!str) {
+        return ESP_ERR_INVALID_ARG;
     }
-    return ESP_OK;
+    return esp_diag_variable_report_h(handle, ESP_DIAG_DATA_TYPE_STR, str, strlen(str), esp_diag_timestamp_get());
 }
 
 #ifdef CONFIG_ESP_INSIGHTS_META_VERSION_10
@@ -36,6 +36,9 @@ typedef struct {
     TimerHandle_t handle;
     int32_t prev_rssi;
     int32_t min_rssi;
+    esp_diag_metrics_handle_t rssi_handle;
+    esp_diag_metrics_handle_t min_rssi_handle;
+    esp_diag_metrics_handle_t status_handle;
 } wifi_diag_priv_data_t;
 
 static wifi_diag_priv_data_t s_priv_data;
@@ -44,11 +47,7 @@ static void update_min_rssi(int32_t rssi)
 {
     if (rssi < s_priv_data.min_rssi) {
         s_priv_data.min_rssi = rssi;
-#ifndef CONFIG_ESP_INSIGHTS_META_VERSION_10
-        esp_diag_metrics_report_int(METRICS_TAG, KEY_MIN_RSSI, rssi);
-#else
-        esp_diag_metrics_add_int(KEY_MIN_RSSI, rssi);
-#endif
+        esp_diag_metrics_report_int_h(s_priv_data.min_rssi_handle, rssi);
         ESP_LOGI(LOG_TAG, "Wi-Fi RSSI crossed threshold %" PRIi32, rssi);
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0)
         esp_wifi_set_rssi_threshold(rssi);
@@ -71,15 +70,9 @@ static void wifi_evt_handler(void *arg, esp_event_base_t evt_base, int32_t evt_i
         {
             s_priv_data.wifi_connected = true;
             s_priv_data.status_sent = false;
-#ifndef CONFIG_ESP_INSIGHTS_META_VERSION_10
-            if (esp_diag_metrics_report_bool(METRICS_TAG, KEY_STATUS, 1) == ESP_OK) {
-                s_priv_data.status_sent = true;
-            }
-#else
-            if (esp_diag_metrics_add_bool(KEY_STATUS, 1) == ESP_OK) {
+            if (esp_diag_metrics_report_bool_h(s_priv_data.status_handle, 1) == ESP_OK) {
                 s_priv_data.status_sent = true;
             }
-#endif
 
             break;
         }
@@ -88,15 +81,9 @@ static void wifi_evt_handler(void *arg, esp_event_base_t evt_base, int32_t evt_i
             if (s_priv_data.wifi_connected) {
                 s_priv_data.wifi_connected = false;
                 s_priv_data.status_sent = false;
-#ifndef CONFIG_ESP_INSIGHTS_META_VERSION_10
-                if (esp_diag_metrics_report_bool(METRICS_TAG, KEY_STATUS, 0) == ESP_OK) {
-                    s_priv_data.status_sent = true;
-                }
-#else
-                if (esp_diag_metrics_add_bool(KEY_STATUS, 0) == ESP_OK) {
+                if (esp_diag_metrics_report_bool_h(s_priv_data.status_handle, 0) == ESP_OK) {
                     s_priv_data.status_sent = true;
                 }
-#endif
             }
             break;
         }
@@ -124,31 +111,18 @@ esp_err_t esp_diag_wifi_metrics_dump(void)
     int32_t rssi = get_rssi();
     if (rssi != 1) {
         update_min_rssi(rssi);
-#ifndef CONFIG_ESP_INSIGHTS_META_VERSION_10
-        RET_ON_ERR_WITH_LOG(esp_diag_metrics_report_int(METRICS_TAG, KEY_RSSI, rssi), ESP_LOG_WARN, LOG_TAG,
-                            "Failed to add Wi-Fi metrics key:" KEY_RSSI);
-        RET_ON_ERR_WITH_LOG(esp_diag_metrics_report_int(METRICS_TAG, KEY_MIN_RSSI, s_priv_data.min_rssi), ESP_LOG_WARN, LOG_TAG,
-                            "Failed to add Wi-Fi metrics key:" KEY_MIN_RSSI);
-#else
-        RET_ON_ERR_WITH_LOG(esp_diag_metrics_add_int(KEY_RSSI, rssi), ESP_LOG_WARN, LOG_TAG,
+        RET_ON_ERR_WITH_LOG(esp_diag_metrics_report_int_h(s_priv_data.rssi_handle, rssi), ESP_LOG_WARN, LOG_TAG,
                             "Failed to add Wi-Fi metrics key:" KEY_RSSI);
-        RET_ON_ERR_WITH_LOG(esp_diag_metrics_add_int(KEY_MIN_RSSI, s_priv_data.min_rssi), ESP_LOG_WARN, LOG_TAG,
+        RET_ON_ERR_WITH_LOG(esp_diag_metrics_report_int_h(s_priv_data.min_rssi_handle, s_priv_data.min_rssi), ESP_LOG_WARN, LOG_TAG,
                             "Failed to add Wi-Fi metrics key:" KEY_MIN_RSSI);
-#endif
         s_priv_data.prev_rssi = rssi;
         ESP_LOGI(LOG_TAG, "%s:%" PRIi32 " %s:%" PRIi32, KEY_RSSI, rssi, KEY_MIN_RSSI, s_priv_data.min_rssi);
     }
     if (!s_priv_data.status_sent) {
         // if for some reason we were not able to add the status, try again
-#ifndef CONFIG_ESP_INSIGHTS_META_VERSION_10
-        if (esp_diag_metrics_report_bool(METRICS_TAG, KEY_STATUS, s_priv_data.wifi_connected) == ESP_OK) {
+        if (esp_diag_metrics_report_bool_h(s_priv_data.status_handle, s_priv_data.wifi_connected) == ESP_OK) {
             s_priv_data.status_sent = true;
         }
-#else
-        if (esp_diag_metrics_add_bool(KEY_STATUS, s_priv_data.wifi_connected) == ESP_OK) {
-            s_priv_data.status_sent = true;
-        }
-#endif
     }
     return ESP_OK;
 }
@@ -179,9 +153,12 @@ esp_err_t esp_diag_wifi_metrics_init(void)
         ESP_LOGW(LOG_TAG, "Failed to set rssi threshold value");
     }
 #endif
-    esp_diag_metrics_register(METRICS_TAG, KEY_RSSI, "Wi-Fi RSSI", PATH_WIFI_STATION, ESP_DIAG_DATA_TYPE_INT);
-    esp_diag_metrics_register(METRICS_TAG, KEY_MIN_RSSI, "Minimum ever Wi-Fi RSSI", PATH_WIFI_STATION, ESP_DIAG_DATA_TYPE_INT);
-    esp_diag_metrics_register(METRICS_TAG, KEY_STATUS, "Wi-Fi connect status", PATH_WIFI_STATION, ESP_DIAG_DATA_TYPE_BOOL);
+    esp_diag_metrics_register_h(METRICS_TAG, KEY_RSSI, "Wi-Fi RSSI", PATH_WIFI_STATION, ESP_DIAG_DATA_TYPE_INT,
+                                &s_priv_data.rssi_handle);
+    esp_diag_metrics_register_h(METRICS_TAG, KEY_MIN_RSSI, "Minimum ever Wi-Fi RSSI", PATH_WIFI_STATION, ESP_DIAG_DATA_TYPE_INT,
+                                &s_priv_data.min_rssi_handle);
+    esp_diag_metrics_register_h(METRICS_TAG, KEY_STATUS, "Wi-Fi connect status", PATH_WIFI_STATION, ESP_DIAG_DATA_TYPE_BOOL,
+                                &s_priv_data.status_handle);
 #ifndef CONFIG_ESP_INSIGHTS_META_VERSION_10
     esp_diag_metrics_add_unit(METRICS_TAG, KEY_RSSI, METRICS_UNIT);
     esp_diag_metrics_add_unit(METRICS_TAG, KEY_MIN_RSSI, METRICS_UNIT);
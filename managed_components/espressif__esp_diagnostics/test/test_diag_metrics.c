@@ -0,0 +1,128 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <unity.h>
+#include <esp_timer.h>
+#include <inttypes.h>
+#include <esp_diagnostics_metrics.h>
+
+#define TAG              "diag_metrics_UT"
+#define METRICS_TAG      "test"
+#define METRICS_PATH     "test.metrics"
+#define MAX_METRICS      128
+
+static char keys[MAX_METRICS][8];
+
+static esp_err_t write_cb(const char *tag, void *data, size_t len, void *cb_arg)
+{
+    return ESP_OK;
+}
+
+static void metrics_init(void)
+{
+    esp_diag_metrics_config_t config = {
+        .write_cb = write_cb,
+    };
+    TEST_ASSERT(esp_diag_metrics_init(&config) == ESP_OK);
+    for (int i = 0; i < MAX_METRICS; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "key%d", i);
+    }
+}
+
+static esp_err_t report_uint(const char *key, uint32_t u)
+{
+#ifdef CONFIG_ESP_INSIGHTS_META_VERSION_10
+    return esp_diag_metrics_add_uint(key, u);
+#else
+    return esp_diag_metrics_report_uint(METRICS_TAG, key, u);
+#endif
+}
+
+static esp_err_t unregister(const char *key)
+{
+#ifdef CONFIG_ESP_INSIGHTS_META_VERSION_10
+    return esp_diag_metrics_unregister(key);
+#else
+    return esp_diag_metrics_unregister(METRICS_TAG, key);
+#endif
+}
+
+TEST_CASE("metrics handles", "[diag-metrics]")
+{
+    esp_diag_metrics_handle_t handles[3];
+
+    metrics_init();
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT(esp_diag_metrics_register_h(METRICS_TAG, keys[i], keys[i], METRICS_PATH,
+                                                ESP_DIAG_DATA_TYPE_UINT, &handles[i]) == ESP_OK);
+        TEST_ASSERT(handles[i] != 0);
+    }
+    TEST_ASSERT(esp_diag_metrics_report_uint_h(handles[0], 1) == ESP_OK);
+    TEST_ASSERT(esp_diag_metrics_report_int_h(handles[0], 1) == ESP_ERR_INVALID_ARG);
+
+    /* The last metrics takes the place of the unregistered one, its handle still works */
+    TEST_ASSERT(unregister(keys[0]) == ESP_OK);
+    TEST_ASSERT(esp_diag_metrics_report_uint_h(handles[0], 1) == ESP_ERR_NOT_FOUND);
+    TEST_ASSERT(esp_diag_metrics_report_uint_h(handles[2], 1) == ESP_OK);
+    TEST_ASSERT(report_uint(keys[0], 1) == ESP_ERR_NOT_FOUND);
+    TEST_ASSERT(report_uint(keys[1], 1) == ESP_OK);
+    TEST_ASSERT(report_uint(keys[2], 1) == ESP_OK);
+
+    /* Registering again reuses the slot, but not the handle */
+    esp_diag_metrics_handle_t handle;
+    TEST_ASSERT(esp_diag_metrics_register_h(METRICS_TAG, keys[0], keys[0], METRICS_PATH,
+                                            ESP_DIAG_DATA_TYPE_UINT, &handle) == ESP_OK);
+    TEST_ASSERT(handle != handles[0]);
+    TEST_ASSERT(esp_diag_metrics_report_uint_h(handles[0], 1) == ESP_ERR_NOT_FOUND);
+    TEST_ASSERT(esp_diag_metrics_report_uint_h(handle, 1) == ESP_OK);
+
+    TEST_ASSERT(esp_diag_metrics_unregister_all() == ESP_OK);
+    TEST_ASSERT(esp_diag_metrics_report_uint_h(handle, 1) == ESP_ERR_NOT_FOUND);
+    TEST_ASSERT(esp_diag_metrics_report_uint_h(handles[2], 1) == ESP_ERR_NOT_FOUND);
+    esp_diag_metrics_deinit();
+}
+
+TEST_CASE("metrics report by key and by handle", "[diag-metrics-perf]")
+{
+    const int counts[] = {8, 32, 128};
+    const int reports = 10000;
+    esp_diag_metrics_handle_t handles[MAX_METRICS];
+
+    metrics_init();
+    for (int c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        if (counts[c] > CONFIG_DIAG_METRICS_MAX_COUNT) {
+            ESP_LOGW(TAG, "%d metrics: skipped, CONFIG_DIAG_METRICS_MAX_COUNT is %d", counts[c],
+                     CONFIG_DIAG_METRICS_MAX_COUNT);
+            continue;
+        }
+        for (int i = 0; i < counts[c]; i++) {
+            TEST_ASSERT(esp_diag_metrics_register_h(METRICS_TAG, keys[i], keys[i], METRICS_PATH,
+                                                    ESP_DIAG_DATA_TYPE_UINT, &handles[i]) == ESP_OK);
+        }
+
+        /* Report every metrics in turn, as the periodic dumps do */
+        int64_t start = esp_timer_get_time();
+        for (int i = 0; i < reports; i++) {
+            TEST_ASSERT(report_uint(keys[i % counts[c]], i) == ESP_OK);
+        }
+        int64_t key_us = esp_timer_get_time() - start;
+
+        start = esp_timer_get_time();
+        for (int i = 0; i < reports; i++) {
+            TEST_ASSERT(esp_diag_metrics_report_uint_h(handles[i % counts[c]], i) == ESP_OK);
+        }
+        int64_t handle_us = esp_timer_get_time() - start;
+
+        ESP_LOGI(TAG, "%3d metrics: by key %" PRId64 " reports/s, by handle %" PRId64 " reports/s", counts[c],
+                 (int64_t) reports * 1000000 / key_us, (int64_t) reports * 1000000 / handle_us);
+        TEST_ASSERT(esp_diag_metrics_unregister_all() == ESP_OK);
+    }
+    esp_diag_metrics_deinit();
+}
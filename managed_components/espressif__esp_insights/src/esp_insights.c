@@ -253,6 +253,17 @@ static esp_err_t esp_insights_register_periodic_handler(esp_rmaker_work_fn_t wor
     return ret;
 }
 
+static void insights_periodic_handler(void *priv_data);
+
+/* Send again right away while the flash overflow tier of the data store holds data,
+ * so that it drains oldest first once connectivity returns */
+static void insights_drain_overflow(void)
+{
+    if (esp_diag_data_store_get_overflow_pending() && is_insights_active()) {
+        esp_rmaker_work_queue_add_task(insights_periodic_handler, NULL);
+    }
+}
+
 static void data_send_timeout_cb(TimerHandle_t handle)
 {
     xSemaphoreTake(s_insights_data.data_lock, portMAX_DELAY);
@@ -290,6 +301,7 @@ static void insights_event_handler(void* arg, esp_event_base_t event_base,
                     if (xTimerIsTimerActive(s_insights_data.data_send_timer) == pdTRUE) {
                         xTimerStop(s_insights_data.data_send_timer, portMAX_DELAY);
                     }
+                    insights_drain_overflow();
 #if SEND_INSIGHTS_META
                 } else if (s_insights_data.meta_msg_pending && data->msg_id == s_insights_data.meta_msg_id) {
 #if INSIGHTS_DEBUG_ENABLED
@@ -350,7 +362,7 @@ static void hex_dump(uint8_t *data, uint32_t len)
         if ((index % 16) == 0) {
             printf("\n");
         }
-        printf("0x%02x ", s_insights_data.scratch_buf[index]);
+        printf("0x%02x ", data[index]);
     }
     printf("\n");
 }
@@ -359,7 +371,7 @@ static void hex_dump(uint8_t *data, uint32_t len)
 static void insights_dbg_dump(uint8_t *data, uint32_t len)
 {
 #if CONFIG_ESP_INSIGHTS_DEBUG_PRINT_JSON
-    esp_insights_cbor_decode_dump((const uint8_t *) (s_insights_data.scratch_buf + 3), len - 3);
+    esp_insights_cbor_decode_dump((const uint8_t *) (data + 3), len - 3);
 #else
     hex_dump(data, len);
 #endif
@@ -422,20 +434,34 @@ static bool insights_meta_changed(void)
 static void send_insights_meta(void)
 {
     uint16_t len = 0;
+    uint8_t *buf = s_insights_data.scratch_buf;
+    size_t buf_size = INSIGHTS_DATA_MAX_SIZE;
+
+    /* The metadata grows with the number of registered metrics and variables.
+     * Measure it first, so that it is never truncated. */
+    size_t meta_size = esp_insights_encode_meta_size(s_insights_data.app_sha256);
+    if (meta_size > INSIGHTS_DATA_MAX_SIZE) {
+        buf = MEM_ALLOC_EXTRAM(meta_size);
+        if (!buf) {
+            ESP_LOGE(TAG, "Failed to allocate %d bytes for metadata", (int) meta_size);
+            return;
+        }
+        buf_size = meta_size;
+    }
 
-    memset(s_insights_data.scratch_buf, 0, INSIGHTS_DATA_MAX_SIZE);
-    len = esp_insights_encode_meta(s_insights_data.scratch_buf, INSIGHTS_DATA_MAX_SIZE, s_insights_data.app_sha256);
+    memset(buf, 0, buf_size);
+    len = esp_insights_encode_meta(buf, buf_size, s_insights_data.app_sha256);
     if (len == 0) {
 #if INSIGHTS_DEBUG_ENABLED
         ESP_LOGI(TAG, "No metadata to send");
 #endif
-        return;
+        goto out;
     }
 #if INSIGHTS_DEBUG_ENABLED
     ESP_LOGI(TAG, "Insights meta data length %d", len);
-    insights_dbg_dump(s_insights_data.scratch_buf, len);
+    insights_dbg_dump(buf, len);
 #endif
-    int msg_id = esp_insights_transport_data_send(s_insights_data.scratch_buf, len);
+    int msg_id = esp_insights_transport_data_send(buf, len);
     if (msg_id > 0) {
         xSemaphoreTake(s_insights_data.data_lock, portMAX_DELAY);
         s_insights_data.meta_msg_pending = true;
@@ -448,6 +474,10 @@ static void send_insights_meta(void)
         ESP_LOGI(TAG, "meta message send failed");
 #endif
     }
+out:
+    if (buf != s_insights_data.scratch_buf) {
+        free(buf);
+    }
 }
 #endif /* SEND_INSIGHTS_META */
 
@@ -550,6 +580,7 @@ static void send_insights_data(void)
     } else if (msg_id == 0) {
         esp_diag_data_store_critical_release(critical_consumed);
         s_insights_data.data_sent = true;
+        insights_drain_overflow();
     } else {
 #if INSIGHTS_DEBUG_ENABLED
         ESP_LOGI(TAG, "insights_data message send failed");
@@ -687,6 +718,13 @@ static esp_err_t log_write_cb(void *data, size_t len, void *priv_data)
     return ret_val;
 }
 
+#if CONFIG_DIAG_ENABLE_METRICS || CONFIG_DIAG_ENABLE_VARIABLES
+static uint64_t data_pt_time_base_cb(uint64_t ts, void *cb_arg)
+{
+    return esp_diag_data_store_get_time_base(ts);
+}
+#endif
+
 #if CONFIG_DIAG_ENABLE_METRICS
 static esp_err_t metrics_write_cb(const char *group, void *data, size_t len, void *cb_arg)
 {
@@ -699,12 +737,36 @@ static esp_err_t metrics_write_cb(const char *group, void *data, size_t len, voi
     return ret_val;
 }
 
+static esp_err_t metrics_writev_cb(const char *group, const esp_diag_metrics_iov_t *iov, int iovcnt, void *cb_arg)
+{
+    esp_diag_data_store_iov_t store_iov[ESP_DIAG_DATA_STORE_IOV_MAX];
+    if (iovcnt > ESP_DIAG_DATA_STORE_IOV_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < iovcnt; i++) {
+        store_iov[i].base = iov[i].base;
+        store_iov[i].len = iov[i].len;
+    }
+    esp_err_t ret_val = esp_diag_data_store_non_critical_writev(group, store_iov, iovcnt);
+#if INSIGHTS_DEBUG_ENABLED
+    if (ret_val != ESP_OK) {
+        ESP_LOGI(TAG, "esp_diag_data_store_non_critical_writev failed group %s, err 0x%04x", group, ret_val);
+    }
+#endif
+    return ret_val;
+}
+
 static void metrics_init(void)
 {
     /* Initialize and enable metrics */
     esp_diag_metrics_config_t metrics_config = {
         .write_cb = metrics_write_cb,
         .cb_arg = NULL,
+        .writev_cb = metrics_writev_cb,
+#if CONFIG_ESP_INSIGHTS_COMPACT_DATA_POINTS
+        .compact = true,
+        .time_base_cb = data_pt_time_base_cb,
+#endif
     };
     esp_err_t ret = esp_diag_metrics_init(&metrics_config);
     if (ret == ESP_OK) {
@@ -749,6 +811,10 @@ static void variables_init(void)
     esp_diag_variable_config_t variable_config = {
         .write_cb = variables_write_cb,
         .cb_arg = NULL,
+#if CONFIG_ESP_INSIGHTS_COMPACT_DATA_POINTS
+        .compact = true,
+        .time_base_cb = data_pt_time_base_cb,
+#endif
     };
     esp_err_t ret = esp_diag_variable_init(&variable_config);
     if (ret == ESP_OK) {
@@ -952,6 +1018,11 @@ esp_err_t esp_insights_enable(esp_insights_config_t *config)
     uint32_t new_crc, previous_crc;
     new_crc = esp_diag_data_store_get_crc();
     new_crc = esp_crc32_le(esp_diag_data_size_get_crc(), (const unsigned char *)&new_crc, sizeof(new_crc));
+#if CONFIG_ESP_INSIGHTS_COMPACT_DATA_POINTS
+    /* Record format differs, so data is discarded when switching to it or back to firmware without it */
+    const uint8_t compact_format = 1;
+    new_crc = esp_crc32_le(new_crc, &compact_format, sizeof(compact_format));
+#endif
     err = esp_insights_read_diag_data_store_crc_from_nvs(&previous_crc);
     if ((err != ESP_OK) || (new_crc != previous_crc)) {
         ESP_LOGI(TAG, "RTC Store configuration changed. Discarding previous data from RTC buffers");
@@ -301,21 +301,6 @@ CborType esp_insights_cbor_decode_get_value_type(cbor_parse_ctx_t *ctx)
     return cbor_value_get_type(&ctx->it[ctx->curr_itr]);
 }
 
-char *esp_insights_cbor_decoder_get_string(CborValue *val)
-{
-    CborError ret = CborNoError;
-    char *buf = NULL;
-    size_t n;
-    if (cbor_value_get_type(val) != CborTextStringType) {
-        return NULL;
-    }
-    ret = cbor_value_dup_text_string(val, &buf, &n, val);
-    if (ret == CborNoError) {
-        return (char *) buf;
-    }
-    return NULL;
-}
-
 esp_err_t esp_insights_cbor_decoder_enter_container(cbor_parse_ctx_t *ctx)
 {
     CborError ret = CborNoError;
@@ -372,10 +357,10 @@ cbor_parse_ctx_t *esp_insights_cbor_decoder_start(const uint8_t *buffer, int len
         ESP_LOGE(TAG, "failed to allocate cbor ctx");
         return NULL;
     }
-    CborParser root_parser = ctx->root_parser;
     CborValue *it = &ctx->it[0];
-    if (cbor_parser_init(buffer, len, 0, &root_parser, it) != CborNoError) {
+    if (cbor_parser_init(buffer, len, 0, &ctx->root_parser, it) != CborNoError) {
         ESP_LOGE(TAG, "Error initializing cbor parser");
+        free(ctx);
         return NULL;
     }
     return ctx;
@@ -31,7 +31,6 @@ bool esp_insights_cbor_decoder_at_end(cbor_parse_ctx_t *ctx);
 
 esp_err_t esp_insights_cbor_decoder_advance(cbor_parse_ctx_t *ctx);
 CborType esp_insights_cbor_decode_get_value_type(cbor_parse_ctx_t *ctx);
-char *esp_insights_cbor_decoder_get_string(CborValue *val);
 
 esp_err_t esp_insights_cbor_decoder_enter_container(cbor_parse_ctx_t *ctx);
 esp_err_t esp_insights_cbor_decoder_exit_container(cbor_parse_ctx_t *ctx);
@@ -5,6 +5,7 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 #include <esp_log.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -505,27 +506,149 @@ size_t esp_insights_cbor_encode_diag_logs(const uint8_t *data, size_t size)
 }
 
 #if (CONFIG_DIAG_ENABLE_METRICS || CONFIG_DIAG_ENABLE_VARIABLES)
-// {"n":<key>, "v": <value>, "t": <ts> }
-static void encode_str_data_pt(CborEncoder *array, const uint8_t *data)
+#ifndef CONFIG_ESP_INSIGHTS_META_VERSION_10
+#define DATA_PT_TAG(pt)     ((pt)->tag)
+#else
+#define DATA_PT_TAG(pt)     NULL    /* older metadata has no tag */
+#endif
+
+// "n": [<path>, <tag>, <key>] or "n": <key> for the older metadata format
+static void encode_data_pt_name(CborEncoder *map, uint16_t type, const char *tag, const char *key)
 {
-    CborEncoder map;
-    cbor_encoder_create_map(array, &map, CborIndefiniteLength);
-    esp_diag_str_data_pt_t *m_data = &enc_scratch_buf.str_data_pt;
-    // copy at aligned address to avoid potential alignment issue
-    memcpy(m_data, data, sizeof(esp_diag_str_data_pt_t));
-    cbor_encode_text_stringz(&map, "n");
+    cbor_encode_text_stringz(map, "n");
 #ifndef CONFIG_ESP_INSIGHTS_META_VERSION_10
-    char temp_path_key[10] = {0};
-    snprintf(temp_path_key, sizeof(temp_path_key), "%s", ((m_data->type & 0xffff)==ESP_DIAG_DATA_PT_METRICS)?METRICS_PATH_VALUE:VARIABLES_PATH_VALUE);
     CborEncoder key_arr;
-    cbor_encoder_create_array(&map, &key_arr, CborIndefiniteLength);
-    cbor_encode_text_stringz(&key_arr, temp_path_key);
-    cbor_encode_text_stringz(&key_arr, m_data->tag);
-    cbor_encode_text_stringz(&key_arr, m_data->key);
-    cbor_encoder_close_container(&map, &key_arr);
+    cbor_encoder_create_array(map, &key_arr, CborIndefiniteLength);
+    cbor_encode_text_stringz(&key_arr, (type == ESP_DIAG_DATA_PT_METRICS) ? METRICS_PATH_VALUE : VARIABLES_PATH_VALUE);
+    cbor_encode_text_stringz(&key_arr, tag);
+    cbor_encode_text_stringz(&key_arr, key);
+    cbor_encoder_close_container(map, &key_arr);
 #else
-    cbor_encode_text_stringz(&map, m_data->key);
+    cbor_encode_text_stringz(map, key);
+#endif
+}
+
+/* Finds the registry entry a compact data point refers to. Only the entry at the recorded index
+ * is trusted: the check is too short to tell entries apart, so if the registry changed since the
+ * point was recorded and the entry there does not match, the point is dropped. */
+static bool compact_pt_resolve(const esp_diag_compact_pt_t *c, const char **tag, const char **key)
+{
+    uint32_t count = 0;
+
+#if CONFIG_DIAG_ENABLE_METRICS
+    if (c->type == ESP_DIAG_DATA_PT_METRICS) {
+        const esp_diag_metrics_meta_t *meta = esp_diag_metrics_meta_get_all(&count);
+        if (meta && c->index < count && meta[c->index].type == c->data_type &&
+                esp_diag_compact_pt_check(meta[c->index].tag, meta[c->index].key) == c->check) {
+            *tag = meta[c->index].tag;
+            *key = meta[c->index].key;
+            return true;
+        }
+    }
+#endif
+#if CONFIG_DIAG_ENABLE_VARIABLES
+    if (c->type == ESP_DIAG_DATA_PT_VARIABLE) {
+        const esp_diag_variable_meta_t *meta = esp_diag_variable_meta_get_all(&count);
+        if (meta && c->index < count && meta[c->index].type == c->data_type &&
+                esp_diag_compact_pt_check(meta[c->index].tag, meta[c->index].key) == c->check) {
+            *tag = meta[c->index].tag;
+            *key = meta[c->index].key;
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+/* Expands a compact data point to esp_diag_data_pt_t or esp_diag_str_data_pt_t */
+static esp_diag_data_type_t compact_pt_load(const uint8_t *pt, size_t len, uint8_t meta_idx, uint16_t type,
+                                            void *out, size_t out_size)
+{
+    esp_diag_compact_pt_t c;
+    const char *tag = NULL, *key = NULL;
+    uint64_t ts;
+
+    if (esp_diag_compact_pt_decode(pt, len, &c) != ESP_OK || c.type != type) {
+        return ESP_DIAG_DATA_TYPE_NULL;
+    }
+    if (!compact_pt_resolve(&c, &tag, &key)) {
+#if INSIGHTS_DEBUG_ENABLED
+        printf("%s: no registry entry for index %d check %d, dropping\n", "insights_cbor_enocoder", c.index, c.check);
+#endif
+        return ESP_DIAG_DATA_TYPE_NULL;
+    }
+    ts = c.ts;
+    if (c.ts_relative) {
+        const rtc_store_meta_header_t *hdr = rtc_store_get_meta_record_by_index(meta_idx);
+        if (!hdr || !hdr->time_base) {
+            return ESP_DIAG_DATA_TYPE_NULL;
+        }
+        ts = hdr->time_base + c.ts;
+    }
+
+    if (c.data_type == ESP_DIAG_DATA_TYPE_STR) {
+        esp_diag_str_data_pt_t *str_pt = out;
+        if (out_size < sizeof(*str_pt)) {
+            return ESP_DIAG_DATA_TYPE_NULL;
+        }
+        memset(str_pt, 0, sizeof(*str_pt));
+        str_pt->type = c.type;
+        str_pt->data_type = c.data_type;
+#ifndef CONFIG_ESP_INSIGHTS_META_VERSION_10
+        strlcpy(str_pt->tag, tag, sizeof(str_pt->tag));
+#endif
+        strlcpy(str_pt->key, key, sizeof(str_pt->key));
+        str_pt->ts = ts;
+        strlcpy(str_pt->value.str, c.value.str, sizeof(str_pt->value.str));
+    } else {
+        esp_diag_data_pt_t *data_pt = out;
+        if (out_size < sizeof(*data_pt)) {
+            return ESP_DIAG_DATA_TYPE_NULL;
+        }
+        memset(data_pt, 0, sizeof(*data_pt));
+        data_pt->type = c.type;
+        data_pt->data_type = c.data_type;
+#ifndef CONFIG_ESP_INSIGHTS_META_VERSION_10
+        strlcpy(data_pt->tag, tag, sizeof(data_pt->tag));
 #endif
+        strlcpy(data_pt->key, key, sizeof(data_pt->key));
+        data_pt->ts = ts;
+        memcpy(&data_pt->value, &c.value, sizeof(data_pt->value));
+    }
+    return c.data_type;
+}
+
+/* Copies the data point of type at pt to out, of out_size bytes, at an aligned address.
+ * Returns its data type, or ESP_DIAG_DATA_TYPE_NULL if the record is not a data point of type. */
+static esp_diag_data_type_t data_pt_load(const uint8_t *pt, size_t len, uint8_t meta_idx, uint16_t type,
+                                         void *out, size_t out_size)
+{
+    uint32_t type_int;
+    esp_diag_data_type_t data_type;
+    size_t pt_size;
+
+    if (pt[0] & ESP_DIAG_COMPACT_PT_FLAG) {
+        return compact_pt_load(pt, len, meta_idx, type, out, out_size);
+    }
+    memcpy(&type_int, pt, 4); // copy, (b'cos alignment!)
+    if ((type_int & 0xffff) != type) {
+        return ESP_DIAG_DATA_TYPE_NULL;
+    }
+    data_type = (type_int >> 16) & 0xffff;
+    pt_size = (data_type == ESP_DIAG_DATA_TYPE_STR) ? sizeof(esp_diag_str_data_pt_t) : sizeof(esp_diag_data_pt_t);
+    if (len != pt_size || out_size < pt_size) {
+        return ESP_DIAG_DATA_TYPE_NULL;
+    }
+    memcpy(out, pt, pt_size);
+    return data_type;
+}
+
+// {"n":<key>, "v": <value>, "t": <ts> }
+static void encode_str_data_pt(CborEncoder *array, const esp_diag_str_data_pt_t *m_data)
+{
+    CborEncoder map;
+    cbor_encoder_create_map(array, &map, CborIndefiniteLength);
+    encode_data_pt_name(&map, m_data->type & 0xffff, DATA_PT_TAG(m_data), m_data->key);
     cbor_encode_text_stringz(&map, "v");
     cbor_encode_text_stringz(&map, m_data->value.str);
     cbor_encode_text_stringz(&map, "t");
@@ -534,26 +657,11 @@ static void encode_str_data_pt(CborEncoder *array, const uint8_t *data)
     cbor_encoder_close_container(array, &map);
 }
 
-static void encode_data_pt(CborEncoder *array, const uint8_t *data)
+static void encode_data_pt(CborEncoder *array, const esp_diag_data_pt_t *m_data)
 {
     CborEncoder map;
     cbor_encoder_create_map(array, &map, CborIndefiniteLength);
-    esp_diag_data_pt_t *m_data = &enc_scratch_buf.data_pt;
-    // copy at aligned address to avoid potential alignment issue
-    memcpy(m_data, data, sizeof(esp_diag_data_pt_t));
-    cbor_encode_text_stringz(&map, "n");
-#ifndef CONFIG_ESP_INSIGHTS_META_VERSION_10
-    char temp_path_key[10] = {0};
-    snprintf(temp_path_key, sizeof(temp_path_key), "%s", ((m_data->type & 0xffff)==ESP_DIAG_DATA_PT_METRICS)?METRICS_PATH_VALUE:VARIABLES_PATH_VALUE);
-    CborEncoder key_arr;
-    cbor_encoder_create_array(&map, &key_arr, CborIndefiniteLength);
-    cbor_encode_text_stringz(&key_arr, temp_path_key);
-    cbor_encode_text_stringz(&key_arr, m_data->tag);
-    cbor_encode_text_stringz(&key_arr, m_data->key);
-    cbor_encoder_close_container(&map, &key_arr);
-#else
-    cbor_encode_text_stringz(&map, m_data->key);
-#endif
+    encode_data_pt_name(&map, m_data->type & 0xffff, DATA_PT_TAG(m_data), m_data->key);
     cbor_encode_text_stringz(&map, "v");
     switch (m_data->data_type) {
         case ESP_DIAG_DATA_TYPE_BOOL:
@@ -587,73 +695,252 @@ static void encode_data_pt(CborEncoder *array, const uint8_t *data)
     cbor_encoder_close_container(array, &map);
 }
 
-static size_t encode_data_points(const uint8_t *data, size_t size, const char *key, uint16_t type)
+/* Walks the records of one meta index: [meta_idx][header][data point]... */
+typedef struct {
+    const uint8_t *data;
+    size_t size;        /* bytes left to walk */
+    size_t i;           /* offset of the next record */
+    uint8_t meta_idx;
+} data_pt_iter_t;
+
+static void data_pt_iter_init(data_pt_iter_t *it, const uint8_t *data, size_t size)
+{
+    it->data = data;
+    it->size = size;
+    it->i = 0;
+    it->meta_idx = data[0];
+}
+
+/* Returns the next data point and its length, or NULL after the last complete record */
+static const uint8_t *data_pt_iter_next(data_pt_iter_t *it, size_t *len)
 {
-    assert(key);
-    size_t i = 0;
-    CborEncoder array;
     /* FIXME */
     rtc_store_non_critical_data_hdr_t header;
-    esp_diag_data_type_t data_type;
+    const uint8_t *data = it->data;
+    size_t i = it->i;
 
-    if (!data || (size <= sizeof(header))) {
-        printf("%s: Invalid arg! data %p, size %d. line %d\n",
-                "insights_cbor_enocoder", data, size, __LINE__);
-        return 0;
+    if (it->size <= sizeof(header)) {
+        return NULL;
     }
-    cbor_encode_text_stringz(&s_diag_data_map, key);
-    cbor_encoder_create_array(&s_diag_data_map, &array, CborIndefiniteLength);
-
-    uint8_t meta_idx = data[0];
-    while (size > sizeof(header)) { // if remaining
-        if (data[i] != meta_idx) {
+    if (data[i] != it->meta_idx) {
 #if INSIGHTS_DEBUG_ENABLED
-            printf("%s: skip data for next iteration meta: %d, data[i]: %d, itr: %d\n",
-                    "insights_cbor_enocoder", meta_idx, data[i], i);
+        printf("%s: skip data for next iteration meta: %d, data[i]: %d, itr: %d\n",
+                "insights_cbor_enocoder", it->meta_idx, data[i], i);
 #endif
-            break; // do not encode for next meta info
-        }
-        i += 1; // skip meta_idx byte
-        size -= 1;
+        return NULL; // do not encode for next meta info
+    }
+    i += 1; // skip meta_idx byte
 
-        memcpy(&header, data + i, sizeof(header));
-        if (sizeof(header) + header.len > size) {
+    memcpy(&header, data + i, sizeof(header));
+    if (sizeof(header) + header.len > it->size - 1) {
 #if INSIGHTS_DEBUG_ENABLED
-            // partial record
-            printf("%s: partial record, needed %d, size %d\n",
-                    "insights_cbor_enocoder", sizeof(header) + header.len, size);
+        // partial record
+        printf("%s: partial record, needed %d, size %d\n",
+                "insights_cbor_enocoder", sizeof(header) + header.len, it->size - 1);
 #endif
-            i -= 1;
-            size += 1;
-            break;
-        }
+        return NULL;
+    }
 
-        if (!header.len) {
+    if (!header.len) {
 #if INSIGHTS_DEBUG_ENABLED
-            // invalid record
-            printf("%s: invalid record, header.len %d\n", "insights_cbor_enocoder", header.len);
+        // invalid record
+        printf("%s: invalid record, header.len %d\n", "insights_cbor_enocoder", header.len);
 
-            ESP_LOG_BUFFER_HEX_LEVEL("cbor_enc", data, size, ESP_LOG_INFO);
+        ESP_LOG_BUFFER_HEX_LEVEL("cbor_enc", data, it->size, ESP_LOG_INFO);
 #endif
-            i -= 1;
-            size += 1;
-            break;
+        return NULL;
+    }
+    it->i = i + sizeof(header) + header.len;
+    it->size -= 1 + sizeof(header) + header.len;
+    *len = header.len;
+    return data + i + sizeof(header);
+}
+
+#if CONFIG_ESP_INSIGHTS_GROUP_DATA_POINTS
+/* Numeric data points of the same metric/variable are sent as one element:
+ * {"n": <name>, "t": [<ts>, <delta>...], "v": <RFC 8746 typed array>}
+ * Each group walks the records again, so the number of groups per call is bounded
+ * and the points of any further key are encoded one by one. */
+#define DATA_PT_GROUPS_MAX      16
+#define DATA_PT_BATCH_MAX       32
+
+static struct {
+    size_t offset[DATA_PT_GROUPS_MAX];  /* offset of the first point of each group */
+    size_t len[DATA_PT_GROUPS_MAX];     /* length of the first point of each group */
+    uint8_t count;
+} s_groups;
+
+static struct {
+    esp_diag_data_pt_t first;           /* name of the batch and first timestamp */
+    esp_diag_data_pt_t pt;
+    uint64_t ts[DATA_PT_BATCH_MAX];
+    union {
+        uint8_t b[DATA_PT_BATCH_MAX];
+        int32_t i[DATA_PT_BATCH_MAX];
+        uint32_t u[DATA_PT_BATCH_MAX];
+        float f[DATA_PT_BATCH_MAX];
+    } v;
+    uint8_t count;
+} s_batch;
+
+static bool is_groupable(uint16_t data_type)
+{
+    return data_type == ESP_DIAG_DATA_TYPE_BOOL || data_type == ESP_DIAG_DATA_TYPE_INT ||
+           data_type == ESP_DIAG_DATA_TYPE_UINT || data_type == ESP_DIAG_DATA_TYPE_FLOAT;
+}
+
+static bool is_same_group(const esp_diag_data_pt_t *a, const esp_diag_data_pt_t *b)
+{
+    return a->type == b->type && a->data_type == b->data_type &&
+#ifndef CONFIG_ESP_INSIGHTS_META_VERSION_10
+           strncmp(a->tag, b->tag, sizeof(a->tag)) == 0 &&
+#endif
+           strncmp(a->key, b->key, sizeof(a->key)) == 0;
+}
+
+/* Loads the first point of group g */
+static esp_diag_data_type_t load_group(const uint8_t *data, uint8_t meta_idx, int g, uint16_t type,
+                                       esp_diag_data_pt_t *pt)
+{
+    return data_pt_load(data + s_groups.offset[g], s_groups.len[g], meta_idx, type, pt, sizeof(*pt));
+}
+
+/* Returns the index of the group of the point, or -1 if it has none */
+static int find_group(const uint8_t *data, uint8_t meta_idx, const esp_diag_data_pt_t *pt)
+{
+    for (int g = 0; g < s_groups.count; g++) {
+        if (load_group(data, meta_idx, g, pt->type, &s_batch.first) != ESP_DIAG_DATA_TYPE_NULL &&
+                is_same_group(&s_batch.first, pt)) {
+            return g;
+        }
+    }
+    return -1;
+}
+
+static void flush_batch(CborEncoder *array)
+{
+    static const CborTypedArrayType array_type[] = {
+        [ESP_DIAG_DATA_TYPE_BOOL] = CborTypedArrayUint8,
+        [ESP_DIAG_DATA_TYPE_INT] = CborTypedArraySint32,
+        [ESP_DIAG_DATA_TYPE_UINT] = CborTypedArrayUint32,
+        [ESP_DIAG_DATA_TYPE_FLOAT] = CborTypedArrayFloat32,
+    };
+    CborEncoder map, ts_arr;
+    esp_diag_data_pt_t *first = &s_batch.first;
+
+    if (!s_batch.count) {
+        return;
+    }
+    cbor_encoder_create_map(array, &map, CborIndefiniteLength);
+    encode_data_pt_name(&map, first->type, DATA_PT_TAG(first), first->key);
+    cbor_encode_text_stringz(&map, "t");
+    cbor_encoder_create_array(&map, &ts_arr, s_batch.count);
+    cbor_encode_uint(&ts_arr, s_batch.ts[0]);
+    for (int j = 1; j < s_batch.count; j++) {
+        // timestamps may go back when time gets synced
+        cbor_encode_int(&ts_arr, (int64_t) (s_batch.ts[j] - s_batch.ts[j - 1]));
+    }
+    cbor_encoder_close_container(&map, &ts_arr);
+    cbor_encode_text_stringz(&map, "v");
+    cbor_encode_typed_array(&map, array_type[first->data_type], &s_batch.v, s_batch.count);
+    cbor_encoder_close_container(array, &map);
+    s_batch.count = 0;
+}
+
+static void encode_data_pt_group(CborEncoder *array, const uint8_t *data, size_t size, int g, uint16_t type)
+{
+    data_pt_iter_t it;
+    const uint8_t *pt;
+    size_t len;
+    esp_diag_data_pt_t group;
+
+    data_pt_iter_init(&it, data, size);
+    if (load_group(data, it.meta_idx, g, type, &group) == ESP_DIAG_DATA_TYPE_NULL) {
+        return;
+    }
+    s_batch.count = 0;
+    while ((pt = data_pt_iter_next(&it, &len)) != NULL) {
+        if ((size_t) (pt - data) < s_groups.offset[g] ||
+                data_pt_load(pt, len, it.meta_idx, type, &s_batch.pt, sizeof(s_batch.pt)) == ESP_DIAG_DATA_TYPE_NULL ||
+                !is_same_group(&s_batch.pt, &group)) {
+            continue;
+        }
+        if (s_batch.count == 0) {
+            s_batch.first = s_batch.pt;
+        }
+        s_batch.ts[s_batch.count] = s_batch.pt.ts;
+        switch (group.data_type) {
+            case ESP_DIAG_DATA_TYPE_BOOL:
+                s_batch.v.b[s_batch.count] = s_batch.pt.value.b;
+                break;
+            case ESP_DIAG_DATA_TYPE_INT:
+                s_batch.v.i[s_batch.count] = s_batch.pt.value.i;
+                break;
+            case ESP_DIAG_DATA_TYPE_UINT:
+                s_batch.v.u[s_batch.count] = s_batch.pt.value.u;
+                break;
+            default:
+                s_batch.v.f[s_batch.count] = s_batch.pt.value.f;
+                break;
+        }
+        if (++s_batch.count == DATA_PT_BATCH_MAX) {
+            flush_batch(array);
         }
-        uint32_t type_int;
-        memcpy(&type_int, &data[i + sizeof(header)], 4); // copy, (b'cos alignment!)
-        if ((type_int & 0xffff) == type) {
-            data_type = (type_int >> 16) & 0xffff;
-            if (data_type == ESP_DIAG_DATA_TYPE_STR && header.len == sizeof(esp_diag_str_data_pt_t)) {
-                encode_str_data_pt(&array, data + i + sizeof(header));
-            } else if (header.len == sizeof(esp_diag_data_pt_t)) {
-                encode_data_pt(&array, data + i + sizeof(header));
+    }
+    flush_batch(array);
+}
+#endif /* CONFIG_ESP_INSIGHTS_GROUP_DATA_POINTS */
+
+static size_t encode_data_points(const uint8_t *data, size_t size, const char *key, uint16_t type)
+{
+    assert(key);
+    CborEncoder array;
+    data_pt_iter_t it;
+    const uint8_t *pt;
+    size_t len;
+    esp_diag_data_type_t data_type;
+
+    if (!data || (size <= sizeof(rtc_store_non_critical_data_hdr_t))) {
+        printf("%s: Invalid arg! data %p, size %d. line %d\n",
+                "insights_cbor_enocoder", data, size, __LINE__);
+        return 0;
+    }
+    cbor_encode_text_stringz(&s_diag_data_map, key);
+    cbor_encoder_create_array(&s_diag_data_map, &array, CborIndefiniteLength);
+
+#if CONFIG_ESP_INSIGHTS_GROUP_DATA_POINTS
+    s_groups.count = 0;
+#endif
+    data_pt_iter_init(&it, data, size);
+    while ((pt = data_pt_iter_next(&it, &len)) != NULL) {
+        // copy at aligned address to avoid potential alignment issue
+        data_type = data_pt_load(pt, len, it.meta_idx, type, &enc_scratch_buf, sizeof(enc_scratch_buf));
+        if (data_type == ESP_DIAG_DATA_TYPE_STR) {
+            encode_str_data_pt(&array, &enc_scratch_buf.str_data_pt);
+        } else if (data_type != ESP_DIAG_DATA_TYPE_NULL) {
+#if CONFIG_ESP_INSIGHTS_GROUP_DATA_POINTS
+            if (is_groupable(data_type)) {
+                /* encoded with its group below, if there is room for one more group */
+                if (find_group(data, it.meta_idx, &enc_scratch_buf.data_pt) >= 0) {
+                    continue;
+                }
+                if (s_groups.count < DATA_PT_GROUPS_MAX) {
+                    s_groups.offset[s_groups.count] = pt - data;
+                    s_groups.len[s_groups.count++] = len;
+                    continue;
+                }
             }
+#endif
+            encode_data_pt(&array, &enc_scratch_buf.data_pt);
         }
-        size -= (sizeof(header) + header.len);
-        i += (sizeof(header) + header.len);
     }
+#if CONFIG_ESP_INSIGHTS_GROUP_DATA_POINTS
+    for (int g = 0; g < s_groups.count; g++) {
+        encode_data_pt_group(&array, data, it.i, g, type);
+    }
+#endif
     cbor_encoder_close_container(&s_diag_data_map, &array);
-    return i;
+    return it.i;
 }
 #endif /* (CONFIG_DIAG_ENABLE_METRICS || CONFIG_DIAG_ENABLE_VARIABLES) */
 
@@ -673,9 +960,19 @@ size_t  esp_insights_cbor_encode_diag_variables(const uint8_t *data, size_t size
 
 /* Below are the helpers to encode esp insights meta data */
 
+static size_t s_meta_size;
+
 void esp_insights_cbor_encode_meta_begin(void *data, size_t data_size, const char *version, const char *sha256)
 {
-    cbor_encoder_init(&s_meta_encoder, data, data_size, 0);
+    /* Encode the metadata deterministically (sorted keys, definite lengths),
+     * so that unchanged metadata always results in the same bytes. */
+    if (data) {
+        cbor_encoder_init(&s_meta_encoder, data, data_size, CborEncoderFlag_Deterministic);
+    } else {
+        /* measure pass: only compute the encoded size */
+        s_meta_size = 0;
+        cbor_encoder_init_measure(&s_meta_encoder, &s_meta_size, CborEncoderFlag_Deterministic);
+    }
     cbor_encoder_create_map(&s_meta_encoder, &s_meta_result_map, 1);
     cbor_encode_text_stringz(&s_meta_result_map, "diagmeta");
     cbor_encoder_create_map(&s_meta_result_map, &s_diag_meta_map, CborIndefiniteLength);
@@ -693,6 +990,13 @@ size_t esp_insights_cbor_encode_meta_end(void *data)
 {
     cbor_encoder_close_container(&s_meta_result_map, &s_diag_meta_map);
     cbor_encoder_close_container(&s_meta_encoder, &s_meta_result_map);
+    if (!data) {
+        return s_meta_size;
+    }
+    if (cbor_encoder_get_extra_bytes_needed(&s_meta_encoder)) {
+        ESP_LOGE(TAG, "Meta data needs %d more bytes", (int) cbor_encoder_get_extra_bytes_needed(&s_meta_encoder));
+        return 0;
+    }
     return cbor_encoder_get_buffer_size(&s_meta_encoder, data);
 }
 
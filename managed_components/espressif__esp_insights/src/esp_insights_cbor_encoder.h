@@ -64,7 +64,8 @@ size_t esp_insights_cbor_encode_diag_variables(const uint8_t *data, size_t size)
 void esp_insights_cbor_encode_diag_data_end(void);
 size_t esp_insights_cbor_encode_diag_end(void *data);
 
-/* For encoding diag meta data */
+/* For encoding diag meta data. With data set to NULL, only the encoded size is computed
+ * and returned by esp_insights_cbor_encode_meta_end(NULL) */
 void esp_insights_cbor_encode_meta_begin(void *data, size_t data_size, const char *version, const char *sha256);
 void esp_insights_cbor_encode_meta_data_begin(void);
 #if CONFIG_DIAG_ENABLE_METRICS
@@ -25,8 +25,8 @@ static const char *TAG = "insights_cmd_resp";
 #include "esp_insights_internal.h"
 #include "esp_insights_cbor_decoder.h"
 #include "esp_insights_cbor_encoder.h"
+#include "esp_insights_cmd_schema.h"
 
-#define INS_CONF_STR            "config"
 #define RMAKER_CFG_TOPIC_SUFFIX "config"
 #define TO_NODE_TOPIC_SUFFIX    "to-node"
 #define FROM_NODE_TOPIC_SUFFIX  "from-node"
@@ -35,8 +35,9 @@ static const char *TAG = "insights_cmd_resp";
  */
 #define INSIGHTS_CONF_CMD       0x101
 
-/* depth is dictated by cmd_depth */
+/* depth is dictated by cmd_depth, keep both in sync with `n` in esp_insights_cmd_schema.txt */
 #define MAX_CMD_DEPTH 10
+#define MAX_CMD_NAME_LEN 32 /* including the NUL */
 #define CMD_STORE_SIZE 10
 #define SCRATCH_BUF_SIZE (1 * 1024)
 
@@ -124,7 +125,7 @@ esp_err_t esp_insights_cmd_resp_register_cmd(esp_insights_cmd_cb_t cb, void *prv
     return ESP_OK;
 }
 
-static esp_err_t insights_cmd_resp_search_execute_cmd_store(char **cmd_tree, int cmd_depth)
+static esp_err_t insights_cmd_resp_search_execute_cmd_store(const char cmd_tree[][MAX_CMD_NAME_LEN], int cmd_depth)
 {
     for(int i = 0; i< s_cmd_resp_data.cmd_cnt; i++) {
         if (cmd_depth == s_cmd_resp_data.cmd_store[i].depth) {
@@ -146,36 +147,7 @@ static esp_err_t insights_cmd_resp_search_execute_cmd_store(char **cmd_tree, int
     return ESP_ERR_NOT_FOUND;
 }
 
-static void insights_cmd_parser_clear_cmd_tree(char *cmd_tree[])
-{
-    for (int i = 0; i < MAX_CMD_DEPTH; i++) {
-        if (cmd_tree[i]) {
-            free(cmd_tree[i]);
-            cmd_tree[i] = NULL;
-        } else {
-            return;
-        }
-    }
-}
-
-static void insights_cmd_parser_add_cmd_to_tree(char * cmd_tree[], char *cmd, int pos)
-{
-    ESP_LOGV(TAG, "Adding %s to command path\n", cmd);
-    /* free depth already consumed */
-    for (int i = pos; i < MAX_CMD_DEPTH; i++) {
-        if (cmd_tree[i]) {
-            free(cmd_tree[i]);
-            cmd_tree[i] = NULL;
-        } else {
-            break;
-        }
-    }
-
-    /* insert at the position */
-    cmd_tree[pos] = cmd;
-}
-
-static void insights_cmd_parser_print_cmd_tree(const char *cmd_tree[], int depth)
+static void insights_cmd_parser_print_cmd_tree(const char cmd_tree[][MAX_CMD_NAME_LEN], int depth)
 {
     if (depth <= 0) {
         ESP_LOGI(TAG, "No command found to be printed");
@@ -183,251 +155,97 @@ static void insights_cmd_parser_print_cmd_tree(const char *cmd_tree[], int depth
     }
     printf("The command is: ");
     for (int i = 0; i < depth - 1; i++) {
-        if (cmd_tree[i]) {
-            printf("%s > ", cmd_tree[i]);
-        } else {
-            printf("\ncouldn't find complete depth\n");
-            return;
-        }
-    }
-    if (cmd_tree[depth - 1]) {
-        printf("%s\n", cmd_tree[depth - 1]);
-    } else {
-        printf("\ncouldn't find complete depth\n");
+        printf("%s > ", cmd_tree[i]);
     }
+    printf("%s\n", cmd_tree[depth - 1]);
 }
 
 #define MAX_BUFFER_SIZE 100
 
-/* extract top level fields from CBOR and check for sanity */
-esp_err_t check_top_fields_from_cbor(const uint8_t *cbor_data, size_t cbor_data_len)
+/* The informational fields are only logged, a value of another type is not an error */
+static void insights_cmd_resp_log_text(const char *key, const CborValue *value)
 {
-    CborParser parser;
-    CborValue map, value;
-    CborError err;
-
-    /* Initialize the parser */
-    cbor_parser_init(cbor_data, cbor_data_len, 0, &parser, &map);
-
-    /* Parse the top-level map */
-    if (!cbor_value_is_map(&map)) {
-        ESP_LOGE(TAG, "Invalid CBOR format: top-level map expected");
-        return ESP_FAIL;
-    }
-
-    if (CborNoError != cbor_value_enter_container(&map, &value)) {
-        ESP_LOGE(TAG, "Error entering the container");
-        return ESP_FAIL;
+    char buffer[MAX_BUFFER_SIZE];
+    size_t buffer_size = sizeof(buffer);
+    if (!cbor_value_is_text_string(value)) {
+        ESP_LOGE(TAG, "Invalid CBOR format: text string expected as %s key", key);
+        return;
     }
-
-    /* Iterate through the map and extract the desired fields */
-    while (!cbor_value_at_end(&value)) {
-        CborValue map_key;
-
-        /* Check the map key and extract the corresponding field */
-        if (cbor_value_is_text_string(&value)) {
-            char buffer[MAX_BUFFER_SIZE];
-            size_t buffer_size = sizeof(buffer);
-            err = cbor_value_copy_text_string(&value, buffer, &buffer_size, &map_key);
-            if (err != CborNoError) {
-                ESP_LOGE(TAG, "CBOR value copy text string failed: %d", err);
-                return ESP_FAIL;
-            }
-
-            buffer_size = sizeof(buffer);
-            if (strcmp(buffer, "ver") == 0) {
-                if (cbor_value_is_text_string(&map_key)) {
-                    err = cbor_value_copy_text_string(&map_key, buffer, &buffer_size, &map_key);
-                    if (err != CborNoError) {
-                        ESP_LOGE(TAG, "CBOR value copy text string failed: %d", err);
-                        return ESP_FAIL;
-                    }
-                    ESP_LOGI(TAG, "ver: %s", buffer);
-                } else {
-                    ESP_LOGE(TAG, "Invalid CBOR format: text string expected as ver key");
-                }
-            } else if (strcmp(buffer, "ts") == 0) {
-                CborType _type = cbor_value_get_type(&map_key);
-                ESP_LOGI(TAG, "ts is of type %d", _type);
-            } else if (strcmp(buffer, "sha256") == 0) {
-                if (cbor_value_is_text_string(&map_key)) {
-                    err = cbor_value_copy_text_string(&map_key, buffer, &buffer_size, &map_key);
-                    if (err != CborNoError) {
-                        ESP_LOGE(TAG, "CBOR value copy text string failed: %d", err);
-                        return ESP_FAIL;
-                    }
-                    ESP_LOGI(TAG, "sha256: %s", buffer);
-                } else {
-                    ESP_LOGE(TAG, "Invalid CBOR format: text string expected as sha256 key");
-                }
-            } else if (strcmp(buffer, INS_CONF_STR) == 0) {
-                /* Nothing to do here */
-            }
-
-            /* skip this string now */
-            err = cbor_value_advance(&value);
-            if (err != CborNoError) {
-                ESP_LOGE(TAG, "CBOR value advance failed: %d", err);
-                return ESP_FAIL;
-            }
-        }
-
-        /* advance the value */
-        CborType _type = cbor_value_get_type(&value);
-        ESP_LOGI(TAG, "Skipping type %d", _type);
-        err = cbor_value_advance(&value);
-        if (err != CborNoError) {
-            ESP_LOGE(TAG, "CBOR value advance failed: %d", err);
-            return ESP_FAIL;
-        }
+    /* copies chunked strings too */
+    if (cbor_value_copy_text_string(value, buffer, &buffer_size, NULL) != CborNoError) {
+        ESP_LOGE(TAG, "CBOR value copy text string failed for %s", key);
+        return;
     }
-    return ESP_OK;
+    ESP_LOGI(TAG, "%s: %s", key, buffer);
 }
 
 /**
- * @brief Get next config entry from data
+ * @brief Decode the top level of the config payload
  *
+ * The layout of the payload is described in esp_insights_cmd_schema.txt. The config entries are left
+ * for esp_insights_cmd_resp_execute(), the other fields are only logged.
  */
-static esp_err_t esp_insights_cmd_resp_parse_one_entry(cbor_parse_ctx_t *ctx)
+static esp_err_t esp_insights_cmd_resp_decode(CborParser *parser, const uint8_t *cbor_data, size_t cbor_data_len,
+                                              insights_cmd_resp_t *msg)
 {
-    char *tmp_str = NULL;
-    int cmd_depth = 0;
-    bool cmd_value_b;
-    size_t val_sz = 0;
-    esp_err_t ret = ESP_OK;
-    char *cmd_tree[MAX_CMD_DEPTH] = {0, };
-
-    /* parse till we are at the end */
-    while (!esp_insights_cbor_decoder_at_end(ctx)) {
-        CborType type = esp_insights_cbor_decode_get_value_type(ctx);
-        CborValue *it = &ctx->it[ctx->curr_itr];
-        switch (type)
-        {
-        case CborTextStringType:
-            tmp_str = esp_insights_cbor_decoder_get_string(it);
-            if (!tmp_str) {
-                return ESP_FAIL;
-            }
-            ESP_LOGI(TAG, "found \"%s\"", tmp_str);
-            if (strcmp(tmp_str, "n") == 0) {
-                CborType _type = esp_insights_cbor_decode_get_value_type(ctx);
-                if (_type == CborArrayType) {
-                    if (esp_insights_cbor_decoder_enter_container(ctx) == ESP_OK) {
-                        while(!esp_insights_cbor_decoder_at_end(ctx)) {
-                            char *buffer = esp_insights_cbor_decoder_get_string(&ctx->it[ctx->curr_itr]);
-                            if (!buffer) {
-                                ESP_LOGE(TAG, "Invalid entry");
-                                break;
-                            }
-                            insights_cmd_parser_add_cmd_to_tree(cmd_tree, buffer, cmd_depth);
-                            ++cmd_depth;
-                        }
-
-                        insights_cmd_parser_print_cmd_tree((const char **) cmd_tree, cmd_depth);
-                        esp_insights_cbor_decoder_exit_container(ctx);
-                    }
-                } else {
-                    ESP_LOGE(TAG, "A config name must be of array type");
-                }
-            } else if (strcmp(tmp_str, "v") == 0) {
-                /* decide the type of the value first and then fetch it (bool for now) */
-                esp_diag_data_type_t type = ESP_DIAG_DATA_TYPE_BOOL;
-                /* get the value in val */
-                switch (type)
-                {
-                case ESP_DIAG_DATA_TYPE_BOOL:
-                    cbor_value_get_boolean(it, &cmd_value_b);
-                    val_sz = 1;
-                    break;
-                default:
-                    val_sz = 0;
-                    break;
-                }
-                cbor_value_advance_fixed(it);
-            } else {
-                esp_insights_cbor_decoder_advance(ctx);
-            }
-
-            if (tmp_str) {
-                free(tmp_str);
-                tmp_str = NULL;
-            }
-            break;
+    CborValue it;
+    CborError err = cbor_parser_init(cbor_data, cbor_data_len, 0, parser, &it);
+    if (err == CborNoError) {
+        err = insights_cmd_resp_decode(&it, msg);
+    }
+    if (err == CborNoError && !cbor_value_is_array(&msg->config)) {
+        err = CborErrorSchemaTypeMismatch;
+    }
+    if (err != CborNoError) {
+        ESP_LOGE(TAG, "invalid cmd_resp payload: %s", cbor_error_string(err));
+        return ESP_FAIL;
+    }
 
-        default:
-            esp_insights_cbor_decoder_advance(ctx);
-            break;
+    if (msg->present & INSIGHTS_CMD_RESP_VER_PRESENT) {
+        insights_cmd_resp_log_text("ver", &msg->ver);
+    }
+    if (msg->present & INSIGHTS_CMD_RESP_TS_PRESENT) {
+        uint64_t ts;
+        if (cbor_value_is_unsigned_integer(&msg->ts)) {
+            cbor_value_get_uint64(&msg->ts, &ts);
+            ESP_LOGI(TAG, "ts: %llu", (unsigned long long) ts);
+        } else {
+            ESP_LOGI(TAG, "ts is of type %d", cbor_value_get_type(&msg->ts));
         }
     }
-
-    insights_cmd_resp_search_execute_cmd_store(cmd_tree, cmd_depth);
-    insights_cmd_parser_clear_cmd_tree(cmd_tree);
-
-    return ret;
+    if (msg->present & INSIGHTS_CMD_RESP_SHA256_PRESENT) {
+        insights_cmd_resp_log_text("sha256", &msg->sha256);
+    }
+    return ESP_OK;
 }
 
-static esp_err_t esp_insights_cmd_resp_parse_execute(cbor_parse_ctx_t *ctx)
+static esp_err_t esp_insights_cmd_resp_execute(const insights_cmd_resp_t *msg)
 {
-    esp_insights_cbor_decoder_enter_container(ctx);
+    insights_cmd_t cmd;
+    CborValue entry;
     int cmd_cnt = 0;
-    /* iterate till we are done with current container */
-    while (!esp_insights_cbor_decoder_at_end(ctx)) {
-        esp_insights_cbor_decoder_enter_container(ctx);
-        esp_insights_cmd_resp_parse_one_entry(ctx);
-        esp_insights_cbor_decoder_exit_container(ctx);
+
+    /* the payload is well formed, it was walked over by esp_insights_cmd_resp_decode() */
+    CborError err = cbor_value_enter_container(&msg->config, &entry);
+    while (err == CborNoError && !cbor_value_at_end(&entry)) {
+        /* an entry that does not decode is skipped, the others are still executed */
+        CborError cmd_err = cbor_schema_decode(&entry, &insights_cmd_schema, &cmd);
+        if (cmd_err == CborNoError) {
+            insights_cmd_parser_print_cmd_tree(cmd.n, cmd.n_count);
+            insights_cmd_resp_search_execute_cmd_store(cmd.n, cmd.n_count);
+        } else {
+            ESP_LOGE(TAG, "skipping invalid config entry %d: %s", cmd_cnt, cbor_error_string(cmd_err));
+        }
+        err = cbor_value_advance(&entry);
         cmd_cnt++;
     }
     if (cmd_cnt) {
         esp_insights_report_config_update();
     }
-    esp_insights_cbor_decoder_exit_container(ctx);
     ESP_LOGI(TAG, "parsed and executed %d commands", cmd_cnt);
     return ESP_OK;
 }
 
-static esp_err_t esp_insights_cmd_resp_iterate_to_cmds_array(cbor_parse_ctx_t *ctx)
-{
-    /* layer one */
-    if (esp_insights_cbor_decoder_at_end(ctx)) {
-        ESP_LOGW(TAG, "invalid cmd_resp payload");
-        return ESP_FAIL;
-    }
-
-    if (esp_insights_cbor_decode_get_value_type(ctx) != CborMapType) {
-        ESP_LOGE(TAG, "invalid cmd_resp payload. line (%d)", __LINE__);
-        return ESP_FAIL;
-    }
-
-    if (esp_insights_cbor_decoder_enter_container(ctx) == ESP_OK) {
-        while(!esp_insights_cbor_decoder_at_end(ctx)) {
-            char *buffer = esp_insights_cbor_decoder_get_string(&ctx->it[ctx->curr_itr]);
-
-            if (!buffer) {
-                ESP_LOGE(TAG, "Parsing problem...");
-                return ESP_FAIL;
-            }
-
-            if (strcmp(buffer, INS_CONF_STR) == 0) {
-                free(buffer);
-                buffer = NULL;
-                ESP_LOGI(TAG, "Found commands array:");
-                return ESP_OK;
-            } else {
-                ESP_LOGI(TAG, "skipping token %s", buffer);
-            }
-            free(buffer);
-            buffer = NULL;
-            /* skip the value and find next for INS_CONF_STR */
-            esp_insights_cbor_decoder_advance(ctx);
-        }
-        ESP_LOGI(TAG, "failed to find a `config` array!");
-        return ESP_FAIL;
-    }
-
-    ESP_LOGI(TAG, "invalid payload type");
-    return ESP_FAIL;
-}
-
 static char resp_data[100]; /* FIXME: assumed that the response size is < 100 bytes */
 /** This is a common handler registered with the lower layer command response framework.
  * It parses the received CBOR payload aqnd redirects to appropriate internal insights command callback. */
@@ -446,24 +264,15 @@ static esp_err_t esp_insights_cmd_handler(const void *in_data, size_t in_len, vo
     esp_insights_cbor_decode_dump((uint8_t *) in_data, in_len);
 #endif
 
-    if (ESP_FAIL == check_top_fields_from_cbor(in_data, in_len)) {
-        snprintf(resp_data, sizeof(resp_data), "{\"status\":\"payload error\"}");
-        goto out;
-    }
-    cbor_parse_ctx_t *cbor_ctx = esp_insights_cbor_decoder_start(in_data, in_len);
-    if (cbor_ctx) {
-        ret = esp_insights_cmd_resp_iterate_to_cmds_array(cbor_ctx);
-        if (ret == ESP_OK) {
-            esp_insights_cmd_resp_parse_execute(cbor_ctx); /* it is okay if this is empty */
-            snprintf(resp_data, sizeof(resp_data), "{\"status\":\"success\"}");
-        } else {
-            snprintf(resp_data, sizeof(resp_data), "{\"status\":\"payload error\"}");
-        }
-        esp_insights_cbor_decoder_done(cbor_ctx);
+    CborParser parser;
+    insights_cmd_resp_t msg;
+    ret = esp_insights_cmd_resp_decode(&parser, in_data, in_len, &msg);
+    if (ret == ESP_OK) {
+        esp_insights_cmd_resp_execute(&msg); /* it is okay if this is empty */
+        snprintf(resp_data, sizeof(resp_data), "{\"status\":\"success\"}");
     } else {
-        snprintf(resp_data, sizeof(resp_data), "{\"status\":\"internal error\"}");
+        snprintf(resp_data, sizeof(resp_data), "{\"status\":\"payload error\"}");
     }
-out:
     *out_data = resp_data;
     *out_len = strlen(resp_data);
     return ret;
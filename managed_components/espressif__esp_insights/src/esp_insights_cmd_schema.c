@@ -0,0 +1,27 @@
+/* Generated by cborschema.pl from esp_insights_cmd_schema.txt. Do not edit. */
+
+#include "esp_insights_cmd_schema.h"
+
+#include <stddef.h>
+
+static const CborSchemaField insights_cmd_fields[] = {
+    { "n", 1, CborSchemaTextCopy, CborSchemaFieldRequired | CborSchemaFieldArray, offsetof(struct insights_cmd, n), sizeof(((struct insights_cmd *)0)->n[0]), 10, offsetof(struct insights_cmd, n_count), NULL },
+    { "v", 1, CborSchemaAny, 0, offsetof(struct insights_cmd, v), sizeof(((struct insights_cmd *)0)->v), 0, 0, NULL },
+};
+static const uint8_t insights_cmd_slots[] = { 1, 2 };
+
+const CborSchemaMessage insights_cmd_schema = {
+    insights_cmd_fields, insights_cmd_slots, sizeof(struct insights_cmd), 34U, 0x1U, 2, 1
+};
+
+static const CborSchemaField insights_cmd_resp_fields[] = {
+    { "ver", 3, CborSchemaAny, 0, offsetof(struct insights_cmd_resp, ver), sizeof(((struct insights_cmd_resp *)0)->ver), 0, 0, NULL },
+    { "ts", 2, CborSchemaAny, 0, offsetof(struct insights_cmd_resp, ts), sizeof(((struct insights_cmd_resp *)0)->ts), 0, 0, NULL },
+    { "sha256", 6, CborSchemaAny, 0, offsetof(struct insights_cmd_resp, sha256), sizeof(((struct insights_cmd_resp *)0)->sha256), 0, 0, NULL },
+    { "config", 6, CborSchemaAny, CborSchemaFieldRequired, offsetof(struct insights_cmd_resp, config), sizeof(((struct insights_cmd_resp *)0)->config), 0, 0, NULL },
+};
+static const uint8_t insights_cmd_resp_slots[] = { 3, 4, 1, 2 };
+
+const CborSchemaMessage insights_cmd_resp_schema = {
+    insights_cmd_resp_fields, insights_cmd_resp_slots, sizeof(struct insights_cmd_resp), 10U, 0x8U, 4, 3
+};
@@ -0,0 +1,53 @@
+/* Generated by cborschema.pl from esp_insights_cmd_schema.txt. Do not edit. */
+
+#ifndef ESP_INSIGHTS_CMD_SCHEMA_H
+#define ESP_INSIGHTS_CMD_SCHEMA_H
+
+#include <cborschema.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define INSIGHTS_CMD_N_PRESENT 0x1U
+#define INSIGHTS_CMD_V_PRESENT 0x2U
+typedef struct insights_cmd
+{
+    uint32_t present;
+    char n[10][32];
+    size_t n_count;
+    CborValue v;
+} insights_cmd_t;
+
+extern const CborSchemaMessage insights_cmd_schema;
+
+static inline CborError insights_cmd_decode(CborValue *it, insights_cmd_t *out)
+{
+    return cbor_schema_decode_advance(it, &insights_cmd_schema, out);
+}
+
+#define INSIGHTS_CMD_RESP_VER_PRESENT 0x1U
+#define INSIGHTS_CMD_RESP_TS_PRESENT 0x2U
+#define INSIGHTS_CMD_RESP_SHA256_PRESENT 0x4U
+#define INSIGHTS_CMD_RESP_CONFIG_PRESENT 0x8U
+typedef struct insights_cmd_resp
+{
+    uint32_t present;
+    CborValue ver;
+    CborValue ts;
+    CborValue sha256;
+    CborValue config;
+} insights_cmd_resp_t;
+
+extern const CborSchemaMessage insights_cmd_resp_schema;
+
+static inline CborError insights_cmd_resp_decode(CborValue *it, insights_cmd_resp_t *out)
+{
+    return cbor_schema_decode_advance(it, &insights_cmd_resp_schema, out);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESP_INSIGHTS_CMD_SCHEMA_H */
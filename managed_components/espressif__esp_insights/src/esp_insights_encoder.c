@@ -56,9 +56,20 @@ static void esp_insights_encode_meta_data(void)
 #endif /* CONFIG_DIAG_ENABLE_VARIABLES */
 }
 
+size_t esp_insights_encode_meta_size(char *sha256)
+{
+    char sha[DIAG_HEX_SHA_SIZE + 1];
+    bytes_to_hex((uint8_t *) sha256,(uint8_t *) sha, DIAG_SHA_SIZE);
+    esp_insights_cbor_encode_meta_begin(NULL, 0, INSIGHTS_META_VERSION, sha);
+    esp_insights_cbor_encode_meta_data_begin();
+    esp_insights_encode_meta_data();
+    esp_insights_cbor_encode_meta_data_end();
+    return esp_insights_cbor_encode_meta_end(NULL) + TLV_OFFSET;
+}
+
 size_t esp_insights_encode_meta(uint8_t *out_data, size_t out_data_size, char *sha256)
 {
-    if (!out_data || !out_data_size) {
+    if (!out_data || out_data_size <= TLV_OFFSET) {
         return 0;
     }
     char sha[DIAG_HEX_SHA_SIZE + 1];
@@ -69,7 +80,11 @@ size_t esp_insights_encode_meta(uint8_t *out_data, size_t out_data_size, char *s
     esp_insights_cbor_encode_meta_data_begin();
     esp_insights_encode_meta_data();
     esp_insights_cbor_encode_meta_data_end();
-    uint16_t len = esp_insights_cbor_encode_meta_end(out_data + TLV_OFFSET);
+    size_t encoded_len = esp_insights_cbor_encode_meta_end(out_data + TLV_OFFSET);
+    if (encoded_len == 0 || encoded_len > UINT16_MAX) {
+        return 0;
+    }
+    uint16_t len = encoded_len;
 
     out_data[0] = INSIGHTS_META_DATA_TYPE;      /* Data type inidcation diagnostics meta - 1 byte */
     memcpy(&out_data[1], &len, sizeof(len));    /* Data length - 2 bytes */
@@ -10,6 +10,13 @@
 #include <esp_core_dump.h>
 #endif
 
+/**
+ * @brief compute the exact size of the message encoded by esp_insights_encode_meta()
+ *
+ * @param sha256 application sha256
+ * @return size_t size of the buffer needed, including the TLV header
+ */
+size_t esp_insights_encode_meta_size(char *sha256);
 size_t esp_insights_encode_meta(uint8_t *out_data, size_t out_data_size, char *sha256);
 size_t esp_insights_encode_conf_meta(uint8_t *out_data, size_t out_data_size, char *sha256);
 esp_err_t esp_insights_encode_data_begin(uint8_t *out_data, size_t out_data_size);
@@ -117,6 +117,41 @@ typedef struct mdns_result_s {
     mdns_ip_addr_t *addr;                   /*!< linked list of IP addresses found */
 } mdns_result_t;
 
+/**
+ * @brief   mDNS transmit scheduler statistics
+ *          Used in mdns_tx_stats_get()
+ */
+typedef struct {
+    uint32_t queue_depth;                   /*!< number of packets currently scheduled for sending */
+    uint32_t queue_depth_max;               /*!< maximum number of packets scheduled at the same time */
+    uint32_t sent;                          /*!< number of scheduled packets handled by the mDNS task */
+    uint32_t lateness_max_ms;               /*!< maximum delay between the scheduled and the actual transmit time */
+    uint64_t lateness_total_ms;             /*!< sum of delays of all handled packets (divide by `sent` to get the average) */
+} mdns_tx_stats_t;
+
+/**
+ * @brief   Preallocated object pools (see CONFIG_MDNS_MEMORY_POOLS)
+ */
+typedef enum {
+    MDNS_POOL_ACTION = 0,                   /*!< actions posted to the mDNS task */
+    MDNS_POOL_RX_PACKET,                    /*!< received packets waiting for the mDNS task */
+    MDNS_POOL_PARSED_PACKET,                /*!< packets being parsed */
+    MDNS_POOL_OUT_ANSWER,                   /*!< answers of outgoing packets */
+    MDNS_POOL_TX_PACKET,                    /*!< outgoing packets */
+    MDNS_POOL_MAX
+} mdns_pool_id_t;
+
+/**
+ * @brief   Usage of one preallocated pool
+ *          Used in mdns_pool_stats_get()
+ */
+typedef struct {
+    uint32_t size;                          /*!< number of preallocated blocks */
+    uint32_t used;                          /*!< number of blocks currently in use */
+    uint32_t high_water;                    /*!< maximum number of blocks in use at the same time */
+    uint32_t heap_fallbacks;                /*!< number of allocations served from the heap because the pool was exhausted */
+} mdns_pool_stats_t;
+
 typedef void (*mdns_query_notify_t)(mdns_search_once_t *search);
 typedef void (*mdns_browse_notify_t)(mdns_result_t *result);
 
@@ -692,6 +727,9 @@ mdns_search_once_t *mdns_query_async_new(const char *name, const char *service_t
  * @brief  Generic mDNS query
  *         All following query methods are derived from this one
  *
+ * @note   With CONFIG_MDNS_RECORD_CACHE, PTR, SRV, TXT, A and AAAA queries are answered
+ *         immediately if the records received from other hosts are still valid.
+ *
  * @param  name         service instance or host name (NULL for PTR queries)
  * @param  service_type service type (_http, _arduino, _ftp etc.) (NULL for host queries)
  * @param  proto        service protocol (_tcp, _udp, etc.) (NULL for host queries)
@@ -930,6 +968,35 @@ mdns_browse_t *mdns_browse_new(const char *service, const char *proto, mdns_brow
  */
 esp_err_t mdns_browse_delete(const char *service, const char *proto);
 
+/**
+ * @brief   Get statistics of the transmit scheduler
+ *
+ * @param  stats    Pointer to the structure to fill
+ * @param  reset    Clear the counters (except current queue depth) after reading them
+ *
+ * @return
+ *     - ESP_OK                 success
+ *     - ESP_ERR_INVALID_ARG    stats is NULL
+ *     - ESP_ERR_INVALID_STATE  mDNS is not running
+ */
+esp_err_t mdns_tx_stats_get(mdns_tx_stats_t *stats, bool reset);
+
+/**
+ * @brief   Get usage of a preallocated object pool
+ *
+ * @note    `high_water` close to `size` or non-zero `heap_fallbacks` suggest increasing
+ *          the corresponding CONFIG_MDNS_POOL_* option
+ *
+ * @param  pool     Pool to query
+ * @param  stats    Pointer to the structure to fill
+ *
+ * @return
+ *     - ESP_OK                 success
+ *     - ESP_ERR_INVALID_ARG    invalid pool or stats is NULL
+ *     - ESP_ERR_NOT_SUPPORTED  pools are disabled (CONFIG_MDNS_MEMORY_POOLS)
+ */
+esp_err_t mdns_pool_stats_get(mdns_pool_id_t pool, mdns_pool_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -5,6 +5,7 @@
  */
 
 #include <string.h>
+#include <ctype.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
@@ -17,6 +18,7 @@
 #include "mdns_private.h"
 #include "mdns_networking.h"
 #include "mdns_mem_caps.h"
+#include "mdns_mem_pool.h"
 
 static void _mdns_browse_item_free(mdns_browse_t *browse);
 static esp_err_t _mdns_send_browse_action(mdns_action_type_t type, mdns_browse_t *browse);
@@ -57,7 +59,10 @@ static const char *MDNS_SUB_STR = "_sub";
 
 mdns_server_t *_mdns_server = NULL;
 static mdns_host_item_t *_mdns_host_list = NULL;
+static mdns_host_item_t *_mdns_host_index[MDNS_INDEX_BUCKETS];
 static mdns_host_item_t _mdns_self_host;
+static bool _mdns_tx_overflow;  // an append ran out of room in the packet being built
+static mdns_fqdn_dict_t _mdns_fqdn_dict;
 
 static const char *TAG = "mdns";
 
@@ -67,6 +72,7 @@ static StackType_t *_mdns_stack_buffer;
 
 static void _mdns_search_finish_done(void);
 static mdns_search_once_t *_mdns_search_find_from(mdns_search_once_t *search, mdns_name_t *name, uint16_t type, mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol);
+static void _mdns_search_suppress_duplicate(mdns_name_t *name, uint16_t type, mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol);
 static mdns_browse_t *_mdns_browse_find_from(mdns_browse_t *b, mdns_name_t *name, uint16_t type, mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol);
 static void _mdns_browse_result_add_srv(mdns_browse_t *browse, const char *hostname, const char *instance, const char *service, const char *proto,
                                         uint16_t port, mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol, uint32_t ttl, mdns_browse_sync_t *out_sync_browse);
@@ -95,6 +101,12 @@ static void _mdns_remap_self_service_hostname(const char *old_hostname, const ch
 static esp_err_t mdns_post_custom_action_tcpip_if(mdns_if_t mdns_if, mdns_event_actions_t event_action);
 
 static void _mdns_query_results_free(mdns_result_t *results);
+#if CONFIG_MDNS_RECORD_CACHE
+static void _mdns_cache_add_record(const uint8_t *data, size_t len, const uint8_t *data_ptr, uint16_t data_len,
+                                   mdns_name_t *name, uint16_t type, bool flush, uint32_t ttl, bool wanted,
+                                   mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol);
+static void _mdns_cache_remove_pcb(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol);
+#endif
 typedef enum {
     MDNS_IF_STA = 0,
     MDNS_IF_AP = 1,
@@ -279,6 +291,96 @@ static bool _mdns_service_match(const mdns_service_t *srv, const char *service,
            (_str_null_or_empty(hostname) || !strcasecmp(srv->hostname, hostname));
 }
 
+/**
+ * @brief  Case-insensitive FNV-1a hash of a name (folds ASCII like strcasecmp() does)
+ */
+static uint32_t _mdns_name_hash(uint32_t hash, const char *name)
+{
+    while (*name) {
+        uint8_t c = (uint8_t) * name++;
+        if (c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        }
+        hash = (hash ^ c) * 16777619u;
+    }
+    return hash;
+}
+
+static inline size_t _mdns_service_bucket(const char *service, const char *proto)
+{
+    uint32_t hash = _mdns_name_hash(2166136261u, service);
+    return _mdns_name_hash(hash ^ '.', proto) % MDNS_INDEX_BUCKETS;
+}
+
+static inline size_t _mdns_host_bucket(const char *hostname)
+{
+    return _mdns_name_hash(2166136261u, hostname) % MDNS_INDEX_BUCKETS;
+}
+
+/**
+ * @brief  Links a service item to the index
+ *
+ * @note   Must be called whenever the item is prepended to the services list,
+ *         so that items in the same bucket keep the order of the list
+ */
+static void _mdns_service_index_add(mdns_srv_item_t *item)
+{
+    mdns_srv_item_t **bucket = &_mdns_server->services_index[_mdns_service_bucket(item->service->service, item->service->proto)];
+    item->index_next = *bucket;
+    *bucket = item;
+}
+
+/**
+ * @brief  Unlinks a service item from the index
+ */
+static void _mdns_service_index_remove(mdns_srv_item_t *item)
+{
+    mdns_srv_item_t **s = &_mdns_server->services_index[_mdns_service_bucket(item->service->service, item->service->proto)];
+    while (*s) {
+        if (*s == item) {
+            *s = item->index_next;
+            item->index_next = NULL;
+            return;
+        }
+        s = &(*s)->index_next;
+    }
+}
+
+static void _mdns_host_index_add(mdns_host_item_t *host)
+{
+    mdns_host_item_t **bucket = &_mdns_host_index[_mdns_host_bucket(host->hostname)];
+    host->index_next = *bucket;
+    *bucket = host;
+}
+
+static void _mdns_host_index_remove(mdns_host_item_t *host)
+{
+    mdns_host_item_t **h = &_mdns_host_index[_mdns_host_bucket(host->hostname)];
+    while (*h) {
+        if (*h == host) {
+            *h = host->index_next;
+            host->index_next = NULL;
+            return;
+        }
+        h = &(*h)->index_next;
+    }
+}
+
+/**
+ * @brief  finds delegated host item from the host index
+ */
+static mdns_host_item_t *_mdns_get_delegated_host_item(const char *hostname)
+{
+    mdns_host_item_t *host = _mdns_host_index[_mdns_host_bucket(hostname)];
+    while (host != NULL) {
+        if (strcasecmp(host->hostname, hostname) == 0) {
+            return host;
+        }
+        host = host->index_next;
+    }
+    return NULL;
+}
+
 /**
  * @brief  finds service from given service type
  * @param  server       the server
@@ -290,19 +392,25 @@ static bool _mdns_service_match(const mdns_service_t *srv, const char *service,
  */
 static mdns_srv_item_t *_mdns_get_service_item(const char *service, const char *proto, const char *hostname)
 {
-    mdns_srv_item_t *s = _mdns_server->services;
+    if (!service || !proto) {
+        return NULL;
+    }
+    mdns_srv_item_t *s = _mdns_server->services_index[_mdns_service_bucket(service, proto)];
     while (s) {
         if (_mdns_service_match(s->service, service, proto, hostname)) {
             return s;
         }
-        s = s->next;
+        s = s->index_next;
     }
     return NULL;
 }
 
 static mdns_srv_item_t *_mdns_get_service_item_subtype(const char *subtype, const char *service, const char *proto)
 {
-    mdns_srv_item_t *s = _mdns_server->services;
+    if (!service || !proto) {
+        return NULL;
+    }
+    mdns_srv_item_t *s = _mdns_server->services_index[_mdns_service_bucket(service, proto)];
     while (s) {
         if (_mdns_service_match(s->service, service, proto, NULL)) {
             mdns_subtype_t *subtype_item = s->service->subtype;
@@ -313,7 +421,7 @@ static mdns_srv_item_t *_mdns_get_service_item_subtype(const char *subtype, cons
                 subtype_item = subtype_item->next;
             }
         }
-        s = s->next;
+        s = s->index_next;
     }
     return NULL;
 }
@@ -323,14 +431,7 @@ static mdns_host_item_t *mdns_get_host_item(const char *hostname)
     if (hostname == NULL || strcasecmp(hostname, _mdns_server->hostname) == 0) {
         return &_mdns_self_host;
     }
-    mdns_host_item_t *host = _mdns_host_list;
-    while (host != NULL) {
-        if (strcasecmp(host->hostname, hostname) == 0) {
-            return host;
-        }
-        host = host->next;
-    }
-    return NULL;
+    return _mdns_get_delegated_host_item(hostname);
 }
 
 static bool _mdns_can_add_more_services(void)
@@ -355,7 +456,7 @@ esp_err_t _mdns_send_rx_action(mdns_rx_packet_t *packet)
 {
     mdns_action_t *action = NULL;
 
-    action = (mdns_action_t *)mdns_mem_malloc(sizeof(mdns_action_t));
+    action = (mdns_action_t *)mdns_mem_pool_malloc(MDNS_POOL_ACTION, sizeof(mdns_action_t));
     if (!action) {
         HOOK_MALLOC_FAILED;
         return ESP_ERR_NO_MEM;
@@ -364,7 +465,7 @@ esp_err_t _mdns_send_rx_action(mdns_rx_packet_t *packet)
     action->type = ACTION_RX_HANDLE;
     action->data.rx_handle.packet = packet;
     if (xQueueSend(_mdns_server->action_queue, &action, (TickType_t)0) != pdPASS) {
-        mdns_mem_free(action);
+        mdns_mem_pool_free(MDNS_POOL_ACTION, action);
         return ESP_ERR_NO_MEM;
     }
     return ESP_OK;
@@ -422,7 +523,10 @@ static bool _mdns_service_match_instance(const mdns_service_t *srv, const char *
 static mdns_srv_item_t *_mdns_get_service_item_instance(const char *instance, const char *service, const char *proto,
                                                         const char *hostname)
 {
-    mdns_srv_item_t *s = _mdns_server->services;
+    if (!service || !proto) {
+        return NULL;
+    }
+    mdns_srv_item_t *s = _mdns_server->services_index[_mdns_service_bucket(service, proto)];
     while (s) {
         if (instance) {
             if (_mdns_service_match_instance(s->service, instance, service, proto, hostname)) {
@@ -433,7 +537,7 @@ static mdns_srv_item_t *_mdns_get_service_item_instance(const char *instance, co
                 return s;
             }
         }
-        s = s->next;
+        s = s->index_next;
     }
     return NULL;
 }
@@ -502,6 +606,19 @@ static const uint8_t *_mdns_read_fqdn(const uint8_t *packet, const uint8_t *star
     return start + index + 1;
 }
 
+/**
+ * @brief  checks if data ending at `end` would not fit the packet and remembers the overflow,
+ *         so that the dispatcher can continue in the next packet
+ */
+static inline bool _mdns_packet_overflows(uint32_t end)
+{
+    if (end >= MDNS_MAX_PACKET_SIZE) {
+        _mdns_tx_overflow = true;
+        return true;
+    }
+    return false;
+}
+
 /**
  * @brief  sets uint16_t value in a packet
  *
@@ -529,7 +646,7 @@ static inline void _mdns_set_u16(uint8_t *packet, uint16_t index, uint16_t value
  */
 static inline uint8_t _mdns_append_u8(uint8_t *packet, uint16_t *index, uint8_t value)
 {
-    if (*index >= MDNS_MAX_PACKET_SIZE) {
+    if (_mdns_packet_overflows(*index)) {
         return 0;
     }
     packet[*index] = value;
@@ -548,7 +665,7 @@ static inline uint8_t _mdns_append_u8(uint8_t *packet, uint16_t *index, uint8_t
  */
 static inline uint8_t _mdns_append_u16(uint8_t *packet, uint16_t *index, uint16_t value)
 {
-    if ((*index + 1) >= MDNS_MAX_PACKET_SIZE) {
+    if (_mdns_packet_overflows(*index + 1)) {
         return 0;
     }
     _mdns_append_u8(packet, index, (value >> 8) & 0xFF);
@@ -567,7 +684,7 @@ static inline uint8_t _mdns_append_u16(uint8_t *packet, uint16_t *index, uint16_
  */
 static inline uint8_t _mdns_append_u32(uint8_t *packet, uint16_t *index, uint32_t value)
 {
-    if ((*index + 3) >= MDNS_MAX_PACKET_SIZE) {
+    if (_mdns_packet_overflows(*index + 3)) {
         return 0;
     }
     _mdns_append_u8(packet, index, (value >> 24) & 0xFF);
@@ -589,7 +706,7 @@ static inline uint8_t _mdns_append_u32(uint8_t *packet, uint16_t *index, uint32_
  */
 static inline uint8_t _mdns_append_type(uint8_t *packet, uint16_t *index, uint8_t type, bool flush, uint32_t ttl)
 {
-    if ((*index + 10) >= MDNS_MAX_PACKET_SIZE) {
+    if (_mdns_packet_overflows(*index + 10)) {
         return 0;
     }
     uint16_t mdns_class = MDNS_CLASS_IN;
@@ -621,7 +738,7 @@ static inline uint8_t _mdns_append_type(uint8_t *packet, uint16_t *index, uint8_
 
 static inline uint8_t _mdns_append_string_with_len(uint8_t *packet, uint16_t *index, const char *string, uint8_t len)
 {
-    if ((*index + len + 1) >= MDNS_MAX_PACKET_SIZE) {
+    if (_mdns_packet_overflows(*index + len + 1)) {
         return 0;
     }
     _mdns_append_u8(packet, index, len);
@@ -642,7 +759,7 @@ static inline uint8_t _mdns_append_string_with_len(uint8_t *packet, uint16_t *in
 static inline uint8_t _mdns_append_string(uint8_t *packet, uint16_t *index, const char *string)
 {
     uint8_t len = strlen(string);
-    if ((*index + len + 1) >= MDNS_MAX_PACKET_SIZE) {
+    if (_mdns_packet_overflows(*index + len + 1)) {
         return 0;
     }
     _mdns_append_u8(packet, index, len);
@@ -669,7 +786,7 @@ static inline int append_one_txt_record_entry(uint8_t *packet, uint16_t *index,
     }
     size_t key_len = strlen(txt->key);
     size_t len = key_len + txt->value_len + (txt->value ? 1 : 0);
-    if ((*index + len + 1) >= MDNS_MAX_PACKET_SIZE) {
+    if (_mdns_packet_overflows(*index + len + 1)) {
         return 0;
     }
     _mdns_append_u8(packet, index, len);
@@ -685,7 +802,7 @@ static inline int append_one_txt_record_entry(uint8_t *packet, uint16_t *index,
 #ifdef CONFIG_MDNS_RESPOND_REVERSE_QUERIES
 static inline int append_single_str(uint8_t *packet, uint16_t *index, const char *str, int len)
 {
-    if ((*index + len + 1) >= MDNS_MAX_PACKET_SIZE) {
+    if (_mdns_packet_overflows(*index + len + 1)) {
         return 0;
     }
     if (!_mdns_append_u8(packet, index, len)) {
@@ -736,6 +853,130 @@ static uint16_t append_fqdn_dots(uint8_t *packet, uint16_t *index, const char *n
 }
 #endif /* CONFIG_MDNS_RESPOND_REVERSE_QUERIES */
 
+/**
+ * @brief  checks if the name at `location` in the packet is the FQDN from the strings
+ */
+static bool _mdns_fqdn_matches(const uint8_t *packet, const uint8_t *location, const char *strings[], uint8_t count, size_t packet_len)
+{
+    static char buf[MDNS_NAME_BUF_LEN];
+    mdns_name_t name;
+    uint8_t len = strlen(strings[0]);
+    //check if the string after location is the string that we are looking for
+    if (*location != len || memcmp(location + 1, strings[0], len)) {
+        return false;
+    }
+    //read the destination into name and compare
+    name.parts = 0;
+    name.sub = 0;
+    name.invalid = false;
+    name.host[0] = 0;
+    name.service[0] = 0;
+    name.proto[0] = 0;
+    name.domain[0] = 0;
+    if (!_mdns_read_fqdn(packet, location, &name, buf, packet_len)) {
+        return false; // not a readable fqdn, could be our unfinished fqdn
+    }
+    if (name.parts != count) {
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        if (strcasecmp(strings[i], (const char *)&name + (i * (MDNS_NAME_BUF_LEN)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief  searches the packet for the first occurrence of the FQDN from the strings
+ */
+static const uint8_t *_mdns_fqdn_search(const uint8_t *packet, uint16_t index, const char *strings[], uint8_t count, size_t packet_len)
+{
+    uint8_t len = strlen(strings[0]);
+    //try to find first the string length in the packet (if it exists)
+    const uint8_t *len_location = (const uint8_t *)memchr(packet, (char)len, index);
+    while (len_location) {
+        if (_mdns_fqdn_matches(packet, len_location, strings, count, packet_len)) {
+            return len_location;
+        }
+        //try and find the length byte further in the packet
+        len_location = (const uint8_t *)memchr(len_location + 1, (char)len, index - (len_location + 1 - packet));
+    }
+    return NULL;
+}
+
+/**
+ * @brief  starts the name compression dictionary of a new packet
+ */
+static void _mdns_fqdn_dict_reset(const uint8_t *packet)
+{
+    memset(&_mdns_fqdn_dict, 0, sizeof(_mdns_fqdn_dict));
+    _mdns_fqdn_dict.packet = packet;
+}
+
+/**
+ * @brief  case insensitive FNV-1a hash of the FQDN from the strings
+ */
+static uint32_t _mdns_fqdn_hash(const char *strings[], uint8_t count)
+{
+    uint32_t hash = 2166136261UL;
+    for (uint8_t i = 0; i < count; i++) {
+        for (const char *c = strings[i]; *c; c++) {
+            hash = (hash ^ (uint8_t)tolower((unsigned char)*c)) * 16777619UL;
+        }
+        hash = (hash ^ '.') * 16777619UL;
+    }
+    return hash;
+}
+
+/**
+ * @brief  remembers that the FQDN with the hash starts at `offset` of the packet
+ */
+static void _mdns_fqdn_dict_add(const uint8_t *packet, uint32_t hash, uint16_t offset)
+{
+    mdns_fqdn_dict_t *dict = &_mdns_fqdn_dict;
+    if (dict->packet != packet || dict->overflow) {
+        return;
+    }
+    if (dict->entries >= MDNS_FQDN_DICT_SIZE * 3 / 4) {
+        dict->overflow = true;
+        return;
+    }
+    uint16_t slot = hash & (MDNS_FQDN_DICT_SIZE - 1);
+    while (dict->offset[slot]) {
+        slot = (slot + 1) & (MDNS_FQDN_DICT_SIZE - 1);
+    }
+    dict->hash[slot] = hash;
+    dict->offset[slot] = offset;
+    dict->entries++;
+}
+
+/**
+ * @brief  finds the first occurrence of the FQDN from the strings in the packet
+ *
+ * Only names written by _mdns_append_fqdn() are in the dictionary, entries from answers which were
+ * rolled back are verified against the packet content, so the result is the same as of _mdns_fqdn_search()
+ */
+static const uint8_t *_mdns_fqdn_find(const uint8_t *packet, uint16_t index, const char *strings[], uint8_t count,
+                                      uint32_t hash, size_t packet_len)
+{
+    mdns_fqdn_dict_t *dict = &_mdns_fqdn_dict;
+    if (dict->packet != packet || dict->overflow) {
+        return _mdns_fqdn_search(packet, index, strings, count, packet_len);
+    }
+    uint16_t found = 0;
+    uint16_t slot = hash & (MDNS_FQDN_DICT_SIZE - 1);
+    while (dict->offset[slot]) {
+        uint16_t offset = dict->offset[slot];
+        if (dict->hash[slot] == hash && offset < index && (!found || offset < found)
+                && _mdns_fqdn_matches(packet, packet + offset, strings, count, packet_len)) {
+            found = offset;
+        }
+        slot = (slot + 1) & (MDNS_FQDN_DICT_SIZE - 1);
+    }
+    return found ? packet + found : NULL;
+}
+
 /**
  * @brief  appends FQDN to a packet, incrementing the index and
  *         compressing the output if previous occurrence of the string (or part of it) has been found
@@ -753,53 +994,16 @@ static uint16_t _mdns_append_fqdn(uint8_t *packet, uint16_t *index, const char *
         //empty string so terminate
         return _mdns_append_u8(packet, index, 0);
     }
-    static char buf[MDNS_NAME_BUF_LEN];
-    uint8_t len = strlen(strings[0]);
-    //try to find first the string length in the packet (if it exists)
-    uint8_t *len_location = (uint8_t *)memchr(packet, (char)len, *index);
-    while (len_location) {
-        mdns_name_t name;
-        //check if the string after len_location is the string that we are looking for
-        if (memcmp(len_location + 1, strings[0], len)) { //not continuing with our string
-search_next:
-            //try and find the length byte further in the packet
-            len_location = (uint8_t *)memchr(len_location + 1, (char)len, *index - (len_location + 1 - packet));
-            continue;
-        }
-        //seems that we might have found the string that we are looking for
-        //read the destination into name and compare
-        name.parts = 0;
-        name.sub = 0;
-        name.invalid = false;
-        name.host[0] = 0;
-        name.service[0] = 0;
-        name.proto[0] = 0;
-        name.domain[0] = 0;
-        const uint8_t *content = _mdns_read_fqdn(packet, len_location, &name, buf, packet_len);
-        if (!content) {
-            //not a readable fqdn?
-            goto search_next; // could be our unfinished fqdn, continue searching
-        }
-        if (name.parts == count) {
-            uint8_t i;
-            for (i = 0; i < count; i++) {
-                if (strcasecmp(strings[i], (const char *)&name + (i * (MDNS_NAME_BUF_LEN)))) {
-                    //not our string! let's search more
-                    goto search_next;
-                }
-            }
-            //we actually have found the string
-            break;
-        } else {
-            goto search_next;
-        }
-    }
+    uint32_t hash = _mdns_fqdn_hash(strings, count);
+    const uint8_t *len_location = _mdns_fqdn_find(packet, *index, strings, count, hash, packet_len);
     //string is not yet in the packet, so let's add it
     if (!len_location) {
+        uint16_t offset = *index;
         uint8_t written = _mdns_append_string(packet, index, strings[0]);
         if (!written) {
             return 0;
         }
+        _mdns_fqdn_dict_add(packet, hash, offset);
         //run the same for the other strings in the name
         return written + _mdns_append_fqdn(packet, index, &strings[1], count - 1, packet_len);
     }
@@ -1129,7 +1333,7 @@ static uint16_t _mdns_append_a_record(uint8_t *packet, uint16_t *index, const ch
 
     uint16_t data_len_location = *index - 2;
 
-    if ((*index + 3) >= MDNS_MAX_PACKET_SIZE) {
+    if (_mdns_packet_overflows(*index + 3)) {
         return 0;
     }
     _mdns_append_u8(packet, index, ip & 0xFF);
@@ -1182,7 +1386,7 @@ static uint16_t _mdns_append_aaaa_record(uint8_t *packet, uint16_t *index, const
 
     uint16_t data_len_location = *index - 2;
 
-    if ((*index + MDNS_ANSWER_AAAA_SIZE) > MDNS_MAX_PACKET_SIZE) {
+    if (_mdns_packet_overflows(*index + MDNS_ANSWER_AAAA_SIZE - 1)) {
         return 0;
     }
 
@@ -1345,24 +1549,43 @@ static uint8_t _mdns_append_reverse_ptr_record(uint8_t *packet, uint16_t *index,
 /**
  * @brief  Append PTR answers to packet
  *
+ * Records are appended one by one, if the packet runs out of room it is left with the records which fit,
+ * so that the rest can continue in the next packet
+ *
+ * @param  first_record number of records to skip (sent already in the previous packet)
+ *
  *  @return number of answers added to the packet
  */
 static uint8_t _mdns_append_service_ptr_answers(uint8_t *packet, uint16_t *index, mdns_service_t *service, bool flush,
-                                                bool bye)
+                                                bool bye, uint8_t first_record)
 {
     uint8_t appended_answers = 0;
+    uint8_t record = 0;
+    uint16_t start = *index;
 
-    if (_mdns_append_ptr_record(packet, index, _mdns_get_service_instance_name(service), service->service,
-                                service->proto, flush, bye) <= 0) {
-        return appended_answers;
+    if (record++ >= first_record) {
+        if (_mdns_append_ptr_record(packet, index, _mdns_get_service_instance_name(service), service->service,
+                                    service->proto, flush, bye) <= 0) {
+            *index = start;
+            return appended_answers;
+        }
+        appended_answers++;
     }
-    appended_answers++;
 
     mdns_subtype_t *subtype = service->subtype;
     while (subtype) {
-        appended_answers +=
-            (_mdns_append_subtype_ptr_record(packet, index, _mdns_get_service_instance_name(service), subtype->subtype,
-                                             service->service, service->proto, flush, bye) > 0);
+        if (record++ >= first_record) {
+            start = *index;
+            if (_mdns_append_subtype_ptr_record(packet, index, _mdns_get_service_instance_name(service), subtype->subtype,
+                                                service->service, service->proto, flush, bye) > 0) {
+                appended_answers++;
+            } else {
+                *index = start;
+                if (_mdns_tx_overflow) {
+                    break;
+                }
+            }
+        }
         subtype = subtype->next;
     }
 
@@ -1373,9 +1596,13 @@ static uint8_t _mdns_append_service_ptr_answers(uint8_t *packet, uint16_t *index
 /**
  * @brief  Append answer to packet
  *
+ * @param  first_record number of records of the answer to skip, if it continues from the previous packet
+ *                      (only PTR answers of a service, which include the subtypes, are split across packets)
+ *
  *  @return number of answers added to the packet
  */
-static uint8_t _mdns_append_answer(uint8_t *packet, uint16_t *index, mdns_out_answer_t *answer, mdns_if_t tcpip_if)
+static uint8_t _mdns_append_answer(uint8_t *packet, uint16_t *index, mdns_out_answer_t *answer, mdns_if_t tcpip_if,
+                                   uint8_t first_record)
 {
     if (answer->host) {
         bool is_host_valid = (&_mdns_self_host == answer->host);
@@ -1393,7 +1620,7 @@ static uint8_t _mdns_append_answer(uint8_t *packet, uint16_t *index, mdns_out_an
 
     if (answer->type == MDNS_TYPE_PTR) {
         if (answer->service) {
-            return _mdns_append_service_ptr_answers(packet, index, answer->service, answer->flush, answer->bye);
+            return _mdns_append_service_ptr_answers(packet, index, answer->service, answer->flush, answer->bye, first_record);
 #ifdef CONFIG_MDNS_RESPOND_REVERSE_QUERIES
         } else if (answer->host && answer->host->hostname &&
                    (strstr(answer->host->hostname, "in-addr") || strstr(answer->host->hostname, "ip6"))) {
@@ -1482,9 +1709,56 @@ static uint8_t _mdns_append_answer(uint8_t *packet, uint16_t *index, mdns_out_an
     return 0;
 }
 
+/**
+ * @brief  Append answer to packet, either with all its records or not at all
+ *
+ * @param  overflow     set if the answer did not fit the packet
+ *
+ *  @return number of answers added to the packet
+ */
+static uint8_t _mdns_append_whole_answer(uint8_t *packet, uint16_t *index, mdns_out_answer_t *answer, mdns_if_t tcpip_if, bool *overflow)
+{
+    uint16_t start = *index;
+    _mdns_tx_overflow = false;
+    uint8_t count = _mdns_append_answer(packet, index, answer, tcpip_if, 0);
+    *overflow = _mdns_tx_overflow;
+    if (*overflow || !count) {
+        *index = start;
+        return 0;
+    }
+    return count;
+}
+
+/**
+ * @brief  writes the packet from the tx buffer
+ */
+static void _mdns_write_tx_buffer(mdns_tx_packet_t *p, uint8_t *packet, uint16_t len)
+{
+#ifdef MDNS_ENABLE_DEBUG
+    _mdns_dbg_printf("\nTX[%lu][%lu]: ", (unsigned long)p->tcpip_if, (unsigned long)p->ip_protocol);
+#ifdef CONFIG_LWIP_IPV4
+    if (p->dst.type == ESP_IPADDR_TYPE_V4) {
+        _mdns_dbg_printf("To: " IPSTR ":%u, ", IP2STR(&p->dst.u_addr.ip4), p->port);
+    }
+#endif
+#ifdef CONFIG_LWIP_IPV6
+    if (p->dst.type == ESP_IPADDR_TYPE_V6) {
+        _mdns_dbg_printf("To: " IPV6STR ":%u, ", IPV62STR(p->dst.u_addr.ip6), p->port);
+    }
+#endif
+    mdns_debug_packet(packet, len);
+#endif
+
+    _mdns_udp_pcb_write(p->tcpip_if, p->ip_protocol, &p->dst, p->port, packet, len);
+}
+
 /**
  * @brief  sends a packet
  *
+ * Answers which do not fit into one packet continue in the following packets (without the questions).
+ * A query announces that more known answers follow by the TC bit in all but the last packet (RFC 6762 Section 7.2),
+ * a legacy unicast response is truncated instead. Authority and additional records which do not fit are left out.
+ *
  * @param  p       the packet
  */
 static void _mdns_dispatch_tx_packet(mdns_tx_packet_t *p)
@@ -1492,27 +1766,64 @@ static void _mdns_dispatch_tx_packet(mdns_tx_packet_t *p)
     static uint8_t packet[MDNS_MAX_PACKET_SIZE];
     uint16_t index = MDNS_HEAD_LEN;
     memset(packet, 0, MDNS_HEAD_LEN);
+    _mdns_fqdn_dict_reset(packet);
     mdns_out_question_t *q;
     mdns_out_answer_t *a;
     uint8_t count;
+    uint8_t questions;
+    bool overflow;
+    bool legacy_unicast = p->port != MDNS_SERVICE_PORT;
 
     _mdns_set_u16(packet, MDNS_HEAD_FLAGS_OFFSET, p->flags);
     _mdns_set_u16(packet, MDNS_HEAD_ID_OFFSET, p->id);
 
-    count = 0;
+    questions = 0;
     q = p->questions;
     while (q) {
+        uint16_t start = index;
         if (_mdns_append_question(packet, &index, q)) {
-            count++;
+            questions++;
+        } else {
+            index = start;
         }
         q = q->next;
     }
-    _mdns_set_u16(packet, MDNS_HEAD_QUESTIONS_OFFSET, count);
+    _mdns_set_u16(packet, MDNS_HEAD_QUESTIONS_OFFSET, questions);
 
     count = 0;
     a = p->answers;
+    uint8_t sent_records = 0;   // records of the current answer sent in the previous packets
     while (a) {
-        count += _mdns_append_answer(packet, &index, a, p->tcpip_if);
+        uint16_t start = index;
+        _mdns_tx_overflow = false;
+        uint8_t appended = _mdns_append_answer(packet, &index, a, p->tcpip_if, sent_records);
+        overflow = _mdns_tx_overflow;
+        if (!appended || (overflow && !(a->type == MDNS_TYPE_PTR && a->service))) {
+            index = start;
+            appended = 0;
+        }
+        count += appended;
+        if (overflow && (questions || count)) {
+            if (legacy_unicast) {
+                _mdns_set_u16(packet, MDNS_HEAD_FLAGS_OFFSET, p->flags | MDNS_FLAGS_DISTRIBUTED);
+                break;
+            }
+            // send what we have and continue with the rest of this answer in the next packet
+            if (!(p->flags & MDNS_FLAGS_QUERY_REPSONSE)) {
+                _mdns_set_u16(packet, MDNS_HEAD_FLAGS_OFFSET, p->flags | MDNS_FLAGS_DISTRIBUTED);
+            }
+            _mdns_set_u16(packet, MDNS_HEAD_ANSWERS_OFFSET, count);
+            _mdns_write_tx_buffer(p, packet, index);
+            memset(packet + MDNS_HEAD_QUESTIONS_OFFSET, 0, MDNS_HEAD_LEN - MDNS_HEAD_QUESTIONS_OFFSET);
+            _mdns_set_u16(packet, MDNS_HEAD_FLAGS_OFFSET, p->flags);
+            index = MDNS_HEAD_LEN;
+            _mdns_fqdn_dict_reset(packet);
+            questions = 0;
+            count = 0;
+            sent_records += appended;
+            continue;
+        }
+        sent_records = 0;
         a = a->next;
     }
     _mdns_set_u16(packet, MDNS_HEAD_ANSWERS_OFFSET, count);
@@ -1520,7 +1831,7 @@ static void _mdns_dispatch_tx_packet(mdns_tx_packet_t *p)
     count = 0;
     a = p->servers;
     while (a) {
-        count += _mdns_append_answer(packet, &index, a, p->tcpip_if);
+        count += _mdns_append_whole_answer(packet, &index, a, p->tcpip_if, &overflow);
         a = a->next;
     }
     _mdns_set_u16(packet, MDNS_HEAD_SERVERS_OFFSET, count);
@@ -1528,27 +1839,24 @@ static void _mdns_dispatch_tx_packet(mdns_tx_packet_t *p)
     count = 0;
     a = p->additional;
     while (a) {
-        count += _mdns_append_answer(packet, &index, a, p->tcpip_if);
+        count += _mdns_append_whole_answer(packet, &index, a, p->tcpip_if, &overflow);
         a = a->next;
     }
     _mdns_set_u16(packet, MDNS_HEAD_ADDITIONAL_OFFSET, count);
 
-#ifdef MDNS_ENABLE_DEBUG
-    _mdns_dbg_printf("\nTX[%lu][%lu]: ", (unsigned long)p->tcpip_if, (unsigned long)p->ip_protocol);
-#ifdef CONFIG_LWIP_IPV4
-    if (p->dst.type == ESP_IPADDR_TYPE_V4) {
-        _mdns_dbg_printf("To: " IPSTR ":%u, ", IP2STR(&p->dst.u_addr.ip4), p->port);
-    }
-#endif
-#ifdef CONFIG_LWIP_IPV6
-    if (p->dst.type == ESP_IPADDR_TYPE_V6) {
-        _mdns_dbg_printf("To: " IPV6STR ":%u, ", IPV62STR(p->dst.u_addr.ip6), p->port);
-    }
-#endif
-    mdns_debug_packet(packet, index);
-#endif
+    _mdns_write_tx_buffer(p, packet, index);
+}
 
-    _mdns_udp_pcb_write(p->tcpip_if, p->ip_protocol, &p->dst, p->port, packet, index);
+/**
+ * @brief  frees a list of answers
+ */
+static void _mdns_free_answers(mdns_out_answer_t *answers)
+{
+    while (answers) {
+        mdns_out_answer_t *next = answers->next;
+        mdns_mem_pool_free(MDNS_POOL_OUT_ANSWER, answers);
+        answers = next;
+    }
 }
 
 /**
@@ -1573,10 +1881,153 @@ static void _mdns_free_tx_packet(mdns_tx_packet_t *packet)
         mdns_mem_free(q);
         q = next;
     }
-    queueFree(mdns_out_answer_t, packet->answers);
-    queueFree(mdns_out_answer_t, packet->servers);
-    queueFree(mdns_out_answer_t, packet->additional);
-    mdns_mem_free(packet);
+    _mdns_free_answers(packet->answers);
+    _mdns_free_answers(packet->servers);
+    _mdns_free_answers(packet->additional);
+    mdns_mem_pool_free(MDNS_POOL_TX_PACKET, packet);
+}
+
+/**
+ * @brief  TX scheduler
+ *
+ * Scheduled packets are kept in a binary min-heap ordered by send_at (and by scheduling order
+ * for equal times), so that scheduling and cancelling a packet is O(log n).
+ * Each scheduled packet is also linked to the list of its pcb, so that per-pcb operations
+ * only visit the packets of that pcb.
+ * When a packet is due, the timer moves it from the heap to the tx_due list and the service task
+ * transmits all packets from that list in a single ACTION_TX_HANDLE.
+ */
+static inline bool _mdns_tx_before(const mdns_tx_packet_t *a, const mdns_tx_packet_t *b)
+{
+    int32_t diff = (int32_t)(a->send_at - b->send_at);
+    return diff < 0 || (diff == 0 && (int32_t)(a->sched_seq - b->sched_seq) < 0);
+}
+
+static inline void _mdns_tx_heap_place(uint16_t pos, mdns_tx_packet_t *packet)
+{
+    _mdns_server->tx_heap[pos] = packet;
+    packet->heap_index = pos + 1;
+}
+
+static void _mdns_tx_heap_sift_up(uint16_t pos)
+{
+    mdns_tx_packet_t *packet = _mdns_server->tx_heap[pos];
+    while (pos > 0) {
+        uint16_t parent = (pos - 1) / 2;
+        if (!_mdns_tx_before(packet, _mdns_server->tx_heap[parent])) {
+            break;
+        }
+        _mdns_tx_heap_place(pos, _mdns_server->tx_heap[parent]);
+        pos = parent;
+    }
+    _mdns_tx_heap_place(pos, packet);
+}
+
+static void _mdns_tx_heap_sift_down(uint16_t pos)
+{
+    mdns_tx_packet_t *packet = _mdns_server->tx_heap[pos];
+    uint16_t len = _mdns_server->tx_heap_len;
+    for (;;) {
+        uint32_t child = 2 * (uint32_t)pos + 1;
+        if (child >= len) {
+            break;
+        }
+        if (child + 1 < len && _mdns_tx_before(_mdns_server->tx_heap[child + 1], _mdns_server->tx_heap[child])) {
+            child++;
+        }
+        if (!_mdns_tx_before(_mdns_server->tx_heap[child], packet)) {
+            break;
+        }
+        _mdns_tx_heap_place(pos, _mdns_server->tx_heap[child]);
+        pos = child;
+    }
+    _mdns_tx_heap_place(pos, packet);
+}
+
+static bool _mdns_tx_heap_push(mdns_tx_packet_t *packet)
+{
+    if (_mdns_server->tx_heap_len == _mdns_server->tx_heap_size) {
+        if (_mdns_server->tx_heap_size == UINT16_MAX) {
+            return false;
+        }
+        uint32_t size = _mdns_server->tx_heap_size ? 2 * (uint32_t)_mdns_server->tx_heap_size : 8;
+        if (size > UINT16_MAX) {
+            size = UINT16_MAX;
+        }
+        mdns_tx_packet_t **heap = (mdns_tx_packet_t **)mdns_mem_malloc(size * sizeof(mdns_tx_packet_t *));
+        if (!heap) {
+            HOOK_MALLOC_FAILED;
+            return false;
+        }
+        if (_mdns_server->tx_heap_len) {
+            memcpy(heap, _mdns_server->tx_heap, _mdns_server->tx_heap_len * sizeof(mdns_tx_packet_t *));
+        }
+        mdns_mem_free(_mdns_server->tx_heap);
+        _mdns_server->tx_heap = heap;
+        _mdns_server->tx_heap_size = size;
+    }
+    _mdns_server->tx_heap[_mdns_server->tx_heap_len] = packet;
+    _mdns_tx_heap_sift_up(_mdns_server->tx_heap_len++);
+    return true;
+}
+
+static void _mdns_tx_heap_remove(mdns_tx_packet_t *packet)
+{
+    uint16_t pos = packet->heap_index - 1;
+    mdns_tx_packet_t *last = _mdns_server->tx_heap[--_mdns_server->tx_heap_len];
+    packet->heap_index = 0;
+    if (pos == _mdns_server->tx_heap_len) {
+        return;
+    }
+    _mdns_tx_heap_place(pos, last);
+    if (pos > 0 && _mdns_tx_before(last, _mdns_server->tx_heap[(pos - 1) / 2])) {
+        _mdns_tx_heap_sift_up(pos);
+    } else {
+        _mdns_tx_heap_sift_down(pos);
+    }
+}
+
+static void _mdns_tx_pcb_link(mdns_tx_packet_t *packet)
+{
+    mdns_pcb_t *pcb = &_mdns_server->interfaces[packet->tcpip_if].pcbs[packet->ip_protocol];
+    packet->pcb_prev = NULL;
+    packet->pcb_next = pcb->tx_packets;
+    if (pcb->tx_packets) {
+        pcb->tx_packets->pcb_prev = packet;
+    }
+    pcb->tx_packets = packet;
+}
+
+static void _mdns_tx_pcb_unlink(mdns_tx_packet_t *packet)
+{
+    mdns_pcb_t *pcb = &_mdns_server->interfaces[packet->tcpip_if].pcbs[packet->ip_protocol];
+    if (packet->pcb_prev) {
+        packet->pcb_prev->pcb_next = packet->pcb_next;
+    } else {
+        pcb->tx_packets = packet->pcb_next;
+    }
+    if (packet->pcb_next) {
+        packet->pcb_next->pcb_prev = packet->pcb_prev;
+    }
+    packet->pcb_next = NULL;
+    packet->pcb_prev = NULL;
+}
+
+/**
+ * @brief  removes a packet from the scheduler (the packet is not freed)
+ */
+static void _mdns_unschedule_tx_packet(mdns_tx_packet_t *packet)
+{
+    if (packet->heap_index) {
+        _mdns_tx_heap_remove(packet);
+    } else if (packet->queued) {
+        queueDetach(mdns_tx_packet_t, _mdns_server->tx_due, packet);
+        packet->queued = false;
+    } else {
+        return;
+    }
+    _mdns_tx_pcb_unlink(packet);
+    _mdns_server->tx_stats.queue_depth--;
 }
 
 /**
@@ -1591,18 +2042,17 @@ static void _mdns_schedule_tx_packet(mdns_tx_packet_t *packet, uint32_t ms_after
         return;
     }
     packet->send_at = (xTaskGetTickCount() * portTICK_PERIOD_MS) + ms_after;
+    packet->sched_seq = _mdns_server->tx_seq++;
     packet->next = NULL;
-    if (!_mdns_server->tx_queue_head || _mdns_server->tx_queue_head->send_at > packet->send_at) {
-        packet->next = _mdns_server->tx_queue_head;
-        _mdns_server->tx_queue_head = packet;
+    if (!_mdns_tx_heap_push(packet)) {
+        ESP_LOGE(TAG, "Cannot schedule packet: Out of memory");
+        _mdns_free_tx_packet(packet);
         return;
     }
-    mdns_tx_packet_t *q = _mdns_server->tx_queue_head;
-    while (q->next && q->next->send_at <= packet->send_at) {
-        q = q->next;
+    _mdns_tx_pcb_link(packet);
+    if (++_mdns_server->tx_stats.queue_depth > _mdns_server->tx_stats.queue_depth_max) {
+        _mdns_server->tx_stats.queue_depth_max = _mdns_server->tx_stats.queue_depth;
     }
-    packet->next = q->next;
-    q->next = packet;
 }
 
 /**
@@ -1611,9 +2061,14 @@ static void _mdns_schedule_tx_packet(mdns_tx_packet_t *packet, uint32_t ms_after
 static void _mdns_clear_tx_queue_head(void)
 {
     mdns_tx_packet_t *q;
-    while (_mdns_server->tx_queue_head) {
-        q = _mdns_server->tx_queue_head;
-        _mdns_server->tx_queue_head = _mdns_server->tx_queue_head->next;
+    while (_mdns_server->tx_heap_len) {
+        q = _mdns_server->tx_heap[_mdns_server->tx_heap_len - 1];
+        _mdns_unschedule_tx_packet(q);
+        _mdns_free_tx_packet(q);
+    }
+    while (_mdns_server->tx_due) {
+        q = _mdns_server->tx_due;
+        _mdns_unschedule_tx_packet(q);
         _mdns_free_tx_packet(q);
     }
 }
@@ -1626,24 +2081,13 @@ static void _mdns_clear_tx_queue_head(void)
  */
 static void _mdns_clear_pcb_tx_queue_head(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
 {
-    mdns_tx_packet_t *q, * p;
-    while (_mdns_server->tx_queue_head && _mdns_server->tx_queue_head->tcpip_if == tcpip_if && _mdns_server->tx_queue_head->ip_protocol == ip_protocol) {
-        q = _mdns_server->tx_queue_head;
-        _mdns_server->tx_queue_head = _mdns_server->tx_queue_head->next;
+    mdns_pcb_t *pcb = &_mdns_server->interfaces[tcpip_if].pcbs[ip_protocol];
+    mdns_tx_packet_t *q;
+    while (pcb->tx_packets) {
+        q = pcb->tx_packets;
+        _mdns_unschedule_tx_packet(q);
         _mdns_free_tx_packet(q);
     }
-    if (_mdns_server->tx_queue_head) {
-        q = _mdns_server->tx_queue_head;
-        while (q->next) {
-            if (q->next->tcpip_if == tcpip_if && q->next->ip_protocol == ip_protocol) {
-                p = q->next;
-                q->next = p->next;
-                _mdns_free_tx_packet(p);
-            } else {
-                q = q->next;
-            }
-        }
-    }
 }
 
 /**
@@ -1654,14 +2098,16 @@ static void _mdns_clear_pcb_tx_queue_head(mdns_if_t tcpip_if, mdns_ip_protocol_t
  */
 static mdns_tx_packet_t *_mdns_get_next_pcb_packet(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
 {
-    mdns_tx_packet_t *q = _mdns_server->tx_queue_head;
+    mdns_tx_packet_t *q = _mdns_server->interfaces[tcpip_if].pcbs[ip_protocol].tx_packets;
+    mdns_tx_packet_t *next = q;
     while (q) {
-        if (q->tcpip_if == tcpip_if && q->ip_protocol == ip_protocol) {
-            return q;
+        // packets already handed over to the service task go first
+        if ((q->queued && !next->queued) || (q->queued == next->queued && _mdns_tx_before(q, next))) {
+            next = q;
         }
-        q = q->next;
+        q = q->pcb_next;
     }
-    return NULL;
+    return next;
 }
 
 /**
@@ -1673,20 +2119,20 @@ static void _mdns_remove_scheduled_answer(mdns_if_t tcpip_if, mdns_ip_protocol_t
     if (!service) {
         service = &s;
     }
-    mdns_tx_packet_t *q = _mdns_server->tx_queue_head;
+    mdns_tx_packet_t *q = _mdns_server->interfaces[tcpip_if].pcbs[ip_protocol].tx_packets;
     while (q) {
-        if (q->tcpip_if == tcpip_if && q->ip_protocol == ip_protocol && q->distributed) {
+        if (q->distributed) {
             mdns_out_answer_t *a = q->answers;
             if (a) {
                 if (a->type == type && a->service == service->service) {
                     q->answers = q->answers->next;
-                    mdns_mem_free(a);
+                    mdns_mem_pool_free(MDNS_POOL_OUT_ANSWER, a);
                 } else {
                     while (a->next) {
                         if (a->next->type == type && a->next->service == service->service) {
                             mdns_out_answer_t *b = a->next;
                             a->next = b->next;
-                            mdns_mem_free(b);
+                            mdns_mem_pool_free(MDNS_POOL_OUT_ANSWER, b);
                             break;
                         }
                         a = a->next;
@@ -1694,7 +2140,7 @@ static void _mdns_remove_scheduled_answer(mdns_if_t tcpip_if, mdns_ip_protocol_t
                 }
             }
         }
-        q = q->next;
+        q = q->pcb_next;
     }
 }
 
@@ -1713,14 +2159,14 @@ static void _mdns_dealloc_answer(mdns_out_answer_t **destination, uint16_t type,
     }
     if (d->type == type && d->service == service->service) {
         *destination = d->next;
-        mdns_mem_free(d);
+        mdns_mem_pool_free(MDNS_POOL_OUT_ANSWER, d);
         return;
     }
     while (d->next) {
         mdns_out_answer_t *a = d->next;
         if (a->type == type && a->service == service->service) {
             d->next = a->next;
-            mdns_mem_free(a);
+            mdns_mem_pool_free(MDNS_POOL_OUT_ANSWER, a);
             return;
         }
         d = d->next;
@@ -1741,7 +2187,7 @@ static bool _mdns_alloc_answer(mdns_out_answer_t **destination, uint16_t type, m
         d = d->next;
     }
 
-    mdns_out_answer_t *a = (mdns_out_answer_t *)mdns_mem_malloc(sizeof(mdns_out_answer_t));
+    mdns_out_answer_t *a = (mdns_out_answer_t *)mdns_mem_pool_malloc(MDNS_POOL_OUT_ANSWER, sizeof(mdns_out_answer_t));
     if (!a) {
         HOOK_MALLOC_FAILED;
         return false;
@@ -1762,7 +2208,7 @@ static bool _mdns_alloc_answer(mdns_out_answer_t **destination, uint16_t type, m
  */
 static mdns_tx_packet_t *_mdns_alloc_packet_default(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
 {
-    mdns_tx_packet_t *packet = (mdns_tx_packet_t *)mdns_mem_malloc(sizeof(mdns_tx_packet_t));
+    mdns_tx_packet_t *packet = (mdns_tx_packet_t *)mdns_mem_pool_malloc(MDNS_POOL_TX_PACKET, sizeof(mdns_tx_packet_t));
     if (!packet) {
         HOOK_MALLOC_FAILED;
         return NULL;
@@ -1856,6 +2302,209 @@ static bool _mdns_service_match_ptr_question(const mdns_service_t *service, cons
     return true;
 }
 
+/**
+ * @brief  Check if the querier listed our PTR record of the service as a known answer
+ *         with at least half of its TTL (RFC 6762 Section 7.1)
+ */
+static bool _mdns_ptr_is_known_answer(mdns_parsed_packet_t *parsed_packet, const mdns_service_t *service)
+{
+    mdns_parsed_record_t *r = parsed_packet->records;
+    while (r) {
+        if (r->type == MDNS_TYPE_PTR && r->ttl >= (MDNS_ANSWER_PTR_TTL / 2)) {
+            if (r->host && _mdns_service_match_instance(service, r->host, r->service, r->proto, NULL)) {
+                return true;
+            }
+            // a service without an instance name is known by its service type
+            if (!r->host && !service->instance && _mdns_service_match(service, r->service, r->proto, NULL)) {
+                return true;
+            }
+        }
+        r = r->next;
+    }
+    return false;
+}
+
+/**
+ * @brief  Check if the querier listed this address of the host as a known answer
+ */
+static bool _mdns_address_is_known_answer(mdns_parsed_packet_t *parsed_packet, uint16_t type, const char *hostname,
+                                          const void *addr, uint16_t len)
+{
+    mdns_parsed_record_t *r = parsed_packet->records;
+    while (r) {
+        if (r->type == type && r->data_len == len && r->host && !strcasecmp(r->host, hostname) && !memcmp(r->data, addr, len)) {
+            return true;
+        }
+        r = r->next;
+    }
+    return false;
+}
+
+/**
+ * @brief  Check if the querier already knows all addresses of the given type we would answer with
+ */
+static bool _mdns_host_is_known_answer(mdns_parsed_packet_t *parsed_packet, uint16_t type, const char *hostname)
+{
+    mdns_host_item_t *host = mdns_get_host_item(hostname);
+    if (!host || !parsed_packet->records) {
+        return false;
+    }
+    mdns_if_t tcpip_if = parsed_packet->tcpip_if;
+    if (host == &_mdns_self_host) {
+        if (_mdns_if_is_dup(tcpip_if)) {
+            return false;   // we would also answer with addresses of the other interface
+        }
+#ifdef CONFIG_LWIP_IPV4
+        if (type == MDNS_TYPE_A) {
+            esp_netif_ip_info_t if_ip_info;
+            if (esp_netif_get_ip_info(_mdns_get_esp_netif(tcpip_if), &if_ip_info)) {
+                return false;
+            }
+            return _mdns_address_is_known_answer(parsed_packet, type, hostname, &if_ip_info.ip.addr, MDNS_ANSWER_A_SIZE);
+        }
+#endif /* CONFIG_LWIP_IPV4 */
+#ifdef CONFIG_LWIP_IPV6
+        if (type == MDNS_TYPE_AAAA) {
+            struct esp_ip6_addr if_ip6s[NETIF_IPV6_MAX_NUMS];
+            int count = esp_netif_get_all_ip6(_mdns_get_esp_netif(tcpip_if), if_ip6s);
+            for (int i = 0; i < count; i++) {
+                if (!_mdns_address_is_known_answer(parsed_packet, type, hostname, if_ip6s[i].addr, MDNS_ANSWER_AAAA_SIZE)) {
+                    return false;
+                }
+            }
+            return count > 0;
+        }
+#endif /* CONFIG_LWIP_IPV6 */
+        return false;
+    }
+    bool found = false;
+    mdns_ip_addr_t *addr = host->address_list;
+    while (addr) {
+#ifdef CONFIG_LWIP_IPV4
+        if (type == MDNS_TYPE_A && addr->addr.type == ESP_IPADDR_TYPE_V4) {
+            if (!_mdns_address_is_known_answer(parsed_packet, type, hostname, &addr->addr.u_addr.ip4.addr, MDNS_ANSWER_A_SIZE)) {
+                return false;
+            }
+            found = true;
+        }
+#endif /* CONFIG_LWIP_IPV4 */
+#ifdef CONFIG_LWIP_IPV6
+        if (type == MDNS_TYPE_AAAA && addr->addr.type == ESP_IPADDR_TYPE_V6) {
+            if (!_mdns_address_is_known_answer(parsed_packet, type, hostname, addr->addr.u_addr.ip6.addr, MDNS_ANSWER_AAAA_SIZE)) {
+                return false;
+            }
+            found = true;
+        }
+#endif /* CONFIG_LWIP_IPV6 */
+        addr = addr->next;
+    }
+    return found;
+}
+
+/**
+ * @brief  Check if two answers produce the same records
+ */
+static bool _mdns_answer_equal(mdns_out_answer_t *a, mdns_out_answer_t *b)
+{
+    return a->type == b->type && a->service == b->service && a->host == b->host
+           && a->bye == b->bye && a->custom_instance == b->custom_instance;
+}
+
+/**
+ * @brief  Check if an equal answer is in the list
+ */
+static bool _mdns_answer_in_list(mdns_out_answer_t *list, mdns_out_answer_t *answer)
+{
+    while (list) {
+        if (_mdns_answer_equal(list, answer)) {
+            return true;
+        }
+        list = list->next;
+    }
+    return false;
+}
+
+/**
+ * @brief  Check if an equal answer is already scheduled to be multicast on the same interface no later than `send_at`,
+ *         e.g. when several hosts ask the same question within the response delay (RFC 6762 Section 7.3)
+ */
+static bool _mdns_answer_is_scheduled(mdns_tx_packet_t *packet, mdns_out_answer_t *answer, uint32_t send_at)
+{
+    mdns_tx_packet_t *p = _mdns_server->interfaces[packet->tcpip_if].pcbs[packet->ip_protocol].tx_packets;
+    while (p) {
+        if (p != packet && !p->questions && !p->distributed && p->port == MDNS_SERVICE_PORT
+                && (int32_t)(p->send_at - send_at) <= 0
+                && !memcmp(&p->dst, &packet->dst, sizeof(esp_ip_addr_t))
+                && _mdns_answer_in_list(p->answers, answer)) {
+            return true;
+        }
+        p = p->pcb_next;
+    }
+    return false;
+}
+
+/**
+ * @brief  Drops answers of a shared multicast response which are already scheduled to be sent
+ *
+ * @return false if no answer is left
+ */
+static bool _mdns_remove_scheduled_duplicates(mdns_tx_packet_t *packet, uint32_t send_at)
+{
+    mdns_out_answer_t **a = &packet->answers;
+    while (*a) {
+        if (_mdns_answer_is_scheduled(packet, *a, send_at)) {
+            mdns_out_answer_t *d = *a;
+            *a = d->next;
+            mdns_mem_pool_free(MDNS_POOL_OUT_ANSWER, d);
+        } else {
+            a = &(*a)->next;
+        }
+    }
+    return packet->answers != NULL;
+}
+
+/**
+ * @brief  Moves answers to the end of another list, dropping the ones which are already there or in `skip`
+ */
+static void _mdns_move_answers(mdns_out_answer_t **from, mdns_out_answer_t **to, mdns_out_answer_t *skip)
+{
+    while (*from) {
+        mdns_out_answer_t *a = *from;
+        *from = a->next;
+        a->next = NULL;
+        if (_mdns_answer_in_list(*to, a) || _mdns_answer_in_list(skip, a)) {
+            mdns_mem_pool_free(MDNS_POOL_OUT_ANSWER, a);
+            continue;
+        }
+        queueToEnd(mdns_out_answer_t, *to, a);
+    }
+}
+
+/**
+ * @brief  Adds the answers of a shared multicast response to a response which is already waiting
+ *         to be sent in the 20-120ms window, so that several questions are answered by one packet
+ *         (oversized packets are split when dispatched)
+ *
+ * @return true if the answers were moved to the waiting response and the packet can be freed
+ */
+static bool _mdns_aggregate_response(mdns_tx_packet_t *packet, uint32_t now)
+{
+    mdns_tx_packet_t *p = _mdns_server->interfaces[packet->tcpip_if].pcbs[packet->ip_protocol].tx_packets;
+    while (p) {
+        if (p != packet && !p->questions && !p->servers && !p->distributed && !p->queued
+                && p->flags == packet->flags && p->port == MDNS_SERVICE_PORT
+                && (int32_t)(p->send_at - (now + MDNS_SHARED_DELAY_MIN_MS)) >= 0
+                && (int32_t)(p->send_at - (now + MDNS_SHARED_DELAY_MAX_MS)) <= 0
+                && !memcmp(&p->dst, &packet->dst, sizeof(esp_ip_addr_t))) {
+            _mdns_move_answers(&packet->answers, &p->answers, NULL);
+            _mdns_move_answers(&packet->additional, &p->additional, p->answers);
+            return true;
+        }
+        p = p->pcb_next;
+    }
+    return false;
+}
+
 /**
  * @brief  Create answer packet to questions from parsed packet
  */
@@ -1895,23 +2544,7 @@ static void _mdns_create_answer_from_parsed_packet(mdns_parsed_packet_t *parsed_
             mdns_srv_item_t *service = _mdns_server->services;
             while (service) {
                 if (_mdns_service_match_ptr_question(service->service, q)) {
-                    mdns_parsed_record_t *r = parsed_packet->records;
-                    bool is_record_exist = false;
-                    while (r) {
-                        if (service->service->instance && r->host) {
-                            if (_mdns_service_match_instance(service->service, r->host, r->service, r->proto, NULL) && r->ttl > (MDNS_ANSWER_PTR_TTL / 2)) {
-                                is_record_exist = true;
-                                break;
-                            }
-                        } else if (!service->service->instance && !r->host) {
-                            if (_mdns_service_match(service->service, r->service, r->proto, NULL) && r->ttl > (MDNS_ANSWER_PTR_TTL / 2)) {
-                                is_record_exist = true;
-                                break;
-                            }
-                        }
-                        r = r->next;
-                    }
-                    if (!is_record_exist) {
+                    if (!_mdns_ptr_is_known_answer(parsed_packet, service->service)) {
                         if (!_mdns_create_answer_from_service(packet, service->service, q, shared, send_flush)) {
                             _mdns_free_tx_packet(packet);
                             return;
@@ -1923,6 +2556,10 @@ static void _mdns_create_answer_from_parsed_packet(mdns_parsed_packet_t *parsed_
                 service = service->next;
             }
         } else if (q->type == MDNS_TYPE_A || q->type == MDNS_TYPE_AAAA) {
+            if (_mdns_host_is_known_answer(parsed_packet, q->type, q->host)) {
+                q = q->next;
+                continue;
+            }
             if (!_mdns_create_answer_from_hostname(packet, q->host, send_flush)) {
                 _mdns_free_tx_packet(packet);
                 return;
@@ -1988,15 +2625,26 @@ static void _mdns_create_answer_from_parsed_packet(mdns_parsed_packet_t *parsed_
         _mdns_free_tx_packet(packet);
         return;
     }
-    if (unicast || !send_flush) {
+    bool multicast = !unicast && send_flush;
+    if (!multicast) {
         memcpy(&packet->dst, &parsed_packet->src, sizeof(esp_ip_addr_t));
         packet->port = parsed_packet->src_port;
     }
 
-    static uint8_t share_step = 0;
-    if (shared) {
-        _mdns_schedule_tx_packet(packet, 25 + (share_step * 25));
-        share_step = (share_step + 1) & 0x03;
+    if (packet->distributed) {
+        // wait for the rest of the known answers of a truncated query (RFC 6762 Section 7.2)
+        _mdns_schedule_tx_packet(packet, MDNS_TC_DELAY_MIN_MS + esp_random() % (MDNS_TC_DELAY_MAX_MS - MDNS_TC_DELAY_MIN_MS + 1));
+    } else if (shared) {
+        uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+        // an equal answer going out within the shared response delay satisfies this question too,
+        // the other answers join a response which is already waiting
+        if (multicast
+                && (!_mdns_remove_scheduled_duplicates(packet, now + MDNS_SHARED_DELAY_MAX_MS)
+                    || _mdns_aggregate_response(packet, now))) {
+            _mdns_free_tx_packet(packet);
+            return;
+        }
+        _mdns_schedule_tx_packet(packet, MDNS_SHARED_DELAY_MIN_MS + esp_random() % (MDNS_SHARED_DELAY_MAX_MS - MDNS_SHARED_DELAY_MIN_MS + 1));
     } else {
         _mdns_dispatch_tx_packet(packet);
         _mdns_free_tx_packet(packet);
@@ -2417,6 +3065,7 @@ static void _mdns_send_bye_subtype(mdns_srv_item_t *service, const char *instanc
                 static uint8_t pkt[MDNS_MAX_PACKET_SIZE];
                 uint16_t index = MDNS_HEAD_LEN;
                 memset(pkt, 0, MDNS_HEAD_LEN);
+                _mdns_fqdn_dict_reset(pkt);
                 mdns_out_answer_t *a;
                 uint8_t count;
 
@@ -2762,14 +3411,14 @@ static void _mdns_dealloc_scheduled_service_answers(mdns_out_answer_t **destinat
     }
     while (d && d->service == service) {
         *destination = d->next;
-        mdns_mem_free(d);
+        mdns_mem_pool_free(MDNS_POOL_OUT_ANSWER, d);
         d = *destination;
     }
     while (d && d->next) {
         mdns_out_answer_t *a = d->next;
         if (a->service == service) {
             d->next = a->next;
-            mdns_mem_free(a);
+            mdns_mem_pool_free(MDNS_POOL_OUT_ANSWER, a);
         } else {
             d = d->next;
         }
@@ -2777,15 +3426,12 @@ static void _mdns_dealloc_scheduled_service_answers(mdns_out_answer_t **destinat
 }
 
 /**
- * @brief  Find, remove and free answers and scheduled packets for service
+ * @brief  Find, remove and free answers and scheduled packets for service on a specific interface
  */
-static void _mdns_remove_scheduled_service_packets(mdns_service_t *service)
+static void _mdns_remove_scheduled_pcb_service_packets(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol, mdns_service_t *service)
 {
-    if (!service) {
-        return;
-    }
     mdns_tx_packet_t *p = NULL;
-    mdns_tx_packet_t *q = _mdns_server->tx_queue_head;
+    mdns_tx_packet_t *q = _mdns_server->interfaces[tcpip_if].pcbs[ip_protocol].tx_packets;
     while (q) {
         bool had_answers = (q->answers != NULL);
 
@@ -2852,14 +3498,29 @@ static void _mdns_remove_scheduled_service_packets(mdns_service_t *service)
         }
 
         p = q;
-        q = q->next;
+        q = q->pcb_next;
         if (!p->questions && !p->answers && !p->additional && !p->servers) {
-            queueDetach(mdns_tx_packet_t, _mdns_server->tx_queue_head, p);
+            _mdns_unschedule_tx_packet(p);
             _mdns_free_tx_packet(p);
         }
     }
 }
 
+/**
+ * @brief  Find, remove and free answers and scheduled packets for service
+ */
+static void _mdns_remove_scheduled_service_packets(mdns_service_t *service)
+{
+    if (!service) {
+        return;
+    }
+    for (uint8_t tcpip_if = 0; tcpip_if < MDNS_MAX_INTERFACES; tcpip_if++) {
+        for (uint8_t ip_protocol = 0; ip_protocol < MDNS_IP_PROTOCOL_MAX; ip_protocol++) {
+            _mdns_remove_scheduled_pcb_service_packets(tcpip_if, ip_protocol, service);
+        }
+    }
+}
+
 static void _mdns_free_subtype(mdns_subtype_t *subtype)
 {
     while (subtype) {
@@ -3010,6 +3671,9 @@ static int _mdns_check_txt_collision(mdns_service_t *service, const uint8_t *dat
 
 static esp_err_t mdns_pcb_deinit_local(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_proto)
 {
+#if CONFIG_MDNS_RECORD_CACHE
+    _mdns_cache_remove_pcb(tcpip_if, ip_proto);
+#endif
     esp_err_t err = _mdns_pcb_deinit(tcpip_if, ip_proto);
     mdns_pcb_t *_pcb = &_mdns_server->interfaces[tcpip_if].pcbs[ip_proto];
     if (_pcb == NULL || err != ESP_OK) {
@@ -3125,14 +3789,7 @@ static bool _hostname_is_ours(const char *hostname)
             strcasecmp(hostname, _mdns_server->hostname) == 0) {
         return true;
     }
-    mdns_host_item_t *host = _mdns_host_list;
-    while (host != NULL) {
-        if (strcasecmp(hostname, host->hostname) == 0) {
-            return true;
-        }
-        host = host->next;
-    }
-    return false;
+    return _mdns_get_delegated_host_item(hostname) != NULL;
 }
 
 /**
@@ -3157,6 +3814,7 @@ static bool _mdns_delegate_hostname_add(const char *hostname, mdns_ip_addr_t *ad
     host->hostname = hostname;
     host->next = _mdns_host_list;
     _mdns_host_list = host;
+    _mdns_host_index_add(host);
     return true;
 }
 
@@ -3176,16 +3834,13 @@ static bool _mdns_delegate_hostname_set_address(const char *hostname, mdns_ip_ad
             strcasecmp(hostname, _mdns_server->hostname) == 0) {
         return false;
     }
-    mdns_host_item_t *host = _mdns_host_list;
-    while (host != NULL) {
-        if (strcasecmp(hostname, host->hostname) == 0) {
-            // free previous address list
-            free_address_list(host->address_list);
-            // set current address list to the host
-            host->address_list = address_list;
-            return true;
-        }
-        host = host->next;
+    mdns_host_item_t *host = _mdns_get_delegated_host_item(hostname);
+    if (host != NULL) {
+        // free previous address list
+        free_address_list(host->address_list);
+        // set current address list to the host
+        host->address_list = address_list;
+        return true;
     }
     return false;
 }
@@ -3225,6 +3880,7 @@ static void free_delegated_hostnames(void)
         mdns_mem_free(item);
     }
     _mdns_host_list = NULL;
+    memset(_mdns_host_index, 0, sizeof(_mdns_host_index));
 }
 
 static bool _mdns_delegate_hostname_remove(const char *hostname)
@@ -3236,6 +3892,7 @@ static bool _mdns_delegate_hostname_remove(const char *hostname)
             mdns_srv_item_t *to_free = srv;
             _mdns_send_bye(&srv, 1, false);
             _mdns_remove_scheduled_service_packets(srv->service);
+            _mdns_service_index_remove(srv);
             if (prev_srv == NULL) {
                 _mdns_server->services = srv->next;
                 srv = srv->next;
@@ -3259,6 +3916,7 @@ static bool _mdns_delegate_hostname_remove(const char *hostname)
             } else {
                 prev_host->next = host->next;
             }
+            _mdns_host_index_remove(host);
             free_address_list(host->address_list);
             mdns_mem_free((char *)host->hostname);
             mdns_mem_free(host);
@@ -3472,6 +4130,47 @@ static bool _mdns_question_matches(mdns_parsed_question_t *question, uint16_t ty
     return false;
 }
 
+/**
+ * @brief  Check if SRV data of a known answer equals our record of the service
+ */
+static bool _mdns_srv_data_match(const mdns_service_t *service, uint16_t priority, uint16_t weight, uint16_t port, mdns_name_t *target)
+{
+    const char *hostname = service->hostname ? service->hostname : _mdns_server->hostname;
+    return service->priority == priority && service->weight == weight && service->port == port
+           && !_str_null_or_empty(hostname) && !strcasecmp(hostname, target->host)
+           && !strcasecmp(MDNS_DEFAULT_DOMAIN, target->domain);
+}
+
+/**
+ * @brief  Saves A/AAAA known answer of our host from a query
+ *
+ * @return false on memory error
+ */
+static bool _mdns_add_known_address(mdns_parsed_packet_t *parsed_packet, uint16_t type, const char *host, const uint8_t *addr, uint16_t len)
+{
+    mdns_parsed_record_t *record = mdns_mem_calloc(1, sizeof(mdns_parsed_record_t));
+    if (!record) {
+        HOOK_MALLOC_FAILED;
+        return false;
+    }
+    record->host = mdns_mem_strdup(host);
+    record->data = mdns_mem_malloc(len);
+    if (!record->host || !record->data) {
+        HOOK_MALLOC_FAILED;
+        mdns_mem_free(record->host);
+        mdns_mem_free(record->data);
+        mdns_mem_free(record);
+        return false;
+    }
+    memcpy(record->data, addr, len);
+    record->data_len = len;
+    record->type = type;
+    record->record_type = MDNS_ANSWER;
+    record->next = parsed_packet->records;
+    parsed_packet->records = record;
+    return true;
+}
+
 /**
  * @brief  Removes saved question from parsed data
  */
@@ -3721,7 +4420,7 @@ void mdns_parse_packet(mdns_rx_packet_t *packet)
         return;
     }
 
-    mdns_parsed_packet_t *parsed_packet = (mdns_parsed_packet_t *)mdns_mem_malloc(sizeof(mdns_parsed_packet_t));
+    mdns_parsed_packet_t *parsed_packet = (mdns_parsed_packet_t *)mdns_mem_pool_malloc(MDNS_POOL_PARSED_PACKET, sizeof(mdns_parsed_packet_t));
     if (!parsed_packet) {
         HOOK_MALLOC_FAILED;
         return;
@@ -3739,13 +4438,13 @@ void mdns_parse_packet(mdns_rx_packet_t *packet)
     header.additional = _mdns_read_u16(data, MDNS_HEAD_ADDITIONAL_OFFSET);
 
     if (header.flags == MDNS_FLAGS_QR_AUTHORITATIVE && packet->src_port != MDNS_SERVICE_PORT) {
-        mdns_mem_free(parsed_packet);
+        mdns_mem_pool_free(MDNS_POOL_PARSED_PACKET, parsed_packet);
         return;
     }
 
     //if we have not set the hostname, we can not answer questions
     if (header.questions && !header.answers && _str_null_or_empty(_mdns_server->hostname)) {
-        mdns_mem_free(parsed_packet);
+        mdns_mem_pool_free(MDNS_POOL_PARSED_PACKET, parsed_packet);
         return;
     }
 
@@ -3753,7 +4452,7 @@ void mdns_parse_packet(mdns_rx_packet_t *packet)
     parsed_packet->ip_protocol = packet->ip_protocol;
     parsed_packet->multicast = packet->multicast;
     parsed_packet->authoritative = (header.flags == MDNS_FLAGS_QR_AUTHORITATIVE);
-    parsed_packet->distributed = header.flags == MDNS_FLAGS_DISTRIBUTED;
+    parsed_packet->distributed = !(header.flags & MDNS_FLAGS_QUERY_REPSONSE) && (header.flags & MDNS_FLAGS_DISTRIBUTED);
     parsed_packet->id = header.id;
     esp_netif_ip_addr_copy(&parsed_packet->src, &packet->src);
     parsed_packet->src_port = packet->src_port;
@@ -3810,6 +4509,9 @@ void mdns_parse_packet(mdns_rx_packet_t *packet)
                 }
                 continue;
             }
+            if (!unicast && !header.answers && !(header.flags & MDNS_FLAGS_QUERY_REPSONSE)) {
+                _mdns_search_suppress_duplicate(name, type, packet->tcpip_if, packet->ip_protocol);
+            }
             if (!_mdns_name_is_ours(name)) {
                 continue;
             }
@@ -3842,6 +4544,8 @@ void mdns_parse_packet(mdns_rx_packet_t *packet)
         goto clear_rx_packet;
     } else if (header.answers || header.servers || header.additional) {
         uint16_t recordIndex = 0;
+        // answers in a query are the querier's known answers (RFC 6762 Section 7.1), not a conflict
+        bool known_answers = parsed_packet->questions && !parsed_packet->probe;
 
         while (content < (data + len)) {
 
@@ -3858,6 +4562,9 @@ void mdns_parse_packet(mdns_rx_packet_t *packet)
             uint32_t ttl = _mdns_read_u32(content, MDNS_TTL_OFFSET);
             uint16_t data_len = _mdns_read_u16(content, MDNS_LEN_OFFSET);
             const uint8_t *data_ptr = content + MDNS_DATA_OFFSET;
+#if CONFIG_MDNS_RECORD_CACHE
+            bool flush = mdns_class & 0x8000;
+#endif
             mdns_class &= 0x7FFF;
 
             content = data_ptr + data_len;
@@ -3934,6 +4641,12 @@ void mdns_parse_packet(mdns_rx_packet_t *packet)
                         memcpy(browse_result_instance, name->host, MDNS_NAME_BUF_LEN);
                     }
                 }
+#if CONFIG_MDNS_RECORD_CACHE
+                if (mdns_class == MDNS_CLASS_IN) {
+                    _mdns_cache_add_record(data, len, data_ptr, data_len, name, type, flush, ttl, search_result || browse_result,
+                                           packet->tcpip_if, packet->ip_protocol);
+                }
+#endif
             }
 
             if (type == MDNS_TYPE_PTR) {
@@ -3950,17 +4663,17 @@ void mdns_parse_packet(mdns_rx_packet_t *packet)
                         service = _mdns_get_service_item(name->service, name->proto, NULL);
                     }
                     if (discovery && service) {
-                        _mdns_remove_parsed_question(parsed_packet, MDNS_TYPE_SDPTR, service);
-                    } else if (service && parsed_packet->questions && !parsed_packet->probe) {
-                        _mdns_remove_parsed_question(parsed_packet, type, service);
-                    } else if (service) {
+                        if (ttl >= MDNS_ANSWER_PTR_TTL / 2) {
+                            _mdns_remove_parsed_question(parsed_packet, MDNS_TYPE_SDPTR, service);
+                        }
+                    } else if (service && !known_answers) {
                         //check if TTL is more than half of the full TTL value (4500)
                         if (ttl > (MDNS_ANSWER_PTR_TTL / 2)) {
                             _mdns_remove_scheduled_answer(packet->tcpip_if, packet->ip_protocol, type, service);
                         }
                     }
                     if (service) {
-                        mdns_parsed_record_t *record = mdns_mem_malloc(sizeof(mdns_parsed_record_t));
+                        mdns_parsed_record_t *record = mdns_mem_calloc(1, sizeof(mdns_parsed_record_t));
                         if (!record) {
                             HOOK_MALLOC_FAILED;
                             goto clear_rx_packet;
@@ -4020,6 +4733,10 @@ void mdns_parse_packet(mdns_rx_packet_t *packet)
                     }
                 }
                 bool is_selfhosted = _mdns_name_is_selfhosted(name);
+                mdns_srv_item_t *known_service = NULL;
+                if (ours && known_answers) {
+                    known_service = _mdns_get_service_item_instance(name->host, name->service, name->proto, NULL);
+                }
                 if (!_mdns_parse_fqdn(data, data_ptr + MDNS_SRV_FQDN_OFFSET, name, len)) {
                     continue;//error
                 }
@@ -4044,8 +4761,11 @@ void mdns_parse_packet(mdns_rx_packet_t *packet)
                         _mdns_search_result_add_srv(search_result, name->host, port, packet->tcpip_if, packet->ip_protocol, ttl);
                     }
                 } else if (ours) {
-                    if (parsed_packet->questions && !parsed_packet->probe) {
-                        _mdns_remove_parsed_question(parsed_packet, type, service);
+                    if (known_answers) {
+                        if (known_service && ttl >= MDNS_ANSWER_SRV_TTL / 2
+                                && _mdns_srv_data_match(known_service->service, priority, weight, port, name)) {
+                            _mdns_remove_parsed_question(parsed_packet, type, known_service);
+                        }
                         continue;
                     } else if (parsed_packet->distributed) {
                         _mdns_remove_scheduled_answer(packet->tcpip_if, packet->ip_protocol, type, service);
@@ -4145,8 +4865,12 @@ void mdns_parse_packet(mdns_rx_packet_t *packet)
                         }
                     }
                 } else if (ours) {
-                    if (parsed_packet->questions && !parsed_packet->probe && service) {
-                        _mdns_remove_parsed_question(parsed_packet, type, service);
+                    if (known_answers) {
+                        mdns_srv_item_t *known_service = _mdns_get_service_item_instance(name->host, name->service, name->proto, NULL);
+                        if (known_service && ttl >= MDNS_ANSWER_TXT_TTL / 2
+                                && !_mdns_check_txt_collision(known_service->service, data_ptr, data_len)) {
+                            _mdns_remove_parsed_question(parsed_packet, type, known_service);
+                        }
                         continue;
                     }
                     if (!_mdns_name_is_selfhosted(name)) {
@@ -4185,8 +4909,11 @@ void mdns_parse_packet(mdns_rx_packet_t *packet)
                         search_result = _mdns_search_find_from(search_result->next, name, type, packet->tcpip_if, packet->ip_protocol);
                     }
                 } else if (ours) {
-                    if (parsed_packet->questions && !parsed_packet->probe) {
-                        _mdns_remove_parsed_question(parsed_packet, type, NULL);
+                    if (known_answers) {
+                        if (ttl >= MDNS_ANSWER_AAAA_TTL / 2 && data_len == MDNS_ANSWER_AAAA_SIZE
+                                && !_mdns_add_known_address(parsed_packet, type, name->host, data_ptr, MDNS_ANSWER_AAAA_SIZE)) {
+                            goto clear_rx_packet;
+                        }
                         continue;
                     }
                     if (!_mdns_name_is_selfhosted(name)) {
@@ -4242,8 +4969,11 @@ void mdns_parse_packet(mdns_rx_packet_t *packet)
                         search_result = _mdns_search_find_from(search_result->next, name, type, packet->tcpip_if, packet->ip_protocol);
                     }
                 } else if (ours) {
-                    if (parsed_packet->questions && !parsed_packet->probe) {
-                        _mdns_remove_parsed_question(parsed_packet, type, NULL);
+                    if (known_answers) {
+                        if (ttl >= MDNS_ANSWER_A_TTL / 2 && data_len == MDNS_ANSWER_A_SIZE
+                                && !_mdns_add_known_address(parsed_packet, type, name->host, data_ptr, MDNS_ANSWER_A_SIZE)) {
+                            goto clear_rx_packet;
+                        }
                         continue;
                     }
                     if (!_mdns_name_is_selfhosted(name)) {
@@ -4341,10 +5071,11 @@ clear_rx_packet:
         if (record->proto) {
             mdns_mem_free(record->proto);
         }
+        mdns_mem_free(record->data);
         record->next = NULL;
         mdns_mem_free(record);
     }
-    mdns_mem_free(parsed_packet);
+    mdns_mem_pool_free(MDNS_POOL_PARSED_PACKET, parsed_packet);
     mdns_mem_free(browse_result_instance);
     mdns_mem_free(browse_result_service);
     mdns_mem_free(browse_result_proto);
@@ -4992,6 +5723,38 @@ static mdns_search_once_t *_mdns_search_find_from(mdns_search_once_t *s, mdns_na
     return NULL;
 }
 
+static bool _mdns_name_part_match(const char *search_part, const char *name_part)
+{
+    return !strcasecmp(search_part ? search_part : "", name_part);
+}
+
+/**
+ * @brief  Duplicate question suppression (RFC 6762 Section 7.3)
+ *
+ * Another host multicast the same question as one of our running searches without any known answers,
+ * so our next query on this interface would not bring anything new and is skipped.
+ */
+static void _mdns_search_suppress_duplicate(mdns_name_t *name, uint16_t type, mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
+{
+    mdns_search_once_t *s = _mdns_server->search_once;
+    while (s) {
+        if (s->state == SEARCH_RUNNING && !s->unicast && s->type == type && !name->sub
+                && _mdns_name_part_match(s->instance, name->host)
+                && _mdns_name_part_match(s->service, name->service)
+                && _mdns_name_part_match(s->proto, name->proto)) {
+            // our query would carry known answers from results on this interface
+            mdns_result_t *r = s->result;
+            while (r && !(r->esp_netif == _mdns_get_esp_netif(tcpip_if) && r->ip_protocol == ip_protocol)) {
+                r = r->next;
+            }
+            if (!r) {
+                s->suppressed_pcbs |= MDNS_PCB_BIT(tcpip_if, ip_protocol);
+            }
+        }
+        s = s->next;
+    }
+}
+
 /**
  * @brief  Create search packet for particular interface
  */
@@ -5027,7 +5790,7 @@ static mdns_tx_packet_t *_mdns_create_search_packet(mdns_search_once_t *search,
                 r = r->next;
                 continue;
             }
-            mdns_out_answer_t *a = (mdns_out_answer_t *)mdns_mem_malloc(sizeof(mdns_out_answer_t));
+            mdns_out_answer_t *a = (mdns_out_answer_t *)mdns_mem_pool_malloc(MDNS_POOL_OUT_ANSWER, sizeof(mdns_out_answer_t));
             if (!a) {
                 HOOK_MALLOC_FAILED;
                 _mdns_free_tx_packet(packet);
@@ -5089,10 +5852,443 @@ static void _mdns_search_send(mdns_search_once_t *search)
     uint8_t i, j;
     for (i = 0; i < MDNS_MAX_INTERFACES; i++) {
         for (j = 0; j < MDNS_IP_PROTOCOL_MAX; j++) {
+            if (search->suppressed_pcbs & MDNS_PCB_BIT(i, j)) {
+                continue;
+            }
             _mdns_search_send_pcb(search, (mdns_if_t)i, (mdns_ip_protocol_t)j);
         }
     }
+    search->suppressed_pcbs = 0;
+}
+
+#if CONFIG_MDNS_RECORD_CACHE
+/**
+ * @brief  Free cached record
+ */
+static void _mdns_cache_record_free(mdns_cache_record_t *record)
+{
+    mdns_mem_free(record->host);
+    mdns_mem_free(record->service);
+    mdns_mem_free(record->proto);
+    mdns_mem_free(record->target);
+    mdns_mem_free(record->txt);
+    mdns_mem_free(record);
+}
+
+/**
+ * @brief  Remove record from the cache
+ */
+static void _mdns_cache_remove(mdns_cache_record_t *record)
+{
+    queueDetach(mdns_cache_record_t, _mdns_server->cache, record);
+    _mdns_server->cache_len--;
+    _mdns_cache_record_free(record);
+}
+
+/**
+ * @brief  Remove all cached records received on particular interface
+ */
+static void _mdns_cache_remove_pcb(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
+{
+    mdns_cache_record_t *r = _mdns_server->cache;
+    while (r) {
+        mdns_cache_record_t *next = r->next;
+        if (r->tcpip_if == tcpip_if && r->ip_protocol == ip_protocol) {
+            _mdns_cache_remove(r);
+        }
+        r = next;
+    }
+}
+
+static inline bool _mdns_cache_str_match(const char *a, const char *b)
+{
+    if (_str_null_or_empty(a) || _str_null_or_empty(b)) {
+        return _str_null_or_empty(a) && _str_null_or_empty(b);
+    }
+    return !strcasecmp(a, b);
+}
+
+/**
+ * @brief  Check if cached record has given type and name
+ */
+static bool _mdns_cache_name_match(mdns_cache_record_t *r, uint16_t type, const char *host, const char *service, const char *proto)
+{
+    return r->type == type && _mdns_cache_str_match(r->host, host)
+           && _mdns_cache_str_match(r->service, service) && _mdns_cache_str_match(r->proto, proto);
+}
+
+/**
+ * @brief  Check if two cached records would be refreshed by the same query
+ */
+static inline bool _mdns_cache_same_question(mdns_cache_record_t *a, mdns_cache_record_t *b)
+{
+    return a->tcpip_if == b->tcpip_if && a->ip_protocol == b->ip_protocol
+           && _mdns_cache_name_match(a, b->type, b->host, b->service, b->proto);
+}
+
+static inline uint32_t _mdns_cache_ms_left(mdns_cache_record_t *r, uint32_t now)
+{
+    uint32_t age = now - r->received_at;
+    return age < r->ttl * 1000 ? r->ttl * 1000 - age : 0;
+}
+
+/**
+ * @brief  Remaining TTL of cached record in seconds, as reported in query results
+ */
+static inline uint32_t _mdns_cache_ttl_left(mdns_cache_record_t *r, uint32_t now)
+{
+    return (_mdns_cache_ms_left(r, now) + 999) / 1000;
+}
+
+/**
+ * @brief  (Re)start the lifetime of cached record
+ */
+static void _mdns_cache_record_received(mdns_cache_record_t *r, uint32_t ttl, uint32_t now)
+{
+    r->ttl = ttl < MDNS_CACHE_MAX_TTL ? ttl : MDNS_CACHE_MAX_TTL;
+    r->received_at = now;
+    r->refresh_step = 0;
+    // refresh points are randomized by up to 2% of TTL (RFC 6762, section 5.2)
+    r->jitter = esp_random() % (r->ttl * 20 + 1);
+}
+
+/**
+ * @brief  Let cached record expire in one second, without refreshing it
+ *         (goodbye packets and flushed records, RFC 6762, sections 10.1 and 10.2)
+ */
+static void _mdns_cache_record_expire(mdns_cache_record_t *r, uint32_t now)
+{
+    r->ttl = 1;
+    r->received_at = now;
+    r->refresh_step = MDNS_CACHE_REFRESH_STEPS;
+}
+
+/**
+ * @brief  Check if a refresh query is due for cached record
+ */
+static bool _mdns_cache_refresh_due(mdns_cache_record_t *r, uint32_t now)
+{
+    if (!r->in_use || r->refresh_step >= MDNS_CACHE_REFRESH_STEPS) {
+        return false;
+    }
+    uint32_t refresh_at = r->ttl * 10 * (MDNS_CACHE_REFRESH_FIRST + MDNS_CACHE_REFRESH_STEP * r->refresh_step) + r->jitter;
+    return now - r->received_at >= refresh_at;
+}
+
+/**
+ * @brief  Called from packet parser to add a record of received response to the cache
+ */
+static void _mdns_cache_add_record(const uint8_t *data, size_t len, const uint8_t *data_ptr, uint16_t data_len,
+                                   mdns_name_t *name, uint16_t type, bool flush, uint32_t ttl, bool wanted,
+                                   mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
+{
+    static mdns_name_t rdata_name;
+    const char *target = NULL;
+    uint16_t port = 0;
+    esp_ip_addr_t addr = { 0 };
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+
+    if (name->invalid || name->sub || strcasecmp(name->domain, MDNS_DEFAULT_DOMAIN)) {
+        return;
+    }
+    if (type == MDNS_TYPE_PTR) {
+        if (name->host[0] || !name->service[0] || !_mdns_parse_fqdn(data, data_ptr, &rdata_name, len)
+                || rdata_name.invalid || !rdata_name.host[0]) {
+            return;
+        }
+        target = rdata_name.host;
+    } else if (type == MDNS_TYPE_SRV || type == MDNS_TYPE_TXT) {
+        if (!name->host[0] || !name->service[0]) {
+            return;
+        }
+        if (type == MDNS_TYPE_SRV) {
+            if (data_len <= MDNS_SRV_FQDN_OFFSET || !_mdns_parse_fqdn(data, data_ptr + MDNS_SRV_FQDN_OFFSET, &rdata_name, len)
+                    || rdata_name.invalid || !rdata_name.host[0]) {
+                return;
+            }
+            target = rdata_name.host;
+            port = _mdns_read_u16(data_ptr, MDNS_SRV_PORT_OFFSET);
+        }
+    }
+#ifdef CONFIG_LWIP_IPV4
+    else if (type == MDNS_TYPE_A) {
+        if (!name->host[0] || name->service[0] || data_len != MDNS_ANSWER_A_SIZE) {
+            return;
+        }
+        addr.type = ESP_IPADDR_TYPE_V4;
+        memcpy(&addr.u_addr.ip4.addr, data_ptr, MDNS_ANSWER_A_SIZE);
+    }
+#endif
+#ifdef CONFIG_LWIP_IPV6
+    else if (type == MDNS_TYPE_AAAA) {
+        if (!name->host[0] || name->service[0] || data_len != MDNS_ANSWER_AAAA_SIZE) {
+            return;
+        }
+        addr.type = ESP_IPADDR_TYPE_V6;
+        memcpy(addr.u_addr.ip6.addr, data_ptr, MDNS_ANSWER_AAAA_SIZE);
+    }
+#endif
+    else {
+        return;
+    }
+
+    mdns_cache_record_t *record = NULL;
+    mdns_cache_record_t *r = _mdns_server->cache;
+    while (r) {
+        mdns_cache_record_t *next = r->next;
+        if (r->tcpip_if == tcpip_if && r->ip_protocol == ip_protocol
+                && _mdns_cache_name_match(r, type, name->host, name->service, name->proto)) {
+            // shared records (PTR) and addresses are kept per record data, SRV and TXT are replaced
+            if (!record && ((type == MDNS_TYPE_PTR && !strcasecmp(r->target, target))
+                            || ((type == MDNS_TYPE_A || type == MDNS_TYPE_AAAA) && !memcmp(&r->addr, &addr, sizeof(esp_ip_addr_t)))
+                            || type == MDNS_TYPE_SRV || type == MDNS_TYPE_TXT)) {
+                record = r;
+            } else if (flush && ttl && now - r->received_at > 1000) {
+                _mdns_cache_record_expire(r, now);
+            }
+        }
+        r = next;
+    }
+
+    if (!ttl) {
+        if (record) {
+            _mdns_cache_record_expire(record, now);
+        }
+        return;
+    }
+
+    if (record) {
+        if (type == MDNS_TYPE_SRV && (record->port != port || strcasecmp(record->target, target))) {
+            char *new_target = mdns_mem_strdup(target);
+            if (!new_target) {
+                HOOK_MALLOC_FAILED;
+                _mdns_cache_remove(record);
+                return;
+            }
+            mdns_mem_free(record->target);
+            record->target = new_target;
+            record->port = port;
+        } else if (type == MDNS_TYPE_TXT && (record->txt_len != data_len || memcmp(record->txt, data_ptr, data_len))) {
+            uint8_t *new_txt = (uint8_t *)mdns_mem_malloc(data_len);
+            if (!new_txt) {
+                HOOK_MALLOC_FAILED;
+                _mdns_cache_remove(record);
+                return;
+            }
+            memcpy(new_txt, data_ptr, data_len);
+            mdns_mem_free(record->txt);
+            record->txt = new_txt;
+            record->txt_len = data_len;
+        }
+        // keep refreshing only if the record is used again before the next refresh
+        record->in_use = wanted;
+        _mdns_cache_record_received(record, ttl, now);
+        return;
+    }
+
+    if (_mdns_server->cache_len >= CONFIG_MDNS_RECORD_CACHE_SIZE) {
+        // replace the record closest to its expiry
+        mdns_cache_record_t *oldest = _mdns_server->cache;
+        for (r = oldest->next; r; r = r->next) {
+            if (_mdns_cache_ms_left(r, now) < _mdns_cache_ms_left(oldest, now)) {
+                oldest = r;
+            }
+        }
+        _mdns_cache_remove(oldest);
+    }
+
+    record = (mdns_cache_record_t *)mdns_mem_calloc(1, sizeof(mdns_cache_record_t));
+    if (!record) {
+        HOOK_MALLOC_FAILED;
+        return;
+    }
+    record->type = type;
+    record->tcpip_if = tcpip_if;
+    record->ip_protocol = ip_protocol;
+    record->in_use = wanted;
+    record->port = port;
+    record->addr = addr;
+    if ((name->host[0] && !(record->host = mdns_mem_strdup(name->host)))
+            || (name->service[0] && !(record->service = mdns_mem_strdup(name->service)))
+            || (name->proto[0] && !(record->proto = mdns_mem_strdup(name->proto)))
+            || (target && !(record->target = mdns_mem_strdup(target)))) {
+        HOOK_MALLOC_FAILED;
+        _mdns_cache_record_free(record);
+        return;
+    }
+    if (type == MDNS_TYPE_TXT) {
+        record->txt = (uint8_t *)mdns_mem_malloc(data_len);
+        if (!record->txt) {
+            HOOK_MALLOC_FAILED;
+            _mdns_cache_record_free(record);
+            return;
+        }
+        memcpy(record->txt, data_ptr, data_len);
+        record->txt_len = data_len;
+    }
+    _mdns_cache_record_received(record, ttl, now);
+    record->next = _mdns_server->cache;
+    _mdns_server->cache = record;
+    _mdns_server->cache_len++;
+}
+
+/**
+ * @brief  Add cached addresses of the host to search results
+ */
+static void _mdns_cache_add_host_addresses(mdns_search_once_t *search, const char *hostname,
+                                           mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol, uint32_t now)
+{
+    mdns_cache_record_t *r;
+    for (r = _mdns_server->cache; r; r = r->next) {
+        if ((r->type == MDNS_TYPE_A || r->type == MDNS_TYPE_AAAA) && r->tcpip_if == tcpip_if && r->ip_protocol == ip_protocol
+                && _mdns_cache_ms_left(r, now) && !strcasecmp(r->host, hostname)) {
+            r->in_use = true;
+            _mdns_search_result_add_ip(search, hostname, &r->addr, tcpip_if, ip_protocol, _mdns_cache_ttl_left(r, now));
+        }
+    }
+}
+
+/**
+ * @brief  Complete PTR search result with cached SRV, TXT and address records of the instance
+ */
+static void _mdns_cache_add_instance(mdns_search_once_t *search, mdns_result_t *result, mdns_cache_record_t *ptr, uint32_t now)
+{
+    mdns_cache_record_t *r;
+    for (r = _mdns_server->cache; r; r = r->next) {
+        if (r->tcpip_if != ptr->tcpip_if || r->ip_protocol != ptr->ip_protocol || !_mdns_cache_ms_left(r, now)
+                || !_mdns_cache_name_match(r, r->type, ptr->target, ptr->service, ptr->proto)) {
+            continue;
+        }
+        if (r->type == MDNS_TYPE_SRV && !result->hostname) {
+            r->in_use = true;
+            result->hostname = mdns_mem_strdup(r->target);
+            result->port = r->port;
+        } else if (r->type == MDNS_TYPE_TXT && !result->txt) {
+            r->in_use = true;
+            _mdns_result_txt_create(r->txt, r->txt_len, &result->txt, &result->txt_value_len, &result->txt_count);
+        }
+    }
+    if (result->hostname) {
+        _mdns_cache_add_host_addresses(search, result->hostname, ptr->tcpip_if, ptr->ip_protocol, now);
+    }
+}
+
+/**
+ * @brief  Called from service thread to fill results of a new search from the cache
+ *
+ * PTR searches keep the cached results and are still sent, unless they already reached max_results.
+ *
+ * @return true if the search was answered from the cache and does not need to be sent
+ */
+static bool _mdns_cache_answer_search(mdns_search_once_t *search)
+{
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    mdns_cache_record_t *r;
+    mdns_result_t *result;
+
+    if (search->type != MDNS_TYPE_PTR && search->type != MDNS_TYPE_SRV && search->type != MDNS_TYPE_TXT
+            && search->type != MDNS_TYPE_A && search->type != MDNS_TYPE_AAAA) {
+        return false;
+    }
+    for (r = _mdns_server->cache; r; r = r->next) {
+        if (!_mdns_cache_ms_left(r, now) || !_mdns_cache_name_match(r, search->type, search->instance, search->service, search->proto)) {
+            continue;
+        }
+        r->in_use = true;
+        uint32_t ttl = _mdns_cache_ttl_left(r, now);
+        if (r->type == MDNS_TYPE_PTR) {
+            result = _mdns_search_result_add_ptr(search, r->target, r->service, r->proto, r->tcpip_if, r->ip_protocol, ttl);
+            if (result) {
+                _mdns_cache_add_instance(search, result, r, now);
+            }
+        } else if (r->type == MDNS_TYPE_SRV) {
+            _mdns_search_result_add_srv(search, r->target, r->port, r->tcpip_if, r->ip_protocol, ttl);
+            _mdns_cache_add_host_addresses(search, r->target, r->tcpip_if, r->ip_protocol, now);
+        } else if (r->type == MDNS_TYPE_TXT) {
+            mdns_txt_item_t *txt = NULL;
+            uint8_t *txt_value_len = NULL;
+            size_t txt_count = 0;
+            _mdns_result_txt_create(r->txt, r->txt_len, &txt, &txt_value_len, &txt_count);
+            if (txt_count) {
+                _mdns_search_result_add_txt(search, txt, txt_value_len, txt_count, r->tcpip_if, r->ip_protocol, ttl);
+            }
+        } else {
+            _mdns_search_result_add_ip(search, r->host, &r->addr, r->tcpip_if, r->ip_protocol, ttl);
+        }
+    }
+
+    if (!search->num_results) {
+        return false;
+    }
+    if (search->type == MDNS_TYPE_PTR) {
+        // other instances may exist on the network, so browse unless enough were found;
+        // complete cached instances are sent with the query as known answers
+        return search->max_results && search->num_results >= search->max_results;
+    }
+    return true;
+}
+
+/**
+ * @brief  Send query refreshing cached record (and all others with the same name and type)
+ */
+static void _mdns_cache_send_refresh(mdns_cache_record_t *record, uint32_t now)
+{
+    mdns_cache_record_t *r;
+    for (r = _mdns_server->cache; r; r = r->next) {
+        if (r != record && _mdns_cache_same_question(r, record) && _mdns_cache_refresh_due(r, now)) {
+            r->refresh_step++;
+        }
+    }
+    record->refresh_step++;
+
+    if (!mdns_is_netif_ready(record->tcpip_if, record->ip_protocol)
+            || _mdns_server->interfaces[record->tcpip_if].pcbs[record->ip_protocol].state <= PCB_INIT) {
+        return;
+    }
+    mdns_tx_packet_t *packet = _mdns_alloc_packet_default(record->tcpip_if, record->ip_protocol);
+    if (!packet) {
+        return;
+    }
+    mdns_out_question_t *q = (mdns_out_question_t *)mdns_mem_calloc(1, sizeof(mdns_out_question_t));
+    if (!q) {
+        HOOK_MALLOC_FAILED;
+        _mdns_free_tx_packet(packet);
+        return;
+    }
+    q->type = record->type;
+    q->own_dynamic_memory = true;
+    queueToEnd(mdns_out_question_t, packet->questions, q);
+    if ((record->host && !(q->host = mdns_mem_strdup(record->host)))
+            || (record->service && !(q->service = mdns_mem_strdup(record->service)))
+            || (record->proto && !(q->proto = mdns_mem_strdup(record->proto)))
+            || !(q->domain = mdns_mem_strdup(MDNS_DEFAULT_DOMAIN))) {
+        HOOK_MALLOC_FAILED;
+        _mdns_free_tx_packet(packet);
+        return;
+    }
+    _mdns_schedule_tx_packet(packet, 0);
+}
+
+/**
+ * @brief  Called from timer task to expire cached records and refresh the ones in use
+ */
+static void _mdns_cache_run(void)
+{
+    MDNS_SERVICE_LOCK();
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    mdns_cache_record_t *r = _mdns_server->cache;
+    while (r) {
+        mdns_cache_record_t *next = r->next;
+        if (!_mdns_cache_ms_left(r, now)) {
+            _mdns_cache_remove(r);
+        } else if (_mdns_cache_refresh_due(r, now)) {
+            _mdns_cache_send_refresh(r, now);
+        }
+        r = next;
+    }
+    MDNS_SERVICE_UNLOCK();
 }
+#endif /* CONFIG_MDNS_RECORD_CACHE */
 
 static void _mdns_tx_handle_packet(mdns_tx_packet_t *p)
 {
@@ -5151,6 +6347,27 @@ static void _mdns_tx_handle_packet(mdns_tx_packet_t *p)
     }
 }
 
+/**
+ * @brief  Transmits all packets the scheduler marked as due
+ */
+static void _mdns_tx_handle_due_packets(void)
+{
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    mdns_tx_stats_t *stats = &_mdns_server->tx_stats;
+    mdns_tx_packet_t *p;
+    while (_mdns_server->tx_due) {
+        p = _mdns_server->tx_due;
+        _mdns_unschedule_tx_packet(p);
+        uint32_t late = (int32_t)(now - p->send_at) > 0 ? now - p->send_at : 0;
+        stats->sent++;
+        stats->lateness_total_ms += late;
+        if (late > stats->lateness_max_ms) {
+            stats->lateness_max_ms = late;
+        }
+        _mdns_tx_handle_packet(p);
+    }
+}
+
 static void _mdns_remap_self_service_hostname(const char *old_hostname, const char *new_hostname)
 {
     mdns_srv_item_t *service = _mdns_server->services;
@@ -5204,9 +6421,6 @@ static void _mdns_free_action(mdns_action_t *action)
     case ACTION_BROWSE_SYNC:
         _mdns_sync_browse_result_link_free(action->data.browse_sync.browse_sync);
         break;
-    case ACTION_TX_HANDLE:
-        _mdns_free_tx_packet(action->data.tx_handle.packet);
-        break;
     case ACTION_RX_HANDLE:
         _mdns_packet_free(action->data.rx_handle.packet);
         break;
@@ -5221,7 +6435,7 @@ static void _mdns_free_action(mdns_action_t *action)
     default:
         break;
     }
-    mdns_mem_free(action);
+    mdns_mem_pool_free(MDNS_POOL_ACTION, action);
 }
 
 /**
@@ -5250,6 +6464,12 @@ static void _mdns_execute_action(mdns_action_t *action)
 
         break;
     case ACTION_SEARCH_ADD:
+#if CONFIG_MDNS_RECORD_CACHE
+        if (_mdns_cache_answer_search(action->data.search_add.search)) {
+            _mdns_search_finish(action->data.search_add.search);
+            break;
+        }
+#endif
         _mdns_search_add(action->data.search_add.search);
         break;
     case ACTION_SEARCH_SEND:
@@ -5270,18 +6490,10 @@ static void _mdns_execute_action(mdns_action_t *action)
         _mdns_browse_finish(action->data.browse_add.browse);
         break;
 
-    case ACTION_TX_HANDLE: {
-        mdns_tx_packet_t *p = _mdns_server->tx_queue_head;
-        // packet to be handled should be at tx head, but must be consistent with the one pushed to action queue
-        if (p && p == action->data.tx_handle.packet && p->queued) {
-            p->queued = false; // clearing, as the packet might be reused (pushed and transmitted again)
-            _mdns_server->tx_queue_head = p->next;
-            _mdns_tx_handle_packet(p);
-        } else {
-            ESP_LOGD(TAG, "Skipping transmit of an unexpected packet!");
-        }
-    }
-    break;
+    case ACTION_TX_HANDLE:
+        _mdns_server->tx_handle_pending = false;
+        _mdns_tx_handle_due_packets();
+        break;
     case ACTION_RX_HANDLE:
         mdns_parse_packet(action->data.rx_handle.packet);
         _mdns_packet_free(action->data.rx_handle.packet);
@@ -5308,7 +6520,7 @@ static void _mdns_execute_action(mdns_action_t *action)
     default:
         break;
     }
-    mdns_mem_free(action);
+    mdns_mem_pool_free(MDNS_POOL_ACTION, action);
 }
 
 /**
@@ -5318,7 +6530,7 @@ static esp_err_t _mdns_send_search_action(mdns_action_type_t type, mdns_search_o
 {
     mdns_action_t *action = NULL;
 
-    action = (mdns_action_t *)mdns_mem_malloc(sizeof(mdns_action_t));
+    action = (mdns_action_t *)mdns_mem_pool_malloc(MDNS_POOL_ACTION, sizeof(mdns_action_t));
     if (!action) {
         HOOK_MALLOC_FAILED;
         return ESP_ERR_NO_MEM;
@@ -5327,7 +6539,7 @@ static esp_err_t _mdns_send_search_action(mdns_action_type_t type, mdns_search_o
     action->type = type;
     action->data.search_add.search = search;
     if (xQueueSend(_mdns_server->action_queue, &action, (TickType_t)0) != pdPASS) {
-        mdns_mem_free(action);
+        mdns_mem_pool_free(MDNS_POOL_ACTION, action);
         return ESP_ERR_NO_MEM;
     }
     return ESP_OK;
@@ -5336,40 +6548,39 @@ static esp_err_t _mdns_send_search_action(mdns_action_type_t type, mdns_search_o
 /**
  * @brief  Called from timer task to run mDNS responder
  *
- * periodically checks first unqueued packet (from tx head).
- * if it is scheduled to be transmitted, then pushes the packet to action queue to be handled.
+ * moves all packets which are scheduled to be transmitted from the scheduler heap to the tx_due list
+ * and pushes one action to the action queue to transmit them.
  *
  */
 static void _mdns_scheduler_run(void)
 {
     MDNS_SERVICE_LOCK();
-    mdns_tx_packet_t *p = _mdns_server->tx_queue_head;
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    mdns_tx_packet_t *p = NULL;
     mdns_action_t *action = NULL;
 
-    // find first unqueued packet
-    while (p && p->queued) {
-        p = p->next;
+    while (_mdns_server->tx_heap_len && (int32_t)(_mdns_server->tx_heap[0]->send_at - now) < 0) {
+        p = _mdns_server->tx_heap[0];
+        _mdns_tx_heap_remove(p);
+        p->queued = true;
+        p->next = NULL;
+        queueToEnd(mdns_tx_packet_t, _mdns_server->tx_due, p);
     }
-    if (!p) {
+    if (!_mdns_server->tx_due || _mdns_server->tx_handle_pending) {
         MDNS_SERVICE_UNLOCK();
         return;
     }
-    while (p && (int32_t)(p->send_at - (xTaskGetTickCount() * portTICK_PERIOD_MS)) < 0) {
-        action = (mdns_action_t *)mdns_mem_malloc(sizeof(mdns_action_t));
-        if (action) {
-            action->type = ACTION_TX_HANDLE;
-            action->data.tx_handle.packet = p;
-            p->queued = true;
-            if (xQueueSend(_mdns_server->action_queue, &action, (TickType_t)0) != pdPASS) {
-                mdns_mem_free(action);
-                p->queued = false;
-            }
-        } else {
-            HOOK_MALLOC_FAILED;
-            break;
+    action = (mdns_action_t *)mdns_mem_pool_malloc(MDNS_POOL_ACTION, sizeof(mdns_action_t));
+    if (action) {
+        action->type = ACTION_TX_HANDLE;
+        action->data.tx_handle.packet = NULL;
+        _mdns_server->tx_handle_pending = true;
+        if (xQueueSend(_mdns_server->action_queue, &action, (TickType_t)0) != pdPASS) {
+            mdns_mem_pool_free(MDNS_POOL_ACTION, action);
+            _mdns_server->tx_handle_pending = false;
         }
-        //Find the next unqued packet
-        p = p->next;
+    } else {
+        HOOK_MALLOC_FAILED;
     }
     MDNS_SERVICE_UNLOCK();
 }
@@ -5435,6 +6646,9 @@ static void _mdns_timer_cb(void *arg)
 {
     _mdns_scheduler_run();
     _mdns_search_run();
+#if CONFIG_MDNS_RECORD_CACHE
+    _mdns_cache_run();
+#endif
 }
 
 static esp_err_t _mdns_start_timer(void)
@@ -5556,17 +6770,18 @@ static esp_err_t mdns_post_custom_action_tcpip_if(mdns_if_t mdns_if, mdns_event_
         return ESP_ERR_INVALID_STATE;
     }
 
-    mdns_action_t *action = (mdns_action_t *)mdns_mem_calloc(1, sizeof(mdns_action_t));
+    mdns_action_t *action = (mdns_action_t *)mdns_mem_pool_malloc(MDNS_POOL_ACTION, sizeof(mdns_action_t));
     if (!action) {
         HOOK_MALLOC_FAILED;
         return ESP_ERR_NO_MEM;
     }
+    memset(action, 0, sizeof(mdns_action_t));
     action->type = ACTION_SYSTEM_EVENT;
     action->data.sys_event.event_action = event_action;
     action->data.sys_event.interface = mdns_if;
 
     if (xQueueSend(_mdns_server->action_queue, &action, (TickType_t)0) != pdPASS) {
-        mdns_mem_free(action);
+        mdns_mem_pool_free(MDNS_POOL_ACTION, action);
     }
     return ESP_OK;
 }
@@ -5785,6 +7000,7 @@ void mdns_free(void)
         vQueueDelete(_mdns_server->action_queue);
     }
     _mdns_clear_tx_queue_head();
+    mdns_mem_free(_mdns_server->tx_heap);
     while (_mdns_server->search_once) {
         mdns_search_once_t *h = _mdns_server->search_once;
         _mdns_server->search_once = h->next;
@@ -5821,7 +7037,7 @@ esp_err_t mdns_hostname_set(const char *hostname)
         return ESP_ERR_NO_MEM;
     }
 
-    mdns_action_t *action = (mdns_action_t *)mdns_mem_malloc(sizeof(mdns_action_t));
+    mdns_action_t *action = (mdns_action_t *)mdns_mem_pool_malloc(MDNS_POOL_ACTION, sizeof(mdns_action_t));
     if (!action) {
         HOOK_MALLOC_FAILED;
         mdns_mem_free(new_hostname);
@@ -5831,7 +7047,7 @@ esp_err_t mdns_hostname_set(const char *hostname)
     action->data.hostname_set.hostname = new_hostname;
     if (xQueueSend(_mdns_server->action_queue, &action, (TickType_t)0) != pdPASS) {
         mdns_mem_free(new_hostname);
-        mdns_mem_free(action);
+        mdns_mem_pool_free(MDNS_POOL_ACTION, action);
         return ESP_ERR_NO_MEM;
     }
     xSemaphoreTake(_mdns_server->action_sema, portMAX_DELAY);
@@ -5869,7 +7085,7 @@ esp_err_t mdns_delegate_hostname_add(const char *hostname, const mdns_ip_addr_t
         return ESP_ERR_NO_MEM;
     }
 
-    mdns_action_t *action = (mdns_action_t *)mdns_mem_malloc(sizeof(mdns_action_t));
+    mdns_action_t *action = (mdns_action_t *)mdns_mem_pool_malloc(MDNS_POOL_ACTION, sizeof(mdns_action_t));
     if (!action) {
         HOOK_MALLOC_FAILED;
         mdns_mem_free(new_hostname);
@@ -5880,7 +7096,7 @@ esp_err_t mdns_delegate_hostname_add(const char *hostname, const mdns_ip_addr_t
     action->data.delegate_hostname.address_list = copy_address_list(address_list);
     if (xQueueSend(_mdns_server->action_queue, &action, (TickType_t)0) != pdPASS) {
         mdns_mem_free(new_hostname);
-        mdns_mem_free(action);
+        mdns_mem_pool_free(MDNS_POOL_ACTION, action);
         return ESP_ERR_NO_MEM;
     }
     xSemaphoreTake(_mdns_server->action_sema, portMAX_DELAY);
@@ -5900,7 +7116,7 @@ esp_err_t mdns_delegate_hostname_remove(const char *hostname)
         return ESP_ERR_NO_MEM;
     }
 
-    mdns_action_t *action = (mdns_action_t *)mdns_mem_malloc(sizeof(mdns_action_t));
+    mdns_action_t *action = (mdns_action_t *)mdns_mem_pool_malloc(MDNS_POOL_ACTION, sizeof(mdns_action_t));
     if (!action) {
         HOOK_MALLOC_FAILED;
         mdns_mem_free(new_hostname);
@@ -5910,7 +7126,7 @@ esp_err_t mdns_delegate_hostname_remove(const char *hostname)
     action->data.delegate_hostname.hostname = new_hostname;
     if (xQueueSend(_mdns_server->action_queue, &action, (TickType_t)0) != pdPASS) {
         mdns_mem_free(new_hostname);
-        mdns_mem_free(action);
+        mdns_mem_pool_free(MDNS_POOL_ACTION, action);
         return ESP_ERR_NO_MEM;
     }
     return ESP_OK;
@@ -5929,7 +7145,7 @@ esp_err_t mdns_delegate_hostname_set_address(const char *hostname, const mdns_ip
         return ESP_ERR_NO_MEM;
     }
 
-    mdns_action_t *action = (mdns_action_t *)mdns_mem_malloc(sizeof(mdns_action_t));
+    mdns_action_t *action = (mdns_action_t *)mdns_mem_pool_malloc(MDNS_POOL_ACTION, sizeof(mdns_action_t));
     if (!action) {
         HOOK_MALLOC_FAILED;
         mdns_mem_free(new_hostname);
@@ -5940,7 +7156,7 @@ esp_err_t mdns_delegate_hostname_set_address(const char *hostname, const mdns_ip
     action->data.delegate_hostname.address_list = copy_address_list(address_list);
     if (xQueueSend(_mdns_server->action_queue, &action, (TickType_t)0) != pdPASS) {
         mdns_mem_free(new_hostname);
-        mdns_mem_free(action);
+        mdns_mem_pool_free(MDNS_POOL_ACTION, action);
         return ESP_ERR_NO_MEM;
     }
     return ESP_OK;
@@ -5968,7 +7184,7 @@ esp_err_t mdns_instance_name_set(const char *instance)
         return ESP_ERR_NO_MEM;
     }
 
-    mdns_action_t *action = (mdns_action_t *)mdns_mem_malloc(sizeof(mdns_action_t));
+    mdns_action_t *action = (mdns_action_t *)mdns_mem_pool_malloc(MDNS_POOL_ACTION, sizeof(mdns_action_t));
     if (!action) {
         HOOK_MALLOC_FAILED;
         mdns_mem_free(new_instance);
@@ -5978,7 +7194,7 @@ esp_err_t mdns_instance_name_set(const char *instance)
     action->data.instance = new_instance;
     if (xQueueSend(_mdns_server->action_queue, &action, (TickType_t)0) != pdPASS) {
         mdns_mem_free(new_instance);
-        mdns_mem_free(action);
+        mdns_mem_pool_free(MDNS_POOL_ACTION, action);
         return ESP_ERR_NO_MEM;
     }
     return ESP_OK;
@@ -6017,6 +7233,7 @@ esp_err_t mdns_service_add_for_host(const char *instance, const char *service, c
 
     item->next = _mdns_server->services;
     _mdns_server->services = item;
+    _mdns_service_index_add(item);
     _mdns_probe_all_pcbs(&item, 1, false, false);
     MDNS_SERVICE_UNLOCK();
     return ESP_OK;
@@ -6113,12 +7330,9 @@ handle_error:
 
 static mdns_ip_addr_t *_copy_delegated_host_address_list(char *hostname)
 {
-    mdns_host_item_t *host = _mdns_host_list;
-    while (host) {
-        if (strcasecmp(host->hostname, hostname) == 0) {
-            return copy_address_list(host->address_list);
-        }
-        host = host->next;
+    mdns_host_item_t *host = _mdns_get_delegated_host_item(hostname);
+    if (host) {
+        return copy_address_list(host->address_list);
     }
     return NULL;
 }
@@ -6688,6 +7902,7 @@ esp_err_t mdns_service_remove_for_host(const char *instance, const char *service
                 }
                 _mdns_send_bye(&a, 1, false);
                 _mdns_remove_scheduled_service_packets(a->service);
+                _mdns_service_index_remove(a);
                 _mdns_free_service(a->service);
                 mdns_mem_free(a);
                 break;
@@ -6705,6 +7920,7 @@ esp_err_t mdns_service_remove_for_host(const char *instance, const char *service
                 }
                 _mdns_send_bye(&a, 1, false);
                 _mdns_remove_scheduled_service_packets(a->service);
+                _mdns_service_index_remove(a);
                 _mdns_free_service(a->service);
                 mdns_mem_free(a);
                 break;
@@ -6739,6 +7955,7 @@ esp_err_t mdns_service_remove_all(void)
     _mdns_send_final_bye(false);
     mdns_srv_item_t *services = _mdns_server->services;
     _mdns_server->services = NULL;
+    memset(_mdns_server->services_index, 0, sizeof(_mdns_server->services_index));
     while (services) {
         mdns_srv_item_t *s = services;
         services = services->next;
@@ -6752,6 +7969,25 @@ done:
     return ret;
 }
 
+esp_err_t mdns_tx_stats_get(mdns_tx_stats_t *stats, bool reset)
+{
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!_mdns_server) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    MDNS_SERVICE_LOCK();
+    *stats = _mdns_server->tx_stats;
+    if (reset) {
+        memset(&_mdns_server->tx_stats, 0, sizeof(mdns_tx_stats_t));
+        _mdns_server->tx_stats.queue_depth = stats->queue_depth;
+        _mdns_server->tx_stats.queue_depth_max = stats->queue_depth;
+    }
+    MDNS_SERVICE_UNLOCK();
+    return ESP_OK;
+}
+
 /*
  * MDNS QUERY
  * */
@@ -7252,7 +8488,7 @@ static esp_err_t _mdns_sync_browse_action(mdns_action_type_t type, mdns_browse_s
 {
     mdns_action_t *action = NULL;
 
-    action = (mdns_action_t *)mdns_mem_malloc(sizeof(mdns_action_t));
+    action = (mdns_action_t *)mdns_mem_pool_malloc(MDNS_POOL_ACTION, sizeof(mdns_action_t));
     if (!action) {
         HOOK_MALLOC_FAILED;
         return ESP_ERR_NO_MEM;
@@ -7261,7 +8497,7 @@ static esp_err_t _mdns_sync_browse_action(mdns_action_type_t type, mdns_browse_s
     action->type = type;
     action->data.browse_sync.browse_sync = browse_sync;
     if (xQueueSend(_mdns_server->action_queue, &action, (TickType_t)0) != pdPASS) {
-        mdns_mem_free(action);
+        mdns_mem_pool_free(MDNS_POOL_ACTION, action);
         return ESP_ERR_NO_MEM;
     }
     return ESP_OK;
@@ -7274,7 +8510,7 @@ static esp_err_t _mdns_send_browse_action(mdns_action_type_t type, mdns_browse_t
 {
     mdns_action_t *action = NULL;
 
-    action = (mdns_action_t *)mdns_mem_malloc(sizeof(mdns_action_t));
+    action = (mdns_action_t *)mdns_mem_pool_malloc(MDNS_POOL_ACTION, sizeof(mdns_action_t));
 
     if (!action) {
         HOOK_MALLOC_FAILED;
@@ -7284,7 +8520,7 @@ static esp_err_t _mdns_send_browse_action(mdns_action_type_t type, mdns_browse_t
     action->type = type;
     action->data.browse_add.browse = browse;
     if (xQueueSend(_mdns_server->action_queue, &action, (TickType_t)0) != pdPASS) {
-        mdns_mem_free(action);
+        mdns_mem_pool_free(MDNS_POOL_ACTION, action);
         return ESP_ERR_NO_MEM;
     }
     return ESP_OK;
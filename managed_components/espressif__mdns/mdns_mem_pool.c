@@ -0,0 +1,117 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+#include "sdkconfig.h"
+#include "mdns_private.h"
+#include "mdns_mem_pool.h"
+
+#if CONFIG_MDNS_MEMORY_POOLS
+
+/**
+ * @brief Free block, the link is stored in the block itself
+ */
+typedef struct mdns_pool_block_s {
+    struct mdns_pool_block_s *next;
+} mdns_pool_block_t;
+
+typedef struct {
+    uint8_t *base;                  /*!< first block */
+    size_t block_size;
+    uint32_t count;                 /*!< number of blocks */
+    uint32_t untouched;             /*!< blocks [untouched, count) were never handed out */
+    mdns_pool_block_t *free_list;   /*!< returned blocks */
+    uint32_t used;
+    uint32_t high_water;
+    uint32_t heap_fallbacks;
+} mdns_pool_t;
+
+static mdns_action_t s_action_blocks[CONFIG_MDNS_POOL_ACTIONS];
+static mdns_rx_packet_t s_rx_packet_blocks[CONFIG_MDNS_POOL_RX_PACKETS];
+static mdns_parsed_packet_t s_parsed_packet_blocks[CONFIG_MDNS_POOL_PARSED_PACKETS];
+static mdns_out_answer_t s_out_answer_blocks[CONFIG_MDNS_POOL_OUT_ANSWERS];
+static mdns_tx_packet_t s_tx_packet_blocks[CONFIG_MDNS_POOL_TX_PACKETS];
+
+#define MDNS_POOL_INIT(blocks) { \
+    .base = (uint8_t *)(blocks), \
+    .block_size = sizeof((blocks)[0]), \
+    .count = sizeof(blocks) / sizeof((blocks)[0]) }
+
+static mdns_pool_t s_pools[MDNS_POOL_MAX] = {
+    [MDNS_POOL_ACTION] = MDNS_POOL_INIT(s_action_blocks),
+    [MDNS_POOL_RX_PACKET] = MDNS_POOL_INIT(s_rx_packet_blocks),
+    [MDNS_POOL_PARSED_PACKET] = MDNS_POOL_INIT(s_parsed_packet_blocks),
+    [MDNS_POOL_OUT_ANSWER] = MDNS_POOL_INIT(s_out_answer_blocks),
+    [MDNS_POOL_TX_PACKET] = MDNS_POOL_INIT(s_tx_packet_blocks),
+};
+
+// actions and received packets are allocated outside of the mDNS task
+static portMUX_TYPE s_pool_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void *mdns_mem_pool_malloc(mdns_pool_id_t id, size_t size)
+{
+    mdns_pool_t *pool = &s_pools[id];
+    void *ptr = NULL;
+
+    if (size <= pool->block_size) {
+        portENTER_CRITICAL(&s_pool_lock);
+        if (pool->free_list) {
+            ptr = pool->free_list;
+            pool->free_list = pool->free_list->next;
+        } else if (pool->untouched < pool->count) {
+            ptr = pool->base + (size_t)pool->untouched++ * pool->block_size;
+        }
+        if (ptr) {
+            if (++pool->used > pool->high_water) {
+                pool->high_water = pool->used;
+            }
+        } else {
+            pool->heap_fallbacks++;
+        }
+        portEXIT_CRITICAL(&s_pool_lock);
+    }
+    if (!ptr) {
+        ptr = mdns_mem_malloc(size);
+    }
+    return ptr;
+}
+
+void mdns_mem_pool_free(mdns_pool_id_t id, void *ptr)
+{
+    mdns_pool_t *pool = &s_pools[id];
+    uint8_t *p = (uint8_t *)ptr;
+
+    if (p < pool->base || p >= pool->base + (size_t)pool->count * pool->block_size) {
+        mdns_mem_free(ptr);
+        return;
+    }
+    mdns_pool_block_t *block = (mdns_pool_block_t *)p;
+    portENTER_CRITICAL(&s_pool_lock);
+    block->next = pool->free_list;
+    pool->free_list = block;
+    pool->used--;
+    portEXIT_CRITICAL(&s_pool_lock);
+}
+
+#endif // CONFIG_MDNS_MEMORY_POOLS
+
+esp_err_t mdns_pool_stats_get(mdns_pool_id_t id, mdns_pool_stats_t *stats)
+{
+#if CONFIG_MDNS_MEMORY_POOLS
+    if (id >= MDNS_POOL_MAX || !stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    mdns_pool_t *pool = &s_pools[id];
+    portENTER_CRITICAL(&s_pool_lock);
+    stats->size = pool->count;
+    stats->used = pool->used;
+    stats->high_water = pool->high_water;
+    stats->heap_fallbacks = pool->heap_fallbacks;
+    portEXIT_CRITICAL(&s_pool_lock);
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
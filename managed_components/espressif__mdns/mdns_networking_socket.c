@@ -8,6 +8,12 @@
  * @brief MDNS Server Networking module implemented using BSD sockets
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     // recvmmsg()
+#endif
+#if defined(__linux__)
+#define MDNS_SOCKET_EPOLL 1     // event driven receive loop
+#endif
 #include <string.h>
 #include "esp_event.h"
 #include "mdns_networking.h"
@@ -22,11 +28,16 @@
 #include <sys/param.h>
 #include "esp_log.h"
 #include "mdns_mem_caps.h"
+#include "mdns_mem_pool.h"
 
 #if defined(CONFIG_IDF_TARGET_LINUX)
 #include <sys/ioctl.h>
 #include <net/if.h>
 #endif
+#if MDNS_SOCKET_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
 
 enum interface_protocol {
     PROTO_IPV4 = 1 << MDNS_IP_PROTOCOL_V4,
@@ -42,6 +53,15 @@ static interfaces_t s_interfaces[MDNS_MAX_INTERFACES];
 
 static const char *TAG = "mdns_networking";
 static bool s_run_sock_recv_task = false;
+#if MDNS_SOCKET_EPOLL
+#define MDNS_EPOLL_CTRL MDNS_MAX_INTERFACES     // event data of the control eventfd, sockets use their tcpip_if
+static int s_epoll_fd = -1;
+static int s_ctrl_fd = -1;  // wakes up the receive task when the interfaces change
+// guards the epoll instance and the run flag between the mDNS task and the exiting receive task
+static SemaphoreHandle_t s_epoll_lock;
+static StaticSemaphore_t s_epoll_lock_buf;
+static bool s_sock_recv_task_alive = false; // cleared by the receive task when it closes the epoll instance
+#endif
 static int create_socket(esp_netif_t *netif);
 static int join_mdns_multicast_group(int sock, esp_netif_t *netif, mdns_ip_protocol_t ip_protocol);
 
@@ -58,19 +78,146 @@ struct pbuf  {
 #define s6_addr32 un.u32_addr
 #endif // CONFIG_IDF_TARGET_LINUX
 
+#if CONFIG_MDNS_SOCKET_RX_ZERO_COPY
+#if defined(__linux__)
+#define MDNS_RX_BATCH   CONFIG_MDNS_SOCKET_RX_BATCH
+#else
+#define MDNS_RX_BATCH   1
+#endif
+
+/**
+ * @brief Preallocated receive buffer, the embedded packet is passed to the mDNS task as is
+ */
+typedef struct {
+    mdns_rx_packet_t packet;                /*!< must be the first member, see rx_buffer_from_packet() */
+    struct pbuf pb;
+    uint32_t refcount;                      /*!< references of the receive task and of the queued packet */
+    uint8_t payload[MDNS_MAX_PACKET_SIZE];
+} mdns_rx_buffer_t;
+
+static mdns_rx_buffer_t s_rx_buffers[CONFIG_MDNS_SOCKET_RX_BUFFERS];
+static size_t s_rx_next;    // next buffer of the ring to claim
+// buffers are claimed by the receive task and released by the mDNS task
+static portMUX_TYPE s_rx_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static mdns_rx_buffer_t *rx_buffer_from_packet(mdns_rx_packet_t *packet)
+{
+    mdns_rx_buffer_t *buf = (mdns_rx_buffer_t *)packet;
+    if (buf < s_rx_buffers || buf >= s_rx_buffers + CONFIG_MDNS_SOCKET_RX_BUFFERS) {
+        return NULL;
+    }
+    return buf;
+}
+
+static void rx_buffer_ref(mdns_rx_buffer_t *buf)
+{
+    portENTER_CRITICAL(&s_rx_lock);
+    buf->refcount++;
+    portEXIT_CRITICAL(&s_rx_lock);
+}
+
+static void rx_buffer_unref(mdns_rx_buffer_t *buf)
+{
+    portENTER_CRITICAL(&s_rx_lock);
+    buf->refcount--;
+    portEXIT_CRITICAL(&s_rx_lock);
+}
+
+/**
+ * @brief Claims up to max free buffers in ring order, holding one reference to each of them
+ *
+ * @return number of claimed buffers, 0 if all buffers are in use
+ */
+static size_t rx_buffers_claim(mdns_rx_buffer_t **bufs, size_t max)
+{
+    size_t count = 0;
+    portENTER_CRITICAL(&s_rx_lock);
+    for (size_t i = 0; i < CONFIG_MDNS_SOCKET_RX_BUFFERS && count < max; ++i) {
+        mdns_rx_buffer_t *buf = &s_rx_buffers[s_rx_next];
+        s_rx_next = (s_rx_next + 1) % CONFIG_MDNS_SOCKET_RX_BUFFERS;
+        if (buf->refcount == 0) {
+            buf->refcount = 1;
+            bufs[count++] = buf;
+        }
+    }
+    portEXIT_CRITICAL(&s_rx_lock);
+    return count;
+}
+#endif // CONFIG_MDNS_SOCKET_RX_ZERO_COPY
+
 static void __attribute__((constructor)) ctor_networking_socket(void)
 {
     for (int i = 0; i < sizeof(s_interfaces) / sizeof(s_interfaces[0]); ++i) {
         s_interfaces[i].sock = -1;
         s_interfaces[i].proto = 0;
     }
+#if MDNS_SOCKET_EPOLL
+    s_epoll_lock = xSemaphoreCreateMutexStatic(&s_epoll_lock_buf);
+#endif
 }
 
 static void delete_socket(int sock)
 {
+#if MDNS_SOCKET_EPOLL
+    xSemaphoreTake(s_epoll_lock, portMAX_DELAY);
+    if (s_epoll_fd >= 0) {
+        epoll_ctl(s_epoll_fd, EPOLL_CTL_DEL, sock, NULL);
+    }
+    xSemaphoreGive(s_epoll_lock);
+#endif
     close(sock);
 }
 
+#if MDNS_SOCKET_EPOLL
+/**
+ * @brief Creates the epoll instance with the control eventfd, if not created yet
+ *
+ * Called with s_epoll_lock held.
+ */
+static bool epoll_init(void)
+{
+    if (s_epoll_fd >= 0) {
+        return true;
+    }
+    s_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    s_ctrl_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    struct epoll_event event = { .events = EPOLLIN, .data.u32 = MDNS_EPOLL_CTRL };
+    if (s_epoll_fd < 0 || s_ctrl_fd < 0 || epoll_ctl(s_epoll_fd, EPOLL_CTL_ADD, s_ctrl_fd, &event) < 0) {
+        ESP_LOGE(TAG, "Failed to create the epoll instance. errno=%d: %s", errno, strerror(errno));
+        if (s_ctrl_fd >= 0) {
+            close(s_ctrl_fd);
+        }
+        if (s_epoll_fd >= 0) {
+            close(s_epoll_fd);
+        }
+        s_epoll_fd = s_ctrl_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Closes the epoll instance, called by the exiting receive task with s_epoll_lock held
+ */
+static void epoll_deinit(void)
+{
+    close(s_ctrl_fd);
+    close(s_epoll_fd);
+    s_epoll_fd = s_ctrl_fd = -1;
+}
+
+/**
+ * @brief Wakes up the receive task to re-check the interfaces and whether to keep running
+ */
+static void epoll_notify(void)
+{
+    uint64_t one = 1;
+    if (s_ctrl_fd >= 0 && write(s_ctrl_fd, &one, sizeof(one)) < 0) {
+        ESP_LOGE(TAG, "Failed to notify the receive task. errno=%d: %s", errno, strerror(errno));
+    }
+}
+#endif // MDNS_SOCKET_EPOLL
+
 bool mdns_is_netif_ready(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
 {
     return s_interfaces[tcpip_if].proto & (ip_protocol == MDNS_IP_PROTOCOL_V4 ? PROTO_IPV4 : PROTO_IPV6);
@@ -88,9 +235,16 @@ size_t _mdns_get_packet_len(mdns_rx_packet_t *packet)
 
 void _mdns_packet_free(mdns_rx_packet_t *packet)
 {
+#if CONFIG_MDNS_SOCKET_RX_ZERO_COPY
+    mdns_rx_buffer_t *buf = rx_buffer_from_packet(packet);
+    if (buf) {
+        rx_buffer_unref(buf);
+        return;
+    }
+#endif
     mdns_mem_free(packet->pb->payload);
     mdns_mem_free(packet->pb);
-    mdns_mem_free(packet);
+    mdns_mem_pool_free(MDNS_POOL_RX_PACKET, packet);
 }
 
 esp_err_t _mdns_pcb_deinit(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
@@ -100,6 +254,7 @@ esp_err_t _mdns_pcb_deinit(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
         // if the interface for both protocols uninitialized, close the interface socket
         if (s_interfaces[tcpip_if].sock >= 0) {
             delete_socket(s_interfaces[tcpip_if].sock);
+            s_interfaces[tcpip_if].sock = -1;
         }
     }
 
@@ -111,7 +266,14 @@ esp_err_t _mdns_pcb_deinit(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
     }
 
     // no interface alive, stop the rx task
+#if MDNS_SOCKET_EPOLL
+    xSemaphoreTake(s_epoll_lock, portMAX_DELAY);
+    s_run_sock_recv_task = false;
+    epoll_notify();
+    xSemaphoreGive(s_epoll_lock);
+#else
     s_run_sock_recv_task = false;
+#endif
     vTaskDelay(pdMS_TO_TICKS(500));
     return ESP_OK;
 }
@@ -247,6 +409,221 @@ static inline void inet_to_espaddr(const struct sockaddr_storage *in_addr, esp_i
 #endif // CONFIG_LWIP_IPV6
 }
 
+/**
+ * @brief Fills in the descriptor of a datagram received from raddr on the given interface
+ */
+static void rx_packet_init(mdns_rx_packet_t *packet, struct pbuf *pb, mdns_if_t tcpip_if, struct sockaddr_storage *raddr)
+{
+    uint16_t port = 0;
+
+    memset(packet, 0, sizeof(mdns_rx_packet_t));
+    inet_to_espaddr(raddr, &packet->src, &port);
+    packet->tcpip_if = tcpip_if;
+    packet->pb = pb;
+    packet->src_port = ntohs(port);
+    // TODO(IDF-3651): Add the correct dest addr -- for mdns to decide multicast/unicast
+    // Currently it's enough to assume the packet is multicast and mdns to check the source port of the packet
+    packet->multicast = 1;
+    packet->dest.type = packet->src.type;
+    packet->ip_protocol =
+        packet->src.type == ESP_IPADDR_TYPE_V4 ? MDNS_IP_PROTOCOL_V4 : MDNS_IP_PROTOCOL_V6;
+}
+
+/**
+ * @brief Receives one datagram to a static buffer and passes a heap copy of it to the mDNS task
+ *
+ * Only the packet comes from MDNS_POOL_RX_PACKET, the pbuf and the payload are always
+ * allocated on the heap (use CONFIG_MDNS_SOCKET_RX_ZERO_COPY to avoid it).
+ *
+ * @return false if the socket failed
+ */
+static bool sock_recv_copy(int sock, mdns_if_t tcpip_if)
+{
+    static char recvbuf[MDNS_MAX_PACKET_SIZE];
+
+    struct sockaddr_storage raddr; // Large enough for both IPv4 or IPv6
+    socklen_t socklen = sizeof(struct sockaddr_storage);
+    int len = recvfrom(sock, recvbuf, sizeof(recvbuf), 0,
+                       (struct sockaddr *) &raddr, &socklen);
+    if (len < 0) {
+        ESP_LOGE(TAG, "multicast recvfrom failed. errno=%d: %s", errno, strerror(errno));
+        return false;
+    }
+    ESP_LOGD(TAG, "[sock=%d]: Received from IP:%s", sock, get_string_address(&raddr));
+    ESP_LOG_BUFFER_HEXDUMP(TAG, recvbuf, len, ESP_LOG_VERBOSE);
+
+    // Allocate the packet structure and pass it to the mdns main engine
+    mdns_rx_packet_t *packet = (mdns_rx_packet_t *) mdns_mem_pool_malloc(MDNS_POOL_RX_PACKET, sizeof(mdns_rx_packet_t));
+    struct pbuf *packet_pbuf = mdns_mem_calloc(1, sizeof(struct pbuf));
+    uint8_t *buf = mdns_mem_malloc(len);
+    if (packet == NULL || packet_pbuf == NULL || buf == NULL) {
+        mdns_mem_free(buf);
+        mdns_mem_free(packet_pbuf);
+        mdns_mem_pool_free(MDNS_POOL_RX_PACKET, packet);
+        HOOK_MALLOC_FAILED;
+        ESP_LOGE(TAG, "Failed to allocate the mdns packet");
+        return true;
+    }
+    memcpy(buf, recvbuf, len);
+    packet_pbuf->next = NULL;
+    packet_pbuf->payload = buf;
+    packet_pbuf->tot_len = len;
+    packet_pbuf->len = len;
+    rx_packet_init(packet, packet_pbuf, tcpip_if, &raddr);
+    if (_mdns_send_rx_action(packet) != ESP_OK) {
+        ESP_LOGE(TAG, "_mdns_send_rx_action failed!");
+        mdns_mem_free(packet->pb->payload);
+        mdns_mem_free(packet->pb);
+        mdns_mem_pool_free(MDNS_POOL_RX_PACKET, packet);
+    }
+    return true;
+}
+
+#if CONFIG_MDNS_SOCKET_RX_ZERO_COPY
+/**
+ * @brief Receives up to MDNS_RX_BATCH datagrams directly to the ring buffers and passes them
+ * to the mDNS task without copying
+ *
+ * Falls back to sock_recv_copy() if all buffers are still waiting to be parsed.
+ *
+ * @return false if the socket failed
+ */
+static bool sock_recv_zero_copy(int sock, mdns_if_t tcpip_if)
+{
+    mdns_rx_buffer_t *bufs[MDNS_RX_BATCH];
+    struct sockaddr_storage raddr[MDNS_RX_BATCH];
+    size_t len[MDNS_RX_BATCH];
+    int received = 0;
+
+    size_t claimed = rx_buffers_claim(bufs, MDNS_RX_BATCH);
+    if (claimed == 0) {
+        return sock_recv_copy(sock, tcpip_if);
+    }
+#if defined(__linux__)
+    struct mmsghdr msgs[MDNS_RX_BATCH];
+    struct iovec iov[MDNS_RX_BATCH];
+    memset(msgs, 0, sizeof(msgs));
+    for (size_t i = 0; i < claimed; ++i) {
+        iov[i].iov_base = bufs[i]->payload;
+        iov[i].iov_len = sizeof(bufs[i]->payload);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &raddr[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(raddr[i]);
+    }
+    // the socket is readable, so at least one datagram is waiting; take whatever else is queued
+    received = recvmmsg(sock, msgs, claimed, MSG_DONTWAIT, NULL);
+    for (int i = 0; i < received; ++i) {
+        len[i] = msgs[i].msg_len;
+    }
+    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        received = 0;
+    }
+#else
+    socklen_t socklen = sizeof(raddr[0]);
+    int ret = recvfrom(sock, bufs[0]->payload, sizeof(bufs[0]->payload), 0,
+                       (struct sockaddr *) &raddr[0], &socklen);
+    if (ret >= 0) {
+        len[0] = ret;
+        received = 1;
+    } else {
+        received = ret;
+    }
+#endif // __linux__
+    if (received < 0) {
+        ESP_LOGE(TAG, "multicast recvfrom failed. errno=%d: %s", errno, strerror(errno));
+    }
+
+    for (int i = 0; i < received; ++i) {
+        mdns_rx_buffer_t *buf = bufs[i];
+        ESP_LOGD(TAG, "[sock=%d]: Received from IP:%s", sock, get_string_address(&raddr[i]));
+        ESP_LOG_BUFFER_HEXDUMP(TAG, buf->payload, len[i], ESP_LOG_VERBOSE);
+        buf->pb.next = NULL;
+        buf->pb.payload = buf->payload;
+        buf->pb.tot_len = len[i];
+        buf->pb.len = len[i];
+        rx_packet_init(&buf->packet, &buf->pb, tcpip_if, &raddr[i]);
+        // reference of the queued packet, dropped by _mdns_packet_free()
+        rx_buffer_ref(buf);
+        if (_mdns_send_rx_action(&buf->packet) != ESP_OK) {
+            ESP_LOGE(TAG, "_mdns_send_rx_action failed!");
+            rx_buffer_unref(buf);
+        }
+    }
+    // drop the references of the receive task, unused buffers return to the ring
+    for (size_t i = 0; i < claimed; ++i) {
+        rx_buffer_unref(bufs[i]);
+    }
+    return received >= 0;
+}
+#endif // CONFIG_MDNS_SOCKET_RX_ZERO_COPY
+
+static bool sock_recv(int sock, mdns_if_t tcpip_if)
+{
+#if CONFIG_MDNS_SOCKET_RX_ZERO_COPY
+    return sock_recv_zero_copy(sock, tcpip_if);
+#else
+    return sock_recv_copy(sock, tcpip_if);
+#endif
+}
+
+#if MDNS_SOCKET_EPOLL
+/**
+ * @brief Receive loop waiting for readable sockets, which are registered once when created,
+ * or for the control eventfd, which is signalled when the interfaces change
+ *
+ * The epoll instance is closed under s_epoll_lock only if the run flag is still cleared,
+ * a socket registered by _mdns_pcb_init() in the meantime keeps this task running.
+ */
+void sock_recv_task(void *arg)
+{
+    struct epoll_event events[MDNS_MAX_INTERFACES + 1];
+    bool failed = false;
+
+    for (;;) {
+        while (s_run_sock_recv_task) {
+            int n = epoll_wait(s_epoll_fd, events, sizeof(events) / sizeof(events[0]), -1);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                ESP_LOGE(TAG, "epoll_wait failed. errno=%d: %s", errno, strerror(errno));
+                failed = true;
+                break;
+            }
+            for (int i = 0; i < n; i++) {
+                if (events[i].data.u32 == MDNS_EPOLL_CTRL) {
+                    uint64_t count;
+                    if (read(s_ctrl_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+                        ESP_LOGE(TAG, "Failed to read the control eventfd. errno=%d: %s", errno, strerror(errno));
+                    }
+                    continue;
+                }
+                mdns_if_t tcpip_if = events[i].data.u32;
+                int sock = s_interfaces[tcpip_if].sock;
+                if (sock < 0) {
+                    continue;   // closed in the meantime
+                }
+                if (!sock_recv(sock, tcpip_if)) {
+                    break;
+                }
+            }
+        }
+        xSemaphoreTake(s_epoll_lock, portMAX_DELAY);
+        bool stop = failed || !s_run_sock_recv_task;
+        if (stop) {
+            s_run_sock_recv_task = false;
+            s_sock_recv_task_alive = false;
+            epoll_deinit();
+        }
+        xSemaphoreGive(s_epoll_lock);
+        if (stop) {
+            break;
+        }
+    }
+    vTaskDelete(NULL);
+}
+#else
 void sock_recv_task(void *arg)
 {
     while (s_run_sock_recv_task) {
@@ -281,69 +658,31 @@ void sock_recv_task(void *arg)
                     continue;
                 }
                 if (FD_ISSET(sock, &rfds)) {
-                    static char recvbuf[MDNS_MAX_PACKET_SIZE];
-                    uint16_t port = 0;
-
-                    struct sockaddr_storage raddr; // Large enough for both IPv4 or IPv6
-                    socklen_t socklen = sizeof(struct sockaddr_storage);
-                    esp_ip_addr_t addr = {0};
-                    int len = recvfrom(sock, recvbuf, sizeof(recvbuf), 0,
-                                       (struct sockaddr *) &raddr, &socklen);
-                    if (len < 0) {
-                        ESP_LOGE(TAG, "multicast recvfrom failed. errno=%d: %s", errno, strerror(errno));
+                    if (!sock_recv(sock, tcpip_if)) {
                         break;
                     }
-                    ESP_LOGD(TAG, "[sock=%d]: Received from IP:%s", sock, get_string_address(&raddr));
-                    ESP_LOG_BUFFER_HEXDUMP(TAG, recvbuf, len, ESP_LOG_VERBOSE);
-                    inet_to_espaddr(&raddr, &addr, &port);
-
-                    // Allocate the packet structure and pass it to the mdns main engine
-                    mdns_rx_packet_t *packet = (mdns_rx_packet_t *) mdns_mem_calloc(1, sizeof(mdns_rx_packet_t));
-                    struct pbuf *packet_pbuf = mdns_mem_calloc(1, sizeof(struct pbuf));
-                    uint8_t *buf = mdns_mem_malloc(len);
-                    if (packet == NULL || packet_pbuf == NULL || buf == NULL) {
-                        mdns_mem_free(buf);
-                        mdns_mem_free(packet_pbuf);
-                        mdns_mem_free(packet);
-                        HOOK_MALLOC_FAILED;
-                        ESP_LOGE(TAG, "Failed to allocate the mdns packet");
-                        continue;
-                    }
-                    memcpy(buf, recvbuf, len);
-                    packet_pbuf->next = NULL;
-                    packet_pbuf->payload = buf;
-                    packet_pbuf->tot_len = len;
-                    packet_pbuf->len = len;
-                    packet->tcpip_if = tcpip_if;
-                    packet->pb = packet_pbuf;
-                    packet->src_port = ntohs(port);
-                    memcpy(&packet->src, &addr, sizeof(esp_ip_addr_t));
-                    // TODO(IDF-3651): Add the correct dest addr -- for mdns to decide multicast/unicast
-                    // Currently it's enough to assume the packet is multicast and mdns to check the source port of the packet
-                    memset(&packet->dest, 0, sizeof(esp_ip_addr_t));
-                    packet->multicast = 1;
-                    packet->dest.type = packet->src.type;
-                    packet->ip_protocol =
-                        packet->src.type == ESP_IPADDR_TYPE_V4 ? MDNS_IP_PROTOCOL_V4 : MDNS_IP_PROTOCOL_V6;
-                    if (_mdns_send_rx_action(packet) != ESP_OK) {
-                        ESP_LOGE(TAG, "_mdns_send_rx_action failed!");
-                        mdns_mem_free(packet->pb->payload);
-                        mdns_mem_free(packet->pb);
-                        mdns_mem_free(packet);
-                    }
                 }
             }
         }
     }
     vTaskDelete(NULL);
 }
+#endif // MDNS_SOCKET_EPOLL
 
 static void mdns_networking_init(void)
 {
+#if MDNS_SOCKET_EPOLL
+    // a stopped receive task which has not closed the epoll instance yet just keeps running
+    s_run_sock_recv_task = true;
+    if (!s_sock_recv_task_alive) {
+        s_sock_recv_task_alive = xTaskCreate(sock_recv_task, "mdns recv task", 3 * 1024, NULL, 5, NULL) == pdPASS;
+    }
+#else
     if (s_run_sock_recv_task == false) {
         s_run_sock_recv_task = true;
         xTaskCreate(sock_recv_task, "mdns recv task", 3 * 1024, NULL, 5, NULL);
     }
+#endif
 }
 
 static bool create_pcb(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
@@ -354,11 +693,25 @@ static bool create_pcb(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
     int sock = s_interfaces[tcpip_if].sock;
     esp_netif_t *netif = _mdns_get_esp_netif(tcpip_if);
     if (sock < 0) {
+#if MDNS_SOCKET_EPOLL
+        if (!epoll_init()) {
+            return false;
+        }
+#endif
         sock = create_socket(netif);
-    }
-    if (sock < 0) {
-        ESP_LOGE(TAG, "Failed to create the socket!");
-        return false;
+        if (sock < 0) {
+            ESP_LOGE(TAG, "Failed to create the socket!");
+            return false;
+        }
+#if MDNS_SOCKET_EPOLL
+        struct epoll_event event = { .events = EPOLLIN, .data.u32 = tcpip_if };
+        if (epoll_ctl(s_epoll_fd, EPOLL_CTL_ADD, sock, &event) < 0) {
+            ESP_LOGE(TAG, "[sock=%d]: Failed to add the socket to epoll. errno=%d: %s", sock, errno, strerror(errno));
+            close(sock);
+            return false;
+        }
+        epoll_notify();
+#endif
     }
     int err = join_mdns_multicast_group(sock, netif, ip_protocol);
     if (err < 0) {
@@ -372,12 +725,23 @@ static bool create_pcb(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
 esp_err_t _mdns_pcb_init(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
 {
     ESP_LOGI(TAG, "_mdns_pcb_init(tcpip_if=%lu, ip_protocol=%lu)", (unsigned long)tcpip_if, (unsigned long)ip_protocol);
+#if MDNS_SOCKET_EPOLL
+    // registers the socket and restarts the receive task atomically with its exit
+    xSemaphoreTake(s_epoll_lock, portMAX_DELAY);
+    bool created = create_pcb(tcpip_if, ip_protocol);
+    if (created) {
+        mdns_networking_init();
+    }
+    xSemaphoreGive(s_epoll_lock);
+    return created ? ESP_OK : ESP_FAIL;
+#else
     if (!create_pcb(tcpip_if, ip_protocol)) {
         return ESP_FAIL;
     }
 
     mdns_networking_init();
     return ESP_OK;
+#endif
 }
 
 static int create_socket(esp_netif_t *netif)
@@ -0,0 +1,45 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stddef.h>
+#include "sdkconfig.h"
+#include "mdns.h"
+#include "mdns_mem_caps.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if CONFIG_MDNS_MEMORY_POOLS
+
+/**
+ * @brief Allocate one object from a preallocated pool.
+ *        Falls back to mdns_mem_malloc() if the pool is exhausted.
+ * @param pool Pool to allocate from.
+ * @param size Size of the object, must not exceed the pool block size.
+ * @return Pointer to allocated memory, or NULL on failure.
+ */
+void *mdns_mem_pool_malloc(mdns_pool_id_t pool, size_t size);
+
+/**
+ * @brief Return an object allocated by mdns_mem_pool_malloc().
+ *        Objects which were served from the heap are passed to mdns_mem_free().
+ * @param pool Pool the object was allocated from.
+ * @param ptr Pointer to the object (NULL is ignored).
+ */
+void mdns_mem_pool_free(mdns_pool_id_t pool, void *ptr);
+
+#else
+
+#define mdns_mem_pool_malloc(pool, size)    mdns_mem_malloc(size)
+#define mdns_mem_pool_free(pool, ptr)       mdns_mem_free(ptr)
+
+#endif // CONFIG_MDNS_MEMORY_POOLS
+
+#ifdef __cplusplus
+}
+#endif
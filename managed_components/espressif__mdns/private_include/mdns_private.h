@@ -57,6 +57,7 @@
 
 /** The maximum number of services */
 #define MDNS_MAX_SERVICES           CONFIG_MDNS_MAX_SERVICES
+#define MDNS_INDEX_BUCKETS          CONFIG_MDNS_SERVICE_INDEX_BUCKETS
 
 #define MDNS_ANSWER_PTR_TTL         4500
 #define MDNS_ANSWER_TXT_TTL         4500
@@ -67,7 +68,7 @@
 #define MDNS_FLAGS_QUERY_REPSONSE   0x8000
 #define MDNS_FLAGS_AUTHORITATIVE    0x0400
 #define MDNS_FLAGS_QR_AUTHORITATIVE (MDNS_FLAGS_QUERY_REPSONSE | MDNS_FLAGS_AUTHORITATIVE)
-#define MDNS_FLAGS_DISTRIBUTED      0x0200
+#define MDNS_FLAGS_DISTRIBUTED      0x0200                  // TC bit, more known answers follow in the next packet
 
 #define MDNS_NAME_REF               0xC000
 
@@ -87,6 +88,7 @@
 #define MDNS_ANSWER_AAAA            0x10
 #define MDNS_ANSWER_NSEC            0x20
 #define MDNS_ANSWER_SDPTR           0x80
+#define MDNS_ANSWER_A_SIZE          4
 #define MDNS_ANSWER_AAAA_SIZE       16
 
 #define MDNS_SERVICE_PORT           5353                    // UDP port that the server runs on
@@ -104,6 +106,16 @@
 #define MDNS_ACTION_QUEUE_LEN       CONFIG_MDNS_ACTION_QUEUE_LEN  // Maximum actions pending to the server
 #define MDNS_TXT_MAX_LEN            1024                    // Maximum string length of text data in TXT record
 #define MDNS_MAX_PACKET_SIZE        1460                    // Maximum size of mDNS  outgoing packet
+#define MDNS_SHARED_DELAY_MIN_MS    20                      // Shared answers are delayed by 20-120ms and aggregated
+#define MDNS_SHARED_DELAY_MAX_MS    120
+#define MDNS_TC_DELAY_MIN_MS        400                     // Answers to truncated queries wait 400-500ms for the known answers
+#define MDNS_TC_DELAY_MAX_MS        500
+
+#define MDNS_FQDN_DICT_SIZE         128                     // Name compression dictionary slots, must be a power of two
+#define MDNS_CACHE_MAX_TTL          4500                    // Cached records are kept for at most this many seconds
+#define MDNS_CACHE_REFRESH_FIRST    80                      // Cached records in use are refreshed at 80%, 85%, 90% and 95% of TTL
+#define MDNS_CACHE_REFRESH_STEP     5
+#define MDNS_CACHE_REFRESH_STEPS    4
 
 #define MDNS_HEAD_LEN               12
 #define MDNS_HEAD_ID_OFFSET         0
@@ -160,6 +172,8 @@
 #define PCB_STATE_IS_ANNOUNCING(s) (s->state > PCB_PROBE_3 && s->state < PCB_RUNNING)
 #define PCB_STATE_IS_RUNNING(s) (s->state == PCB_RUNNING)
 
+#define MDNS_PCB_BIT(tcpip_if, ip_protocol) (1UL << ((tcpip_if) * MDNS_IP_PROTOCOL_MAX + (ip_protocol)))
+
 #ifndef HOOK_MALLOC_FAILED
 #define HOOK_MALLOC_FAILED  ESP_LOGE(TAG, "Cannot allocate memory (line: %d, free heap: %" PRIu32 " bytes)", __LINE__, esp_get_free_heap_size());
 #endif
@@ -293,6 +307,7 @@ typedef struct {
 
 typedef struct mdns_srv_item_s {
     struct mdns_srv_item_s *next;
+    struct mdns_srv_item_s *index_next;     // next item in the same service index bucket
     mdns_service_t *service;
 } mdns_srv_item_t;
 
@@ -311,6 +326,7 @@ typedef struct mdns_host_item_t {
     const char *hostname;
     mdns_ip_addr_t *address_list;
     struct mdns_host_item_t *next;
+    struct mdns_host_item_t *index_next;    // next item in the same host index bucket
 } mdns_host_item_t;
 
 typedef struct mdns_out_answer_s {
@@ -325,9 +341,25 @@ typedef struct mdns_out_answer_s {
     const char *custom_proto;
 } mdns_out_answer_t;
 
+/**
+ * @brief  Name compression dictionary of the packet being built,
+ *         offsets of the names (and their suffixes) already written, indexed by hash
+ */
+typedef struct {
+    const uint8_t *packet;                  // packet the dictionary belongs to
+    uint16_t entries;
+    bool overflow;                          // too many names, search the packet instead
+    uint32_t hash[MDNS_FQDN_DICT_SIZE];
+    uint16_t offset[MDNS_FQDN_DICT_SIZE];   // 0 marks an empty slot (names never start in the header)
+} mdns_fqdn_dict_t;
+
 typedef struct mdns_tx_packet_s {
     struct mdns_tx_packet_s *next;
+    struct mdns_tx_packet_s *pcb_next;      // scheduled packets of the same pcb
+    struct mdns_tx_packet_s *pcb_prev;
     uint32_t send_at;
+    uint32_t sched_seq;                     // keeps packets scheduled at the same time in FIFO order
+    uint16_t heap_index;                    // 1-based position in the scheduler heap, 0 if not in the heap
     mdns_if_t tcpip_if;
     mdns_ip_protocol_t ip_protocol;
     esp_ip_addr_t dst;
@@ -338,7 +370,7 @@ typedef struct mdns_tx_packet_s {
     mdns_out_answer_t *answers;
     mdns_out_answer_t *servers;
     mdns_out_answer_t *additional;
-    bool queued;
+    bool queued;                            // due and waiting in the tx_due list for the service task
     uint16_t id;
 } mdns_tx_packet_t;
 
@@ -349,6 +381,7 @@ typedef struct {
     uint8_t probe_ip;
     uint8_t probe_running;
     uint16_t failed_probes;
+    struct mdns_tx_packet_s *tx_packets;    // packets scheduled on this pcb
 } mdns_pcb_t;
 
 typedef enum {
@@ -372,6 +405,7 @@ typedef struct mdns_search_once_s {
     uint32_t started_at;
     uint32_t sent_at;
     uint32_t timeout;
+    uint32_t suppressed_pcbs;               // pcbs where another host asked the same question since our last query
     mdns_query_notify_t notifier;
     SemaphoreHandle_t done_semaphore;
     uint16_t type;
@@ -405,6 +439,27 @@ typedef struct mdns_browse_sync {
     mdns_browse_result_sync_t *sync_result;
 } mdns_browse_sync_t;
 
+typedef struct mdns_cache_record_s {
+    struct mdns_cache_record_s *next;
+
+    uint16_t type;
+    mdns_if_t tcpip_if;
+    mdns_ip_protocol_t ip_protocol;
+    bool in_use;                            // used to answer a local query, refreshed before it expires
+    uint8_t refresh_step;                   // refresh queries sent since the record was last received
+    uint32_t received_at;
+    uint32_t ttl;                           // in seconds
+    uint32_t jitter;                        // random delay (ms) added to the refresh points
+    char *host;                             // hostname (A/AAAA) or instance name (SRV/TXT), NULL for PTR
+    char *service;
+    char *proto;
+    char *target;                           // instance name (PTR) or hostname (SRV)
+    uint16_t port;
+    esp_ip_addr_t addr;
+    uint8_t *txt;                           // TXT record data as received
+    uint16_t txt_len;
+} mdns_cache_record_t;
+
 typedef struct mdns_server_s {
     struct {
         mdns_pcb_t pcbs[MDNS_IP_PROTOCOL_MAX];
@@ -412,12 +467,21 @@ typedef struct mdns_server_s {
     const char *hostname;
     const char *instance;
     mdns_srv_item_t *services;
+    mdns_srv_item_t *services_index[MDNS_INDEX_BUCKETS];   // services hashed by service type and proto
     QueueHandle_t action_queue;
     SemaphoreHandle_t action_sema;
-    mdns_tx_packet_t *tx_queue_head;
+    mdns_tx_packet_t **tx_heap;             // min-heap of scheduled packets ordered by send_at
+    uint16_t tx_heap_len;
+    uint16_t tx_heap_size;
+    uint32_t tx_seq;
+    mdns_tx_packet_t *tx_due;               // packets due for sending, handed over to the service task
+    bool tx_handle_pending;
+    mdns_tx_stats_t tx_stats;
     mdns_search_once_t *search_once;
     esp_timer_handle_t timer_handle;
     mdns_browse_t *browse;
+    mdns_cache_record_t *cache;             // records received from other hosts
+    uint16_t cache_len;
 } mdns_server_t;
 
 typedef struct {
@@ -5,8 +5,11 @@ import re
 import socket
 import sys
 
+import dns.flags
 import dns.message
+import dns.name
 import dns.query
+import dns.rdata
 import dns.rdataclass
 import dns.rdatatype
 import dns.resolver
@@ -70,6 +73,28 @@ class DnsPythonWrapper:
 
         return response
 
+    def run_query_with_known_answer(self, name, query_type, known_answer, ttl, timeout=3):
+        logger.info(f'Running DNS query for {name} with type {query_type}, known answer {known_answer} (TTL {ttl})')
+        query = dns.message.make_query(name, dns.rdatatype.from_text(query_type), dns.rdataclass.IN)
+        # Known answers are carried in the answer section of the query (RFC 6762 Section 7.1)
+        rdtype = dns.rdatatype.from_text(query_type)
+        rrset = query.find_rrset(query.answer, dns.name.from_text(name), dns.rdataclass.IN, rdtype, create=True)
+        rrset.add(dns.rdata.from_text(dns.rdataclass.IN, rdtype, known_answer), ttl)
+        response = self.send_and_receive_query(query, timeout)
+        if response:
+            logger.info(f'DNS query response:\n{response}')
+        return response
+
+    def send_announcement(self, name, query_type, rdata, ttl):
+        logger.info(f'Announcing {name} {query_type} {rdata} (TTL {ttl})')
+        response = dns.message.Message()
+        response.flags = dns.flags.QR | dns.flags.AA
+        rdtype = dns.rdatatype.from_text(query_type)
+        rrset = response.find_rrset(response.answer, dns.name.from_text(name), dns.rdataclass.IN, rdtype, create=True)
+        rrset.add(dns.rdata.from_text(dns.rdataclass.IN, rdtype, rdata), ttl)
+        with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
+            sock.sendto(response.to_wire(), (self.server, self.port))
+
     def parse_answer_section(self, response, query_type):
         answers = []
         if response:
@@ -96,6 +121,15 @@ class DnsPythonWrapper:
         else:
             assert not any(expect in answer for answer in answers), f"Unexpected record '{expect}' found in answer section"
 
+    def check_known_answer(self, name, query_type, known_answer, ttl, expected=True):
+        output = self.run_query_with_known_answer(name, query_type, known_answer, ttl)
+        answers = self.parse_answer_section(output, query_type)
+        logger.info(f'answers: {answers}')
+        if expected:
+            assert any(known_answer in answer for answer in answers), f"Expected record '{known_answer}' not found in answer section"
+        else:
+            assert not any(known_answer in answer for answer in answers), f"Known answer '{known_answer}' was not suppressed"
+
 
 if __name__ == '__main__':
     if len(sys.argv) < 3:
@@ -10,6 +10,9 @@
 #include "esp_console.h"
 #include "mdns.h"
 #include "mdns_console.h"
+#ifdef CONFIG_TEST_BENCHMARK
+#include "mdns_bench.h"
+#endif
 
 static const char *TAG = "mdns-test";
 
@@ -24,7 +27,7 @@ static int exit_console(int argc, char **argv)
     return 0;
 }
 
-#else
+#elif !defined(CONFIG_TEST_BENCHMARK)
 static void query_mdns_host(const char *host_name)
 {
     ESP_LOGI(TAG, "Query A: %s.local", host_name);
@@ -44,7 +47,7 @@ static void query_mdns_host(const char *host_name)
 
     ESP_LOGI(TAG, "Query A: %s.local resolved to: " IPSTR, host_name, IP2STR(&addr));
 }
-#endif // TEST_CONSOLE
+#endif // TEST_CONSOLE / TEST_BENCHMARK
 
 #ifndef CONFIG_IDF_TARGET_LINUX
 #include "protocol_examples_common.h"
@@ -116,6 +119,9 @@ static void mdns_test_app(esp_netif_t *interface)
     ESP_ERROR_CHECK(esp_console_start_repl(repl));
     xEventGroupWaitBits(s_exit_signal, 1, pdTRUE, pdFALSE, portMAX_DELAY);
     repl->del(repl);
+#elif defined(CONFIG_TEST_BENCHMARK)
+    vTaskDelay(pdMS_TO_TICKS(3000));
+    mdns_bench_run();
 #else
     vTaskDelay(pdMS_TO_TICKS(10000));
     query_mdns_host("david-work");
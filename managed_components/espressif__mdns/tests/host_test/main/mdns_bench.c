@@ -0,0 +1,277 @@
+/*
+ * SPDX-FileCopyrightText: 2024-2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "mdns.h"
+#include "mdns_bench.h"
+
+static const char *TAG = "mdns-bench";
+
+#define BENCH_QUERIES       (CONFIG_TEST_BENCHMARK_QUERIES)
+#define BENCH_PROBE_WAIT_MS 3000
+#define BENCH_FLOOD_PACKETS (CONFIG_TEST_BENCHMARK_FLOOD_PACKETS)
+#define BENCH_FLOOD_MARKER  0xBEEF
+#define BENCH_MARKER_WAIT_MS 10
+#define BENCH_FLOOD_TIMEOUT_US (10 * 1000 * 1000)
+
+static const size_t s_service_counts[] = { 1, 8, 32, 64, 128 };
+
+// Queries captured from other hosts, see tests/test_afl_fuzz_host/in
+static const uint8_t s_minif_query[] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0x07, 0x5f, 0x73, 0x65, 0x72, 0x76, 0x65, 0x72, 0x04, 0x5f, 0x73, 0x75,
+    0x62, 0x06, 0x5f, 0x66, 0x72, 0x69, 0x74, 0x7a, 0x04, 0x5f, 0x74, 0x63,
+    0x70, 0x05, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x00, 0x00, 0x0c, 0x00, 0x01,
+    0x00, 0x00, 0x29, 0x05, 0xa0, 0x00, 0x00, 0x11, 0x94, 0x00, 0x12, 0x00,
+    0x04, 0x00, 0x0e, 0x00, 0x3a, 0xac, 0xde, 0x48, 0x00, 0x11, 0x22, 0xdc,
+    0xa9, 0x04, 0x99, 0xf3, 0x82
+};
+
+static const uint8_t s_minif_ptr[] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x07, 0x5f, 0x74, 0x65, 0x6c, 0x6e, 0x65, 0x74, 0x04, 0x5f, 0x74, 0x63,
+    0x70, 0x05, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x00, 0x00, 0x0c, 0x00, 0x01
+};
+
+static const uint8_t s_minif_disc[] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x09, 0x5f, 0x73, 0x65, 0x72, 0x76, 0x69, 0x63, 0x65, 0x73, 0x07, 0x5f,
+    0x64, 0x6e, 0x73, 0x2d, 0x73, 0x64, 0x04, 0x5f, 0x75, 0x64, 0x70, 0x05,
+    0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x00, 0x00, 0x0c, 0x00, 0x01, 0x07, 0x5f,
+    0x74, 0x65, 0x6c, 0x6e, 0x65, 0x74, 0x04, 0x5f, 0x74, 0x63, 0x70, 0xc0,
+    0x23, 0x00, 0x0c, 0x00, 0x01
+};
+
+static const uint8_t s_minif_any[] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00,
+    0x09, 0x6d, 0x69, 0x6e, 0x69, 0x66, 0x72, 0x69, 0x74, 0x7a, 0x07, 0x5f,
+    0x74, 0x65, 0x6c, 0x6e, 0x65, 0x74, 0x04, 0x5f, 0x74, 0x63, 0x70, 0x05,
+    0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x00, 0x00, 0xff, 0x80, 0x01, 0x09, 0x6d,
+    0x69, 0x6e, 0x69, 0x66, 0x72, 0x69, 0x74, 0x7a, 0x05, 0x6c, 0x6f, 0x63,
+    0x61, 0x6c, 0x00, 0x00, 0xff, 0x80, 0x01, 0xc0, 0x2e, 0x00, 0xff, 0x80,
+    0x01, 0xc0, 0x0c, 0x00, 0x21, 0x00, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00,
+    0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0xc0, 0x2e, 0xc0, 0x2e, 0x00,
+    0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x04, 0xc0, 0xa8, 0x0a,
+    0x6a
+};
+
+static const struct {
+    const uint8_t *data;
+    size_t len;
+} s_captured_queries[] = {
+    { s_minif_query, sizeof(s_minif_query) },
+    { s_minif_ptr, sizeof(s_minif_ptr) },
+    { s_minif_disc, sizeof(s_minif_disc) },
+    { s_minif_any, sizeof(s_minif_any) },
+};
+
+/**
+ * @brief Appends one DNS label to the query buffer
+ */
+static size_t append_label(uint8_t *buf, size_t index, const char *label)
+{
+    size_t len = strlen(label);
+    buf[index++] = (uint8_t)len;
+    memcpy(&buf[index], label, len);
+    return index + len;
+}
+
+/**
+ * @brief Builds a one-shot (legacy unicast) SRV question for <instance>.<service>.<proto>.local
+ */
+static size_t build_srv_query(uint8_t *buf, uint16_t id, const char *instance, const char *service, const char *proto)
+{
+    memset(buf, 0, 12);
+    buf[0] = id >> 8;
+    buf[1] = id & 0xFF;
+    buf[5] = 1;     // QDCOUNT
+    size_t index = append_label(buf, 12, instance);
+    index = append_label(buf, index, service);
+    index = append_label(buf, index, proto);
+    index = append_label(buf, index, "local");
+    buf[index++] = 0;
+    buf[index++] = 0;
+    buf[index++] = 33;  // SRV
+    buf[index++] = 0;
+    buf[index++] = 1;   // IN
+    return index;
+}
+
+static void register_services(size_t from, size_t to)
+{
+    char instance[32], service[32];
+    for (size_t i = from; i < to; ++i) {
+        snprintf(instance, sizeof(instance), "bench-%u", (unsigned)i);
+        snprintf(service, sizeof(service), "_bench%u", (unsigned)i);
+        ESP_ERROR_CHECK(mdns_service_add(instance, service, "_tcp", 1000 + i, NULL, 0));
+    }
+}
+
+/**
+ * @brief Measures question-to-answer time of SRV queries to the first registered service,
+ * which is the last one in the responder's service list
+ */
+static void run_queries(int sock, size_t services)
+{
+    struct sockaddr_in dst = { .sin_family = AF_INET, .sin_port = htons(5353) };
+    inet_pton(AF_INET, "224.0.0.251", &dst.sin_addr);
+    uint8_t query[128];
+    uint8_t answer[1500];
+    int64_t min_us = INT64_MAX, max_us = 0, total_us = 0;
+    int answered = 0;
+
+    for (int i = 0; i < BENCH_QUERIES; ++i) {
+        size_t len = build_srv_query(query, (uint16_t)(i + 1), "bench-0", "_bench0", "_tcp");
+        int64_t start = esp_timer_get_time();
+        if (sendto(sock, query, len, 0, (struct sockaddr *)&dst, sizeof(dst)) < 0) {
+            ESP_LOGE(TAG, "Failed to send the query");
+            return;
+        }
+        if (recv(sock, answer, sizeof(answer), 0) < 12) {
+            continue;   // timeout
+        }
+        int64_t elapsed = esp_timer_get_time() - start;
+        min_us = elapsed < min_us ? elapsed : min_us;
+        max_us = elapsed > max_us ? elapsed : max_us;
+        total_us += elapsed;
+        answered++;
+    }
+    if (!answered) {
+        ESP_LOGE(TAG, "services=%u: no answers received", (unsigned)services);
+        return;
+    }
+    // machine readable line for collecting results
+    printf("BENCH services=%u queries=%d answered=%d min_us=%lld avg_us=%lld max_us=%lld\n",
+           (unsigned)services, BENCH_QUERIES, answered, (long long)min_us, (long long)(total_us / answered), (long long)max_us);
+}
+
+/**
+ * @brief Sums the drop counters of all UDP sockets bound to the mDNS port
+ */
+static unsigned long read_socket_drops(void)
+{
+    static const char *const tables[] = { "/proc/net/udp", "/proc/net/udp6" };
+    unsigned long drops = 0;
+    char line[256];
+    for (size_t i = 0; i < sizeof(tables) / sizeof(tables[0]); ++i) {
+        FILE *f = fopen(tables[i], "r");
+        if (!f) {
+            continue;
+        }
+        while (fgets(line, sizeof(line), f)) {
+            // "sl local_address rem_address st ... drops", the address is printed as "<hex addr>:<hex port>"
+            char *port = strchr(line, ':') ? strchr(strchr(line, ':') + 1, ':') : NULL;
+            char *last = strrchr(line, ' ');
+            if (port && last && strtoul(port + 1, NULL, 16) == 5353) {
+                drops += strtoul(last + 1, NULL, 10);
+            }
+        }
+        fclose(f);
+    }
+    return drops;
+}
+
+/**
+ * @brief Floods the responder with captured queries and measures how fast they are received and parsed
+ *
+ * The mDNS task handles received packets in order, so the answer to a query sent after the flood
+ * marks the point where all preceding packets were processed (or dropped). Packets dropped by the
+ * kernel because the receive queue was full are reported separately.
+ */
+static void run_flood(int sock)
+{
+    struct sockaddr_in dst = { .sin_family = AF_INET, .sin_port = htons(5353) };
+    inet_pton(AF_INET, "224.0.0.251", &dst.sin_addr);
+    uint8_t marker[128];
+    uint8_t answer[1500];
+    struct timeval timeout = { .tv_usec = BENCH_MARKER_WAIT_MS * 1000 };
+    struct timeval restore = { .tv_sec = 1 };
+    size_t marker_len = build_srv_query(marker, BENCH_FLOOD_MARKER, "bench-0", "_bench0", "_tcp");
+    size_t captured = sizeof(s_captured_queries) / sizeof(s_captured_queries[0]);
+    unsigned long drops = read_socket_drops();
+    int retries = 0;
+
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < BENCH_FLOOD_PACKETS; ++i) {
+        sendto(sock, s_captured_queries[i % captured].data, s_captured_queries[i % captured].len, 0,
+               (struct sockaddr *)&dst, sizeof(dst));
+    }
+    sendto(sock, marker, marker_len, 0, (struct sockaddr *)&dst, sizeof(dst));
+    for (;;) {
+        int len = recv(sock, answer, sizeof(answer), 0);
+        if (len >= 12 && answer[0] == (BENCH_FLOOD_MARKER >> 8) && answer[1] == (BENCH_FLOOD_MARKER & 0xFF)) {
+            break;
+        }
+        if (len < 0) {
+            // still processing, or the marker was dropped as well; the queue is drained once a copy is answered
+            if (esp_timer_get_time() - start > BENCH_FLOOD_TIMEOUT_US) {
+                ESP_LOGE(TAG, "flood: no answer to the marker query");
+                setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &restore, sizeof(restore));
+                return;
+            }
+            sendto(sock, marker, marker_len, 0, (struct sockaddr *)&dst, sizeof(dst));
+            retries++;
+        }
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &restore, sizeof(restore));
+    // machine readable line for collecting results
+    printf("FLOOD packets=%d elapsed_us=%lld pkts_per_s=%lld socket_drops=%lu marker_retries=%d\n",
+           BENCH_FLOOD_PACKETS, (long long)elapsed, (long long)BENCH_FLOOD_PACKETS * 1000000 / (elapsed ? elapsed : 1),
+           read_socket_drops() - drops, retries);
+}
+
+static void print_pool_stats(void)
+{
+    mdns_pool_stats_t stats;
+    for (int pool = 0; pool < MDNS_POOL_MAX; ++pool) {
+        if (mdns_pool_stats_get(pool, &stats) != ESP_OK) {
+            return;
+        }
+        printf("POOL id=%d size=%" PRIu32 " used=%" PRIu32 " high_water=%" PRIu32 " heap_fallbacks=%" PRIu32 "\n",
+               pool, stats.size, stats.used, stats.high_water, stats.heap_fallbacks);
+    }
+}
+
+void mdns_bench_run(void)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Failed to create socket");
+        return;
+    }
+    struct timeval timeout = { .tv_sec = 1 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    size_t registered = 0;
+    for (size_t i = 0; i < sizeof(s_service_counts) / sizeof(s_service_counts[0]); ++i) {
+        size_t count = s_service_counts[i];
+        if (count > CONFIG_MDNS_MAX_SERVICES) {
+            ESP_LOGW(TAG, "Skipping %u services, CONFIG_MDNS_MAX_SERVICES=%d", (unsigned)count, CONFIG_MDNS_MAX_SERVICES);
+            break;
+        }
+        register_services(registered, count);
+        registered = count;
+        // wait until the new services are probed and announced
+        vTaskDelay(pdMS_TO_TICKS(BENCH_PROBE_WAIT_MS));
+        run_queries(sock, count);
+    }
+    run_flood(sock);
+    close(sock);
+    mdns_service_remove_all();
+    print_pool_stats();
+}
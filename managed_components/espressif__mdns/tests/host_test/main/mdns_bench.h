@@ -0,0 +1,11 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#pragma once
+
+/**
+ * @brief Runs the responder benchmarks and prints one "BENCH ..." line per measured configuration
+ */
+void mdns_bench_run(void);
@@ -1,7 +1,11 @@
 # SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
 # SPDX-License-Identifier: Unlicense OR CC0-1.0
 import logging
+import time
 
+import dns.flags
+import dns.message
+import dns.rdatatype
 import pexpect
 import pytest
 from dnsfixture import DnsPythonWrapper
@@ -65,6 +69,31 @@ def test_add_service(mdns_console, dig_app):
     dig_app.check_record('_http._tcp.local', query_type='PTR', expected=True)
 
 
+def test_known_answer_suppression(mdns_console, dig_app):
+    # known answer with more than half of the PTR TTL (4500s) suppresses our answer
+    dig_app.check_known_answer('_http._tcp.local', 'PTR', 'test_service._http._tcp.local.', ttl=4500, expected=False)
+    # known answer about to expire does not
+    dig_app.check_known_answer('_http._tcp.local', 'PTR', 'test_service._http._tcp.local.', ttl=1000, expected=True)
+
+
+def test_truncated_query(mdns_console, dig_app):
+    # answers to a query with the TC bit wait 400-500ms for the rest of the known answers
+    query = dns.message.make_query('_http._tcp.local', dns.rdatatype.PTR)
+    query.flags |= dns.flags.TC
+    start = time.monotonic()
+    response = dig_app.send_and_receive_query(query)
+    assert response is not None
+    assert time.monotonic() - start >= 0.4
+    assert any('test_service' in answer for answer in dig_app.parse_answer_section(response, 'PTR'))
+
+
+def test_record_cache(mdns_console, dig_app):
+    # records announced by other hosts are cached and answer queries without going to the network
+    dig_app.send_announcement('cached-peer.local', 'A', '1.2.3.5', ttl=120)
+    mdns_console.send_input('mdns_query_a cached-peer -t 1000')
+    mdns_console.get_output('1.2.3.5')
+
+
 def test_remove_service(mdns_console, dig_app):
     mdns_console.send_input('mdns_service_remove _http _tcp')
     mdns_console.send_input('mdns_service_lookup _http _tcp')
@@ -0,0 +1,98 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp32_mock.h"
+#include "mdns.h"
+#include "mdns_private.h"
+
+//
+// Packet construction benchmark: builds the announce packet(s) of 1, 10 and 50 services
+// and prints one machine readable "BENCH" line per service count
+//
+#define BENCH_ITERATIONS    2000
+
+void mdns_test_execute_action(void *action);
+void mdns_test_init_di(void);
+mdns_tx_packet_t *mdns_test_create_announce_packet(mdns_srv_item_t *services[], size_t len);
+void mdns_test_dispatch_tx_packet(mdns_tx_packet_t *packet);
+void mdns_test_free_tx_packet(mdns_tx_packet_t *packet);
+extern mdns_server_t *_mdns_server;
+
+static const size_t s_service_counts[] = { 1, 10, 50 };
+
+static void execute_last_action(void)
+{
+    mdns_action_t *a = NULL;
+    GetLastItem(&a);
+    mdns_test_execute_action(a);
+}
+
+static void add_service(size_t i)
+{
+    char instance[32], service[32], txt_value[16];
+    snprintf(instance, sizeof(instance), "bench instance %u", (unsigned)i);
+    snprintf(service, sizeof(service), "_bench%u", (unsigned)i);
+    snprintf(txt_value, sizeof(txt_value), "%u", (unsigned)i);
+    mdns_txt_item_t txt[] = { {"board", "esp32"}, {"id", txt_value} };
+    if (mdns_service_add(instance, service, "_tcp", 1000 + i, txt, 2)) {
+        printf("add failed %u\n", (unsigned)i);
+        abort();
+    }
+}
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+    mdns_test_init_di();
+    if (mdns_init()) {
+        abort();
+    }
+    for (int i = 0; i < MDNS_MAX_INTERFACES; i++) {
+        _mdns_server->interfaces[i].pcbs[MDNS_IP_PROTOCOL_V4].state = PCB_RUNNING;
+        _mdns_server->interfaces[i].pcbs[MDNS_IP_PROTOCOL_V6].state = PCB_RUNNING;
+    }
+    if (mdns_hostname_set("benchhost")) {
+        abort();
+    }
+    execute_last_action();
+
+    size_t registered = 0;
+    for (size_t c = 0; c < sizeof(s_service_counts) / sizeof(s_service_counts[0]); c++) {
+        size_t count = s_service_counts[c];
+        while (registered < count) {
+            add_service(registered++);
+        }
+        mdns_srv_item_t *services[count];
+        size_t len = 0;
+        for (mdns_srv_item_t *s = _mdns_server->services; s && len < count; s = s->next) {
+            services[len++] = s;
+        }
+        mdns_tx_packet_t *packet = mdns_test_create_announce_packet(services, len);
+        if (!packet) {
+            abort();
+        }
+        int64_t start = now_ns();
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            mdns_test_dispatch_tx_packet(packet);
+        }
+        int64_t elapsed = now_ns() - start;
+        mdns_test_free_tx_packet(packet);
+        printf("BENCH services=%u iterations=%d build_ns=%lld\n", (unsigned)count, BENCH_ITERATIONS,
+               (long long)(elapsed / BENCH_ITERATIONS));
+    }
+    return 0;
+}
@@ -14,6 +14,7 @@
 void     *g_queue;
 int       g_queue_send_shall_fail = 0;
 int       g_size = 0;
+size_t    g_mdns_mem_allocs = 0;
 
 const char *WIFI_EVENT = "wifi_event";
 const char *ETH_EVENT = "eth_event";
@@ -91,6 +92,8 @@ uint32_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksTo
 void GetLastItem(void *pvBuffer)
 {
     memcpy(pvBuffer, g_queue, g_size);
+    // the item is consumed, API calls which do not post an action leave the queue empty
+    memset(g_queue, 0, g_size);
 }
 
 void ForceTaskDelete(void)
@@ -128,11 +131,13 @@ uint32_t esp_log_timestamp(void)
 
 void *mdns_mem_malloc(size_t size)
 {
+    g_mdns_mem_allocs++;
     return malloc(size);
 }
 
 void *mdns_mem_calloc(size_t num, size_t size)
 {
+    g_mdns_mem_allocs++;
     return calloc(num, size);
 }
 
@@ -143,16 +148,19 @@ void mdns_mem_free(void *ptr)
 
 char *mdns_mem_strdup(const char *s)
 {
+    g_mdns_mem_allocs++;
     return strdup(s);
 }
 
 char *mdns_mem_strndup(const char *s, size_t n)
 {
+    g_mdns_mem_allocs++;
     return strndup(s, n);
 }
 
 void *mdns_mem_task_malloc(size_t size)
 {
+    g_mdns_mem_allocs++;
     return malloc(size);
 }
 
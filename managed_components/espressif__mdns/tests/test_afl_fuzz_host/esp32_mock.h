@@ -66,7 +66,7 @@
 #define vSemaphoreDelete(s)         free(s)
 #define queueQUEUE_TYPE_MUTEX       ( ( uint8_t ) 1U
 #define xTaskCreatePinnedToCore(a,b,c,d,e,f,g)     *(f) = malloc(1)
-#define xTaskCreateStaticPinnedToCore(a,b,c,d,e,f,g,h)     true
+#define xTaskCreateStaticPinnedToCore(a,b,c,d,e,f,g,h)     malloc(1)
 #define vTaskDelay(m)               usleep((m)*0)
 #define esp_random()                (rand()%UINT32_MAX)
 
@@ -130,6 +130,9 @@ void GetLastItem(void *pvBuffer);
 
 void ForceTaskDelete(void);
 
+// Number of allocations made through mdns_mem_*() functions
+extern size_t g_mdns_mem_allocs;
+
 esp_err_t esp_event_handler_register(const char *event_base, int32_t event_id, void *event_handler, void *event_handler_arg);
 
 esp_err_t esp_event_handler_unregister(const char *event_base, int32_t event_id, void *event_handler);
@@ -18,6 +18,10 @@ mdns_search_once_t *(*mdns_test_static_search_init)(const char *name, const char
         mdns_query_notify_t notifier) = NULL;
 esp_err_t         (*mdns_test_static_send_search_action)(mdns_action_type_t type, mdns_search_once_t *search) = NULL;
 void              (*mdns_test_static_search_free)(mdns_search_once_t *search) = NULL;
+mdns_tx_packet_t *(*mdns_test_static_create_announce_packet)(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol, mdns_srv_item_t *services[], size_t len, bool include_ip) = NULL;
+void              (*mdns_test_static_dispatch_tx_packet)(mdns_tx_packet_t *p) = NULL;
+void              (*mdns_test_static_free_tx_packet)(mdns_tx_packet_t *packet) = NULL;
+void              (*mdns_test_static_unschedule_tx_packet)(mdns_tx_packet_t *packet) = NULL;
 
 static void _mdns_execute_action(mdns_action_t *action);
 static mdns_srv_item_t *_mdns_get_service_item(const char *service, const char *proto, const char *hostname);
@@ -25,6 +29,11 @@ static mdns_search_once_t *_mdns_search_init(const char *name, const char *servi
         uint32_t timeout, uint8_t max_results, mdns_query_notify_t notifier);
 static esp_err_t _mdns_send_search_action(mdns_action_type_t type, mdns_search_once_t *search);
 static void _mdns_search_free(mdns_search_once_t *search);
+static mdns_tx_packet_t *_mdns_create_announce_packet(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol, mdns_srv_item_t *services[], size_t len, bool include_ip);
+static void _mdns_dispatch_tx_packet(mdns_tx_packet_t *p);
+static void _mdns_free_tx_packet(mdns_tx_packet_t *packet);
+static void _mdns_unschedule_tx_packet(mdns_tx_packet_t *packet);
+extern mdns_server_t *_mdns_server;
 
 void mdns_test_init_di(void)
 {
@@ -33,11 +42,17 @@ void mdns_test_init_di(void)
     mdns_test_static_search_init = _mdns_search_init;
     mdns_test_static_send_search_action = _mdns_send_search_action;
     mdns_test_static_search_free = _mdns_search_free;
+    mdns_test_static_create_announce_packet = _mdns_create_announce_packet;
+    mdns_test_static_dispatch_tx_packet = _mdns_dispatch_tx_packet;
+    mdns_test_static_free_tx_packet = _mdns_free_tx_packet;
+    mdns_test_static_unschedule_tx_packet = _mdns_unschedule_tx_packet;
 }
 
 void mdns_test_execute_action(void *action)
 {
-    mdns_test_static_execute_action((mdns_action_t *)action);
+    if (action) {
+        mdns_test_static_execute_action((mdns_action_t *)action);
+    }
 }
 
 void mdns_test_search_free(mdns_search_once_t *search)
@@ -59,3 +74,29 @@ mdns_srv_item_t *mdns_test_mdns_get_service_item(const char *service, const char
 {
     return mdns_test_static_mdns_get_service_item(service, proto, NULL);
 }
+
+mdns_tx_packet_t *mdns_test_create_announce_packet(mdns_srv_item_t *services[], size_t len)
+{
+    return mdns_test_static_create_announce_packet(0, MDNS_IP_PROTOCOL_V4, services, len, true);
+}
+
+void mdns_test_dispatch_tx_packet(mdns_tx_packet_t *packet)
+{
+    mdns_test_static_dispatch_tx_packet(packet);
+}
+
+void mdns_test_free_tx_packet(mdns_tx_packet_t *packet)
+{
+    mdns_test_static_free_tx_packet(packet);
+}
+
+// Builds and sends all scheduled packets right away
+void mdns_test_flush_tx_packets(void)
+{
+    while (_mdns_server->tx_heap_len || _mdns_server->tx_due) {
+        mdns_tx_packet_t *packet = _mdns_server->tx_heap_len ? _mdns_server->tx_heap[0] : _mdns_server->tx_due;
+        mdns_test_static_unschedule_tx_packet(packet);
+        mdns_test_static_dispatch_tx_packet(packet);
+        mdns_test_static_free_tx_packet(packet);
+    }
+}
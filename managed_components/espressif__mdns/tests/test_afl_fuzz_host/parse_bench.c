@@ -0,0 +1,235 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <glob.h>
+
+#include "esp32_mock.h"
+#include "mdns.h"
+#include "mdns_private.h"
+#include "mdns_mem_caps.h"
+
+//
+// Packet processing benchmark: passes recorded packets (the AFL input corpus by default) through
+// mdns_parse_packet() and sends the answers it schedules. Prints one machine readable "PARSE" line
+// per packet and one with the totals.
+//
+#define BENCH_DEFAULT_ITERATIONS    1000
+#define BENCH_DEFAULT_CORPUS        "in/*.bin"
+
+void mdns_test_execute_action(void *action);
+void mdns_test_init_di(void);
+mdns_srv_item_t *mdns_test_mdns_get_service_item(const char *service, const char *proto);
+void mdns_test_flush_tx_packets(void);
+void mdns_parse_packet(mdns_rx_packet_t *packet);
+extern mdns_server_t *_mdns_server;
+
+typedef struct {
+    const char *name;
+    uint8_t data[MDNS_MAX_PACKET_SIZE];
+    size_t len;
+    int64_t *samples;       // processing time of each iteration
+    size_t allocs;
+} bench_packet_t;
+
+static const char *s_services[] = {
+    "_fritz", "_telnet", "_workstation", "_arduino", "_http", "_afpovertcp", "_rfb", "_smb", "_adisk", "_airport",
+    "_printer", "_airplay", "_raop", "_uscan", "_uscans", "_ippusb", "_scanner", "_ipp", "_ipps", "_pdl-datastream", "_ptp",
+};
+
+static void execute_last_action(void)
+{
+    mdns_action_t *a = NULL;
+    GetLastItem(&a);
+    mdns_test_execute_action(a);
+}
+
+/**
+ * @brief Marks all PCBs as running, finishing any probe which a conflicting record of the corpus started
+ */
+static void mark_pcbs_running(void)
+{
+    for (int i = 0; i < MDNS_MAX_INTERFACES; i++) {
+        for (int j = 0; j < MDNS_IP_PROTOCOL_MAX; j++) {
+            mdns_pcb_t *pcb = &_mdns_server->interfaces[i].pcbs[j];
+            mdns_mem_free(pcb->probe_services);
+            pcb->probe_services = NULL;
+            pcb->probe_services_len = 0;
+            pcb->probe_running = false;
+            pcb->probe_ip = false;
+            pcb->failed_probes = 0;
+            pcb->state = PCB_RUNNING;
+        }
+    }
+}
+
+/**
+ * @brief Registers the same host, services and TXT records as the fuzzer test, so that the corpus is answered
+ */
+static void setup_responder(void)
+{
+    mdns_txt_item_t txt[] = { {"board", "esp32"}, {"tcp_check", "no"}, {"ssh_upload", "no"}, {"auth_upload", "no"} };
+    mdns_ip_addr_t addr = { .addr = { .type = ESP_IPADDR_TYPE_V4 } };
+    addr.addr.u_addr.ip4.addr = 0x11111111;
+
+    mark_pcbs_running();
+    if (mdns_hostname_set("minifritz")) {
+        abort();
+    }
+    execute_last_action();
+    if (mdns_delegate_hostname_add("megafritz", &addr)) {
+        abort();
+    }
+    execute_last_action();
+    for (size_t i = 0; i < sizeof(s_services) / sizeof(s_services[0]); i++) {
+        // fails as the service task is not running, the action is executed below
+        mdns_service_add(NULL, s_services[i], "_tcp", 22 + i, NULL, 0);
+        execute_last_action();
+        if (!mdns_test_mdns_get_service_item(s_services[i], "_tcp")) {
+            abort();
+        }
+    }
+    mdns_service_instance_name_set("_http", "_tcp", "ESP WebServer");
+    execute_last_action();
+    mdns_service_instance_name_set("_airport", "_tcp", "Hristo's Time Capsule");
+    execute_last_action();
+    mdns_service_txt_set("_arduino", "_tcp", txt, 4);
+    execute_last_action();
+    mdns_service_subtype_add_for_host(NULL, "_fritz", "_tcp", NULL, "_server");
+    execute_last_action();
+    mdns_test_flush_tx_packets();
+}
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int compare_samples(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int64_t percentile(int64_t *sorted, size_t count, unsigned pct)
+{
+    return sorted[(count - 1) * pct / 100];
+}
+
+/**
+ * @brief Processes one received packet: parses it and builds and sends all answers it scheduled
+ */
+static void process_packet(bench_packet_t *p)
+{
+    struct pbuf pb = { .payload = p->data, .tot_len = p->len, .len = p->len };
+    mdns_rx_packet_t packet = {
+        .tcpip_if = 0, .ip_protocol = MDNS_IP_PROTOCOL_V4, .pb = &pb, .src_port = 5353, .multicast = 1,
+        .src = { .type = ESP_IPADDR_TYPE_V4, .u_addr.ip4.addr = 0x0a01a8c0 },
+    };
+    mdns_parse_packet(&packet);
+    mdns_test_flush_tx_packets();
+    mark_pcbs_running();
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = BENCH_DEFAULT_ITERATIONS;
+    glob_t corpus = { 0 };
+    int arg = 1;
+
+    if (argc > 2 && !strcmp(argv[1], "-i")) {
+        iterations = atoi(argv[2]);
+        arg = 3;
+    }
+    if (iterations <= 0) {
+        printf("Usage: %s [-i iterations] [packet.bin ...]\n", argv[0]);
+        return 1;
+    }
+    if (arg < argc) {
+        for (int i = arg; i < argc; i++) {
+            glob(argv[i], GLOB_NOCHECK | (i > arg ? GLOB_APPEND : 0), NULL, &corpus);
+        }
+    } else if (glob(BENCH_DEFAULT_CORPUS, 0, NULL, &corpus)) {
+        printf("No packets found in %s\n", BENCH_DEFAULT_CORPUS);
+        return 1;
+    }
+
+    size_t count = corpus.gl_pathc;
+    bench_packet_t *packets = calloc(count, sizeof(bench_packet_t));
+    if (!packets) {
+        abort();
+    }
+    for (size_t i = 0; i < count; i++) {
+        FILE *file = fopen(corpus.gl_pathv[i], "r");
+        if (!file) {
+            printf("Failed to open %s\n", corpus.gl_pathv[i]);
+            return 1;
+        }
+        packets[i].name = corpus.gl_pathv[i];
+        packets[i].len = fread(packets[i].data, 1, sizeof(packets[i].data), file);
+        packets[i].samples = malloc(iterations * sizeof(int64_t));
+        fclose(file);
+        if (!packets[i].samples) {
+            abort();
+        }
+    }
+
+    mdns_test_init_di();
+    if (mdns_init()) {
+        abort();
+    }
+    setup_responder();
+
+    // warm up, the record cache and name tables reach their steady state
+    for (size_t i = 0; i < count; i++) {
+        process_packet(&packets[i]);
+    }
+    size_t allocs_before = g_mdns_mem_allocs;
+    int64_t start = now_ns();
+    for (int it = 0; it < iterations; it++) {
+        for (size_t i = 0; i < count; i++) {
+            size_t allocs = g_mdns_mem_allocs;
+            int64_t t = now_ns();
+            process_packet(&packets[i]);
+            packets[i].samples[it] = now_ns() - t;
+            packets[i].allocs += g_mdns_mem_allocs - allocs;
+        }
+    }
+    int64_t elapsed = now_ns() - start;
+    size_t total_allocs = g_mdns_mem_allocs - allocs_before;
+
+    size_t total = count * iterations;
+    int64_t *all = malloc(total * sizeof(int64_t));
+    if (!all) {
+        abort();
+    }
+    for (size_t i = 0; i < count; i++) {
+        memcpy(&all[i * iterations], packets[i].samples, iterations * sizeof(int64_t));
+        qsort(packets[i].samples, iterations, sizeof(int64_t), compare_samples);
+        printf("PARSE packet=%s len=%u p50_ns=%lld p99_ns=%lld allocs_per_pkt=%.2f\n", packets[i].name, (unsigned)packets[i].len,
+               (long long)percentile(packets[i].samples, iterations, 50), (long long)percentile(packets[i].samples, iterations, 99),
+               (double)packets[i].allocs / iterations);
+        free(packets[i].samples);
+    }
+    qsort(all, total, sizeof(int64_t), compare_samples);
+    printf("PARSE packet=all packets=%u iterations=%d pkts_per_s=%lld p50_ns=%lld p99_ns=%lld allocs_per_pkt=%.2f\n",
+           (unsigned)count, iterations, (long long)(total * 1000000000LL / (elapsed ? elapsed : 1)),
+           (long long)percentile(all, total, 50), (long long)percentile(all, total, 99), (double)total_allocs / total);
+    free(all);
+    free(packets);
+    globfree(&corpus);
+
+    mdns_service_remove_all();
+    execute_last_action();
+    ForceTaskDelete();
+    mdns_free();
+    return 0;
+}
@@ -288,7 +288,8 @@
 #define CONFIG_MBEDTLS_ECP_DP_BP512R1_ENABLED 1
 #define CONFIG_MBEDTLS_ECP_DP_CURVE25519_ENABLED 1
 #define CONFIG_MBEDTLS_ECP_NIST_OPTIM 1
-#define CONFIG_MDNS_MAX_SERVICES 25
+#define CONFIG_MDNS_MAX_SERVICES 64
+#define CONFIG_MDNS_SERVICE_INDEX_BUCKETS 16
 #define CONFIG_MDNS_MAX_INTERFACES 3
 #define CONFIG_MDNS_TASK_PRIORITY 1
 #define CONFIG_MDNS_ACTION_QUEUE_LEN 16
@@ -297,6 +298,8 @@
 #define CONFIG_MDNS_TASK_AFFINITY 0x0
 #define CONFIG_MDNS_SERVICE_ADD_TIMEOUT_MS 1
 #define CONFIG_MDNS_TIMER_PERIOD_MS 100
+#define CONFIG_MDNS_RECORD_CACHE 1
+#define CONFIG_MDNS_RECORD_CACHE_SIZE 32
 #define CONFIG_MQTT_PROTOCOL_311 1
 #define CONFIG_MQTT_TRANSPORT_SSL 1
 #define CONFIG_MQTT_TRANSPORT_WEBSOCKET 1
@@ -49,6 +49,8 @@ TEST(mdns, api_fails_with_invalid_state)
     TEST_ASSERT_NOT_EQUAL(ESP_OK, mdns_hostname_set(MDNS_HOSTNAME));
     TEST_ASSERT_NOT_EQUAL(ESP_OK, mdns_instance_name_set(MDNS_INSTANCE));
     TEST_ASSERT_NOT_EQUAL(ESP_OK, mdns_service_add(MDNS_INSTANCE, MDNS_SERVICE_NAME, MDNS_SERVICE_PROTO, MDNS_SERVICE_PORT, NULL, 0));
+    mdns_tx_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, mdns_tx_stats_get(&stats, false));
 }
 
 TEST(mdns, init_deinit)
@@ -57,6 +59,18 @@ TEST(mdns, init_deinit)
     TEST_ASSERT_EQUAL(ESP_OK, esp_event_loop_create_default());
     TEST_ASSERT_EQUAL(ESP_OK, mdns_init());
     yield_to_all_priorities(); // Make sure that mdns task has executed to complete initialization
+    mdns_tx_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, mdns_tx_stats_get(NULL, false));
+    TEST_ASSERT_EQUAL(ESP_OK, mdns_tx_stats_get(&stats, true));
+    mdns_pool_stats_t pool_stats;
+#if CONFIG_MDNS_MEMORY_POOLS
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, mdns_pool_stats_get(MDNS_POOL_MAX, &pool_stats));
+    TEST_ASSERT_EQUAL(ESP_OK, mdns_pool_stats_get(MDNS_POOL_ACTION, &pool_stats));
+    TEST_ASSERT_EQUAL(CONFIG_MDNS_POOL_ACTIONS, pool_stats.size);
+    TEST_ASSERT_LESS_OR_EQUAL(pool_stats.size, pool_stats.high_water);
+#else
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, mdns_pool_stats_get(MDNS_POOL_ACTION, &pool_stats));
+#endif
     mdns_free();
     esp_event_loop_delete_default();
 }